@@ -10,9 +10,13 @@
 // Update uniforms for each frame.
 
 #include <algorithm>
+#include <atomic>
+#include <climits>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #if defined(WIN32) || defined(_WIN32)
 #include <windows.h>
 #endif
@@ -20,10 +24,15 @@
 #include "Aquarium.h"
 #include "ContextFactory.h"
 #include "FishModel.h"
+#include "FileSystem.h"
+#include "JobSystem.h"
 #include "Matrix.h"
+#include "MeshSimplifier.h"
+#include "ModelCache.h"
 #include "Program.h"
 #include "SeaweedModel.h"
 #include "Texture.h"
+#include "Timer.h"
 
 #include "AQUARIUM_ASSERT.h"
 #include "CmdArgsHelper.h"
@@ -35,6 +44,95 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 
+namespace
+{
+
+// World matrices start on cache lines, so that SIMD code can use aligned loads.
+constexpr size_t kWorldMatrixAlignment = 64;
+
+// Assets are few and each takes long to load, so every one is a job of its own.
+constexpr int kAssetGrainSize = 1;
+
+// A fish count change is compared to the mean of the frames before it, and its spike is the
+// longest of the frames from the change on.
+constexpr size_t kBaselineFrameCount = 16;
+constexpr int kSpikeFrameCount       = 4;
+
+}  // namespace
+
+size_t CStringHash::operator()(const char *string) const
+{
+    return static_cast<size_t>(hashBytes(string, strlen(string)));
+}
+
+bool CStringEqual::operator()(const char *a, const char *b) const
+{
+    return strcmp(a, b) == 0;
+}
+
+// A model on its way through the loading stages.
+struct ModelLoadTask
+{
+    const G_sceneInfo *info;
+    ModelData data;
+    Program *program;
+    bool useSkybox;
+    // Indices of the decimated meshes of a fish with --fish-lod, from level 1.
+    std::vector<unsigned short> lodIndices[FISH_LOD_COUNT - 1];
+};
+
+// Everything loadReource() loads, filled in stage by stage. The textures and programs are the
+// ones created by this load, each listed once however many models share it.
+struct AssetLoadPlan
+{
+    std::vector<std::unique_ptr<ModelLoadTask>> models;
+    std::vector<Texture *> textures;
+    // Programs with whether to compile them with alpha blending.
+    std::vector<std::pair<Program *, bool>> programs;
+};
+
+namespace {
+
+// Decimate the mesh of a fish into the meshes of its levels of detail. They index its vertices.
+void simplifyFishModel(ModelLoadTask *task)
+{
+    const ModelField *positions = nullptr;
+    const ModelField *texCoords = nullptr;
+    const ModelField *indices   = nullptr;
+    for (const auto &field : task->data.fields)
+    {
+        if (field.name == "position" && field.numComponents == 3)
+        {
+            positions = &field;
+        }
+        else if (field.name == "texCoord" && field.numComponents == 2)
+        {
+            texCoords = &field;
+        }
+        else if (field.name == "indices" && field.isIndex)
+        {
+            indices = &field;
+        }
+    }
+    if (positions == nullptr || indices == nullptr)
+    {
+        return;
+    }
+
+    MeshSimplifier simplifier(
+        static_cast<const float *>(positions->data),
+        texCoords != nullptr ? static_cast<const float *>(texCoords->data) : nullptr,
+        positions->count / 3, static_cast<const unsigned short *>(indices->data), indices->count);
+    for (int lod = 1; lod < FISH_LOD_COUNT; ++lod)
+    {
+        simplifier.simplify(
+            static_cast<int>(simplifier.getTriangleCount() * g_fishLodTriangleRatios[lod]),
+            &task->lodIndices[lod - 1]);
+    }
+}
+
+}  // namespace
+
 Aquarium::Aquarium()
     : mModelEnumMap(),
       mTextureMap(),
@@ -42,11 +140,23 @@ Aquarium::Aquarium()
       mAquariumModels(),
       mContext(nullptr),
       mFpsTimer(),
+      mDrawTime(0.0),
+      mFishTriangleCount(0),
+      mFishTriangleFrameCount(0),
       mCurFishCount(30000),
       mPreFishCount(0),
       mTestTime(INT_MAX),
+      mTestFrames(0),
+      mFixedTimeStep(0.0),
+      mWorkFishCount(0),
+      mFishPersHash(0),
+      mHashedFishCount(0),
+      mTextureCompression(TEXTURECOMPRESSIONNONE),
       mBackendType(BACKENDTYPE::BACKENDTYPED3D12),
-      mFactory(nullptr)
+      mFactory(nullptr),
+      mJobSystem(nullptr),
+      mPlacementArena(0),
+      mFrameCount(0)
 {
     g.then          = 0.0;
     g.mclock        = 0.0;
@@ -105,17 +215,8 @@ Aquarium::~Aquarium()
         delete mAquariumModels[i];
     }
 
-    if (toggleBitset.test(static_cast<size_t>(TOGGLE::SIMULATINGFISHCOMEANDGO)))
-    {
-        while (!mFishBehavior.empty())
-        {
-            Behavior *behave = mFishBehavior.front();
-            mFishBehavior.pop();
-            delete behave;
-        }
-    }
-
     delete mFactory;
+    delete mJobSystem;
 }
 
 BACKENDTYPE Aquarium::getBackendType(const std::string &backendPath)
@@ -154,6 +255,10 @@ BACKENDTYPE Aquarium::getBackendType(const std::string &backendPath)
         return BACKENDTYPED3D12;
 #endif
     }
+    else if (backendPath == "null")
+    {
+        return BACKENDTYPENULL;
+    }
 
     return BACKENDTYPELAST;
 }
@@ -207,6 +312,7 @@ bool Aquarium::init(int argc, char **argv)
     int windowWidth  = 0;
     int windowHeight = 0;
     int MSAACount = 4;
+    int workerThreadCount = -1;
 
     for (int i = 1; i < argc; ++i)
     {
@@ -226,16 +332,13 @@ bool Aquarium::init(int argc, char **argv)
         }
         else if (cmd == "--enable-instanced-draws")
         {
-            /*if (!availableToggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS)))
+            if (!availableToggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS)))
             {
-                std::cerr << "Instanced draw path isn't implemented for the backend." << std::endl;
+                std::cerr << "Instanced draw path is only implemented for d3d12 and null backend."
+                          << std::endl;
                 return false;
             }
             toggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS));
-            // Disable map write aync for instanced draw mode
-            toggleBitset.reset(static_cast<size_t>(TOGGLE::BUFFERMAPPINGASYNC));*/
-            std::cerr << "Instanced draw path is deprecated." << std::endl;
-            return false;
         }
         else if (cmd == "--disable-dynamic-buffer-offset")
         {
@@ -303,6 +406,67 @@ bool Aquarium::init(int argc, char **argv)
 
             toggleBitset.set(static_cast<size_t>(TOGGLE::TURNOFFVSYNC));
         }
+        else if (cmd == "--pack-fish-pers")
+        {
+            if (!availableToggleBitset.test(static_cast<size_t>(TOGGLE::PACKFISHPERS)))
+            {
+                std::cerr << "Packed fish data is only implemented for d3d12 and null backend."
+                          << std::endl;
+                return false;
+            }
+
+            toggleBitset.set(static_cast<size_t>(TOGGLE::PACKFISHPERS));
+        }
+        else if (cmd == "--cull-fish")
+        {
+            toggleBitset.set(static_cast<size_t>(TOGGLE::CULLFISH));
+        }
+        else if (cmd == "--fish-lod")
+        {
+            toggleBitset.set(static_cast<size_t>(TOGGLE::FISHLOD));
+        }
+        else if (cmd == "--record-commands")
+        {
+            if (!availableToggleBitset.test(static_cast<size_t>(TOGGLE::RECORDCOMMANDS)))
+            {
+                std::cerr << "Recorded commands are only implemented for d3d12 and null backend."
+                          << std::endl;
+                return false;
+            }
+
+            toggleBitset.set(static_cast<size_t>(TOGGLE::RECORDCOMMANDS));
+        }
+        else if (cmd == "--warm-up-time")
+        {
+            mFpsTimer.setWarmUpTime(strtod(argv[i++ + 1], &pNext));
+        }
+        else if (cmd == "--frame-time-csv")
+        {
+            mFrameTimeCsvPath = argv[i++ + 1];
+            mFpsTimer.enableTimeline();
+        }
+        else if (cmd == "--frames")
+        {
+            mTestFrames = strtol(argv[i++ + 1], &pNext, 10);
+            if (mTestFrames <= 0)
+            {
+                std::cerr << "Frame count should be larger than 0." << std::endl;
+                return false;
+            }
+        }
+        else if (cmd == "--fixed-dt")
+        {
+            mFixedTimeStep = strtod(argv[i++ + 1], &pNext);
+            if (mFixedTimeStep <= 0.0)
+            {
+                std::cerr << "Fixed time step should be larger than 0." << std::endl;
+                return false;
+            }
+        }
+        else if (cmd == "--hash-fish-pers")
+        {
+            toggleBitset.set(static_cast<size_t>(TOGGLE::HASHFISHPERS));
+        }
         else if (cmd == "--test-time")
         {
 
@@ -358,18 +522,45 @@ bool Aquarium::init(int argc, char **argv)
         }
         else if (cmd == "--simulating-fish-come-and-go")
         {
-            if (!availableToggleBitset.test(static_cast<size_t>(TOGGLE::SIMULATINGFISHCOMEANDGO)))
+            mScenarioPath = mContext->getResourceHelper()->getFishBehaviorPath();
+            toggleBitset.set(static_cast<size_t>(TOGGLE::PLAYSCENARIO));
+        }
+        else if (cmd == "--scenario")
+        {
+            mScenarioPath = argv[i++ + 1];
+            toggleBitset.set(static_cast<size_t>(TOGGLE::PLAYSCENARIO));
+        }
+        else if (cmd == "--disable-control-panel")
+        {
+            toggleBitset.set(static_cast<size_t>(TOGGLE::DISABLECONTROLPANEL));
+        }
+        else if (cmd == "--simd-level")
+        {
+            SIMDLEVEL level;
+            if (!parseSIMDLevel(argv[i++ + 1], &level) || level > getSupportedSIMDLevel())
             {
-                std::cerr << "Simulating fish come and go is only implemented for Dawn backend."
-                          << std::endl;
+                std::cerr << "SIMD level isn't supported, the highest supported level is "
+                          << getSIMDLevelName(getSupportedSIMDLevel()) << "." << std::endl;
                 return false;
             }
-
-            toggleBitset.set(static_cast<size_t>(TOGGLE::SIMULATINGFISHCOMEANDGO));
+            mFishSimulation.setSIMDLevel(level);
+            mFishCulling.setSIMDLevel(level);
         }
-        else if (cmd == "--disable-control-panel")
+        else if (cmd == "--legacy-random")
         {
-            toggleBitset.set(static_cast<size_t>(TOGGLE::DISABLECONTROLPANEL));
+            mFishSimulation.setLegacyRandom(true);
+        }
+        else if (cmd == "--texture-compression")
+        {
+            if (!parseTextureCompression(argv[i++ + 1], &mTextureCompression))
+            {
+                std::cerr << "Texture compression should be 'none' or 'bc'." << std::endl;
+                return false;
+            }
+        }
+        else if (cmd == "--worker-threads")
+        {
+            workerThreadCount = strtol(argv[i++ + 1], &pNext, 10);
         }
 
         //else if (cmd == "--enable-full-screen-mode")
@@ -386,28 +577,64 @@ bool Aquarium::init(int argc, char **argv)
         mContext->mMSAACount = MSAACount;
     }
 
+    // Only the last frame of a bounded run is hashed.
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::HASHFISHPERS)) && mTestFrames == 0)
+    {
+        std::cerr << "Hashing fish data requires --frames." << std::endl;
+        return false;
+    }
+
+    // The scenario settles what is baked into the render targets and pipelines before they are
+    // created.
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::PLAYSCENARIO)))
+    {
+        if (!mScenario.load(mScenarioPath))
+        {
+            return false;
+        }
+        if (mScenario.getMSAACount() > 0)
+        {
+            mContext->mMSAACount = mScenario.getMSAACount();
+        }
+        if (!mScenario.getAlphaBlending().empty())
+        {
+            g.alpha = mScenario.getAlphaBlending();
+            toggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEALPHABLENDING),
+                             g.alpha != "false");
+        }
+    }
+
+    // The null backend has no window to close, so it runs until one of the bounds ends it.
+    if (mBackendType == BACKENDTYPE::BACKENDTYPENULL &&
+        !toggleBitset.test(static_cast<size_t>(TOGGLE::AUTOSTOP)) && mTestFrames == 0 &&
+        !(toggleBitset.test(static_cast<size_t>(TOGGLE::PLAYSCENARIO)) && mScenario.isBounded()))
+    {
+        std::cerr << "The null backend requires --test-time, --frames or a scenario whose last "
+                     "phase has a frame count."
+                  << std::endl;
+        return false;
+    }
+
+    mJobSystem = new JobSystem(workerThreadCount);
+    mFishSimulation.setJobSystem(mJobSystem);
+    mFishCulling.setJobSystem(mJobSystem);
+
     if (!mContext->initialize(mBackendType, toggleBitset, windowWidth, windowHeight))
     {
         return false;
     }
 
-    calculateFishCount();
+    calculateFishCount(mCurFishCount, fishCounts);
+    mFishSimulation.reset(fishCounts);
 
     //std::cout << "Init resources ..." << std::endl;
     getElapsedTime();
 
-    const ResourceHelper *resourceHelper = mContext->getResourceHelper();
-    std::vector<std::string> skyUrls;
-    resourceHelper->getSkyBoxUrls(&skyUrls);
-    mTextureMap["skybox"] = mContext->createTexture("skybox", skyUrls);
-
-    // Init general buffer and binding groups for dawn backend.
-    mContext->initGeneralResources(this);
-    // Avoid resource allocation in the first render loop
-    mPreFishCount = mCurFishCount;
-
     setupModelEnumMap();
-    loadReource();
+    if (!loadReource())
+    {
+        return false;
+    }
     mContext->Flush();
 
     //std::cout << "End loading.\nCost " << getElapsedTime() << "s totally." << std::endl;
@@ -420,12 +647,8 @@ bool Aquarium::init(int argc, char **argv)
 
 void Aquarium::resetFpsTime()
 {
-#ifdef _WIN32
-    g.start = GetTickCount64() / 1000.0;
-#else
-    g.start    = clock() / 1000000.0;
-#endif
-    g.then          = g.start;
+    g.start = timer::getSeconds();
+    g.then  = g.start;
 }
 
 void Aquarium::display()
@@ -433,9 +656,41 @@ void Aquarium::display()
     while (!mContext->ShouldQuit())
     {
         mContext->KeyBoardQuit();
-        render();
 
+        bool playingScenario = toggleBitset.test(static_cast<size_t>(TOGGLE::PLAYSCENARIO));
+        if (playingScenario && !playScenario())
+        {
+            break;
+        }
+
+        // The update stage records the commands of the frame, the draw stage being the part of it
+        // spent issuing draws. The submit time of the flush is reported by the backend, and the
+        // rest is spent presenting and waiting for frames in flight.
+        timer::Clock::time_point frameBegin = timer::now();
+        render();
+        timer::Clock::time_point flushBegin = timer::now();
         mContext->DoFlush(toggleBitset);
+        double flushTime  = timer::getMilliseconds(flushBegin, timer::now());
+        double submitTime = std::min(mContext->getSubmitTime(), flushTime);
+        double updateTime = timer::getMilliseconds(frameBegin, flushBegin);
+        mFpsTimer.updateStages(updateTime, mDrawTime, submitTime, flushTime - submitTime);
+        if (playingScenario)
+        {
+            mScenario.endFrame(updateTime + flushTime, updateTime, mDrawTime, submitTime);
+        }
+
+        // Presenting waits for the GPU and the display, so only the work of the CPU is timed.
+        if (mTestFrames > 0)
+        {
+            mWorkUpdateTimes.record(updateTime - mDrawTime);
+            mWorkRecordTimes.record(mDrawTime);
+            mWorkSubmitTimes.record(submitTime);
+            mWorkFishCount += mCurFishCount;
+            if (mFrameCount >= mTestFrames)
+            {
+                break;
+            }
+        }
 
         if (toggleBitset.test(static_cast<size_t>(TOGGLE::AUTOSTOP)) &&
             (g.then - g.start) > mTestTime)
@@ -446,18 +701,156 @@ void Aquarium::display()
 
     mContext->Terminate();
 
-    int avg = mFpsTimer.variance();
-    printf("[RESULT] RENDERPASS:%s,MSAA:%d,FPS:%d\n", mContext->mDisableD3D12RenderPass ? "False" : "True", mContext->mMSAACount, avg);
+    printFishCountChanges();
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::PLAYSCENARIO)))
+    {
+        printf("[RESULT] SCENARIO:%s,MSAA:%d,ALPHA_BLENDING:%s\n", mScenarioPath.c_str(),
+               mContext->mMSAACount,
+               toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEALPHABLENDING)) ? g.alpha.c_str()
+                                                                                    : "false");
+        mScenario.printResults();
+    }
+
+    // FPS is the mean over the frames after the warm-up window, whether they are stable or not.
+    const FrameTimeHistogram &frameTimes = mFpsTimer.getFrameTimes();
+    printf(
+        "[RESULT] RENDERPASS:%s,MSAA:%d,FPS:%d,FRAMES:%llu,MEAN_MS:%.3f,MEDIAN_MS:%.3f,P90_MS:%.3f,"
+        "P99_MS:%.3f,P999_MS:%.3f,STDDEV_MS:%.3f,STABLE:%s\n",
+        mContext->mDisableD3D12RenderPass ? "False" : "True", mContext->mMSAACount,
+        static_cast<int>(floor(mFpsTimer.getMeasuredFPS() + 0.5)),
+        static_cast<unsigned long long>(frameTimes.getCount()), frameTimes.getMean(),
+        frameTimes.getPercentile(50.0), frameTimes.getPercentile(90.0),
+        frameTimes.getPercentile(99.0), frameTimes.getPercentile(99.9),
+        frameTimes.getStandardDeviation(), mFpsTimer.isStable() ? "True" : "False");
+
+    const FrameTimeHistogram &updateTimes  = mFpsTimer.getUpdateTimes();
+    const FrameTimeHistogram &drawTimes    = mFpsTimer.getDrawTimes();
+    const FrameTimeHistogram &submitTimes  = mFpsTimer.getSubmitTimes();
+    const FrameTimeHistogram &presentTimes = mFpsTimer.getPresentTimes();
+    printf(
+        "[RESULT] FISHDRAWS:%s,UPDATE_MS:%.3f,UPDATE_P99_MS:%.3f,DRAW_MS:%.3f,DRAW_P99_MS:%.3f,"
+        "SUBMIT_MS:%.3f,SUBMIT_P99_MS:%.3f,PRESENT_MS:%.3f,PRESENT_P99_MS:%.3f\n",
+        toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS)) ? "instanced"
+                                                                              : "individual",
+        updateTimes.getMean(), updateTimes.getPercentile(99.0), drawTimes.getMean(),
+        drawTimes.getPercentile(99.0), submitTimes.getMean(), submitTimes.getPercentile(99.0),
+        presentTimes.getMean(), presentTimes.getPercentile(99.0));
+
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::CULLFISH)))
+    {
+        // Fish and visible fish are averaged over the frames, culled ones are the difference.
+        double frameCount  = std::max(mFishCulling.getFrameCount(), 1);
+        double testedFish  = mFishCulling.getTestedFishCount() / frameCount;
+        double visibleFish = mFishCulling.getVisibleFishCount() / frameCount;
+        printf(
+            "[RESULT] CULLING:%s,FISH_PER_FRAME:%.1f,VISIBLE_PER_FRAME:%.1f,"
+            "CULLED_PER_FRAME:%.1f,VISIBLE_RATIO:%.3f\n",
+            getSIMDLevelName(mFishCulling.getSIMDLevel()), testedFish, visibleFish,
+            testedFish - visibleFish, testedFish > 0.0 ? visibleFish / testedFish : 1.0);
+    }
+
+    if (mFishTriangleFrameCount > 0)
+    {
+        // Without culling or levels of detail, every fish is drawn with the full mesh.
+        bool sortedFish    = mFishCulling.getFrameCount() > 0;
+        double visibleFish = static_cast<double>(mFishCulling.getVisibleFishCount());
+        printf("[RESULT] FISHLOD:%s,FISH_TRIANGLES_PER_FRAME:%.0f",
+               toggleBitset.test(static_cast<size_t>(TOGGLE::FISHLOD)) ? "True" : "False",
+               static_cast<double>(mFishTriangleCount) / mFishTriangleFrameCount);
+        for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+        {
+            double ratio = lod == 0 ? 1.0 : 0.0;
+            if (sortedFish && visibleFish > 0.0)
+            {
+                ratio = mFishCulling.getLodFishCount(lod) / visibleFish;
+            }
+            printf(",LOD%d_RATIO:%.3f", lod, ratio);
+        }
+        printf("\n");
+    }
+
+    if (mTestFrames > 0)
+    {
+        double workMs =
+            mWorkUpdateTimes.getMean() + mWorkRecordTimes.getMean() + mWorkSubmitTimes.getMean();
+        double workSeconds = workMs * mWorkUpdateTimes.getCount() / 1000.0;
+        printf(
+            "[RESULT] FIXEDSTEP:%s,FRAMES:%llu,FIXED_DT:%.4f,UPDATE_MS:%.3f,UPDATE_P99_MS:%.3f,"
+            "RECORD_MS:%.3f,RECORD_P99_MS:%.3f,SUBMIT_MS:%.3f,SUBMIT_P99_MS:%.3f,WORK_MS:%.3f,"
+            "WORK_FPS:%.1f,FISH_PER_SECOND:%.0f\n",
+            mFixedTimeStep > 0.0 ? "True" : "False",
+            static_cast<unsigned long long>(mWorkUpdateTimes.getCount()), mFixedTimeStep,
+            mWorkUpdateTimes.getMean(), mWorkUpdateTimes.getPercentile(99.0),
+            mWorkRecordTimes.getMean(), mWorkRecordTimes.getPercentile(99.0),
+            mWorkSubmitTimes.getMean(), mWorkSubmitTimes.getPercentile(99.0), workMs,
+            workMs > 0.0 ? 1000.0 / workMs : 0.0,
+            workSeconds > 0.0 ? mWorkFishCount / workSeconds : 0.0);
+    }
+
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::HASHFISHPERS)))
+    {
+        // Hashes of runs at different SIMD levels don't match, the SIMD kernels round differently
+        // from the scalar one.
+        printf("[RESULT] FISHPERS_HASH:%016llx,FISH:%d,MCLOCK:%.6f,SIMD:%s\n",
+               static_cast<unsigned long long>(mFishPersHash), mHashedFishCount, g.mclock,
+               getSIMDLevelName(mFishSimulation.getSIMDLevel()));
+    }
+
+    if (!mFrameTimeCsvPath.empty())
+    {
+        mFpsTimer.writeTimeline(mFrameTimeCsvPath);
+    }
 }
 
-void Aquarium::loadReource()
+// Loading runs in three stages. The I/O stage maps the model caches and reads the images and
+// shaders, the decode stage decodes the images and generates their mipmaps, both on the job system,
+// and the upload stage creates the backend objects on the main thread.
+bool Aquarium::loadReource()
 {
-    loadModels();
+    typedef timer::Clock Clock;
+
+    AssetLoadPlan plan;
+    Clock::time_point start = Clock::now();
+    if (!readAssets(&plan))
+    {
+        return false;
+    }
+    Clock::time_point read = Clock::now();
+    if (!decodeAssets(&plan))
+    {
+        return false;
+    }
+    Clock::time_point decoded = Clock::now();
+    uploadAssets(plan);
+    Clock::time_point uploaded = Clock::now();
+
     loadPlacement();
-    if (toggleBitset.test(static_cast<size_t>(TOGGLE::SIMULATINGFISHCOMEANDGO)))
+    Clock::time_point end = Clock::now();
+
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::PRINTLOG)))
     {
-        loadFishScenario();
+        int cachedTextureCount = 0;
+        for (const Texture *texture : plan.textures)
+        {
+            cachedTextureCount += texture->isFromCache() ? 1 : 0;
+        }
+        const ShaderCacheStatistics &shaders = mContext->getShaderCache()->getStatistics();
+        printf(
+            "[RESULT] LOAD_IO_MS:%.2f,LOAD_DECODE_MS:%.2f,LOAD_UPLOAD_MS:%.2f,LOAD_TOTAL_MS:%.2f,"
+            "MODELS:%d,TEXTURES:%d,CACHEDTEXTURES:%d,PROGRAMS:%d,TEXTURECOMPRESSION:%s\n",
+            timer::getMilliseconds(start, read), timer::getMilliseconds(read, decoded),
+            timer::getMilliseconds(decoded, uploaded), timer::getMilliseconds(start, end),
+            static_cast<int>(plan.models.size()), static_cast<int>(plan.textures.size()),
+            cachedTextureCount, static_cast<int>(plan.programs.size()),
+            getTextureCompressionName(mTextureCompression));
+        // A cold start compiles every shader, a warm one finds them all in the cache.
+        printf("[RESULT] PROGRAM_MS:%.2f,SHADERS:%d,COMPILEDSHADERS:%d,CACHEDSHADERS:%d,WARM:%s\n",
+               shaders.time, shaders.compiles + shaders.diskHits + shaders.memoryHits,
+               shaders.compiles, shaders.diskHits + shaders.memoryHits,
+               shaders.compiles == 0 ? "True" : "False");
     }
+
+    return true;
 }
 
 void Aquarium::setupModelEnumMap()
@@ -473,10 +866,13 @@ void Aquarium::loadPlacement()
 {
     const ResourceHelper *resourceHelper = mContext->getResourceHelper();
     std::string proppath                 = resourceHelper->getPropPlacementPath();
-    std::ifstream PlacementStream(proppath, std::ios::in);
-    rapidjson::IStreamWrapper isPlacement(PlacementStream);
+    MappedFile placementFile;
+    std::string placementCopy;
+    size_t placementSize;
+    char *placement = mapText(proppath, &placementFile, &placementCopy, &placementSize);
+    ASSERT(placement != nullptr);
     rapidjson::Document document;
-    document.ParseStream(isPlacement);
+    document.ParseInsitu(placement);
 
     ASSERT(document.IsObject());
 
@@ -484,30 +880,80 @@ void Aquarium::loadPlacement()
     const rapidjson::Value &objects = document["objects"];
     ASSERT(objects.IsArray());
 
+    // Count the instances first, so that the matrices of each model go into one block.
+    int instanceCounts[MODELNAME::MODELMAX] = {};
+    int instanceCount                        = 0;
+    for (rapidjson::SizeType i = 0; i < objects.Size(); ++i)
+    {
+        auto modelname = mModelEnumMap.find(objects[i]["name"].GetString());
+        if (modelname != mModelEnumMap.end())
+        {
+            ++instanceCounts[modelname->second];
+            ++instanceCount;
+        }
+    }
+
+    // A matrix is as large as its alignment, so the blocks pack without padding.
+    mPlacementArena.reset();
+    mPlacementArena.reserve(2 * instanceCount * 16 * sizeof(float), kWorldMatrixAlignment);
+    for (int i = 0; i < MODELNAME::MODELMAX; ++i)
+    {
+        if (instanceCounts[i] > 0)
+        {
+            Model *model         = mAquariumModels[i];
+            model->worldmatrices =
+                mPlacementArena.allocateArray<float>(instanceCounts[i] * 16, kWorldMatrixAlignment);
+            model->worldInverseTransposes =
+                mPlacementArena.allocateArray<float>(instanceCounts[i] * 16, kWorldMatrixAlignment);
+            model->worldmatrixCount = 0;
+        }
+    }
+
     for (rapidjson::SizeType i = 0; i < objects.Size(); ++i)
     {
         const rapidjson::Value &name        = objects[i]["name"];
         const rapidjson::Value &worldMatrix = objects[i]["worldMatrix"];
         ASSERT(worldMatrix.IsArray() && worldMatrix.Size() == 16);
 
-        std::vector<float> matrix;
-        for (rapidjson::SizeType j = 0; j < worldMatrix.Size(); ++j)
+        // Names that aren't in the map aren't models of the aquarium.
+        auto modelname = mModelEnumMap.find(name.GetString());
+        if (modelname == mModelEnumMap.end())
         {
-            matrix.push_back(worldMatrix[j].GetFloat());
+            continue;
         }
 
-        MODELNAME modelname = mModelEnumMap[name.GetString()];
-        // MODELFIRST means the model is not found in the Map
-        if (modelname != MODELNAME::MODELFIRST)
+        Model *model  = mAquariumModels[modelname->second];
+        float *matrix = model->worldmatrices + model->worldmatrixCount * 16;
+        for (rapidjson::SizeType j = 0; j < 16; ++j)
         {
-            mAquariumModels[modelname]->worldmatrices.push_back(matrix);
+            matrix[j] = worldMatrix[j].GetFloat();
+        }
+        ++model->worldmatrixCount;
+    }
+
+    // The normals are transformed by the inverse transposes, which don't change either.
+    for (int i = 0; i < MODELNAME::MODELMAX; ++i)
+    {
+        if (instanceCounts[i] == 0)
+        {
+            continue;
         }
+        Model *model = mAquariumModels[i];
+        matrix::inverseTransposeMatrices4(model->worldInverseTransposes, 16, model->worldmatrices,
+                                          model->worldmatrixCount);
     }
 }
 
-void Aquarium::loadModels()
+bool Aquarium::readAssets(AssetLoadPlan *plan)
 {
+    const ResourceHelper *resourceHelper = mContext->getResourceHelper();
+    // Models and textures are preprocessed into the cache folder on first use, and shaders
+    // compiled into it.
+    createDirectory(resourceHelper->getCachePath());
+    mContext->getShaderCache()->setFolder(resourceHelper->getCachePath());
+
     bool enableInstanceddraw = toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS));
+    bool simplifyFish        = toggleBitset.test(static_cast<size_t>(TOGGLE::FISHLOD));
     for (const auto &info : g_sceneInfo)
     {
         if ((enableInstanceddraw && info.type == MODELGROUP::FISH) ||
@@ -515,109 +961,101 @@ void Aquarium::loadModels()
         {
             continue;
         }
-        loadModel(info);
+        std::unique_ptr<ModelLoadTask> task(new ModelLoadTask());
+        task->info = &info;
+        plan->models.push_back(std::move(task));
     }
-}
 
-void Aquarium::loadFishScenario()
-{
-    const ResourceHelper *resourceHelper = mContext->getResourceHelper();
-    std::string fishBehaviorPath         = resourceHelper->getFishBehaviorPath();
+    std::atomic<bool> succeeded(true);
+    mJobSystem->parallelFor(static_cast<int>(plan->models.size()), kAssetGrainSize,
+                            [&](int begin, int end) {
+                                for (int i = begin; i < end; ++i)
+                                {
+                                    ModelLoadTask &task = *plan->models[i];
+                                    std::string name(task.info->namestr);
+                                    if (!ModelCache::load(resourceHelper->getModelPath(name),
+                                                          resourceHelper->getModelCachePath(name),
+                                                          &task.data))
+                                    {
+                                        succeeded = false;
+                                    }
+                                    else if (simplifyFish &&
+                                             (task.info->type == MODELGROUP::FISH ||
+                                              task.info->type == MODELGROUP::FISHINSTANCEDDRAW))
+                                    {
+                                        simplifyFishModel(&task);
+                                    }
+                                }
+                            });
+    if (!succeeded)
+    {
+        return false;
+    }
 
-    std::ifstream FishStream(fishBehaviorPath, std::ios::in);
-    rapidjson::IStreamWrapper is(FishStream);
-    rapidjson::Document document;
-    document.ParseStream(is);
-    ASSERT(document.IsObject());
-    const rapidjson::Value &behaviors = document["behaviors"];
-    ASSERT(behaviors.IsArray());
+    // The textures and programs of the models are only known now.
+    collectAssets(plan);
 
-    for (rapidjson::SizeType i = 0; i < behaviors.Size(); ++i)
-    {
-        int frame      = behaviors[i]["frame"].GetInt();
-        std::string op = behaviors[i]["op"].GetString();
-        int count      = behaviors[i]["count"].GetInt();
+    int textureCount = static_cast<int>(plan->textures.size());
+    int programCount = static_cast<int>(plan->programs.size());
+    mJobSystem->parallelFor(textureCount + programCount, kAssetGrainSize, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+        {
+            if (i < textureCount)
+            {
+                if (!plan->textures[i]->readImages())
+                {
+                    succeeded = false;
+                }
+            }
+            else
+            {
+                plan->programs[i - textureCount].first->loadProgram();
+            }
+        }
+    });
 
-        Behavior *behave = new Behavior(frame, op, count);
-        mFishBehavior.push(behave);
-    }
+    return succeeded;
 }
 
-// Load vertex and index buffers, textures and program for each model.
-void Aquarium::loadModel(const G_sceneInfo &info)
+// Pick the program of each model, and create the textures and programs that no model loaded
+// before. Objects are only created here, so this is cheap.
+void Aquarium::collectAssets(AssetLoadPlan *plan)
 {
     const ResourceHelper *resourceHelper = mContext->getResourceHelper();
     std::string imagePath                = resourceHelper->getImagePath();
     std::string programPath              = resourceHelper->getProgramPath();
-    std::string modelPath                = resourceHelper->getModelPath(std::string(info.namestr));
 
-    std::ifstream ModelStream(modelPath, std::ios::in);
-    rapidjson::IStreamWrapper is(ModelStream);
-    rapidjson::Document document;
-    document.ParseStream(is);
-    ASSERT(document.IsObject());
-    const rapidjson::Value &models = document["models"];
-    ASSERT(models.IsArray());
+    std::vector<std::string> skyUrls;
+    resourceHelper->getSkyBoxUrls(&skyUrls);
+    mTextureMap["skybox"] = mContext->createTexture("skybox", skyUrls);
+    mTextureMap["skybox"]->setCompression(mTextureCompression);
+    mTextureMap["skybox"]->setCachePath(
+        resourceHelper->getTextureCachePath("skybox", mTextureCompression));
+    plan->textures.push_back(mTextureMap["skybox"]);
 
-    Model *model;
-    if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEALPHABLENDING)) &&
-        info.type != MODELGROUP::INNER && info.type != MODELGROUP::OUTSIDE)
-    {
-        model = mContext->createModel(this, info.type, info.name, true);
-    }
-    else
+    bool enableAlphaBlending = toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEALPHABLENDING));
+    for (auto &task : plan->models)
     {
-        model = mContext->createModel(this, info.type, info.name, info.blend);
-    }
-    mAquariumModels[info.name] = model;
+        const G_sceneInfo &info = *task->info;
 
-    auto &value = models.GetArray()[models.GetArray().Size() - 1];
-    {
-        // set up textures
-        const rapidjson::Value &textures = value["textures"];
-        for (rapidjson::Value::ConstMemberIterator itr = textures.MemberBegin();
-             itr != textures.MemberEnd(); ++itr)
+        bool hasReflection = false;
+        bool hasNormalMap  = false;
+        for (const auto &texture : task->data.textures)
         {
-            std::string name  = itr->name.GetString();
-            std::string image = itr->value.GetString();
+            const std::string &name  = texture.first;
+            const std::string &image = texture.second;
 
             if (mTextureMap.find(image) == mTextureMap.end())
             {
                 mTextureMap[image] = mContext->createTexture(name, imagePath + image);
+                mTextureMap[image]->setCompression(mTextureCompression);
+                mTextureMap[image]->setCachePath(
+                    resourceHelper->getTextureCachePath(image, mTextureCompression));
+                plan->textures.push_back(mTextureMap[image]);
             }
 
-            model->textureMap[name] = mTextureMap[image];
-        }
-
-        // set up vertices
-        const rapidjson::Value &arrays = value["fields"];
-        for (rapidjson::Value::ConstMemberIterator itr = arrays.MemberBegin();
-             itr != arrays.MemberEnd(); ++itr)
-        {
-            std::string name  = itr->name.GetString();
-            int numComponents = itr->value["numComponents"].GetInt();
-            std::string type  = itr->value["type"].GetString();
-            Buffer *buffer;
-            if (name == "indices")
-            {
-                std::vector<unsigned short> vec;
-                for (auto &data : itr->value["data"].GetArray())
-                {
-                    vec.push_back(data.GetInt());
-                }
-                buffer = mContext->createBuffer(numComponents, &vec, true);
-            }
-            else
-            {
-                std::vector<float> vec;
-                for (auto &data : itr->value["data"].GetArray())
-                {
-                    vec.push_back(data.GetFloat());
-                }
-                buffer = mContext->createBuffer(numComponents, &vec, false);
-            }
-
-            model->bufferMap[name] = buffer;
+            hasReflection = hasReflection || name == "reflection";
+            hasNormalMap  = hasNormalMap || name == "normalMap";
         }
 
         // setup program
@@ -625,24 +1063,22 @@ void Aquarium::loadModel(const G_sceneInfo &info)
         // DM
         // DM+NM
         // DM+NM+RM
-        std::string vsId;
-        std::string fsId;
-
-        vsId = info.program[0];
-        fsId = info.program[1];
+        std::string vsId = info.program[0];
+        std::string fsId = info.program[1];
+        task->useSkybox  = false;
 
         if (vsId != "" && fsId != "")
         {
-            model->textureMap["skybox"] = mTextureMap["skybox"];
+            task->useSkybox = true;
         }
-        else if (model->textureMap["reflection"] != nullptr)
+        else if (hasReflection)
         {
             vsId = "reflectionMapVertexShader";
             fsId = "reflectionMapFragmentShader";
 
-            model->textureMap["skybox"] = mTextureMap["skybox"];
+            task->useSkybox = true;
         }
-        else if (model->textureMap["normalMap"] != nullptr)
+        else if (hasNormalMap)
         {
             vsId = "normalMapVertexShader";
             fsId = "normalMapFragmentShader";
@@ -653,35 +1089,168 @@ void Aquarium::loadModel(const G_sceneInfo &info)
             fsId = "diffuseFragmentShader";
         }
 
-        Program *program;
-        if (mProgramMap.find(vsId + fsId) != mProgramMap.end())
+        if (mProgramMap.find(vsId + fsId) == mProgramMap.end())
+        {
+            Program *program = mContext->createProgram(programPath + vsId, programPath + fsId);
+            mProgramMap[vsId + fsId] = program;
+            plan->programs.push_back(std::make_pair(
+                program, enableAlphaBlending && info.type != MODELGROUP::INNER &&
+                             info.type != MODELGROUP::OUTSIDE));
+        }
+        task->program = mProgramMap[vsId + fsId];
+    }
+}
+
+bool Aquarium::decodeAssets(AssetLoadPlan *plan)
+{
+    std::atomic<bool> succeeded(true);
+    mJobSystem->parallelFor(static_cast<int>(plan->textures.size()), kAssetGrainSize,
+                            [&](int begin, int end) {
+                                for (int i = begin; i < end; ++i)
+                                {
+                                    if (!plan->textures[i]->decode())
+                                    {
+                                        succeeded = false;
+                                    }
+                                }
+                            });
+    if (!succeeded)
+    {
+        return false;
+    }
+
+    // Cached textures come with their levels.
+    std::vector<MipChain *> mipChains;
+    std::vector<Texture *> uncached;
+    for (Texture *texture : plan->textures)
+    {
+        if (!texture->isFromCache())
+        {
+            mipChains.push_back(texture->getMipChain());
+            uncached.push_back(texture);
+        }
+    }
+    generateMipChains(mJobSystem, mipChains);
+
+    std::vector<TEXTUREFORMAT> formats;
+    for (Texture *texture : uncached)
+    {
+        formats.push_back(texture->getCompressedFormat());
+    }
+    compressMipChains(mJobSystem, mipChains, formats);
+
+    // Failing to write the cache only costs the next start.
+    mJobSystem->parallelFor(static_cast<int>(uncached.size()), kAssetGrainSize,
+                            [&](int begin, int end) {
+                                for (int i = begin; i < end; ++i)
+                                {
+                                    uncached[i]->storeCache();
+                                }
+                            });
+
+    return true;
+}
+
+void Aquarium::uploadAssets(const AssetLoadPlan &plan)
+{
+    for (Texture *texture : plan.textures)
+    {
+        texture->loadTexture();
+    }
+
+    // Init general buffer and binding groups for dawn backend.
+    mContext->initGeneralResources(this);
+    // Avoid resource allocation in the first render loop
+    mPreFishCount = mCurFishCount;
+
+    for (const auto &program : plan.programs)
+    {
+        program.first->compileProgram(program.second, g.alpha);
+    }
+
+    for (const auto &task : plan.models)
+    {
+        uploadModel(*task);
+    }
+}
+
+// Create the model with its vertex and index buffers, textures and program.
+void Aquarium::uploadModel(const ModelLoadTask &task)
+{
+    const G_sceneInfo &info = *task.info;
+
+    Model *model;
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEALPHABLENDING)) &&
+        info.type != MODELGROUP::INNER && info.type != MODELGROUP::OUTSIDE)
+    {
+        model = mContext->createModel(this, info.type, info.name, true);
+    }
+    else
+    {
+        model = mContext->createModel(this, info.type, info.name, info.blend);
+    }
+    mAquariumModels[info.name] = model;
+
+    // set up textures
+    for (const auto &texture : task.data.textures)
+    {
+        model->textureMap[texture.first] = mTextureMap[texture.second];
+    }
+    if (task.useSkybox)
+    {
+        model->textureMap["skybox"] = mTextureMap["skybox"];
+    }
+
+    // set up vertices
+    for (const auto &field : task.data.fields)
+    {
+        Buffer *buffer;
+        if (field.isIndex)
         {
-            program = mProgramMap[vsId + fsId];
+            buffer = mContext->createBuffer(field.numComponents,
+                                            static_cast<const unsigned short *>(field.data),
+                                            field.count, true);
         }
         else
         {
-            program = mContext->createProgram(programPath + vsId, programPath + fsId);
-            if (toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEALPHABLENDING)) &&
-                info.type != MODELGROUP::INNER && info.type != MODELGROUP::OUTSIDE)
-            {
-                program->compileProgram(true, g.alpha);
-            }
-            else
-            {
-                program->compileProgram(false, g.alpha);
-            }
-            mProgramMap[vsId + fsId] = program;
+            buffer = mContext->createBuffer(field.numComponents,
+                                            static_cast<const float *>(field.data), field.count,
+                                            false);
+        }
+
+        model->bufferMap[field.name] = buffer;
+
+        if ((info.type == MODELGROUP::FISH || info.type == MODELGROUP::FISHINSTANCEDDRAW) &&
+            field.name == "position" && field.numComponents == 3)
+        {
+            int species          = static_cast<FishModel *>(model)->getSpecies();
+            const Fish &fishInfo = fishTable[species];
+            mFishCulling.setSpeciesRadius(
+                species, FishCulling::computeSpeciesRadius(static_cast<const float *>(field.data),
+                                                           field.count / field.numComponents,
+                                                           fishInfo.fishLength,
+                                                           fishInfo.fishBendAmount));
         }
+    }
 
-        model->setProgram(program);
-        model->init();
+    for (int lod = 1; lod < FISH_LOD_COUNT; ++lod)
+    {
+        const std::vector<unsigned short> &indices = task.lodIndices[lod - 1];
+        if (!indices.empty())
+        {
+            model->bufferMap[FishModel::getLodIndicesName(lod)] = mContext->createBuffer(
+                3, indices.data(), static_cast<int>(indices.size()), true);
+        }
     }
+
+    model->setProgram(task.program);
+    model->init();
 }
 
-void Aquarium::calculateFishCount()
+void Aquarium::calculateFishCount(int fishCount, int *fishCounts)
 {
     // Calculate fish count for each type of fish
-    int numLeft = mCurFishCount;
+    int numLeft = fishCount;
     for (int i = 0; i < FISHENUM::MAX; ++i)
     {
         for (auto &fishInfo : fishTable)
@@ -693,16 +1262,16 @@ void Aquarium::calculateFishCount()
             int numfloat = numLeft;
             if (i == FISHENUM::BIG)
             {
-                int temp = mCurFishCount < g_smallFishCount ? 1 : 2;
+                int temp = fishCount < g_smallFishCount ? 1 : 2;
                 numfloat = std::min(numLeft, temp);
             }
             else if (i == FISHENUM::MEDIUM)
             {
-                if (mCurFishCount < g_mediumFishCount)
+                if (fishCount < g_mediumFishCount)
                 {
-                    numfloat = std::min(numLeft, mCurFishCount / 10);
+                    numfloat = std::min(numLeft, fishCount / 10);
                 }
-                else if (mCurFishCount < g_bigFishCount)
+                else if (fishCount < g_bigFishCount)
                 {
                     numfloat = std::min(numLeft, g_leftSmallFishCount);
                 }
@@ -720,11 +1289,7 @@ void Aquarium::calculateFishCount()
 double Aquarium::getElapsedTime()
 {
     // Update our time
-#ifdef _WIN32
-    double now = GetTickCount64() / 1000.0;
-#else
-    double now = clock() / 1000000.0;
-#endif
+    double now         = timer::getSeconds();
     double elapsedTime = 0.0;
     if (g.then == 0.0)
     {
@@ -756,8 +1321,17 @@ void Aquarium::updateGlobalUniforms()
     double renderingTime = g.then - g.start;
 
     mFpsTimer.update(elapsedTime, renderingTime, mTestTime);
-    g.mclock += elapsedTime * g_speed;
-    g.eyeClock += elapsedTime * g_eyeSpeed;
+
+    // A fixed time step moves the fish and the camera the same way whatever the frames take. The
+    // step of a scenario phase wins over --fixed-dt.
+    bool playingScenario = toggleBitset.test(static_cast<size_t>(TOGGLE::PLAYSCENARIO));
+    double stepTime      = mFixedTimeStep > 0.0 ? mFixedTimeStep : elapsedTime;
+    if (playingScenario && mScenario.getFixedTimeStep() > 0.0)
+    {
+        stepTime = mScenario.getFixedTimeStep();
+    }
+    g.mclock += stepTime * g_speed;
+    g.eyeClock += stepTime * g_eyeSpeed;
 
     g.eyePosition[0] = sin(g.eyeClock) * g_eyeRadius;
     g.eyePosition[1] = g_eyeHeight;
@@ -765,6 +1339,10 @@ void Aquarium::updateGlobalUniforms()
     g.target[0]      = static_cast<float>(sin(g.eyeClock + M_PI)) * g_targetRadius;
     g.target[1]      = g_targetHeight;
     g.target[2]      = static_cast<float>(cos(g.eyeClock + M_PI)) * g_targetRadius;
+    if (playingScenario)
+    {
+        mScenario.getCamera(g.eyePosition, g.target);
+    }
 
     float nearPlane = 1;
     float farPlane  = 25000.0f;
@@ -806,64 +1384,122 @@ void Aquarium::updateGlobalUniforms()
     mContext->updateWorldlUniforms(this);
 }
 
-void Aquarium::render()
+// Frame k runs from the start of render() to its next start, so it includes the submission and
+// present of DoFlush().
+void Aquarium::recordFrameTime()
 {
-    matrix::resetPseudoRandom();
+    timer::Clock::time_point now = timer::now();
+    if (mFrameCount > 0)
+    {
+        double frameMs = timer::getMilliseconds(mFrameStart, now);
+        for (auto change = mFishCountChanges.rbegin();
+             change != mFishCountChanges.rend() && change->measuredFrames < kSpikeFrameCount;
+             ++change)
+        {
+            change->peakMs = std::max(change->peakMs, frameMs);
+            ++change->measuredFrames;
+        }
 
-    mContext->preFrame();
+        if (mRecentFrameTimes.size() < kBaselineFrameCount)
+        {
+            mRecentFrameTimes.push_back(frameMs);
+        }
+        else
+        {
+            mRecentFrameTimes[mFrameCount % kBaselineFrameCount] = frameMs;
+        }
+    }
+    mFrameStart = now;
+    ++mFrameCount;
+}
 
-    // Global Uniforms should update after command reallocation.
-    updateGlobalUniforms();
+bool Aquarium::playScenario()
+{
+    int preFishCount = mCurFishCount;
+    if (!mScenario.beginFrame(&mCurFishCount))
+    {
+        return false;
+    }
 
-    if (toggleBitset.test(static_cast<size_t>(TOGGLE::SIMULATINGFISHCOMEANDGO)))
+    // Ramps change the count every frame, only the steps between phases are compared to the
+    // frames before them.
+    if (mScenario.isPhaseStart() && mCurFishCount != preFishCount)
     {
-        if (!mFishBehavior.empty())
+        std::cout << "Fish count " << mCurFishCount << std::endl;
+
+        double baselineMs = 0.0;
+        for (double frameMs : mRecentFrameTimes)
         {
-            Behavior *behave = mFishBehavior.front();
-            int frame        = behave->getFrame();
-            if (frame == 0)
-            {
-                mFishBehavior.pop();
-                if (behave->getOp() == "+")
-                {
-                    mCurFishCount += behave->getCount();
-                }
-                else
-                {
-                    mCurFishCount -= behave->getCount();
-                }
-                std::cout << "Fish count" << mCurFishCount << std::endl;
-            }
-            else
-            {
-                behave->setFrame(--frame);
-            }
+            baselineMs += frameMs;
+        }
+        if (!mRecentFrameTimes.empty())
+        {
+            baselineMs /= mRecentFrameTimes.size();
         }
+        mFishCountChanges.push_back({mFrameCount, preFishCount, mCurFishCount, baselineMs, 0.0, 0});
     }
+    return true;
+}
 
-    // TODO(yizhou): Functionality of reallocate fish count during rendering
-    // isn't supported for instanced draw.
-    // To try this functionality now, use composition of "--backend dawn_xxx", or
-    // "--backend dawn_xxx --disable-dyanmic-buffer-offset"
-    if (!toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS)))
-        if (mCurFishCount != mPreFishCount)
-        {
-            calculateFishCount();
-            bool enableDynamicBufferOffset =
-                toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEDYNAMICBUFFEROFFSET));
-            mContext->reallocResource(mPreFishCount, mCurFishCount, enableDynamicBufferOffset);
-            mPreFishCount = mCurFishCount;
+void Aquarium::printFishCountChanges() const
+{
+    if (mFishCountChanges.empty())
+    {
+        return;
+    }
 
-            resetFpsTime();
-        }
+    double totalSpikeMs = 0.0;
+    double maxSpikeMs   = 0.0;
+    for (size_t i = 0; i < mFishCountChanges.size(); ++i)
+    {
+        const FishCountChange &change = mFishCountChanges[i];
+        double spikeMs                = std::max(change.peakMs - change.baselineMs, 0.0);
+        totalSpikeMs += spikeMs;
+        maxSpikeMs = std::max(maxSpikeMs, spikeMs);
+        printf(
+            "[RESULT] FISHCOUNTCHANGE:%d,FRAME:%d,FROM:%d,TO:%d,BASELINE_MS:%.2f,PEAK_MS:%.2f,"
+            "SPIKE_MS:%.2f\n",
+            static_cast<int>(i), change.frame, change.preFishCount, change.curFishCount,
+            change.baselineMs, change.peakMs, spikeMs);
+    }
+    printf("[RESULT] FISHCOUNTCHANGES:%d,MEAN_SPIKE_MS:%.2f,MAX_SPIKE_MS:%.2f\n",
+           static_cast<int>(mFishCountChanges.size()), totalSpikeMs / mFishCountChanges.size(),
+           maxSpikeMs);
+}
+
+void Aquarium::render()
+{
+    recordFrameTime();
+
+    mContext->preFrame();
+
+    // Global Uniforms should update after command reallocation.
+    updateGlobalUniforms();
+
+    // Instanced fish models read their fish from the fish data of the context, so they follow the
+    // reallocation like the others.
+    if (mCurFishCount != mPreFishCount)
+    {
+        calculateFishCount(mCurFishCount, fishCounts);
+        mFishSimulation.reset(fishCounts);
+        bool enableDynamicBufferOffset =
+            toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEDYNAMICBUFFEROFFSET));
+        mContext->reallocResource(mPreFishCount, mCurFishCount, enableDynamicBufferOffset);
+        mPreFishCount = mCurFishCount;
+
+        resetFpsTime();
+    }
 
     bool updateAndDrawForEachFish =
         toggleBitset.test(static_cast<size_t>(TOGGLE::UPATEANDDRAWFOREACHMODEL));
 
     if (updateAndDrawForEachFish)
     {
+        // Updates and draws are interleaved, so all of it counts as drawing.
+        timer::Clock::time_point drawBegin = timer::now();
         updateAndDrawBackground();
         updateAndDrawFishes();
+        mDrawTime = timer::getMilliseconds(drawBegin, timer::now());
         mContext->updateFPS(mFpsTimer, &mCurFishCount, &toggleBitset);
     }
     else
@@ -875,8 +1511,17 @@ void Aquarium::render()
         // Begin render pass
         mContext->beginRenderPass();
 
-        drawBackground();
-        drawFishes();
+        timer::Clock::time_point drawBegin = timer::now();
+        if (toggleBitset.test(static_cast<size_t>(TOGGLE::RECORDCOMMANDS)))
+        {
+            recordAndExecuteDraws();
+        }
+        else
+        {
+            drawBackground();
+            drawFishes();
+        }
+        mDrawTime = timer::getMilliseconds(drawBegin, timer::now());
         mContext->showFPS();
 
         // End renderpass
@@ -912,51 +1557,25 @@ void Aquarium::updateAndDrawFishes()
                   ? MODELNAME::MODELBIGFISHBINSTANCEDDRAWS
                   : MODELNAME::MODELBIGFISHB;
 
+    mFishPers.resize(mFishSimulation.getTotalFishCount());
+    mFishSimulation.update(g.mclock, mFishPers.data());
+    hashFishPers(mFishPers.data(), sizeof(FishPer), static_cast<int>(mFishPers.size()));
+
     for (int i = begin; i <= end; ++i)
     {
         FishModel *model = static_cast<FishModel *>(mAquariumModels[i]);
-
-        const Fish &fishInfo = fishTable[i - begin];
-        int fishCount          = fishCounts[i - begin];
+        int species      = i - begin;
+        int fishCount    = mFishSimulation.getFishCount(species);
+        const FishPer *fishPer = mFishPers.data() + mFishSimulation.getFishOffset(species);
 
         model->prepareForDraw();
 
-        float fishBaseClock   = g.mclock * g_fishSpeed;
-        float fishRadius      = fishInfo.radius;
-        float fishRadiusRange = fishInfo.radiusRange;
-        float fishSpeed       = fishInfo.speed;
-        float fishSpeedRange  = fishInfo.speedRange;
-        float fishTailSpeed   = fishInfo.tailSpeed * g_fishTailSpeed;
-        float fishOffset      = g_fishOffset;
-        // float fishClockSpeed  = g_fishSpeed;
-        float fishHeight      = g_fishHeight + fishInfo.heightOffset;
-        float fishHeightRange = g_fishHeightRange * fishInfo.heightRange;
-        float fishXClock      = g_fishXClock;
-        float fishYClock      = g_fishYClock;
-        float fishZClock      = g_fishZClock;
-
-        for (int ii = 0; ii < fishCount; ++ii)
-        {
-            float fishClock = fishBaseClock + ii * fishOffset;
-            float speed = fishSpeed + static_cast<float>(matrix::pseudoRandom()) * fishSpeedRange;
-            float scale = 1.0f + static_cast<float>(matrix::pseudoRandom()) * 1;
-            float xRadius =
-                fishRadius + static_cast<float>(matrix::pseudoRandom()) * fishRadiusRange;
-            float yRadius = 2.0f + static_cast<float>(matrix::pseudoRandom()) * fishHeightRange;
-            float zRadius =
-                fishRadius + static_cast<float>(matrix::pseudoRandom()) * fishRadiusRange;
-            float fishSpeedClock = fishClock * speed;
-            float xClock         = fishSpeedClock * fishXClock;
-            float yClock         = fishSpeedClock * fishYClock;
-            float zClock         = fishSpeedClock * fishZClock;
-
+        for (int ii = 0; ii < fishCount; ++ii, ++fishPer)
+        {
             model->updateFishPerUniforms(
-                sin(xClock) * xRadius, sin(yClock) * yRadius + fishHeight, cos(zClock) * zRadius,
-                sin(xClock - 0.04f) * xRadius, sin(yClock - 0.01f) * yRadius + fishHeight,
-                cos(zClock - 0.04f) * zRadius, scale,
-                fmod((g.mclock + ii * g_tailOffsetMult) * fishTailSpeed * speed,
-                     static_cast<float>(M_PI) * 2),
-                ii);
+                fishPer->worldPosition[0], fishPer->worldPosition[1], fishPer->worldPosition[2],
+                fishPer->nextPosition[0], fishPer->nextPosition[1], fishPer->nextPosition[2],
+                fishPer->scale, fishPer->time, ii);
 
             model->updatePerInstanceUniforms(worldUniforms);
             model->draw();
@@ -976,62 +1595,165 @@ void Aquarium::updateBackground()
 
 void Aquarium::updateFishes()
 {
-    int begin = toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS))
-                    ? MODELNAME::MODELSMALLFISHAINSTANCEDDRAWS
-                    : MODELNAME::MODELSMALLFISHA;
-    int end = toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS))
-                  ? MODELNAME::MODELBIGFISHBINSTANCEDDRAWS
-                  : MODELNAME::MODELBIGFISHB;
+    bool enableInstancedDraws =
+        toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS));
+    int begin = enableInstancedDraws ? MODELNAME::MODELSMALLFISHAINSTANCEDDRAWS
+                                     : MODELNAME::MODELSMALLFISHA;
+    int end   = enableInstancedDraws ? MODELNAME::MODELBIGFISHBINSTANCEDDRAWS
+                                     : MODELNAME::MODELBIGFISHB;
 
     for (int i = begin; i <= end; ++i)
     {
         FishModel *model = static_cast<FishModel *>(mAquariumModels[i]);
+        model->prepareForDraw();
+    }
 
-        const Fish &fishInfo = fishTable[i - begin];
-        int fishCount          = fishCounts[i - begin];
+    // Write all fish in one pass when the backend exposes its fish data, otherwise fall back to
+    // updating fish one by one through the fish models.
+    FishPer *fishPers             = mContext->getFishPers();
+    FishPerPacked *packedFishPers = mContext->getPackedFishPers();
+    int uploadCount               = mFishSimulation.getTotalFishCount();
+    if (toggleBitset.test(static_cast<size_t>(TOGGLE::CULLFISH)) ||
+        toggleBitset.test(static_cast<size_t>(TOGGLE::FISHLOD)))
+    {
+        uploadCount = cullFishes(begin, end);
+    }
+    else if (packedFishPers != nullptr)
+    {
+        mFishSimulation.update(g.mclock, packedFishPers);
+    }
+    else if (fishPers != nullptr)
+    {
+        mFishSimulation.update(g.mclock, fishPers);
+    }
+    else
+    {
+        mFishPers.resize(mFishSimulation.getTotalFishCount());
+        mFishSimulation.update(g.mclock, mFishPers.data());
 
-        model->prepareForDraw();
+        for (int i = begin; i <= end; ++i)
+        {
+            FishModel *model = static_cast<FishModel *>(mAquariumModels[i]);
+            int species      = i - begin;
+            int fishCount    = mFishSimulation.getFishCount(species);
+            const FishPer *fishPer = mFishPers.data() + mFishSimulation.getFishOffset(species);
 
-        float fishBaseClock   = g.mclock * g_fishSpeed;
-        float fishRadius      = fishInfo.radius;
-        float fishRadiusRange = fishInfo.radiusRange;
-        float fishSpeed       = fishInfo.speed;
-        float fishSpeedRange  = fishInfo.speedRange;
-        float fishTailSpeed   = fishInfo.tailSpeed * g_fishTailSpeed;
-        float fishOffset      = g_fishOffset;
-        // float fishClockSpeed  = g_fishSpeed;
-        float fishHeight      = g_fishHeight + fishInfo.heightOffset;
-        float fishHeightRange = g_fishHeightRange * fishInfo.heightRange;
-        float fishXClock      = g_fishXClock;
-        float fishYClock      = g_fishYClock;
-        float fishZClock      = g_fishZClock;
-
-        for (int ii = 0; ii < fishCount; ++ii)
-        {
-            float fishClock = fishBaseClock + ii * fishOffset;
-            float speed = fishSpeed + static_cast<float>(matrix::pseudoRandom()) * fishSpeedRange;
-            float scale = 1.0f + static_cast<float>(matrix::pseudoRandom()) * 1;
-            float xRadius =
-                fishRadius + static_cast<float>(matrix::pseudoRandom()) * fishRadiusRange;
-            float yRadius = 2.0f + static_cast<float>(matrix::pseudoRandom()) * fishHeightRange;
-            float zRadius =
-                fishRadius + static_cast<float>(matrix::pseudoRandom()) * fishRadiusRange;
-            float fishSpeedClock = fishClock * speed;
-            float xClock         = fishSpeedClock * fishXClock;
-            float yClock         = fishSpeedClock * fishYClock;
-            float zClock         = fishSpeedClock * fishZClock;
+            for (int ii = 0; ii < fishCount; ++ii, ++fishPer)
+            {
+                model->updateFishPerUniforms(
+                    fishPer->worldPosition[0], fishPer->worldPosition[1],
+                    fishPer->worldPosition[2], fishPer->nextPosition[0],
+                    fishPer->nextPosition[1], fishPer->nextPosition[2], fishPer->scale,
+                    fishPer->time, ii);
+            }
+        }
+    }
 
-            model->updateFishPerUniforms(
-                sin(xClock) * xRadius, sin(yClock) * yRadius + fishHeight, cos(zClock) * zRadius,
-                sin(xClock - 0.04f) * xRadius, sin(yClock - 0.01f) * yRadius + fishHeight,
-                cos(zClock - 0.04f) * zRadius, scale,
-                fmod((g.mclock + ii * g_tailOffsetMult) * fishTailSpeed * speed,
-                     static_cast<float>(M_PI) * 2),
-                ii);
+    mContext->updateAllFishData(uploadCount);
+
+    // The records the backend uploaded, or handed to the fish models one by one.
+    if (packedFishPers != nullptr)
+    {
+        hashFishPers(packedFishPers, sizeof(FishPerPacked), uploadCount);
+    }
+    else if (fishPers != nullptr)
+    {
+        hashFishPers(fishPers, sizeof(FishPer), uploadCount);
+    }
+    else if (toggleBitset.test(static_cast<size_t>(TOGGLE::CULLFISH)) ||
+             toggleBitset.test(static_cast<size_t>(TOGGLE::FISHLOD)))
+    {
+        hashFishPers(mVisibleFishPers.data(), sizeof(FishPerPacked), uploadCount);
+    }
+    else
+    {
+        hashFishPers(mFishPers.data(), sizeof(FishPer), uploadCount);
+    }
+
+    for (int i = begin; i <= end; ++i)
+    {
+        FishModel *model = static_cast<FishModel *>(mAquariumModels[i]);
+        for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+        {
+            int triangleCount = model->getIndexCount(lod) / 3;
+            mFishTriangleCount += static_cast<uint64_t>(model->getLodInstanceCount(lod)) *
+                                  static_cast<uint64_t>(triangleCount);
+        }
+    }
+    ++mFishTriangleFrameCount;
+}
+
+void Aquarium::hashFishPers(const void *fishPers, size_t stride, int count)
+{
+    if (!toggleBitset.test(static_cast<size_t>(TOGGLE::HASHFISHPERS)) ||
+        mFrameCount != mTestFrames)
+    {
+        return;
+    }
+
+    // The padding of the constant buffer layout isn't written, so only the fields are hashed.
+    const unsigned char *record = static_cast<const unsigned char *>(fishPers);
+    mFishPersHash               = hashBytes(nullptr, 0);
+    for (int i = 0; i < count; ++i, record += stride)
+    {
+        mFishPersHash = hashBytes(record, sizeof(FishPerPacked), mFishPersHash);
+    }
+    mHashedFishCount = count;
+}
+
+int Aquarium::cullFishes(int begin, int end)
+{
+    mSimulatedFishPers.resize(mFishSimulation.getTotalFishCount());
+    mFishSimulation.update(g.mclock, mSimulatedFishPers.data());
+    mFishCulling.setViewProjection(toggleBitset.test(static_cast<size_t>(TOGGLE::CULLFISH))
+                                       ? lightWorldPositionUniform.viewProjection
+                                       : nullptr);
+    mFishCulling.setEyePosition(g.eyePosition);
+    mFishCulling.setLodDistances(
+        toggleBitset.test(static_cast<size_t>(TOGGLE::FISHLOD)) ? g_fishLodDistances : nullptr);
+
+    FishPer *fishPers             = mContext->getFishPers();
+    FishPerPacked *packedFishPers = mContext->getPackedFishPers();
+    int visibleCount;
+    if (packedFishPers != nullptr)
+    {
+        visibleCount =
+            mFishCulling.cull(mFishSimulation, mSimulatedFishPers.data(), packedFishPers);
+    }
+    else if (fishPers != nullptr)
+    {
+        visibleCount = mFishCulling.cull(mFishSimulation, mSimulatedFishPers.data(), fishPers);
+    }
+    else
+    {
+        mVisibleFishPers.resize(mFishSimulation.getTotalFishCount());
+        visibleCount =
+            mFishCulling.cull(mFishSimulation, mSimulatedFishPers.data(), mVisibleFishPers.data());
+    }
+
+    for (int i = begin; i <= end; ++i)
+    {
+        FishModel *model = static_cast<FishModel *>(mAquariumModels[i]);
+        int species      = i - begin;
+        model->setVisibleInstances(mFishCulling.getVisibleOffset(species),
+                                   mFishCulling.getLodCounts(species));
+        if (packedFishPers != nullptr || fishPers != nullptr)
+        {
+            continue;
+        }
+
+        const FishPerPacked *fishPer =
+            mVisibleFishPers.data() + mFishCulling.getVisibleOffset(species);
+        for (int ii = 0; ii < mFishCulling.getVisibleCount(species); ++ii, ++fishPer)
+        {
+            model->updateFishPerUniforms(fishPer->worldPosition[0], fishPer->worldPosition[1],
+                                         fishPer->worldPosition[2], fishPer->nextPosition[0],
+                                         fishPer->nextPosition[1], fishPer->nextPosition[2],
+                                         fishPer->scale, fishPer->time, ii);
         }
     }
 
-    mContext->updateAllFishData();
+    return visibleCount;
 }
 
 void Aquarium::drawFishes()
@@ -1050,37 +1772,81 @@ void Aquarium::drawFishes()
     }
 }
 
-void Aquarium::updateWorldProjections(const std::vector<float> &w)
+void Aquarium::recordAndExecuteDraws()
+{
+    bool enableInstancedDraws =
+        toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS));
+    int begin = enableInstancedDraws ? MODELNAME::MODELSMALLFISHAINSTANCEDDRAWS
+                                     : MODELNAME::MODELSMALLFISHA;
+    int end   = enableInstancedDraws ? MODELNAME::MODELBIGFISHBINSTANCEDDRAWS
+                                     : MODELNAME::MODELBIGFISHB;
+
+    mCommandRecorder.begin();
+    for (int i = MODELNAME::MODELRUINCOlOMN; i <= MODELNAME::MODELSEAWEEDB; ++i)
+    {
+        mCommandRecorder.addModel(mAquariumModels[i]);
+    }
+    for (int i = begin; i <= end; ++i)
+    {
+        // Instanced fish models draw all their fish at once.
+        if (enableInstancedDraws)
+        {
+            mCommandRecorder.addModel(mAquariumModels[i]);
+        }
+        else
+        {
+            mCommandRecorder.addFishModel(static_cast<FishModel *>(mAquariumModels[i]));
+        }
+    }
+
+    mCommandRecorder.record(mJobSystem);
+    mCommandRecorder.execute();
+}
+
+// Only the world view projections change from frame to frame, the rest is copied from the
+// placement.
+void Aquarium::updateWorldUniforms(const Model &model,
+                                   int first,
+                                   int count,
+                                   WorldUniforms *uniforms)
 {
-    ASSERT(w.size() == 16);
-    memcpy(worldUniforms.world, w.data(), 16 * sizeof(float));
-    matrix::mulMatrixMatrix4(worldUniforms.worldViewProjection, worldUniforms.world,
-                             lightWorldPositionUniform.viewProjection);
-    matrix::inverse4(g.worldInverse, worldUniforms.world);
-    matrix::transpose4(worldUniforms.worldInverseTranspose, g.worldInverse);
+    const float *worlds                 = model.worldmatrices + first * 16;
+    const float *worldInverseTransposes = model.worldInverseTransposes + first * 16;
+    for (int i = 0; i < count; ++i)
+    {
+        memcpy(uniforms[i].world, worlds + i * 16, 16 * sizeof(float));
+        memcpy(uniforms[i].worldInverseTranspose, worldInverseTransposes + i * 16,
+               16 * sizeof(float));
+    }
+    matrix::mulMatricesMatrix4(uniforms->worldViewProjection, sizeof(WorldUniforms) / sizeof(float),
+                               worlds, count, lightWorldPositionUniform.viewProjection);
 }
 
 void Aquarium::updateWorldMatrixAndDraw(Model *model)
 {
-    if (model->worldmatrices.size())
+    for (int i = 0; i < model->worldmatrixCount; ++i)
     {
-        for (auto &world : model->worldmatrices)
-        {
-            updateWorldProjections(world);
-            model->prepareForDraw();
-            model->updatePerInstanceUniforms(worldUniforms);
-            model->draw();
-        }
+        updateWorldUniforms(*model, i, 1, &worldUniforms);
+        model->prepareForDraw();
+        model->updatePerInstanceUniforms(worldUniforms);
+        model->draw();
     }
 }
 
 void Aquarium::updateWorldMatrix(Model *model)
 {
-    if (model->worldmatrices.size())
+    // Compute the uniforms of all instances right into the backend's array when it has one.
+    int count               = model->worldmatrixCount;
+    WorldUniforms *uniforms = count > 0 ? model->mapWorldUniforms(count) : nullptr;
+    if (uniforms != nullptr)
+    {
+        updateWorldUniforms(*model, 0, count, uniforms);
+    }
+    else
     {
-        for (auto &world : model->worldmatrices)
+        for (int i = 0; i < count; ++i)
         {
-            updateWorldProjections(world);
+            updateWorldUniforms(*model, i, 1, &worldUniforms);
             model->updatePerInstanceUniforms(worldUniforms);
         }
     }
@@ -8,17 +8,25 @@
 #ifndef AQUARIUM_H
 #define AQUARIUM_H
 
-#include "Behavior.h"
-
 #include <bitset>
-#include <queue>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "Arena.h"
+#include "BlockCompression.h"
+#include "CommandStream.h"
 #include "FPSTimer.h"
+#include "FishCulling.h"
+#include "FishSimulation.h"
+#include "Scenario.h"
+#include "Timer.h"
 
+struct AssetLoadPlan;
+struct ModelLoadTask;
 class ContextFactory;
 class Context;
+class JobSystem;
 class Texture;
 class Program;
 class Model;
@@ -37,6 +45,7 @@ enum BACKENDTYPE : short
     BACKENDTYPEDAWNVULKAN,
     BACKENDTYPED3D12,
     BACKENDTYPEOPENGL,
+    BACKENDTYPENULL,
     BACKENDTYPELAST
 };
 
@@ -107,6 +116,18 @@ enum FISHENUM : short
     MAX
 };
 
+// Hash and equality of NUL terminated strings, to look names up right in parsed files without
+// building std::string keys.
+struct CStringHash
+{
+    size_t operator()(const char *string) const;
+};
+
+struct CStringEqual
+{
+    bool operator()(const char *a, const char *b) const;
+};
+
 enum TOGGLE : short
 {
     // Stop rendering after specified time.
@@ -138,10 +159,21 @@ enum TOGGLE : short
     PRINTLOG,
     // Use async buffer mapping to upload data
     BUFFERMAPPINGASYNC,
-    // Simulate fish come and go for Dawn backend
-    SIMULATINGFISHCOMEANDGO,
+    // Play a frame-scripted scenario of fish counts, camera paths and time steps.
+    PLAYSCENARIO,
     // Turn off vsync, donot limit fps to 60
     TURNOFFVSYNC,
+    // Read fish data from a structured buffer of 32 byte records instead of a 256 byte constant
+    // buffer view per fish.
+    PACKFISHPERS,
+    // Record draws into command streams on the workers, and replay them on the main thread.
+    RECORDCOMMANDS,
+    // Only upload and draw the fish that may be visible.
+    CULLFISH,
+    // Draw far fish with decimated meshes.
+    FISHLOD,
+    // Print a hash of the fish data of the last frame at exit.
+    HASHFISHPERS,
     TOGGLEMAX
 };
 
@@ -384,6 +416,12 @@ constexpr float g_net_offsetMult  = 1.21f;
 constexpr float g_eyeRadius       = 13.2f;
 constexpr float g_fieldOfView     = 82.699f;
 
+// Share of the triangles of the full fish mesh kept by each level of detail.
+constexpr float g_fishLodTriangleRatios[FISH_LOD_COUNT] = {1.0f, 0.5f, 0.25f};
+// Distances to the eye, in bounding radii of the fish, from which fish use the next level. At
+// 1080p, a fish spans about 120 pixels at the first one and 50 pixels at the second one.
+constexpr float g_fishLodDistances[FISH_LOD_COUNT - 1] = {10.0f, 25.0f};
+
 struct Global
 {
     float projection[16];
@@ -441,15 +479,34 @@ struct FogUniforms
     float fogColor[4];
 };
 
-struct FishPer
+// The data the fish vertex shader reads for one fish. Packed records are read from a structured
+// buffer, 32 bytes apart.
+struct FishPerPacked
 {
     float worldPosition[3];
     float scale;
     float nextPosition[3];
     float time;
+};
+
+// The same data padded to a constant buffer view of its own.
+struct FishPer : FishPerPacked
+{
     float padding[56];  // TODO(yizhou): the padding is to align with 256 byte offset.
 };
 
+// Frame times around a change of the fish count between scenario phases. The frame that applies
+// the change and the next ones are compared to the frames before it.
+struct FishCountChange
+{
+    int frame;
+    int preFishCount;
+    int curFishCount;
+    double baselineMs;
+    double peakMs;
+    int measuredFrames;
+};
+
 class Aquarium
 {
   public:
@@ -460,6 +517,8 @@ class Aquarium
     Texture *getSkybox() { return mTextureMap["skybox"]; }
     int getCurFishCount() const { return mCurFishCount; }
     int getPreFishCount() const { return mPreFishCount; }
+    // Split a total fish count into per-species counts, indexed like fishTable.
+    static void calculateFishCount(int fishCount, int *fishCounts);
 
     std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> toggleBitset;
     LightWorldPositionUniform lightWorldPositionUniform;
@@ -471,44 +530,98 @@ class Aquarium
 
   private:
     void render();
-    void loadReource();
+    bool loadReource();
     void loadPlacement();
-    void loadModels();
-    void loadFishScenario();
-    void loadModel(const G_sceneInfo &info);
+    bool readAssets(AssetLoadPlan *plan);
+    void collectAssets(AssetLoadPlan *plan);
+    bool decodeAssets(AssetLoadPlan *plan);
+    void uploadAssets(const AssetLoadPlan &plan);
+    void uploadModel(const ModelLoadTask &task);
     void setupModelEnumMap();
-    void calculateFishCount();
     void updateWorldMatrixAndDraw(Model *model);
     void updateGlobalUniforms();
 
-    void updateWorldProjections(const std::vector<float> &w);
+    void updateWorldUniforms(const Model &model, int first, int count, WorldUniforms *uniforms);
     BACKENDTYPE getBackendType(const std::string &backendPath);
     double getElapsedTime();
     void printAvgFps();
     void resetFpsTime();
+    void recordFrameTime();
+    // Move the scenario to the next frame and apply its fish count. Returns false once it ends.
+    bool playScenario();
+    void printFishCountChanges() const;
     void updateWorldMatrix(Model *model);
 
     void updateAndDrawFishes();
+    // Hash the world position, next position, scale and time of count fish records stride bytes
+    // apart, as uploaded in the last frame.
+    void hashFishPers(const void *fishPers, size_t stride, int count);
     void updateAndDrawBackground();
 
     void updateBackground();
     void drawBackground();
     void updateFishes();
+    // Simulate all fish, and copy the ones that may be visible to the fish data, sorted by level
+    // of detail. The fish models in [begin, end] then draw only those. Returns how many there are.
+    int cullFishes(int begin, int end);
     void drawFishes();
+    // drawBackground() and drawFishes() through command streams.
+    void recordAndExecuteDraws();
 
-    std::unordered_map<std::string, MODELNAME> mModelEnumMap;
+    // Keyed by the names in g_sceneInfo.
+    std::unordered_map<const char *, MODELNAME, CStringHash, CStringEqual> mModelEnumMap;
     std::unordered_map<std::string, Texture *> mTextureMap;
     std::unordered_map<std::string, Program *> mProgramMap;
     Model *mAquariumModels[MODELNAME::MODELMAX];
     Context *mContext;
     FPSTimer mFpsTimer;  // object to measure frames per second;
+    // CPU time render() spent issuing draws in the last frame, in milliseconds.
+    double mDrawTime;
+    FishSimulation mFishSimulation;
+    // Fish data for backends that don't expose their own FishPer array.
+    std::vector<FishPer> mFishPers;
+    FishCulling mFishCulling;
+    // All fish as simulated, before the visible ones are copied to the fish data of the context.
+    std::vector<FishPerPacked> mSimulatedFishPers;
+    // Visible fish for backends that don't expose their own fish data.
+    std::vector<FishPerPacked> mVisibleFishPers;
+    // Triangles of the fish drawn over the frames, to compare levels of detail on and off.
+    uint64_t mFishTriangleCount;
+    int mFishTriangleFrameCount;
     int mCurFishCount;
     int mPreFishCount;
     int mTestTime;
+    // Frames rendered before exiting with --frames, 0 to run on the test time.
+    int mTestFrames;
+    // Seconds the fish and the camera advance per frame with --fixed-dt, 0 to follow the clock.
+    double mFixedTimeStep;
+    // CPU time of the work of each frame with --frames, in milliseconds, and the fish simulated
+    // over the frames.
+    FrameTimeHistogram mWorkUpdateTimes;
+    FrameTimeHistogram mWorkRecordTimes;
+    FrameTimeHistogram mWorkSubmitTimes;
+    uint64_t mWorkFishCount;
+    // Hash of the fish records uploaded in the last frame with --hash-fish-pers, and their count.
+    uint64_t mFishPersHash;
+    int mHashedFishCount;
+    // Where to export the time of every frame, empty unless --frame-time-csv is passed.
+    std::string mFrameTimeCsvPath;
+    TEXTURECOMPRESSION mTextureCompression;
     BACKENDTYPE mBackendType;
     ContextFactory *mFactory;
+    JobSystem *mJobSystem;
+    CommandRecorder mCommandRecorder;
     std::vector<std::string> mSkyUrls;
-    std::queue<Behavior *> mFishBehavior;
+    // World matrices of the models, in a single chunk sized by loadPlacement().
+    BumpArena mPlacementArena;
+    // Played with --scenario or --simulating-fish-come-and-go.
+    Scenario mScenario;
+    std::string mScenarioPath;
+    std::vector<FishCountChange> mFishCountChanges;
+    // Recent frame times in milliseconds, the baseline of the next count change.
+    std::vector<double> mRecentFrameTimes;
+    timer::Clock::time_point mFrameStart;
+    int mFrameCount;
 };
 
 #endif
@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Arena.cpp: Implement the bump allocator.
+
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "AQUARIUM_ASSERT.h"
+
+namespace {
+
+char *alignPointer(char *pointer, size_t alignment)
+{
+    uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+    return pointer + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+}
+
+}  // namespace
+
+BumpArena::BumpArena(size_t chunkSize)
+    : mChunkSize(chunkSize), mChunks(), mCursor(nullptr), mEnd(nullptr), mAllocatedBytes(0)
+{
+}
+
+void *BumpArena::allocate(size_t size, size_t alignment)
+{
+    reserve(size, alignment);
+    char *result = alignPointer(mCursor, alignment);
+
+    mCursor = result + size;
+    mAllocatedBytes += size;
+    return result;
+}
+
+void BumpArena::reserve(size_t size, size_t alignment)
+{
+    ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    char *start = mCursor != nullptr ? alignPointer(mCursor, alignment) : nullptr;
+    if (start == nullptr || start > mEnd || size > static_cast<size_t>(mEnd - start))
+    {
+        addChunk(size, alignment);
+    }
+}
+
+void BumpArena::addChunk(size_t size, size_t alignment)
+{
+    // The chunk is over-allocated by the alignment, so that size bytes fit wherever new[] puts it.
+    size_t chunkSize = std::max(mChunkSize, size) + alignment;
+    mChunks.emplace_back(new char[chunkSize]);
+    mCursor = mChunks.back().get();
+    mEnd    = mCursor + chunkSize;
+}
+
+void BumpArena::reset()
+{
+    mChunks.clear();
+    mCursor         = nullptr;
+    mEnd            = nullptr;
+    mAllocatedBytes = 0;
+}
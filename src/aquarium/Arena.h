@@ -0,0 +1,53 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Arena.h: Define the bump allocator that holds the output of the asset parsers. Allocations
+// are carved out of large chunks and only released all at once.
+
+#pragma once
+#ifndef ARENA_H
+#define ARENA_H 1
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class BumpArena
+{
+  public:
+    explicit BumpArena(size_t chunkSize = 64 * 1024);
+    BumpArena(const BumpArena &) = delete;
+    BumpArena &operator=(const BumpArena &) = delete;
+
+    // alignment must be a power of two. Requests larger than a chunk get a chunk of their own.
+    void *allocate(size_t size, size_t alignment);
+
+    template <typename T>
+    T *allocateArray(size_t count, size_t alignment = alignof(T))
+    {
+        return static_cast<T *>(allocate(count * sizeof(T), alignment));
+    }
+
+    // Make the next allocations come from a single chunk, as long as their sizes, each rounded up
+    // to its alignment, add up to at most size and no alignment is larger than the given one.
+    void reserve(size_t size, size_t alignment);
+
+    // Release every allocation.
+    void reset();
+
+    size_t getAllocatedBytes() const { return mAllocatedBytes; }
+    size_t getChunkCount() const { return mChunks.size(); }
+
+  private:
+    void addChunk(size_t size, size_t alignment);
+
+    size_t mChunkSize;
+    std::vector<std::unique_ptr<char[]>> mChunks;
+    char *mCursor;
+    char *mEnd;
+    size_t mAllocatedBytes;
+};
+
+#endif  // !ARENA_H
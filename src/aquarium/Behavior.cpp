@@ -1,7 +0,0 @@
-//
-// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
-// Use of this source code is governed by a BSD-style license that can be
-// found in the LICENSE file.
-//
-
-#include "Behavior.h"
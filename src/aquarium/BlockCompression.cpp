@@ -0,0 +1,679 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// BlockCompression.cpp: Implement the block encoders and decoders and the compression of mip
+// chains.
+
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "JobSystem.h"
+
+namespace {
+
+// Blocks per job, so that small levels don't pay for the synchronization.
+constexpr int kCompressJobBlocks = 1024;
+// Least squares passes over the color endpoints. Later passes rarely improve the block.
+constexpr int kRefinementPasses = 2;
+
+// A 4x4 block of RGBA8 texels, row after row.
+typedef uint8_t BlockTexels[64];
+
+void loadBlock(const uint8_t *texels, size_t pitch, BlockTexels block)
+{
+    for (int y = 0; y < 4; ++y)
+    {
+        memcpy(block + y * 16, texels + pitch * y, 16);
+    }
+}
+
+// Blocks that stick out of the level repeat its last row and column.
+void gatherBlock(const uint8_t *level,
+                 size_t pitch,
+                 int width,
+                 int height,
+                 int blockX,
+                 int blockY,
+                 BlockTexels block)
+{
+    for (int y = 0; y < 4; ++y)
+    {
+        const uint8_t *row = level + pitch * std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; ++x)
+        {
+            memcpy(block + (y * 4 + x) * 4, row + std::min(blockX * 4 + x, width - 1) * 4, 4);
+        }
+    }
+}
+
+void storeBlock(const BlockTexels block,
+                uint8_t *level,
+                size_t pitch,
+                int width,
+                int height,
+                int blockX,
+                int blockY)
+{
+    for (int y = 0; y < 4 && blockY * 4 + y < height; ++y)
+    {
+        uint8_t *row = level + pitch * (blockY * 4 + y) + blockX * 16;
+        int count    = std::min(width - blockX * 4, 4);
+        memcpy(row, block + y * 16, count * 4);
+    }
+}
+
+int quantizeChannel(float value, int maxCode)
+{
+    return static_cast<int>(std::min(std::max(value, 0.0f), 255.0f) * maxCode / 255.0f + 0.5f);
+}
+
+uint16_t quantize565(const float *color)
+{
+    int r = quantizeChannel(color[0], 31);
+    int g = quantizeChannel(color[1], 63);
+    int b = quantizeChannel(color[2], 31);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void expand565(uint16_t color, int *rgb)
+{
+    int r  = (color >> 11) & 31;
+    int g  = (color >> 5) & 63;
+    int b  = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Palette of the 4 color mode, in index order.
+void buildColorPalette(uint16_t color0, uint16_t color1, int palette[4][3])
+{
+    expand565(color0, palette[0]);
+    expand565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+    }
+}
+
+// Pick the nearest palette entry of each texel. Returns the squared error of the block.
+int selectColorIndices(const BlockTexels texels,
+                       uint16_t color0,
+                       uint16_t color1,
+                       uint8_t *indices)
+{
+    int palette[4][3];
+    buildColorPalette(color0, color1, palette);
+
+    int error = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        const uint8_t *texel = texels + i * 4;
+        int best             = 0;
+        int bestError        = 0x7fffffff;
+        for (int p = 0; p < 4; ++p)
+        {
+            int dr = texel[0] - palette[p][0];
+            int dg = texel[1] - palette[p][1];
+            int db = texel[2] - palette[p][2];
+            int e  = dr * dr + dg * dg + db * db;
+            if (e < bestError)
+            {
+                best      = p;
+                bestError = e;
+            }
+        }
+        indices[i] = static_cast<uint8_t>(best);
+        error += bestError;
+    }
+    return error;
+}
+
+// Endpoints that minimize the squared error of the block for the given indices. Returns false if
+// all texels use the same weight, which leaves the endpoints undetermined.
+bool fitColorEndpoints(const BlockTexels texels, const uint8_t *indices, float *end0, float *end1)
+{
+    // Weight of endpoint 0 for each index.
+    static const float kWeights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = {0.0f, 0.0f, 0.0f};
+    float bx[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i)
+    {
+        float a = kWeights[indices[i]];
+        float b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < 3; ++c)
+        {
+            ax[c] += a * texels[i * 4 + c];
+            bx[c] += b * texels[i * 4 + c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f)
+    {
+        return false;
+    }
+    for (int c = 0; c < 3; ++c)
+    {
+        end0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+        end1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    }
+    return true;
+}
+
+// Endpoints at the extremes of the block along the principal axis of its colors.
+void findPrincipalEndpoints(const BlockTexels texels, float *end0, float *end1)
+{
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            mean[c] += texels[i * 4 + c];
+        }
+    }
+    for (int c = 0; c < 3; ++c)
+    {
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i)
+    {
+        float r = texels[i * 4 + 0] - mean[0];
+        float g = texels[i * 4 + 1] - mean[1];
+        float b = texels[i * 4 + 2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    // A few steps of power iteration are enough to separate the dominant axis of a block.
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 4; ++iteration)
+    {
+        float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        float largest = std::max(std::max(std::abs(x), std::abs(y)), std::abs(z));
+        if (largest < 1e-6f)
+        {
+            break;
+        }
+        axis[0] = x / largest;
+        axis[1] = y / largest;
+        axis[2] = z / largest;
+    }
+    float norm = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    for (int c = 0; c < 3; ++c)
+    {
+        axis[c] /= norm;
+    }
+
+    float minT = 0.0f;
+    float maxT = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = (texels[i * 4 + 0] - mean[0]) * axis[0] +
+                  (texels[i * 4 + 1] - mean[1]) * axis[1] +
+                  (texels[i * 4 + 2] - mean[2]) * axis[2];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for (int c = 0; c < 3; ++c)
+    {
+        end0[c] = mean[c] + axis[c] * maxT;
+        end1[c] = mean[c] + axis[c] * minT;
+    }
+}
+
+// The color half of BC1 and BC3, always in 4 color mode.
+void encodeColorBlock(const BlockTexels texels, uint8_t *block)
+{
+    float end0[3];
+    float end1[3];
+    findPrincipalEndpoints(texels, end0, end1);
+
+    uint16_t color0 = quantize565(end0);
+    uint16_t color1 = quantize565(end1);
+    uint8_t indices[16];
+    int error = selectColorIndices(texels, color0, color1, indices);
+
+    for (int pass = 0; pass < kRefinementPasses && error > 0; ++pass)
+    {
+        if (!fitColorEndpoints(texels, indices, end0, end1))
+        {
+            break;
+        }
+        uint16_t refined0 = quantize565(end0);
+        uint16_t refined1 = quantize565(end1);
+        uint8_t refinedIndices[16];
+        int refinedError = selectColorIndices(texels, refined0, refined1, refinedIndices);
+        if (refinedError >= error)
+        {
+            break;
+        }
+        color0 = refined0;
+        color1 = refined1;
+        error  = refinedError;
+        memcpy(indices, refinedIndices, sizeof(indices));
+    }
+
+    // BC1 blocks whose first color isn't the larger one are in 3 color mode. Swapping the colors
+    // swaps entries 0 and 1 and entries 2 and 3 of the palette.
+    uint8_t flip = 0;
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+        flip = 1;
+    }
+    else if (color0 == color1)
+    {
+        memset(indices, 0, sizeof(indices));
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        bits |= static_cast<uint32_t>(indices[i] ^ flip) << (2 * i);
+    }
+    block[0] = static_cast<uint8_t>(color0);
+    block[1] = static_cast<uint8_t>(color0 >> 8);
+    block[2] = static_cast<uint8_t>(color1);
+    block[3] = static_cast<uint8_t>(color1 >> 8);
+    for (int i = 0; i < 4; ++i)
+    {
+        block[4 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+}
+
+// Palette of the 8 value mode, in index order.
+void buildChannelPalette(int value0, int value1, int *palette)
+{
+    palette[0] = value0;
+    palette[1] = value1;
+    for (int i = 2; i < 8; ++i)
+    {
+        palette[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+    }
+}
+
+// One channel of the block, the alpha half of BC3 and each half of BC5.
+void encodeChannelBlock(const BlockTexels texels, int channel, uint8_t *block)
+{
+    int minValue = 255;
+    int maxValue = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        minValue = std::min(minValue, static_cast<int>(texels[i * 4 + channel]));
+        maxValue = std::max(maxValue, static_cast<int>(texels[i * 4 + channel]));
+    }
+
+    block[0] = static_cast<uint8_t>(maxValue);
+    block[1] = static_cast<uint8_t>(minValue);
+    uint64_t bits = 0;
+    if (maxValue > minValue)
+    {
+        int palette[8];
+        buildChannelPalette(maxValue, minValue, palette);
+        for (int i = 0; i < 16; ++i)
+        {
+            int value     = texels[i * 4 + channel];
+            int best      = 0;
+            int bestError = 256;
+            for (int p = 0; p < 8; ++p)
+            {
+                int e = std::abs(value - palette[p]);
+                if (e < bestError)
+                {
+                    best      = p;
+                    bestError = e;
+                }
+            }
+            bits |= static_cast<uint64_t>(best) << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; ++i)
+    {
+        block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+}
+
+void decodeColorBlock(const uint8_t *block, bool allowThreeColors, BlockTexels texels)
+{
+    uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    int palette[4][3];
+    buildColorPalette(color0, color1, palette);
+    int alpha[4] = {255, 255, 255, 255};
+    if (allowThreeColors && color0 <= color1)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+        alpha[3] = 0;
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        bits |= static_cast<uint32_t>(block[4 + i]) << (8 * i);
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        int index = (bits >> (2 * i)) & 3;
+        for (int c = 0; c < 3; ++c)
+        {
+            texels[i * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+        }
+        texels[i * 4 + 3] = static_cast<uint8_t>(alpha[index]);
+    }
+}
+
+void decodeChannelBlock(const uint8_t *block, int channel, BlockTexels texels)
+{
+    int palette[8];
+    if (block[0] > block[1])
+    {
+        buildChannelPalette(block[0], block[1], palette);
+    }
+    else
+    {
+        palette[0] = block[0];
+        palette[1] = block[1];
+        for (int i = 2; i < 6; ++i)
+        {
+            palette[i] = ((6 - i) * block[0] + (i - 1) * block[1] + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i)
+    {
+        bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        texels[i * 4 + channel] = static_cast<uint8_t>(palette[(bits >> (3 * i)) & 7]);
+    }
+}
+
+void encodeBlock(TEXTUREFORMAT format, const BlockTexels texels, uint8_t *block)
+{
+    switch (format)
+    {
+        case TEXTUREFORMATBC1:
+            encodeColorBlock(texels, block);
+            break;
+        case TEXTUREFORMATBC3:
+            encodeChannelBlock(texels, 3, block);
+            encodeColorBlock(texels, block + 8);
+            break;
+        case TEXTUREFORMATBC5:
+            encodeChannelBlock(texels, 0, block);
+            encodeChannelBlock(texels, 1, block + 8);
+            break;
+        default:
+            break;
+    }
+}
+
+void decodeBlock(TEXTUREFORMAT format, const uint8_t *block, BlockTexels texels)
+{
+    switch (format)
+    {
+        case TEXTUREFORMATBC1:
+            decodeColorBlock(block, true, texels);
+            break;
+        case TEXTUREFORMATBC3:
+            decodeColorBlock(block + 8, false, texels);
+            decodeChannelBlock(block, 3, texels);
+            break;
+        case TEXTUREFORMATBC5:
+            for (int i = 0; i < 16; ++i)
+            {
+                texels[i * 4 + 2] = 0;
+                texels[i * 4 + 3] = 255;
+            }
+            decodeChannelBlock(block, 0, texels);
+            decodeChannelBlock(block + 8, 1, texels);
+            break;
+        default:
+            break;
+    }
+}
+
+}  // namespace
+
+bool parseTextureCompression(const char *name, TEXTURECOMPRESSION *compression)
+{
+    for (int i = 0; i < TEXTURECOMPRESSIONMAX; ++i)
+    {
+        if (strcmp(name, getTextureCompressionName(static_cast<TEXTURECOMPRESSION>(i))) == 0)
+        {
+            *compression = static_cast<TEXTURECOMPRESSION>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *getTextureCompressionName(TEXTURECOMPRESSION compression)
+{
+    switch (compression)
+    {
+        case TEXTURECOMPRESSIONBC:
+            return "bc";
+        default:
+            return "none";
+    }
+}
+
+TEXTUREFORMAT chooseTextureFormat(const MipChain &chain, TEXTURECOMPRESSION compression)
+{
+    if (compression == TEXTURECOMPRESSIONNONE || chain.getFormat() != TEXTUREFORMATRGBA8)
+    {
+        return chain.getFormat();
+    }
+    int width  = chain.getWidth(0);
+    int height = chain.getHeight(0);
+    if (width % 4 != 0 || height % 4 != 0)
+    {
+        return TEXTUREFORMATRGBA8;
+    }
+
+    // Levels below are averages of the base level, so they are opaque if it is.
+    for (int layer = 0; layer < chain.getLayerCount(); ++layer)
+    {
+        const uint8_t *pixels = chain.getPixels(layer, 0);
+        for (int y = 0; y < height; ++y)
+        {
+            const uint8_t *row = pixels + chain.getRowPitch(0) * y;
+            for (int x = 0; x < width; ++x)
+            {
+                if (row[x * 4 + 3] != 255)
+                {
+                    return TEXTUREFORMATBC3;
+                }
+            }
+        }
+    }
+    return TEXTUREFORMATBC1;
+}
+
+void encodeBC1Block(const uint8_t *texels, size_t pitch, uint8_t *block)
+{
+    BlockTexels loaded;
+    loadBlock(texels, pitch, loaded);
+    encodeBlock(TEXTUREFORMATBC1, loaded, block);
+}
+
+void encodeBC3Block(const uint8_t *texels, size_t pitch, uint8_t *block)
+{
+    BlockTexels loaded;
+    loadBlock(texels, pitch, loaded);
+    encodeBlock(TEXTUREFORMATBC3, loaded, block);
+}
+
+void encodeBC5Block(const uint8_t *texels, size_t pitch, uint8_t *block)
+{
+    BlockTexels loaded;
+    loadBlock(texels, pitch, loaded);
+    encodeBlock(TEXTUREFORMATBC5, loaded, block);
+}
+
+void decodeBC1Block(const uint8_t *block, uint8_t *texels, size_t pitch)
+{
+    BlockTexels decoded;
+    decodeBlock(TEXTUREFORMATBC1, block, decoded);
+    storeBlock(decoded, texels, pitch, 4, 4, 0, 0);
+}
+
+void decodeBC3Block(const uint8_t *block, uint8_t *texels, size_t pitch)
+{
+    BlockTexels decoded;
+    decodeBlock(TEXTUREFORMATBC3, block, decoded);
+    storeBlock(decoded, texels, pitch, 4, 4, 0, 0);
+}
+
+void decodeBC5Block(const uint8_t *block, uint8_t *texels, size_t pitch)
+{
+    BlockTexels decoded;
+    decodeBlock(TEXTUREFORMATBC5, block, decoded);
+    storeBlock(decoded, texels, pitch, 4, 4, 0, 0);
+}
+
+void compressMipChains(JobSystem *jobSystem,
+                       const std::vector<MipChain *> &chains,
+                       const std::vector<TEXTUREFORMAT> &formats)
+{
+    struct CompressJob
+    {
+        int chain;
+        int layer;
+        int level;
+        int firstRow;
+        int lastRow;
+    };
+
+    std::vector<MipChain> compressed(chains.size());
+    std::vector<CompressJob> jobs;
+    for (size_t i = 0; i < chains.size(); ++i)
+    {
+        const MipChain &source = *chains[i];
+        if (formats[i] == TEXTUREFORMATRGBA8 || source.getFormat() != TEXTUREFORMATRGBA8)
+        {
+            continue;
+        }
+        compressed[i].allocate(source.getWidth(0), source.getHeight(0), source.getLevelCount(),
+                               source.getLayerCount(), formats[i]);
+
+        for (int level = 0; level < source.getLevelCount(); ++level)
+        {
+            int blocksWide = (source.getWidth(level) + 3) / 4;
+            int rowCount   = compressed[i].getRowCount(level);
+            int rowsPerJob = std::max(kCompressJobBlocks / blocksWide, 1);
+            for (int layer = 0; layer < source.getLayerCount(); ++layer)
+            {
+                for (int row = 0; row < rowCount; row += rowsPerJob)
+                {
+                    jobs.push_back({static_cast<int>(i), layer, level, row,
+                                    std::min(row + rowsPerJob, rowCount)});
+                }
+            }
+        }
+    }
+
+    auto run = [&](int begin, int end) {
+        for (int j = begin; j < end; ++j)
+        {
+            const CompressJob &job = jobs[j];
+            const MipChain &source = *chains[job.chain];
+            MipChain &destination  = compressed[job.chain];
+            TEXTUREFORMAT format   = destination.getFormat();
+            size_t blockSize       = MipChain::getBlockByteSize(format);
+            int width              = source.getWidth(job.level);
+            int height             = source.getHeight(job.level);
+            int blocksWide         = (width + 3) / 4;
+            const uint8_t *texels  = source.getPixels(job.layer, job.level);
+
+            for (int blockY = job.firstRow; blockY < job.lastRow; ++blockY)
+            {
+                uint8_t *block = destination.getPixels(job.layer, job.level) +
+                                 destination.getRowPitch(job.level) * blockY;
+                for (int blockX = 0; blockX < blocksWide; ++blockX, block += blockSize)
+                {
+                    BlockTexels gathered;
+                    gatherBlock(texels, source.getRowPitch(job.level), width, height, blockX,
+                                blockY, gathered);
+                    encodeBlock(format, gathered, block);
+                }
+            }
+        }
+    };
+    if (jobSystem != nullptr)
+    {
+        jobSystem->parallelFor(static_cast<int>(jobs.size()), 1, run);
+    }
+    else
+    {
+        run(0, static_cast<int>(jobs.size()));
+    }
+
+    for (size_t i = 0; i < chains.size(); ++i)
+    {
+        if (compressed[i].getLevelCount() > 0)
+        {
+            compressed[i].mGenerated = true;
+            *chains[i]               = std::move(compressed[i]);
+        }
+    }
+}
+
+void decompressMipChain(const MipChain &chain, MipChain *decoded)
+{
+    decoded->allocate(chain.getWidth(0), chain.getHeight(0), chain.getLevelCount(),
+                      chain.getLayerCount());
+    TEXTUREFORMAT format = chain.getFormat();
+    size_t blockSize     = MipChain::getBlockByteSize(format);
+    for (int layer = 0; layer < chain.getLayerCount(); ++layer)
+    {
+        for (int level = 0; level < chain.getLevelCount(); ++level)
+        {
+            int width      = chain.getWidth(level);
+            int height     = chain.getHeight(level);
+            int blocksWide = (width + 3) / 4;
+            for (int blockY = 0; blockY < chain.getRowCount(level); ++blockY)
+            {
+                const uint8_t *block =
+                    chain.getPixels(layer, level) + chain.getRowPitch(level) * blockY;
+                for (int blockX = 0; blockX < blocksWide; ++blockX, block += blockSize)
+                {
+                    BlockTexels texels;
+                    decodeBlock(format, block, texels);
+                    storeBlock(texels, decoded->getPixels(layer, level),
+                               decoded->getRowPitch(level), width, height, blockX, blockY);
+                }
+            }
+        }
+    }
+    decoded->mGenerated = true;
+}
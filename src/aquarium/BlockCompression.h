@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// BlockCompression.h: Define the CPU encoders of the BC1, BC3 and BC5 block compressed formats,
+// and the compression of whole mip chains on the job system.
+//
+// Colors are fit along the principal axis of each block and the endpoints refined by least
+// squares. Single channels, the alpha of BC3 and both channels of BC5, use the 8 value mode
+// between the minimum and the maximum of the block. The decoders follow the D3D rounding closely
+// enough to measure the quality of the encoders, they aren't meant to match the hardware bit for
+// bit.
+
+#pragma once
+#ifndef BLOCKCOMPRESSION_H
+#define BLOCKCOMPRESSION_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MipChain.h"
+
+class JobSystem;
+
+enum TEXTURECOMPRESSION : short
+{
+    // Upload textures as RGBA8.
+    TEXTURECOMPRESSIONNONE,
+    // Compress textures with a multiple of 4 as size to BC1 if they are opaque, BC3 otherwise.
+    TEXTURECOMPRESSIONBC,
+    TEXTURECOMPRESSIONMAX
+};
+
+bool parseTextureCompression(const char *name, TEXTURECOMPRESSION *compression);
+const char *getTextureCompressionName(TEXTURECOMPRESSION compression);
+
+// The format compression picks for the generated RGBA8 chain. D3D12 needs the base level of
+// block compressed textures to be a multiple of the block size, smaller textures stay RGBA8.
+//
+// The normal maps of the aquarium keep the specular intensity in alpha and the shaders read all
+// three components of the normal, so they are opaque to this choice and end up as BC3. BC5 only
+// suits normal maps whose shaders reconstruct z from x and y.
+TEXTUREFORMAT chooseTextureFormat(const MipChain &chain, TEXTURECOMPRESSION compression);
+
+// Encode or decode the 4x4 block of RGBA8 texels that starts at texels, rows pitch bytes apart.
+void encodeBC1Block(const uint8_t *texels, size_t pitch, uint8_t *block);
+void encodeBC3Block(const uint8_t *texels, size_t pitch, uint8_t *block);
+// Encodes red and green.
+void encodeBC5Block(const uint8_t *texels, size_t pitch, uint8_t *block);
+void decodeBC1Block(const uint8_t *block, uint8_t *texels, size_t pitch);
+void decodeBC3Block(const uint8_t *block, uint8_t *texels, size_t pitch);
+// Decodes red and green, blue is 0 and alpha 255.
+void decodeBC5Block(const uint8_t *block, uint8_t *texels, size_t pitch);
+
+// Replace each generated RGBA8 chain by its compression to the format at the same index. Chains
+// whose format is RGBA8 are left alone. Blocks don't depend on each other, so all levels of all
+// chains are encoded in a single wave of jobs split by block rows.
+void compressMipChains(JobSystem *jobSystem,
+                       const std::vector<MipChain *> &chains,
+                       const std::vector<TEXTUREFORMAT> &formats);
+
+// Decode all levels of a compressed chain back into an RGBA8 chain of the same size.
+void decompressMipChain(const MipChain &chain, MipChain *decoded);
+
+#endif  // !BLOCKCOMPRESSION_H
@@ -6,20 +6,134 @@
 
 #include "BufferManager.h"
 
+#include <algorithm>
+
 #include "AQUARIUM_ASSERT.h"
 
-BufferManager::BufferManager() : mBufferPoolSize(BUFFER_POOL_MAX_SIZE), mUsedSize(0), mCount(0) {}
+RingBuffer::RingBuffer(size_t size) : RingBuffer(size, nullptr)
+{
+    mStorage.resize(size);
+    mData = mStorage.data();
+}
+
+RingBuffer::RingBuffer(size_t size, uint8_t *data)
+    : mHead(0),
+      mTail(0),
+      mSize(size),
+      mCapacity(size),
+      mUsedSize(0),
+      mFrameSize(0),
+      mPaddingSize(0),
+      mData(data),
+      mIndex(0)
+{
+}
+
+bool RingBuffer::reset(size_t size)
+{
+    if (size > mCapacity || mUsedSize != 0)
+    {
+        return false;
+    }
+
+    mSize = size;
+    mHead = 0;
+    mTail = 0;
+    return true;
+}
+
+// The used region runs from mTail to mHead, wrapping around the end. mUsedSize tells a full ring
+// from an empty one when both are equal, and includes the padding, which is retired along with the
+// frame that skipped it.
+size_t RingBuffer::allocate(size_t size, size_t alignment)
+{
+    if (size == 0 || size > mSize)
+    {
+        return kInvalidOffset;
+    }
+
+    size_t offset = (mHead + alignment - 1) & ~(alignment - 1);
+    if (mHead >= mTail && !(mHead == mTail && mUsedSize != 0))
+    {
+        // Free from the head to the end, then from the start to the tail.
+        if (offset + size > mSize)
+        {
+            if (size > mTail)
+            {
+                return kInvalidOffset;
+            }
+            offset = 0;
+        }
+    }
+    else if (offset + size > mTail)
+    {
+        return kInvalidOffset;
+    }
+
+    size_t padding = offset >= mHead ? offset - mHead : mSize - mHead;
+    mPaddingSize += padding;
+    mUsedSize += padding + size;
+    mFrameSize += padding + size;
+    mHead = offset + size;
+    return offset;
+}
+
+void RingBuffer::finishFrame(uint64_t serial)
+{
+    // Frames without allocations have nothing to retire.
+    if (mFrameSize == 0)
+    {
+        return;
+    }
+
+    mFrameRegions.push({serial, mHead, mFrameSize});
+    mFrameSize = 0;
+}
+
+void RingBuffer::retire(uint64_t completedSerial)
+{
+    while (!mFrameRegions.empty() && mFrameRegions.front().serial <= completedSerial)
+    {
+        mTail = mFrameRegions.front().end;
+        mUsedSize -= mFrameRegions.front().size;
+        mFrameRegions.pop();
+    }
+
+    // Start over from the beginning once idle, so that the next frames don't wrap.
+    if (mUsedSize == 0)
+    {
+        mHead = 0;
+        mTail = 0;
+    }
+}
+
+BufferManager::BufferManager(const FrameFence *fence)
+    : mFence(fence), mBufferPoolSize(BUFFER_POOL_MAX_SIZE), mUsedSize(0), mCurrentIndex(0)
+{
+}
 
 BufferManager::~BufferManager()
 {
     destroyBufferPool();
 }
 
+void BufferManager::destroyBufferPool()
+{
+    for (RingBuffer *buffer : mEnqueuedBufferList)
+    {
+        buffer->destory();
+        delete buffer;
+    }
+    mEnqueuedBufferList.clear();
+    mUsedSize     = 0;
+    mCurrentIndex = 0;
+}
+
 bool BufferManager::resetBuffer(RingBuffer *ringBuffer, size_t size)
 {
-    size_t index = find(ringBuffer);
+    size_t index = ringBuffer->mIndex;
 
-    if (index >= mEnqueuedBufferList.size())
+    if (index >= mEnqueuedBufferList.size() || mEnqueuedBufferList[index] != ringBuffer)
     {
         return false;
     }
@@ -27,10 +141,9 @@ bool BufferManager::resetBuffer(RingBuffer *ringBuffer, size_t size)
     size_t oldSize = ringBuffer->getSize();
 
     bool result = ringBuffer->reset(size);
-    // If the size is larger than the ring buffer size, reset fails and the ring
-    // buffer retains.
-    // If the size is equal or smaller than the ring buffer size, reset success
-    // and the used size need to be updated.
+    // If the size is larger than the ring buffer capacity or the ring buffer holds allocations,
+    // reset fails and the ring buffer retains.
+    // Otherwise reset success and the used size need to be updated.
     if (!result)
     {
         return false;
@@ -43,34 +156,98 @@ bool BufferManager::resetBuffer(RingBuffer *ringBuffer, size_t size)
     return true;
 }
 
+// The last ring takes the place of the destroyed one, so that removal is O(1).
 bool BufferManager::destoryBuffer(RingBuffer *ringBuffer)
 {
-    size_t index = find(ringBuffer);
+    size_t index = ringBuffer->mIndex;
 
-    if (index >= mEnqueuedBufferList.size())
+    if (index >= mEnqueuedBufferList.size() || mEnqueuedBufferList[index] != ringBuffer)
     {
         return false;
     }
 
+    RingBuffer *last           = mEnqueuedBufferList.back();
+    last->mIndex               = index;
+    mEnqueuedBufferList[index] = last;
+    mEnqueuedBufferList.pop_back();
+    mCurrentIndex = 0;
+
     mUsedSize -= ringBuffer->getSize();
     ringBuffer->destory();
-    mEnqueuedBufferList.erase(mEnqueuedBufferList.begin() + index);
+    delete ringBuffer;
 
     return true;
 }
 
-size_t BufferManager::find(RingBuffer *ringBuffer)
+// At most BUFFER_MAX_COUNT rings of the default size fit in the pool, so looking for room is
+// bounded, and usually ends at the ring that served the previous allocation.
+RingBuffer *BufferManager::allocate(size_t size, size_t *offset)
 {
-    size_t index = 0;
-    for (auto buffer : mEnqueuedBufferList)
+    if (size == 0)
     {
-        if (buffer == ringBuffer)
+        return nullptr;
+    }
+
+    size_t count = mEnqueuedBufferList.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t index        = (mCurrentIndex + i) % count;
+        RingBuffer *buffer  = mEnqueuedBufferList[index];
+        size_t bufferOffset = buffer->allocate(size);
+        if (bufferOffset != RingBuffer::kInvalidOffset)
         {
-            break;
+            mCurrentIndex = index;
+            *offset       = bufferOffset;
+            return buffer;
         }
-        index++;
     }
-    return index;
+
+    size_t bufferSize = std::max(size, BUFFER_PER_ALLOCATE_SIZE);
+    if (mUsedSize + bufferSize > mBufferPoolSize)
+    {
+        return nullptr;
+    }
+
+    RingBuffer *buffer = createRingBuffer(bufferSize);
+    if (buffer == nullptr)
+    {
+        return nullptr;
+    }
+    buffer->mIndex = mEnqueuedBufferList.size();
+    mEnqueuedBufferList.push_back(buffer);
+    mUsedSize += bufferSize;
+    mCurrentIndex = buffer->mIndex;
+
+    *offset = buffer->allocate(size);
+    ASSERT(*offset != RingBuffer::kInvalidOffset);
+    return buffer;
+}
+
+void BufferManager::finishFrame(uint64_t serial)
+{
+    for (RingBuffer *buffer : mEnqueuedBufferList)
+    {
+        buffer->finishFrame(serial);
+    }
+}
+
+void BufferManager::retireFrames()
+{
+    uint64_t completedSerial = mFence->getCompletedSerial();
+    for (RingBuffer *buffer : mEnqueuedBufferList)
+    {
+        buffer->retire(completedSerial);
+    }
+}
+
+uint64_t BufferManager::getPaddingSize() const
+{
+    uint64_t paddingSize = 0;
+    for (const RingBuffer *buffer : mEnqueuedBufferList)
+    {
+        paddingSize += buffer->getPaddingSize();
+    }
+    return paddingSize;
 }
 
 // Flush copy commands in buffer pool
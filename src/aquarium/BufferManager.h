@@ -5,61 +5,138 @@
 //
 // BufferManager.h: Implements buffer pool to manage buffer allocation and
 // recycle.
+//
+// Data the CPU writes every frame is sub-allocated from ring buffers. Allocations of a frame are
+// tagged with the serial the frame is submitted with, and their region returns to the ring once
+// the fence reports that serial completed. Allocation and retirement are O(1), nothing is ever
+// freed individually.
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <queue>
 #include <vector>
-#include "Context.h"
 
 constexpr size_t BUFFER_POOL_MAX_SIZE    = 409600000;
 constexpr size_t BUFFER_MAX_COUNT        = 10;
 constexpr size_t BUFFER_PER_ALLOCATE_SIZE = BUFFER_POOL_MAX_SIZE / BUFFER_MAX_COUNT;
+// Constant buffer views and copies of the D3D12 backend need 256 byte aligned offsets.
+constexpr size_t BUFFER_ALLOCATION_ALIGNMENT = 256;
+
+// The serial of the last frame the GPU finished. Serials start at 1, 0 means nothing completed.
+class FrameFence
+{
+  public:
+    virtual ~FrameFence() {}
+    virtual uint64_t getCompletedSerial() const = 0;
+};
+
+// A fence the CPU advances itself, for the null backend and the micro-benchmark. A frame
+// completes latency frames after it's submitted, as if the GPU were that many frames behind.
+class CounterFence : public FrameFence
+{
+  public:
+    explicit CounterFence(uint64_t latency) : mLatency(latency), mSubmittedSerial(0) {}
+
+    uint64_t getCompletedSerial() const override
+    {
+        return mSubmittedSerial > mLatency ? mSubmittedSerial - mLatency : 0;
+    }
+    void submit(uint64_t serial) { mSubmittedSerial = serial; }
+
+  private:
+    uint64_t mLatency;
+    uint64_t mSubmittedSerial;
+};
 
+// A ring over size bytes of host memory. Backends that upload from other memory, like a mapped
+// upload heap, pass it to the protected constructor.
 class RingBuffer
 {
   public:
-    RingBuffer(size_t size) : mHead(0), mTail(size), mSize(size) {}
-    ~RingBuffer() {}
+    static constexpr size_t kInvalidOffset = ~static_cast<size_t>(0);
+
+    explicit RingBuffer(size_t size);
+    virtual ~RingBuffer() {}
 
     size_t getSize() const { return mSize; }
-    size_t getAvailableSize() const { return mSize - mTail; }
+    size_t getUsedSize() const { return mUsedSize; }
+    size_t getAvailableSize() const { return mSize - mUsedSize; }
+    // Bytes skipped to align allocations or to wrap around the end, since the ring was created.
+    uint64_t getPaddingSize() const { return mPaddingSize; }
+    uint8_t *getData(size_t offset) { return mData + offset; }
 
-    virtual bool reset(size_t size) { return false; }
+    // Shrink the ring to size bytes, or grow it back up to its capacity. Fails if the ring still
+    // holds allocations, which must be retired first, or if size is larger than the capacity.
+    virtual bool reset(size_t size);
     virtual void flush() {}
     virtual void destory() {}
-    virtual size_t allocate(size_t size)
-    {
-        return 0;
-    }  // allocate size in a RingBuffer, return offset of the buffer
+    // Allocate size bytes at an offset that is a multiple of alignment, a power of two, and return
+    // the offset, or kInvalidOffset if the free region is too small.
+    size_t allocate(size_t size, size_t alignment = BUFFER_ALLOCATION_ALIGNMENT);
+    // Tag allocations made since the previous call with serial.
+    void finishFrame(uint64_t serial);
+    // Return the regions of frames up to completedSerial to the ring.
+    void retire(uint64_t completedSerial);
 
   protected:
+    friend class BufferManager;
+
+    RingBuffer(size_t size, uint8_t *data);
+
+    struct FrameRegion
+    {
+        uint64_t serial;
+        size_t end;
+        size_t size;
+    };
+
     size_t mHead;
     size_t mTail;
     size_t mSize;
+    size_t mCapacity;
+    size_t mUsedSize;
+    size_t mFrameSize;
+    uint64_t mPaddingSize;
+    uint8_t *mData;
+    // Position in the buffer list of the BufferManager.
+    size_t mIndex;
+    std::queue<FrameRegion> mFrameRegions;
+    std::vector<uint8_t> mStorage;
 };
 
 class BufferManager
 {
   public:
-    BufferManager();
+    explicit BufferManager(const FrameFence *fence);
     virtual ~BufferManager();
 
     size_t GetSize() const { return mBufferPoolSize; }
+    size_t getUsedSize() const { return mUsedSize; }
+    size_t getBufferCount() const { return mEnqueuedBufferList.size(); }
+    uint64_t getPaddingSize() const;
     bool resetBuffer(RingBuffer *ringBuffer, size_t size);
     bool destoryBuffer(RingBuffer *ringBuffer);
-    virtual void destroyBufferPool() {}
+    virtual void destroyBufferPool();
     virtual void flush();
 
-    virtual RingBuffer *allocate(size_t size, size_t *offset) { return nullptr; }
-
-    std::queue<RingBuffer *> mMappedBufferList;
+    // Sub-allocate size bytes from the ring buffers, creating a ring if none has room and the pool
+    // allows it. Returns nullptr if the pool is exhausted until frames in flight complete, or if
+    // the backend fails to create the ring.
+    RingBuffer *allocate(size_t size, size_t *offset);
+    // Tag the allocations of the frame about to be submitted with serial.
+    void finishFrame(uint64_t serial);
+    // Recycle the regions of the frames the fence reports completed.
+    void retireFrames();
 
   protected:
+    // Returns nullptr if the backend can't create the ring.
+    virtual RingBuffer *createRingBuffer(size_t size) { return new RingBuffer(size); }
+
     std::vector<RingBuffer *> mEnqueuedBufferList;
+    const FrameFence *mFence;
     size_t mBufferPoolSize;
     size_t mUsedSize;
-    size_t mCount;
-
-  private:
-    size_t find(RingBuffer *ringBuffer);
+    // The ring that served the last allocation, tried first.
+    size_t mCurrentIndex;
 };
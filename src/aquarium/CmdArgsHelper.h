@@ -10,24 +10,39 @@
 #define CMDARGSHELPER 1
 
 const char *cmdArgsStrAquarium = R"(Options and arguments:
---backend               : specifies running a certain backend, 'opengl', 'dawn_d3d12', 'dawn_vulkan', 'dawn_metal', 'dawn_opengl', 'angle', 'd3d12'.
+--backend               : specifies running a certain backend, 'opengl', 'dawn_d3d12', 'dawn_vulkan', 'dawn_metal', 'dawn_opengl', 'angle', 'd3d12', 'null'. The null backend runs without a GPU and only counts draws and uploads, and requires --test-time, --frames or a scenario that ends.
 --buffer-mapping-async  : Upload uniforms by buffer mapping async for Dawn backend.
+--cull-fish             : Only upload and draw the fish whose bounding sphere is at least partly inside the view frustum, packed together species after species. Fish are culled after the simulation with the kernels of the SIMD level, and the number of fish and visible fish per frame are printed at exit. Fish updated and drawn one by one keep drawing all fish.
 --disable-dynamic-buffer-offset : The path is to test individual draw by creating many binding groups on dawn backend. By default, dynamic buffer offset is enabled. This option is only supported on dawn backend.
 --discrete-gpu          : Choose discrete gpu to render the application. This is only supported on Dawn and D3D12 backend.
 --enable-alpha-blending=[0, 1] | false : Force enable alpha blending to a specific value or disable alpha blending for all models. By default, alpha blending is enabled.
---enable-instanced-draws : specifies rendering fishes by instanced draw. By default, fishes are rendered by individual draw.Instanced rendering is only supported on dawn and d3d12 backend now.
+--enable-instanced-draws : specifies rendering fishes by instanced draw, one draw per fish species reading the packed fish data as per-instance vertex data. By default, fishes are rendered by individual draw. Fish count changes are supported in both modes, and the CPU time spent issuing draws is printed at exit as DRAW_MS. This is only implemented for d3d12 and null backend.
 --msaa-count            : MSAA sample count. 1 for non-MSAA. MSAA of angle backend is not supported now.
 --enable-full-screen-mode       : Render aquarium in full screen mode instead of window mode.
+--hash-fish-pers        : Print a hash of the fish records uploaded in the last frame at exit, after culling and packing, to check that runs with --fixed-dt and --frames draw the same fish on other machines. Requires --frames. Hashes only match at the same SIMD level, use 'scalar' to compare CPUs of different instruction sets.
 --integrated-gpu        : Choose integrated gpu to render the application. This is only supported on Dawn and D3D12 backend.
 --fish-count [count]      : specifies how many fishes will be rendered.
---print-log             : print logs including avarage fps when exit the application.
---simulating-fish-come-and-go : Load fish behavior from FishBehavior.json. The mode is only implemented for Dawn backend.
+--fish-lod              : Decimate the fish meshes at load into meshes of a half and a quarter of their triangles, and draw each fish with the mesh of its distance to the eye, one batch per species and level of detail. The fish triangles drawn per frame and the share of fish at each level are printed at exit. Fish updated and drawn one by one keep drawing the full meshes.
+--fixed-dt [seconds]    : Advance the fish and the camera by a fixed time step per frame instead of the time the frame took, so that every machine simulates and draws the same frames.
+--frame-time-csv [file] : Write the time of every frame to a CSV file at exit, including the frames of the warm-up window.
+--frames [count]        : Render a number of frames and then exit. The mean and 99th percentile of the CPU time per frame spent updating, issuing draws and submitting, which leave out presenting and waiting for the GPU, and the frames and fish per second of that work are printed at exit. Combined with --frame-time-csv for the times of every frame.
+--legacy-random         : Generate fish parameters from the LCG sequence of earlier versions instead of the counter-based generator, to compare results with them bit for bit.
+--micro-benchmark [name] : Run a CPU micro-benchmark instead of rendering, and print its results. 'command-stream' fish draws recorded into command streams per second for each number of threads and replayed per second, 'fish' measures fish updated per second for each SIMD level, 'fish-culling' fish culled per second for each SIMD level and whether every level keeps the same fish at the same level of detail, 'fish-lod' triangles of the decimated fish meshes and fish triangles drawn per frame at 100000 fish with culling and levels of detail on and off, 'fish-threads' its scaling with the number of worker threads, 'fish-upload' bytes of fish data written per frame and the time to write and upload them with the padded and the packed layout, 'random' counter-based random numbers generated per second for each SIMD level, 'matrix' matrices multiplied, inverted and inverted and transposed per second for each SIMD level, checked against the scalar code, 'mipmap' mip chains of all textures of the aquarium generated per second, 'shader-cache' the time to create the programs of the aquarium patching shaders with a regular expression and through the shader cache, cold and warm, 'ring-buffer' sub-allocations per second from the per-frame ring buffers, their padding and whether frames in flight stay intact, 'texture-compression' megabytes of texels compressed per second to BC1, BC3 and BC5, and their PSNR.
+--pack-fish-pers        : Upload fish data as 32 byte records read from a structured buffer instead of one 256 byte constant buffer view per fish. This is only implemented for d3d12 and null backend.
+--print-log             : print logs including avarage fps when exit the application, the time spent in each loading stage, and the time spent creating programs with how many shaders were compiled and how many found in the shader cache.
+--record-commands       : Record the draws of each frame into backend-neutral command streams on the worker threads, a stream per model and per chunk of fish, and replay them in order on the main thread. This is only implemented for d3d12 and null backend.
+--simd-level [level]    : Instruction set used by CPU kernels, 'scalar', 'sse2' or 'avx2'. By default, the highest level supported by the CPU is used. 'scalar' reproduces C library results bit for bit.
+--scenario [file]       : Play a frame-scripted scenario from a JSON file. "phases" is a list of phases played in order, each with "frames" (0 runs it until the test ends), "fishCount" as a count or the first and last count of a ramp over the phase, "addFish" added to the count at the start of the phase, "fixedTimeStep" in seconds the fish and camera advance per frame instead of the wall clock, and "camera" as keys of "frame", "eye" and "target" interpolated over the phase. "fixedTimeStep", "msaa" and "alphaBlending", the value of --enable-alpha-blending, may also be set for the whole run. The frame times and the CPU time of each stage per phase, and the frame time spike of each fish count change between phases, are printed at exit.
+--simulating-fish-come-and-go : Play the {frame, op, count} behaviors of FishBehavior.json as a scenario, a phase per fish count.
+--texture-compression [mode] : 'none' uploads textures as RGBA8. 'bc' compresses opaque textures to BC1 and the others, including the normal maps whose alpha holds specular intensity, to BC3. Compressed textures are cached separately. By default, 'none'.
 --test-time [second]    : Render the application for some seconds and then exit, and the application will run 5 min by default.
 --turn-off-vsync        : Unlimit 60 fps.
+--warm-up-time [second] : Frames rendered in the first seconds are left out of the results. By default, 2 seconds. The results report the mean, median, 90th, 99th and 99.9th percentile and standard deviation of the frame times, and whether they are stable, that is whether the standard deviation is within 10% of the mean. They also report the mean and 99th percentile of the CPU time spent per frame recording commands, submitting them, and presenting, which includes waiting for frames in flight.
 --disable-d3d12-render-pass   : Turn off render pass for dawn_d3d12 and d3d12 backend.
 --disable-dawn-validation : Turn off dawn validation.
 --disable-control-panel : Turn off control panel. You can show fps by passing '--print-log --test-time 30' to print the fps to cmd line.
---window-size=[width],[height]  : Input window size.";
+--window-size=[width],[height]  : Input window size.
+--worker-threads [count] : Number of worker threads for CPU work such as asset loading and the fish update. 0 runs it all on the main thread. By default, one worker per logical core except the main one.";
 
 
 const char *cmdArgsStrAquariumDirectMap = R"(Options and arguments:
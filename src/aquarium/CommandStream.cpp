@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// CommandStream.cpp: Implement recording and replaying draw commands.
+
+#include "CommandStream.h"
+
+#include <algorithm>
+
+#include "FishModel.h"
+#include "JobSystem.h"
+
+void CommandStream::grow(size_t size)
+{
+    size_t wordCount = (mSize + size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    mWords.resize(std::max(wordCount, mWords.size() * 2));
+}
+
+void CommandStream::execute() const
+{
+    FishModel *fishModel = nullptr;
+    const char *end      = getData() + mSize;
+    for (const char *cursor = getData(); cursor < end;)
+    {
+        const CommandHeader *header = reinterpret_cast<const CommandHeader *>(cursor);
+        switch (header->type)
+        {
+            case COMMANDDRAWMODEL:
+                reinterpret_cast<const DrawModelCommand *>(cursor)->model->draw();
+                break;
+            case COMMANDBINDFISHMODEL:
+                fishModel = reinterpret_cast<const BindFishModelCommand *>(cursor)->model;
+                fishModel->bind();
+                break;
+            case COMMANDBINDFISHLOD:
+                fishModel->bindLod(reinterpret_cast<const BindFishLodCommand *>(cursor)->lod);
+                break;
+            case COMMANDDRAWFISH:
+            {
+                const DrawFishCommand *command = reinterpret_cast<const DrawFishCommand *>(cursor);
+                fishModel->drawFish(command->fishPerIndex, command->indexCount);
+                break;
+            }
+        }
+        cursor += header->size;
+    }
+}
+
+void CommandRecorder::addModel(Model *model)
+{
+    mTasks.push_back({model, nullptr, 0, 0});
+}
+
+void CommandRecorder::addFishModel(FishModel *model)
+{
+    int count = model->getInstanceCount();
+    for (int first = 0; first < count; first += kFishChunkSize)
+    {
+        mTasks.push_back({model, model, first, std::min(kFishChunkSize, count - first)});
+    }
+}
+
+void CommandRecorder::record(JobSystem *jobSystem)
+{
+    // Streams are only added, so that they keep their memory.
+    if (mStreams.size() < mTasks.size())
+    {
+        mStreams.resize(mTasks.size());
+    }
+
+    int taskCount = static_cast<int>(mTasks.size());
+    if (jobSystem == nullptr)
+    {
+        for (int i = 0; i < taskCount; ++i)
+        {
+            recordTask(i);
+        }
+        return;
+    }
+
+    jobSystem->parallelFor(taskCount, 1, [this](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+        {
+            recordTask(i);
+        }
+    });
+}
+
+void CommandRecorder::execute() const
+{
+    for (size_t i = 0; i < mTasks.size(); ++i)
+    {
+        mStreams[i].execute();
+    }
+}
+
+void CommandRecorder::recordTask(int index)
+{
+    const Task &task        = mTasks[index];
+    CommandStream &commands = mStreams[index];
+    commands.reset();
+
+    if (task.fishModel == nullptr)
+    {
+        commands.recordDrawModel(task.model);
+        return;
+    }
+
+    // The fish of the model follow each other level after level, and the chunk may span several.
+    commands.recordBindFishModel(task.fishModel);
+    int fishPerOffset = task.fishModel->getFishPerOffset();
+    int lodBegin      = 0;
+    for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+    {
+        int lodEnd = lodBegin + task.fishModel->getLodInstanceCount(lod);
+        int begin  = std::max(task.first, lodBegin);
+        int end    = std::min(task.first + task.count, lodEnd);
+        if (begin < end)
+        {
+            commands.recordBindFishLod(lod);
+            int indexCount = task.fishModel->getIndexCount(lod);
+            for (int i = begin; i < end; ++i)
+            {
+                commands.recordDrawFish(fishPerOffset + i, indexCount);
+            }
+        }
+        lodBegin = lodEnd;
+    }
+}
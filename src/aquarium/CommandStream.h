@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// CommandStream.h: Define the backend-neutral stream of draw commands.
+//
+// Commands are small POD packets written one after another into a linear buffer, which keeps its
+// memory from frame to frame. The recorder fills a stream per background model and per chunk of
+// fish on the workers of the job system, and the streams are replayed in the order the models
+// were added, so that the draws are the same whatever thread recorded them. Replaying calls the
+// models, which translate the commands to their graphics API.
+
+#pragma once
+#ifndef COMMANDSTREAM_H
+#define COMMANDSTREAM_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FishModel;
+class JobSystem;
+class Model;
+
+enum COMMANDTYPE : uint32_t
+{
+    // Draw a model the way it draws itself.
+    COMMANDDRAWMODEL,
+    // Set the state of a fish model for the fish draws that follow.
+    COMMANDBINDFISHMODEL,
+    // Set the level of detail of the bound fish model for the fish draws that follow.
+    COMMANDBINDFISHLOD,
+    // Draw a fish of the bound fish model.
+    COMMANDDRAWFISH,
+};
+
+struct CommandHeader
+{
+    COMMANDTYPE type;
+    // Bytes up to the next command.
+    uint32_t size;
+};
+
+struct DrawModelCommand
+{
+    CommandHeader header;
+    Model *model;
+};
+
+struct BindFishModelCommand
+{
+    CommandHeader header;
+    FishModel *model;
+};
+
+struct BindFishLodCommand
+{
+    CommandHeader header;
+    int32_t lod;
+    // Keeps the next command aligned.
+    int32_t padding;
+};
+
+struct DrawFishCommand
+{
+    CommandHeader header;
+    // Index of the fish data of the fish among all fish.
+    int32_t fishPerIndex;
+    int32_t indexCount;
+};
+
+class CommandStream
+{
+  public:
+    // Commands start on 8 byte boundaries.
+    static constexpr size_t kCommandAlignment = 8;
+
+    CommandStream() : mSize(0), mCommandCount(0) {}
+
+    void reset()
+    {
+        mSize         = 0;
+        mCommandCount = 0;
+    }
+
+    void recordDrawModel(Model *model)
+    {
+        allocate<DrawModelCommand>(COMMANDDRAWMODEL)->model = model;
+    }
+    void recordBindFishModel(FishModel *model)
+    {
+        allocate<BindFishModelCommand>(COMMANDBINDFISHMODEL)->model = model;
+    }
+    void recordBindFishLod(int lod)
+    {
+        BindFishLodCommand *command = allocate<BindFishLodCommand>(COMMANDBINDFISHLOD);
+        command->lod                = lod;
+        command->padding            = 0;
+    }
+    void recordDrawFish(int fishPerIndex, int indexCount)
+    {
+        DrawFishCommand *command = allocate<DrawFishCommand>(COMMANDDRAWFISH);
+        command->fishPerIndex    = fishPerIndex;
+        command->indexCount      = indexCount;
+    }
+
+    // Replay the commands through the models they name.
+    void execute() const;
+
+    const char *getData() const { return reinterpret_cast<const char *>(mWords.data()); }
+    size_t getSize() const { return mSize; }
+    int getCommandCount() const { return mCommandCount; }
+
+  private:
+    template <typename Command>
+    Command *allocate(COMMANDTYPE type)
+    {
+        static_assert(sizeof(Command) % kCommandAlignment == 0,
+                      "Commands must keep the next one aligned.");
+        if (mSize + sizeof(Command) > mWords.size() * sizeof(uint64_t))
+        {
+            grow(sizeof(Command));
+        }
+
+        Command *command =
+            reinterpret_cast<Command *>(reinterpret_cast<char *>(mWords.data()) + mSize);
+        command->header.type = type;
+        command->header.size = static_cast<uint32_t>(sizeof(Command));
+        mSize += sizeof(Command);
+        ++mCommandCount;
+        return command;
+    }
+    void grow(size_t size);
+
+    std::vector<uint64_t> mWords;
+    size_t mSize;
+    int mCommandCount;
+};
+
+// Records the draws of a frame into command streams.
+class CommandRecorder
+{
+  public:
+    // Fish of a model are recorded in chunks of this many, so that the many fish of a big fish
+    // count spread over the workers.
+    static constexpr int kFishChunkSize = 4096;
+
+    // Forget the models of the last frame.
+    void begin() { mTasks.clear(); }
+    void addModel(Model *model);
+    // Draw every fish of the model one by one, at its level of detail.
+    void addFishModel(FishModel *model);
+
+    // Record the models added since begin(), on the workers of jobSystem if it isn't nullptr.
+    void record(JobSystem *jobSystem);
+    // Replay the recorded streams in order.
+    void execute() const;
+
+    const CommandStream *getStreams() const { return mStreams.data(); }
+    int getStreamCount() const { return static_cast<int>(mTasks.size()); }
+
+  private:
+    struct Task
+    {
+        Model *model;
+        FishModel *fishModel;
+        int first;
+        int count;
+    };
+
+    void recordTask(int index);
+
+    std::vector<Task> mTasks;
+    std::vector<CommandStream> mStreams;
+};
+
+#endif  // !COMMANDSTREAM_H
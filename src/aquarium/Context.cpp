@@ -11,8 +11,14 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_internal.h"
 
+#include <algorithm>
 #include <sstream>
 
+int Context::growFishCapacity(int capacity, int count)
+{
+    return std::max(count, capacity + capacity / 2);
+}
+
 void Context::renderImgui(const FPSTimer &fpsTimer,
                           int *fishCount,
                           std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> *toggleBitset)
@@ -67,11 +73,11 @@ void Context::renderImgui(const FPSTimer &fpsTimer,
         std::string resolution = resolutionStream.str();
         ImGui::Text(resolution.c_str());
 
-        ImGui::PlotLines("[0,100 FPS]", fpsTimer.getHistoryFps(), NUM_HISTORY_DATA, 0, NULL, 0.0f,
-                         100.0f, ImVec2(0, 40));
+        ImGui::PlotLines("[0,100 FPS]", fpsTimer.getHistoryFps(), NUM_HISTORY_DATA,
+                         fpsTimer.getHistoryOffset(), NULL, 0.0f, 100.0f, ImVec2(0, 40));
 
         ImGui::PlotHistogram("[0,100 ms/frame]", fpsTimer.getHistoryFrameTime(), NUM_HISTORY_DATA,
-                             0, NULL, 0.0f, 100.0f, ImVec2(0, 40));
+                             fpsTimer.getHistoryOffset(), NULL, 0.0f, 100.0f, ImVec2(0, 40));
 
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
                     1000.0f / fpsTimer.getAverageFPS(), fpsTimer.getAverageFPS());
@@ -15,6 +15,7 @@
 
 #include "Aquarium.h"
 #include "ResourceHelper.h"
+#include "ShaderCache.h"
 
 #include "FPSTimer.h"
 
@@ -29,6 +30,8 @@ enum MODELGROUP : short;
 enum MODELNAME : short;
 enum TOGGLE : short;
 
+struct FishPer;
+struct FishPerPacked;
 struct Global;
 static char fishCountInputBuffer[64];
 
@@ -41,12 +44,18 @@ class Context
                             const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> &toggleBitset,
                             int windowWidth,
                             int windowHeight)                                                 = 0;
+    // Textures are created unloaded, see Texture::loadTexture().
     virtual Texture *createTexture(const std::string &name, const std::string &url)           = 0;
     virtual Texture *createTexture(const std::string &name,
                                    const std::vector<std::string> &urls)                      = 0;
-    virtual Buffer *createBuffer(int numComponents, std::vector<float> *buffer, bool isIndex) = 0;
+    // buffer points to size floats or indices, and only needs to be valid during the call.
     virtual Buffer *createBuffer(int numComponents,
-                                 std::vector<unsigned short> *buffer,
+                                 const float *buffer,
+                                 int size,
+                                 bool isIndex)                                                = 0;
+    virtual Buffer *createBuffer(int numComponents,
+                                 const unsigned short *buffer,
+                                 int size,
                                  bool isIndex)                                                = 0;
     virtual Program *createProgram(const std::string &mVId, const std::string &mFId)          = 0;
     virtual void setWindowTitle(const std::string &text)                                      = 0;
@@ -64,13 +73,23 @@ class Context
                            std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> *toggleBitset) = 0;
     virtual void showFPS() {}
     virtual void destoryImgUI() = 0;
+    // Fish instance buffers only grow, see growFishCapacity(), and keep the fish data they hold.
     virtual void reallocResource(int preTotalInstance,
                                  int curTotalInstance,
                                  bool enableDynamicBufferOffset)
     {
     }
-    virtual void updateAllFishData() = 0;
+    // Upload the first fishCount records of the fish data.
+    virtual void updateAllFishData(int fishCount) = 0;
+    // Host copy of per-fish data that updateAllFishData uploads. Backends that keep fish data
+    // elsewhere return nullptr, and fish are then updated through the fish models.
+    virtual FishPer *getFishPers() { return nullptr; }
+    // The same with the packed layout, for backends that run with --pack-fish-pers.
+    virtual FishPerPacked *getPackedFishPers() { return nullptr; }
     virtual void beginRenderPass() {}
+    // Milliseconds the last DoFlush() spent closing and submitting command lists, before
+    // presenting.
+    double getSubmitTime() const { return mSubmitTime; }
 
     int getClientWidth() const { return mClientWidth; }
     int getclientHeight() const { return mClientHeight; }
@@ -85,10 +104,16 @@ class Context
     virtual void updateWorldlUniforms(Aquarium *aquarium) {}
 
     ResourceHelper *getResourceHelper() { return mResourceHelper; }
+    // Sources and compiled shaders of all programs of the context.
+    ShaderCache *getShaderCache() { return &mShaderCache; }
     int mMSAACount = 4;
     bool mDisableD3D12RenderPass;
 
   protected:
+    // Capacity of the fish instance buffers once they hold count fish. Growing by at least half
+    // keeps reallocations rare when fish come in small steps.
+    static int growFishCapacity(int capacity, int count);
+
     void renderImgui(const FPSTimer &fpsTimer,
                      int *fishCount,
                      std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> *toggleBitset);
@@ -98,8 +123,11 @@ class Context
     int mClientHeight;
     int mPreTotalInstance;
     int mCurTotalInstance;
+    // Set by DoFlush().
+    double mSubmitTime = 0.0;
 
     ResourceHelper *mResourceHelper;
+    ShaderCache mShaderCache;
 
     std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> mAvailableToggleBitset;
     virtual void initAvailableToggleBitset(BACKENDTYPE backendType) = 0;
@@ -14,6 +14,9 @@
 #ifdef ENABLE_D3D12_BACKEND
 #include "d3d12/ContextD3D12.h"
 #endif
+#ifdef ENABLE_NULL_BACKEND
+#include "null/ContextNull.h"
+#endif
 
 ContextFactory::ContextFactory() : mContext(nullptr) {}
 
@@ -47,6 +50,13 @@ Context *ContextFactory::createContext(BACKENDTYPE backendType)
             {
 #if defined(ENABLE_D3D12_BACKEND)
                 mContext = new ContextD3D12(backendType);
+#endif
+                break;
+            }
+            case BACKENDTYPE::BACKENDTYPENULL:
+            {
+#if defined(ENABLE_NULL_BACKEND)
+                mContext = new ContextNull(backendType);
 #endif
                 break;
             }
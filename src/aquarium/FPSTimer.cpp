@@ -10,6 +10,7 @@
 #include "AQUARIUM_ASSERT.h"
 
 #include <cmath>
+#include <cstdio>
 #include <iostream>
 
 FPSTimer::FPSTimer()
@@ -18,7 +19,11 @@ FPSTimer::FPSTimer()
       mTimeTableCursor(0),
       mHistoryFPS(NUM_HISTORY_DATA, 1.0f),
       mHistoryFrameTime(NUM_HISTORY_DATA, 100.0f),
-      mAverageFPS(0.0)
+      mHistoryCursor(0),
+      mAverageFPS(0.0),
+      mWarmUpTime(FRAME_TIME_WARM_UP_TIME),
+      mMeasuringFrame(false),
+      mEnableTimeline(false)
 {}
 
 void FPSTimer::update(double elapsedTime, double renderingTime, int testTime)
@@ -34,45 +39,87 @@ void FPSTimer::update(double elapsedTime, double renderingTime, int testTime)
 
     mAverageFPS = floor((1.0f / (mTotalTime / static_cast<double>(NUM_FRAMES_TO_AVERAGE))) + 0.5);
 
-    for (int i = 0; i < NUM_HISTORY_DATA - 1; i++)
+    mHistoryFPS[mHistoryCursor]       = mAverageFPS;
+    mHistoryFrameTime[mHistoryCursor] = 1000.0 / mAverageFPS;
+    ++mHistoryCursor;
+    if (mHistoryCursor == NUM_HISTORY_DATA)
     {
-        mHistoryFPS[i]       = mHistoryFPS[i + 1];
-        mHistoryFrameTime[i] = mHistoryFrameTime[i + 1];
+        mHistoryCursor = 0;
+    }
+
+    // The first frame has nothing to measure from.
+    mMeasuringFrame = elapsedTime > 0.0 && renderingTime >= mWarmUpTime;
+    if (elapsedTime <= 0.0)
+    {
+        return;
+    }
+
+    if (mEnableTimeline)
+    {
+        mTimeline.push_back({renderingTime, elapsedTime * 1000.0, 0.0, 0.0, 0.0, 0.0});
+    }
+    if (mMeasuringFrame)
+    {
+        mFrameTimes.record(elapsedTime * 1000.0);
     }
-    mHistoryFPS[NUM_HISTORY_DATA - 1]       = mAverageFPS;
-    mHistoryFrameTime[NUM_HISTORY_DATA - 1] = 1000.0 / mAverageFPS;
-    //if (testTime - renderingTime > 5 && testTime - renderingTime < 25)
-    //{
-        mLogFPS.push_back(mAverageFPS);
-    //}
 }
 
-int FPSTimer::variance() const
+void FPSTimer::updateStages(double updateTime,
+                            double drawTime,
+                            double submitTime,
+                            double presentTime)
 {
-    return mLogFPS[mLogFPS.size() - 1];
-    /*
-    float avg = 0.f;
-
-    for (size_t i = 0; i < mLogFPS.size(); i++)
+    if (mEnableTimeline && !mTimeline.empty())
+    {
+        mTimeline.back().updateTime  = updateTime;
+        mTimeline.back().drawTime    = drawTime;
+        mTimeline.back().submitTime  = submitTime;
+        mTimeline.back().presentTime = presentTime;
+    }
+    if (mMeasuringFrame)
     {
-        avg += mLogFPS[i];
+        mUpdateTimes.record(updateTime);
+        mDrawTimes.record(drawTime);
+        mSubmitTimes.record(submitTime);
+        mPresentTimes.record(presentTime);
     }
+}
 
-    avg /= mLogFPS.size();
+double FPSTimer::getMeasuredFPS() const
+{
+    double mean = mFrameTimes.getMean();
+    return mean > 0.0 ? 1000.0 / mean : 0.0;
+}
 
+bool FPSTimer::isStable() const
+{
+    double maxDeviation = FRAME_TIME_STABLE_DEVIATION * mFrameTimes.getMean();
+    return mFrameTimes.getCount() > 1 && mFrameTimes.getStandardDeviation() <= maxDeviation;
+}
 
-    float var = 0.f;
-    for (size_t i = 0; i < mLogFPS.size(); i++)
+int FPSTimer::variance() const
+{
+    return isStable() ? static_cast<int>(floor(getMeasuredFPS() + 0.5)) : 0;
+}
+
+bool FPSTimer::writeTimeline(const std::string &path) const
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr)
     {
-        var += pow(mLogFPS[i] - avg, 2);
+        std::cerr << "Failed to write frame times to " << path << "." << std::endl;
+        return false;
     }
-    var /= mLogFPS.size();
 
-    if (var < FPS_VALID_THRESHOLD)
+    fprintf(file,
+            "frame,rendering_time_s,frame_time_ms,update_ms,draw_ms,submit_ms,present_ms,"
+            "warm_up\n");
+    for (size_t i = 0; i < mTimeline.size(); ++i)
     {
-        return ceil(avg);
+        const TimelineFrame &frame = mTimeline[i];
+        fprintf(file, "%d,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,%d\n", static_cast<int>(i),
+                frame.renderingTime, frame.frameTime, frame.updateTime, frame.drawTime,
+                frame.submitTime, frame.presentTime, frame.renderingTime < mWarmUpTime ? 1 : 0);
     }
-
-    return 0;
-    */
+    return fclose(file) == 0;
 }
@@ -4,16 +4,24 @@
 // found in the LICENSE file.
 //
 // FPSTimer.h: Define fps timer.
+//
+// Frame times after a warm-up window go to a fixed-memory histogram that the results are computed
+// from. The per-frame timeline is only kept when it is exported.
 
 #pragma once
 #ifndef FPS_TIMER
 #define FPS_TIMER 1
 
+#include <string>
 #include <vector>
 
+#include "FrameTimeHistogram.h"
+
 constexpr int NUM_HISTORY_DATA = 100;
 constexpr int NUM_FRAMES_TO_AVERAGE = 128;
-constexpr int FPS_VALID_THRESHOLD   = 10;
+// Frame times are stable when their standard deviation is within this share of their mean.
+constexpr double FRAME_TIME_STABLE_DEVIATION = 0.1;
+constexpr double FRAME_TIME_WARM_UP_TIME     = 2.0;
 
 class FPSTimer
 {
@@ -21,21 +29,64 @@ public:
   FPSTimer();
 
   void update(double elapsedTime, double renderingTime, int testTime);
+  // CPU time of the stages of the frame of the last update(), in milliseconds: recording its
+  // commands, the part of it spent issuing draws, submitting them, and presenting, which includes
+  // waiting for frames in flight.
+  void updateStages(double updateTime, double drawTime, double submitTime, double presentTime);
   double getAverageFPS() const { return mAverageFPS; }
+  // The history is a ring; the oldest value is at getHistoryOffset().
   const float *getHistoryFps() const { return mHistoryFPS.data(); }
   const float *getHistoryFrameTime() const { return mHistoryFrameTime.data(); }
+  int getHistoryOffset() const { return mHistoryCursor; }
+
+  // Frames rendered in the first seconds are not measured.
+  void setWarmUpTime(double seconds) { mWarmUpTime = seconds; }
+  // Keep the time of every frame for writeTimeline().
+  void enableTimeline() { mEnableTimeline = true; }
+  bool writeTimeline(const std::string &path) const;
+
+  // Frame times after the warm-up window, in milliseconds.
+  const FrameTimeHistogram &getFrameTimes() const { return mFrameTimes; }
+  const FrameTimeHistogram &getUpdateTimes() const { return mUpdateTimes; }
+  const FrameTimeHistogram &getDrawTimes() const { return mDrawTimes; }
+  const FrameTimeHistogram &getSubmitTimes() const { return mSubmitTimes; }
+  const FrameTimeHistogram &getPresentTimes() const { return mPresentTimes; }
+  double getMeasuredFPS() const;
+  bool isStable() const;
+  // The measured fps rounded, or 0 if frame times are unstable.
   int variance() const;
 
 private:
+  struct TimelineFrame
+  {
+      double renderingTime;
+      double frameTime;
+      double updateTime;
+      double drawTime;
+      double submitTime;
+      double presentTime;
+  };
+
   double mTotalTime;
   std::vector<double> mTimeTable;
   int mTimeTableCursor;
 
   std::vector<float> mHistoryFPS;
   std::vector<float> mHistoryFrameTime;
-  std::vector<float> mLogFPS;
+  int mHistoryCursor;
 
   double mAverageFPS;
+
+  double mWarmUpTime;
+  FrameTimeHistogram mFrameTimes;
+  FrameTimeHistogram mUpdateTimes;
+  FrameTimeHistogram mDrawTimes;
+  FrameTimeHistogram mSubmitTimes;
+  FrameTimeHistogram mPresentTimes;
+  // Whether the frame of the last update() is past the warm-up window.
+  bool mMeasuringFrame;
+  bool mEnableTimeline;
+  std::vector<TimelineFrame> mTimeline;
 };
 
 #endif
@@ -0,0 +1,252 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FileSystem.cpp: Implement file helpers of the asset loaders.
+
+#include "FileSystem.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if defined(WIN32) || defined(_WIN32)
+#include <direct.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(WIN32) || defined(_WIN32)
+MappedFile::MappedFile()
+    : mData(nullptr), mSize(0), mCopyOnWrite(false), mFile(nullptr), mMapping(nullptr)
+{
+}
+#else
+MappedFile::MappedFile() : mData(nullptr), mSize(0), mCopyOnWrite(false) {}
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string &path, bool copyOnWrite)
+{
+    close();
+
+#if defined(WIN32) || defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY,
+                                        0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void *view = MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mFile    = file;
+    mMapping = mapping;
+    mData    = static_cast<char *>(view);
+    mSize    = static_cast<size_t>(size.QuadPart);
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    int protection = copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *view     = mmap(nullptr, status.st_size, protection, MAP_PRIVATE, file, 0);
+    // The mapping keeps its own reference to the file.
+    ::close(file);
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    mData = static_cast<char *>(view);
+    mSize = static_cast<size_t>(status.st_size);
+#endif
+    mCopyOnWrite = copyOnWrite;
+
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (mData == nullptr)
+    {
+        return;
+    }
+
+#if defined(WIN32) || defined(_WIN32)
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+    mMapping = nullptr;
+    mFile    = nullptr;
+#else
+    munmap(mData, mSize);
+#endif
+
+    mData        = nullptr;
+    mSize        = 0;
+    mCopyOnWrite = false;
+}
+
+bool MappedFile::isNulTerminated() const
+{
+#if defined(WIN32) || defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t pageSize = static_cast<size_t>(info.dwPageSize);
+#else
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return mData != nullptr && mSize % pageSize != 0;
+}
+
+bool getFileStatus(const std::string &path, uint64_t *size, int64_t *modifiedTime)
+{
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+    {
+        return false;
+    }
+
+    *size         = static_cast<uint64_t>(status.st_size);
+    *modifiedTime = static_cast<int64_t>(status.st_mtime);
+    return true;
+}
+
+bool readFile(const std::string &path, std::string *content)
+{
+    std::ifstream stream(path, std::ios::in | std::ios::binary);
+    if (!stream)
+    {
+        return false;
+    }
+
+    std::ostringstream buffer;
+    buffer << stream.rdbuf();
+    *content = buffer.str();
+    return true;
+}
+
+char *mapText(const std::string &path, MappedFile *file, std::string *fallback, size_t *size)
+{
+    if (file->open(path, true) && file->isNulTerminated())
+    {
+        *size = file->size();
+        return file->mutableData();
+    }
+    file->close();
+
+    if (!readFile(path, fallback))
+    {
+        return nullptr;
+    }
+    *size = fallback->size();
+    return &(*fallback)[0];
+}
+
+bool createDirectory(const std::string &path)
+{
+    // stat() doesn't accept a trailing separator on Windows.
+    std::string directory = path;
+    while (directory.size() > 1 && (directory.back() == '/' || directory.back() == '\\'))
+    {
+        directory.pop_back();
+    }
+
+    struct stat status;
+    if (stat(directory.c_str(), &status) == 0)
+    {
+        return (status.st_mode & S_IFDIR) != 0;
+    }
+
+#if defined(WIN32) || defined(_WIN32)
+    return _mkdir(directory.c_str()) == 0;
+#else
+    return mkdir(directory.c_str(), 0755) == 0;
+#endif
+}
+
+bool writeFileAtomic(const std::string &path, const void *content, size_t size)
+{
+    std::ostringstream temporaryStream;
+#if defined(WIN32) || defined(_WIN32)
+    temporaryStream << path << ".tmp" << GetCurrentProcessId();
+#else
+    temporaryStream << path << ".tmp" << getpid();
+#endif
+    std::string temporaryPath = temporaryStream.str();
+
+    {
+        std::ofstream stream(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        stream.write(static_cast<const char *>(content), size);
+        if (!stream)
+        {
+            stream.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+#if defined(WIN32) || defined(_WIN32)
+    bool replaced =
+        MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool replaced = std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+#endif
+    if (!replaced)
+    {
+        std::remove(temporaryPath.c_str());
+    }
+    return replaced;
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
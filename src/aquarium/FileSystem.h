@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FileSystem.h: Define file helpers of the asset loaders: read-only memory mapping, file status,
+// whole file reads and atomic file replacement.
+
+#pragma once
+#ifndef FILESYSTEM_H
+#define FILESYSTEM_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Mapping of a whole file. The view stays valid until close() or destruction.
+class MappedFile
+{
+  public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // A copy-on-write view can be written to, e.g. by in-situ parsers, but the writes never
+    // reach the file.
+    bool open(const std::string &path, bool copyOnWrite = false);
+    void close();
+
+    const char *data() const { return mData; }
+    char *mutableData() { return mCopyOnWrite ? mData : nullptr; }
+    size_t size() const { return mSize; }
+    // Whether a NUL follows the view. The rest of the last page of a mapping reads as zeros, so
+    // this holds unless the file ends on a page boundary.
+    bool isNulTerminated() const;
+
+  private:
+    char *mData;
+    size_t mSize;
+    bool mCopyOnWrite;
+#if defined(WIN32) || defined(_WIN32)
+    void *mFile;
+    void *mMapping;
+#endif
+};
+
+// Size and last modification time of a file, false if it doesn't exist.
+bool getFileStatus(const std::string &path, uint64_t *size, int64_t *modifiedTime);
+
+bool readFile(const std::string &path, std::string *content);
+
+// Get the content of path as a writable, NUL terminated text for in-situ parsing, in a
+// copy-on-write mapping of the file. Files that end on a page boundary are read into fallback
+// instead. Returns nullptr if the file can't be read.
+char *mapText(const std::string &path, MappedFile *file, std::string *fallback, size_t *size);
+
+// Create the directory if it doesn't exist yet. Parents must exist.
+bool createDirectory(const std::string &path);
+
+// Write content to path through a temporary file, so that concurrent readers never see a partly
+// written file.
+bool writeFileAtomic(const std::string &path, const void *content, size_t size);
+
+// 64-bit FNV-1a. Pass the hash of earlier bytes as hash to hash data after them.
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull);
+
+#endif  // !FILESYSTEM_H
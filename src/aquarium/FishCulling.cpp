@@ -0,0 +1,292 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishCulling.cpp: Implement culling of fish against the view frustum.
+
+#include "FishCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "Aquarium.h"
+#include "FishCullingKernel.h"
+#include "JobSystem.h"
+
+namespace {
+
+// Fish culled and copied by one job. A multiple of every SIMD width, so that only the last chunk
+// of a species has a partial block.
+constexpr int kCullingChunkSize = 4096;
+
+}  // namespace
+
+FishCulling::FishCulling()
+    : mSIMDLevel(getSupportedSIMDLevel()),
+      mJobSystem(nullptr),
+      mPlanes(),
+      mEyePosition(),
+      mLodDistances(),
+      mSpeciesRadii(),
+      mVisibleCounts(),
+      mVisibleOffsets(),
+      mLodCounts(),
+      mFrameCount(0),
+      mTestedFishCount(0),
+      mVisibleFishCount(0),
+      mLodFishCounts()
+{
+    setLodDistances(nullptr);
+}
+
+float FishCulling::computeSpeciesRadius(const float *positions,
+                                        int vertexCount,
+                                        float fishLength,
+                                        float fishBendAmount)
+{
+    // The vertex shader moves a vertex sideways by at most mult^2 * fishBendAmount, where mult
+    // grows from the middle of the fish to its head and, twice as fast, to its tail.
+    float radius  = 0.0f;
+    float maxMult = 0.0f;
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        const float *position = positions + i * 3;
+        radius                = std::max(radius, std::sqrt(position[0] * position[0] +
+                                                           position[1] * position[1] +
+                                                           position[2] * position[2]));
+        float mult = position[2] > 0.0f ? position[2] / fishLength : -position[2] / fishLength * 2;
+        maxMult    = std::max(maxMult, mult);
+    }
+    return radius + maxMult * maxMult * std::fabs(fishBendAmount);
+}
+
+void FishCulling::setViewProjection(const float *viewProjection)
+{
+    // Planes of zeros put every fish at distance 0, inside.
+    if (viewProjection == nullptr)
+    {
+        std::fill(mPlanes, mPlanes + FRUSTUM_PLANE_COUNT * 4, 0.0f);
+        return;
+    }
+
+    // Clip coordinates are the dot products of the position with the columns of the matrix. A
+    // point is inside when -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+    const float *m                            = viewProjection;
+    const float signs[FRUSTUM_PLANE_COUNT][2] = {{1, 1}, {1, -1}, {1, 1}, {1, -1}, {0, 1}, {1, -1}};
+    const int columns[FRUSTUM_PLANE_COUNT]    = {0, 0, 1, 1, 2, 2};
+    for (int p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        float *plane = mPlanes + p * 4;
+        for (int i = 0; i < 4; ++i)
+        {
+            plane[i] = signs[p][0] * m[i * 4 + 3] + signs[p][1] * m[i * 4 + columns[p]];
+        }
+
+        // Unit normals make the plane equation a distance, comparable to the radius.
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for (int i = 0; i < 4; ++i)
+        {
+            plane[i] /= length;
+        }
+    }
+}
+
+void FishCulling::setEyePosition(const float *eyePosition)
+{
+    std::copy(eyePosition, eyePosition + 3, mEyePosition);
+}
+
+void FishCulling::setLodDistances(const float *lodDistances)
+{
+    // No fish is ever infinitely far.
+    for (int i = 0; i < FISH_LOD_COUNT - 1; ++i)
+    {
+        mLodDistances[i] =
+            lodDistances != nullptr ? lodDistances[i] : std::numeric_limits<float>::infinity();
+    }
+}
+
+int FishCulling::cull(const FishSimulation &simulation,
+                      const FishPerPacked *fishPers,
+                      FishPer *visibleFishPers)
+{
+    return cull(simulation, fishPers, reinterpret_cast<unsigned char *>(visibleFishPers),
+                sizeof(FishPer));
+}
+
+int FishCulling::cull(const FishSimulation &simulation,
+                      const FishPerPacked *fishPers,
+                      FishPerPacked *visibleFishPers)
+{
+    return cull(simulation, fishPers, reinterpret_cast<unsigned char *>(visibleFishPers),
+                sizeof(FishPerPacked));
+}
+
+template <typename Function>
+void FishCulling::forEachChunk(Function function)
+{
+    auto runRange = [this, &function](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+        {
+            function(&mChunks[i]);
+        }
+    };
+
+    if (mJobSystem != nullptr)
+    {
+        mJobSystem->parallelFor(static_cast<int>(mChunks.size()), 1, runRange);
+    }
+    else
+    {
+        runRange(0, static_cast<int>(mChunks.size()));
+    }
+}
+
+int FishCulling::cull(const FishSimulation &simulation,
+                      const FishPerPacked *fishPers,
+                      unsigned char *visibleFishPers,
+                      size_t visibleFishPerStride)
+{
+    mChunks.clear();
+    for (int species = 0; species < FISH_SPECIES_COUNT; ++species)
+    {
+        int fishCount = simulation.getFishCount(species);
+        for (int begin = 0; begin < fishCount; begin += kCullingChunkSize)
+        {
+            mChunks.push_back(
+                {species, begin, std::min(begin + kCullingChunkSize, fishCount), 0, {}, {}});
+        }
+    }
+    mVisibleIndices.resize(simulation.getTotalFishCount());
+    mVisibleLods.resize(simulation.getTotalFishCount());
+
+    // Each chunk first writes the indices and levels of its visible fish where its own fish are,
+    // so that chunks don't depend on each other. Once the counts are known, the fish are copied to
+    // their place in the dense array.
+    forEachChunk([this, &simulation, fishPers](Chunk *chunk) {
+        int speciesOffset = simulation.getFishOffset(chunk->species);
+
+        FishCullingArgs args;
+        args.planes       = mPlanes;
+        args.radius       = mSpeciesRadii[chunk->species];
+        args.eyePosition  = mEyePosition;
+        args.lodDistances = mLodDistances;
+        args.begin        = chunk->begin;
+        args.end          = chunk->end;
+        args.fishPers     = fishPers + speciesOffset;
+        args.visible      = mVisibleIndices.data() + speciesOffset + chunk->begin;
+        args.lods         = mVisibleLods.data() + speciesOffset + chunk->begin;
+
+        switch (mSIMDLevel)
+        {
+#ifdef AQUARIUM_SIMD_X86
+            case SIMDLEVELAVX2:
+                chunk->visibleCount = cullFishesAVX2(args);
+                break;
+            case SIMDLEVELSSE2:
+                chunk->visibleCount = cullFishesSSE2(args);
+                break;
+#endif
+            default:
+                chunk->visibleCount = cullFishesScalar(args);
+                break;
+        }
+
+        std::fill(chunk->lodCounts, chunk->lodCounts + FISH_LOD_COUNT, 0);
+        for (int i = 0; i < chunk->visibleCount; ++i)
+        {
+            ++chunk->lodCounts[args.lods[i]];
+        }
+    });
+
+    // The fish of a species are sorted by level, and keep their order within a level.
+    int visibleCount = 0;
+    for (int species = 0; species < FISH_SPECIES_COUNT; ++species)
+    {
+        mVisibleOffsets[species] = visibleCount;
+        for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+        {
+            int lodOffset = visibleCount;
+            for (Chunk &chunk : mChunks)
+            {
+                if (chunk.species == species)
+                {
+                    chunk.lodOffsets[lod] = visibleCount;
+                    visibleCount += chunk.lodCounts[lod];
+                }
+            }
+            mLodCounts[species][lod] = visibleCount - lodOffset;
+            mLodFishCounts[lod] += mLodCounts[species][lod];
+        }
+        mVisibleCounts[species] = visibleCount - mVisibleOffsets[species];
+    }
+
+    forEachChunk([&](Chunk *chunk) {
+        int speciesOffset         = simulation.getFishOffset(chunk->species);
+        const int *indices        = mVisibleIndices.data() + speciesOffset + chunk->begin;
+        const unsigned char *lods = mVisibleLods.data() + speciesOffset + chunk->begin;
+        for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+        {
+            if (chunk->lodCounts[lod] == 0)
+            {
+                continue;
+            }
+            unsigned char *dest = visibleFishPers + chunk->lodOffsets[lod] * visibleFishPerStride;
+            for (int i = 0; i < chunk->visibleCount; ++i)
+            {
+                if (lods[i] == lod)
+                {
+                    memcpy(dest, fishPers + speciesOffset + indices[i], sizeof(FishPerPacked));
+                    dest += visibleFishPerStride;
+                }
+            }
+        }
+    });
+
+    ++mFrameCount;
+    mTestedFishCount += simulation.getTotalFishCount();
+    mVisibleFishCount += visibleCount;
+    return visibleCount;
+}
+
+int cullFishesScalar(const FishCullingArgs &args)
+{
+    int visibleCount = 0;
+    for (int ii = args.begin; ii < args.end; ++ii)
+    {
+        const FishPerPacked &fishPer = args.fishPers[ii];
+        float limit                  = fishPer.scale * -args.radius;
+        float reach                  = fishPer.scale * args.radius;
+
+        bool inside = true;
+        for (int p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            const float *plane = args.planes + p * 4;
+            float distance     = plane[0] * fishPer.worldPosition[0] +
+                             plane[1] * fishPer.worldPosition[1] +
+                             plane[2] * fishPer.worldPosition[2] + plane[3];
+            inside = inside && distance >= limit;
+        }
+        if (!inside)
+        {
+            continue;
+        }
+
+        float dx        = fishPer.worldPosition[0] - args.eyePosition[0];
+        float dy        = fishPer.worldPosition[1] - args.eyePosition[1];
+        float dz        = fishPer.worldPosition[2] - args.eyePosition[2];
+        float distance2 = dx * dx + dy * dy + dz * dz;
+        int lod         = 0;
+        for (int k = 0; k < FISH_LOD_COUNT - 1; ++k)
+        {
+            float lodReach = args.lodDistances[k] * reach;
+            lod += distance2 >= lodReach * lodReach ? 1 : 0;
+        }
+        args.visible[visibleCount] = ii;
+        args.lods[visibleCount++]  = static_cast<unsigned char>(lod);
+    }
+    return visibleCount;
+}
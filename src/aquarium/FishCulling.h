@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishCulling.h: Define culling of fish against the view frustum. Each fish is bounded by a
+// sphere around its world position, whose radius is the radius of its species scaled by the fish.
+// The spheres are tested against the six planes of the view projection with the kernels of the
+// selected instruction set level, and the fish that may be visible are copied into a dense
+// array, species after species, so that only they are uploaded and drawn. The far plane doubles
+// as distance culling. Within a species, the fish are sorted by level of detail, picked from their
+// distance to the eye, so that each level of each species is drawn with one batch.
+
+#pragma once
+#ifndef FISHCULLING_H
+#define FISHCULLING_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FishSimulation.h"
+#include "SIMD.h"
+
+class JobSystem;
+struct FishPer;
+struct FishPerPacked;
+
+constexpr int FRUSTUM_PLANE_COUNT = 6;
+// The full mesh of a fish and its decimated meshes, from the closest fish to the farthest.
+constexpr int FISH_LOD_COUNT = 3;
+
+class FishCulling
+{
+  public:
+    FishCulling();
+
+    // Radius of a sphere around the origin of the model that holds every vertex of the species,
+    // including the bending of the fish vertex shader, before the fish is scaled.
+    static float computeSpeciesRadius(const float *positions,
+                                      int vertexCount,
+                                      float fishLength,
+                                      float fishBendAmount);
+    void setSpeciesRadius(int species, float radius) { mSpeciesRadii[species] = radius; }
+
+    // Take the planes from viewProjection, a row-major matrix applied to row vectors whose depth
+    // ends up in [0, w]. nullptr keeps every fish, to only sort them by level of detail.
+    void setViewProjection(const float *viewProjection);
+
+    // Fish whose distance to eyePosition is at least lodDistances[i] times their bounding radius
+    // use level i + 1. lodDistances holds FISH_LOD_COUNT - 1 increasing distances, or is nullptr
+    // to keep every fish at level 0.
+    void setEyePosition(const float *eyePosition);
+    void setLodDistances(const float *lodDistances);
+
+    // Copy the fish of fishPers that may be visible into visibleFishPers, species after species
+    // and level after level, and return how many there are. fishPers is indexed like the fish of
+    // simulation.
+    int cull(const FishSimulation &simulation,
+             const FishPerPacked *fishPers,
+             FishPer *visibleFishPers);
+    int cull(const FishSimulation &simulation,
+             const FishPerPacked *fishPers,
+             FishPerPacked *visibleFishPers);
+
+    // Where the visible fish of species are in the dense array after the last cull().
+    int getVisibleCount(int species) const { return mVisibleCounts[species]; }
+    int getVisibleOffset(int species) const { return mVisibleOffsets[species]; }
+    // Visible fish of species at each level, which follow each other from getVisibleOffset().
+    const int *getLodCounts(int species) const { return mLodCounts[species]; }
+
+    // Totals over the calls to cull().
+    int getFrameCount() const { return mFrameCount; }
+    uint64_t getTestedFishCount() const { return mTestedFishCount; }
+    uint64_t getVisibleFishCount() const { return mVisibleFishCount; }
+    uint64_t getLodFishCount(int lod) const { return mLodFishCounts[lod]; }
+
+    // The scalar level and the SIMD levels keep exactly the same fish. Defaults to the highest
+    // level supported by the CPU.
+    void setSIMDLevel(SIMDLEVEL level) { mSIMDLevel = level; }
+    SIMDLEVEL getSIMDLevel() const { return mSIMDLevel; }
+
+    // Split culling across the workers of jobSystem. nullptr runs it on the calling thread. The
+    // results are the same either way.
+    void setJobSystem(JobSystem *jobSystem) { mJobSystem = jobSystem; }
+
+  private:
+    // Fish [begin, end) of a species, culled and then copied on their own.
+    struct Chunk
+    {
+        int species;
+        int begin;
+        int end;
+        int visibleCount;
+        int lodCounts[FISH_LOD_COUNT];
+        // Where the visible fish of each level go in the dense array.
+        int lodOffsets[FISH_LOD_COUNT];
+    };
+
+    // Records of visibleFishPers are visibleFishPerStride bytes apart.
+    int cull(const FishSimulation &simulation,
+             const FishPerPacked *fishPers,
+             unsigned char *visibleFishPers,
+             size_t visibleFishPerStride);
+    // Call function(chunk) for every chunk, on the workers of the job system if there is one.
+    template <typename Function>
+    void forEachChunk(Function function);
+
+    SIMDLEVEL mSIMDLevel;
+    JobSystem *mJobSystem;
+    // (a, b, c, d) of each plane, see FishCullingArgs.
+    float mPlanes[FRUSTUM_PLANE_COUNT * 4];
+    float mEyePosition[3];
+    float mLodDistances[FISH_LOD_COUNT - 1];
+    float mSpeciesRadii[FISH_SPECIES_COUNT];
+    int mVisibleCounts[FISH_SPECIES_COUNT];
+    int mVisibleOffsets[FISH_SPECIES_COUNT];
+    int mLodCounts[FISH_SPECIES_COUNT][FISH_LOD_COUNT];
+
+    std::vector<Chunk> mChunks;
+    // Visible fish of each chunk, relative to the species, at the global index of its first fish.
+    std::vector<int> mVisibleIndices;
+    // Level of each of mVisibleIndices.
+    std::vector<unsigned char> mVisibleLods;
+
+    int mFrameCount;
+    uint64_t mTestedFishCount;
+    uint64_t mVisibleFishCount;
+    uint64_t mLodFishCounts[FISH_LOD_COUNT];
+};
+
+#endif  // !FISHCULLING_H
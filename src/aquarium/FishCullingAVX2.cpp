@@ -0,0 +1,20 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishCullingAVX2.cpp: Instantiate the fish culling kernel for AVX2. This file is only built
+// with AVX2 enabled, and is only called after getSupportedSIMDLevel() reported AVX2.
+
+#include "FishCullingKernel.h"
+
+#ifdef AQUARIUM_SIMD_X86
+#ifndef __AVX2__
+#error "FishCullingAVX2.cpp must be built with AVX2 enabled."
+#endif
+
+int cullFishesAVX2(const FishCullingArgs &args)
+{
+    return cullFishesSIMD<simd::AVX2Ops>(args);
+}
+#endif
@@ -0,0 +1,142 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishCullingKernel.h: Define per-instruction-set kernels of the fish culling. Only FishCulling
+// and the per-instruction-set translation units include this header.
+
+#pragma once
+#ifndef FISHCULLINGKERNEL_H
+#define FISHCULLINGKERNEL_H 1
+
+#include "Aquarium.h"
+#include "FishCulling.h"
+#include "SIMDMath.h"
+
+// Inputs of one kernel call: fish [begin, end) of one species.
+struct FishCullingArgs
+{
+    // (a, b, c, d) of each plane, with a unit normal pointing inside the frustum.
+    const float *planes;
+    // Bounding radius of the species before scaling.
+    float radius;
+    const float *eyePosition;
+    // FISH_LOD_COUNT - 1 distances to the eye in bounding radii, see FishCulling.
+    const float *lodDistances;
+
+    int begin;
+    int end;
+    // Indexed by the fish index within the species.
+    const FishPerPacked *fishPers;
+    // Receives the indices of the fish that may be visible, in increasing order.
+    int *visible;
+    // Receives the level of detail of each fish of visible.
+    unsigned char *lods;
+};
+
+// Return the number of indices written to args.visible and args.lods.
+int cullFishesScalar(const FishCullingArgs &args);
+#ifdef AQUARIUM_SIMD_X86
+int cullFishesSSE2(const FishCullingArgs &args);
+int cullFishesAVX2(const FishCullingArgs &args);
+#endif
+
+// Tests Ops::kWidth fish per iteration. A fish is kept unless its bounding sphere is entirely
+// behind one of the planes, and its level is the number of level distances its squared distance to
+// the eye reaches. The arithmetic mirrors cullFishesScalar operation for operation, so every level
+// keeps exactly the same fish at the same levels.
+template <typename Ops>
+int cullFishesSIMD(const FishCullingArgs &args)
+{
+    typedef typename Ops::Float Float;
+    constexpr int kWidth = Ops::kWidth;
+
+    Float planes[FRUSTUM_PLANE_COUNT][4];
+    for (int p = 0; p < FRUSTUM_PLANE_COUNT; ++p)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            planes[p][j] = Ops::set1(args.planes[p * 4 + j]);
+        }
+    }
+    const Float radius         = Ops::set1(args.radius);
+    const Float negativeRadius = Ops::set1(-args.radius);
+    Float eye[3];
+    for (int j = 0; j < 3; ++j)
+    {
+        eye[j] = Ops::set1(args.eyePosition[j]);
+    }
+    Float lodDistances[FISH_LOD_COUNT - 1];
+    for (int k = 0; k < FISH_LOD_COUNT - 1; ++k)
+    {
+        lodDistances[k] = Ops::set1(args.lodDistances[k]);
+    }
+
+    float xIn[kWidth], yIn[kWidth], zIn[kWidth], scaleIn[kWidth];
+    int visibleCount = 0;
+
+    for (int first = args.begin; first < args.end; first += kWidth)
+    {
+        const int count = args.end - first < kWidth ? args.end - first : kWidth;
+        for (int i = 0; i < kWidth; ++i)
+        {
+            const FishPerPacked &fishPer = args.fishPers[first + (i < count ? i : count - 1)];
+            xIn[i]                       = fishPer.worldPosition[0];
+            yIn[i]                       = fishPer.worldPosition[1];
+            zIn[i]                       = fishPer.worldPosition[2];
+            scaleIn[i]                   = fishPer.scale;
+        }
+
+        Float x     = Ops::load(xIn);
+        Float y     = Ops::load(yIn);
+        Float z     = Ops::load(zIn);
+        Float scale = Ops::load(scaleIn);
+        Float limit = Ops::mul(scale, negativeRadius);
+
+        Float inside = Ops::greaterEqual(
+            Ops::add(Ops::add(Ops::add(Ops::mul(planes[0][0], x), Ops::mul(planes[0][1], y)),
+                              Ops::mul(planes[0][2], z)),
+                     planes[0][3]),
+            limit);
+        for (int p = 1; p < FRUSTUM_PLANE_COUNT; ++p)
+        {
+            Float distance =
+                Ops::add(Ops::add(Ops::add(Ops::mul(planes[p][0], x), Ops::mul(planes[p][1], y)),
+                                  Ops::mul(planes[p][2], z)),
+                         planes[p][3]);
+            inside = Ops::andMask(inside, Ops::greaterEqual(distance, limit));
+        }
+
+        Float reach     = Ops::mul(scale, radius);
+        Float dx        = Ops::sub(x, eye[0]);
+        Float dy        = Ops::sub(y, eye[1]);
+        Float dz        = Ops::sub(z, eye[2]);
+        Float distance2 = Ops::add(Ops::add(Ops::mul(dx, dx), Ops::mul(dy, dy)), Ops::mul(dz, dz));
+        int lodMasks[FISH_LOD_COUNT - 1];
+        for (int k = 0; k < FISH_LOD_COUNT - 1; ++k)
+        {
+            Float lodReach = Ops::mul(lodDistances[k], reach);
+            lodMasks[k] =
+                Ops::moveMask(Ops::greaterEqual(distance2, Ops::mul(lodReach, lodReach)));
+        }
+
+        int mask = Ops::moveMask(inside);
+        for (int i = 0; i < count; ++i)
+        {
+            if (mask & (1 << i))
+            {
+                int lod = 0;
+                for (int k = 0; k < FISH_LOD_COUNT - 1; ++k)
+                {
+                    lod += (lodMasks[k] >> i) & 1;
+                }
+                args.visible[visibleCount] = first + i;
+                args.lods[visibleCount++]  = static_cast<unsigned char>(lod);
+            }
+        }
+    }
+    return visibleCount;
+}
+
+#endif  // !FISHCULLINGKERNEL_H
@@ -0,0 +1,15 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishCullingSSE2.cpp: Instantiate the fish culling kernel for SSE2, which every x86 target has.
+
+#include "FishCullingKernel.h"
+
+#ifdef AQUARIUM_SIMD_X86
+int cullFishesSSE2(const FishCullingArgs &args)
+{
+    return cullFishesSIMD<simd::SSE2Ops>(args);
+}
+#endif
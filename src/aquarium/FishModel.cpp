@@ -9,13 +9,58 @@
 
 void FishModel::prepareForDraw()
 {
+    int species    = getSpecies();
     mFishPerOffset = 0;
-    for (int i = 0; i < mName - MODELNAME::MODELSMALLFISHA; i++)
+    for (int i = 0; i < species; i++)
     {
         const Fish &fishInfo = fishTable[i];
         mFishPerOffset += mAquarium->fishCounts[fishInfo.modelName - MODELNAME::MODELSMALLFISHA];
     }
 
-    const Fish &fishInfo = fishTable[mName - MODELNAME::MODELSMALLFISHA];
-    mCurInstance         = mAquarium->fishCounts[fishInfo.modelName - MODELNAME::MODELSMALLFISHA];
+    const Fish &fishInfo = fishTable[species];
+    setVisibleInstances(mFishPerOffset,
+                        mAquarium->fishCounts[fishInfo.modelName - MODELNAME::MODELSMALLFISHA]);
+}
+
+void FishModel::setVisibleInstances(int fishPerOffset, int instanceCount)
+{
+    int lodCounts[FISH_LOD_COUNT] = {instanceCount};
+    setVisibleInstances(fishPerOffset, lodCounts);
+}
+
+void FishModel::setVisibleInstances(int fishPerOffset, const int *lodCounts)
+{
+    mFishPerOffset = fishPerOffset;
+    mCurInstance   = 0;
+    for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+    {
+        mLodInstanceCounts[lod] = lodCounts[lod];
+        mCurInstance += lodCounts[lod];
+    }
+}
+
+int FishModel::getSpecies() const
+{
+    // The instanced models come after the others, in the same order.
+    return mName >= MODELNAME::MODELSMALLFISHAINSTANCEDDRAWS
+               ? mName - MODELNAME::MODELSMALLFISHAINSTANCEDDRAWS
+               : mName - MODELNAME::MODELSMALLFISHA;
+}
+
+std::string FishModel::getLodIndicesName(int lod)
+{
+    return lod == 0 ? "indices" : "indicesLod" + std::to_string(lod);
+}
+
+Buffer *FishModel::getLodIndicesBuffer(int lod)
+{
+    for (; lod > 0; --lod)
+    {
+        auto buffer = bufferMap.find(getLodIndicesName(lod));
+        if (buffer != bufferMap.end())
+        {
+            return buffer->second;
+        }
+    }
+    return bufferMap["indices"];
 }
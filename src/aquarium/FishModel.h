@@ -19,6 +19,7 @@ class FishModel : public Model
           mPreInstance(0),
           mCurInstance(0),
           mFishPerOffset(0),
+          mLodInstanceCounts(),
           mAquarium(aquarium)
     {
     }
@@ -34,10 +35,39 @@ class FishModel : public Model
                                        int index) = 0;
     void prepareForDraw();
 
+    // Replaying recorded draws, see CommandStream.h: bind() sets the state of the model and
+    // bindLod() the mesh of a level of detail, then drawFish() draws the fish whose fish data is at
+    // fishPerIndex. Models that can't draw fish one by one are recorded whole instead, and leave
+    // these alone.
+    virtual void bind() {}
+    virtual void bindLod(int lod) {}
+    virtual void drawFish(int fishPerIndex, int indexCount) {}
+    // Indices of the mesh of a level, the full mesh for levels that weren't generated.
+    virtual int getIndexCount(int lod) const { return 0; }
+
+    // Index of the model in fishTable.
+    int getSpecies() const;
+    // Name in bufferMap of the indices of the mesh of a level of detail.
+    static std::string getLodIndicesName(int lod);
+
+    int getInstanceCount() const { return mCurInstance; }
+    // Draw instanceCount fish from fishPerOffset instead of all fish of the model, after
+    // prepareForDraw(). The fish are all drawn with the full mesh, or lodCounts[i] of them with
+    // the mesh of level i, one level after the other.
+    void setVisibleInstances(int fishPerOffset, int instanceCount);
+    void setVisibleInstances(int fishPerOffset, const int *lodCounts);
+    int getLodInstanceCount(int lod) const { return mLodInstanceCounts[lod]; }
+    // Index of the fish data of the first fish of the model.
+    int getFishPerOffset() const { return mFishPerOffset; }
+
   protected:
+    // Indices of the mesh of a level, or of the closest level below it that has a mesh.
+    Buffer *getLodIndicesBuffer(int lod);
+
     int mPreInstance;
     int mCurInstance;
     int mFishPerOffset;
+    int mLodInstanceCounts[FISH_LOD_COUNT];
 
     Aquarium *mAquarium;
 };
@@ -0,0 +1,254 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishSimulation.cpp: Implement fish simulation engine.
+
+#include "FishSimulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Aquarium.h"
+#include "FishSimulationKernel.h"
+#include "JobSystem.h"
+
+namespace {
+
+// speed, scale, xRadius, yRadius and zRadius.
+constexpr int kRandomsPerFish = 5;
+// Counter-based random slots reserved per species; two Philox blocks.
+constexpr int kSlotsPerSpecies = 8;
+// Multiple of every SIMD width, so that only the last range of a species has a partial block.
+constexpr int kFishGrainSize = 1024;
+
+// The kernels write both layouts through FishPerPacked.
+static_assert(sizeof(FishPerPacked) == 32, "Packed fish data must match the shader struct");
+static_assert(sizeof(FishPer) == 256, "Fish data must fill a constant buffer view");
+
+}  // namespace
+
+FishSimulation::FishSimulation()
+    : mSIMDLevel(getSupportedSIMDLevel()),
+      mJobSystem(nullptr),
+      mLegacyRandom(false),
+      mFishCounts(),
+      mFishOffsets(),
+      mTotalFishCount(0)
+{
+}
+
+template <typename Function>
+void FishSimulation::forEachSpeciesRange(int begin, int end, Function function) const
+{
+    for (int species = 0; species < FISH_SPECIES_COUNT; ++species)
+    {
+        int first = std::max(begin, mFishOffsets[species]);
+        int last  = std::min(end, mFishOffsets[species] + mFishCounts[species]);
+        if (first < last)
+        {
+            function(species, first - mFishOffsets[species], last - mFishOffsets[species]);
+        }
+    }
+}
+
+void FishSimulation::reset(const int *fishCounts)
+{
+    mTotalFishCount = 0;
+    for (int i = 0; i < FISH_SPECIES_COUNT; ++i)
+    {
+        mFishCounts[i]  = fishCounts[i];
+        mFishOffsets[i] = mTotalFishCount;
+        mTotalFishCount += fishCounts[i];
+    }
+
+    mSpeed.resize(mTotalFishCount);
+    mScale.resize(mTotalFishCount);
+    mXRadius.resize(mTotalFishCount);
+    mYRadius.resize(mTotalFishCount);
+    mZRadius.resize(mTotalFishCount);
+
+    auto generateRange = [this](int begin, int end) {
+        if (mLegacyRandom)
+        {
+            generateLegacyParameters(begin, end);
+            return;
+        }
+        forEachSpeciesRange(begin, end, [this](int species, int first, int last) {
+            generateParameters(species, first, last);
+        });
+    };
+
+    if (mJobSystem != nullptr)
+    {
+        mJobSystem->parallelFor(mTotalFishCount, kFishGrainSize, generateRange);
+    }
+    else
+    {
+        generateRange(0, mTotalFishCount);
+    }
+}
+
+void FishSimulation::generateParameters(int species, int begin, int end)
+{
+    const Fish &fishInfo  = fishTable[species];
+    float fishRadius      = fishInfo.radius;
+    float fishRadiusRange = fishInfo.radiusRange;
+    float fishSpeed       = fishInfo.speed;
+    float fishSpeedRange  = fishInfo.speedRange;
+    float fishHeightRange = g_fishHeightRange * fishInfo.heightRange;
+
+    // Fish are keyed by species and index within the species, so a fish keeps its parameters
+    // when the counts of other species change.
+    int offset            = mFishOffsets[species];
+    float *speed          = mSpeed.data() + offset;
+    float *scale          = mScale.data() + offset;
+    float *xRadius        = mXRadius.data() + offset;
+    float *yRadius        = mYRadius.data() + offset;
+    float *zRadius        = mZRadius.data() + offset;
+
+    float *const outs[kRandomsPerFish] = {speed + begin, scale + begin, xRadius + begin,
+                                          yRadius + begin, zRadius + begin};
+    mRandom.fill(begin, end - begin, species * kSlotsPerSpecies, kRandomsPerFish, outs,
+                 mSIMDLevel);
+
+    for (int ii = begin; ii < end; ++ii)
+    {
+        speed[ii]   = fishSpeed + speed[ii] * fishSpeedRange;
+        scale[ii]   = 1.0f + scale[ii] * 1;
+        xRadius[ii] = fishRadius + xRadius[ii] * fishRadiusRange;
+        yRadius[ii] = 2.0f + yRadius[ii] * fishHeightRange;
+        zRadius[ii] = fishRadius + zRadius[ii] * fishRadiusRange;
+    }
+}
+
+void FishSimulation::generateLegacyParameters(int begin, int end)
+{
+    // Every fish draws kRandomsPerFish values in global fish order, so the parameters of fish i
+    // come from position kRandomsPerFish * i of the sequence, whichever thread generates them.
+    LegacyRandomStream random(static_cast<long long>(kRandomsPerFish) * begin);
+    forEachSpeciesRange(begin, end, [this, &random](int species, int first, int last) {
+        const Fish &fishInfo  = fishTable[species];
+        float fishRadius      = fishInfo.radius;
+        float fishRadiusRange = fishInfo.radiusRange;
+        float fishSpeed       = fishInfo.speed;
+        float fishSpeedRange  = fishInfo.speedRange;
+        float fishHeightRange = g_fishHeightRange * fishInfo.heightRange;
+
+        int offset = mFishOffsets[species];
+        for (int ii = first; ii < last; ++ii)
+        {
+            mSpeed[offset + ii] = fishSpeed + static_cast<float>(random.next()) * fishSpeedRange;
+            mScale[offset + ii] = 1.0f + static_cast<float>(random.next()) * 1;
+            mXRadius[offset + ii] =
+                fishRadius + static_cast<float>(random.next()) * fishRadiusRange;
+            mYRadius[offset + ii] = 2.0f + static_cast<float>(random.next()) * fishHeightRange;
+            mZRadius[offset + ii] =
+                fishRadius + static_cast<float>(random.next()) * fishRadiusRange;
+        }
+    });
+}
+
+void FishSimulation::update(float mclock, FishPer *fishPers) const
+{
+    update(mclock, reinterpret_cast<unsigned char *>(fishPers), sizeof(FishPer));
+}
+
+void FishSimulation::update(float mclock, FishPerPacked *fishPers) const
+{
+    update(mclock, reinterpret_cast<unsigned char *>(fishPers), sizeof(FishPerPacked));
+}
+
+void FishSimulation::update(float mclock, unsigned char *fishPers, size_t fishPerStride) const
+{
+    // Fish are independent and every kernel computes a fish the same way wherever the range
+    // boundaries fall, so the parallel result matches the serial one exactly.
+    auto updateRange = [this, mclock, fishPers, fishPerStride](int begin, int end) {
+        forEachSpeciesRange(begin, end, [&](int species, int first, int last) {
+            updateSpecies(mclock, species, first, last, fishPers, fishPerStride);
+        });
+    };
+
+    if (mJobSystem != nullptr)
+    {
+        mJobSystem->parallelFor(mTotalFishCount, kFishGrainSize, updateRange);
+    }
+    else
+    {
+        updateRange(0, mTotalFishCount);
+    }
+}
+
+void FishSimulation::updateSpecies(float mclock,
+                                   int species,
+                                   int begin,
+                                   int end,
+                                   unsigned char *fishPers,
+                                   size_t fishPerStride) const
+{
+    const Fish &fishInfo = fishTable[species];
+    const int offset     = mFishOffsets[species];
+
+    FishKernelArgs args;
+    args.mclock        = mclock;
+    args.fishBaseClock = mclock * g_fishSpeed;
+    args.fishTailSpeed = fishInfo.tailSpeed * g_fishTailSpeed;
+    args.fishOffset    = g_fishOffset;
+    args.fishHeight    = g_fishHeight + fishInfo.heightOffset;
+    args.fishXClock    = g_fishXClock;
+    args.fishYClock    = g_fishYClock;
+    args.fishZClock    = g_fishZClock;
+    args.begin         = begin;
+    args.end           = end;
+    args.speed         = mSpeed.data() + offset;
+    args.scale         = mScale.data() + offset;
+    args.xRadius       = mXRadius.data() + offset;
+    args.yRadius       = mYRadius.data() + offset;
+    args.zRadius       = mZRadius.data() + offset;
+    args.fishPers      = fishPers + offset * fishPerStride;
+    args.fishPerStride = fishPerStride;
+
+    switch (mSIMDLevel)
+    {
+#ifdef AQUARIUM_SIMD_X86
+        case SIMDLEVELAVX2:
+            updateFishesAVX2(args);
+            break;
+        case SIMDLEVELSSE2:
+            updateFishesSSE2(args);
+            break;
+#endif
+        default:
+            updateFishesScalar(args);
+            break;
+    }
+}
+
+void updateFishesScalar(const FishKernelArgs &args)
+{
+    for (int ii = args.begin; ii < args.end; ++ii)
+    {
+        float speed   = args.speed[ii];
+        float xRadius = args.xRadius[ii];
+        float yRadius = args.yRadius[ii];
+        float zRadius = args.zRadius[ii];
+
+        float fishClock      = args.fishBaseClock + ii * args.fishOffset;
+        float fishSpeedClock = fishClock * speed;
+        float xClock         = fishSpeedClock * args.fishXClock;
+        float yClock         = fishSpeedClock * args.fishYClock;
+        float zClock         = fishSpeedClock * args.fishZClock;
+
+        FishPerPacked &fishPer   = *args.getFishPer(ii);
+        fishPer.worldPosition[0] = sin(xClock) * xRadius;
+        fishPer.worldPosition[1] = sin(yClock) * yRadius + args.fishHeight;
+        fishPer.worldPosition[2] = cos(zClock) * zRadius;
+        fishPer.nextPosition[0]  = sin(xClock - 0.04f) * xRadius;
+        fishPer.nextPosition[1]  = sin(yClock - 0.01f) * yRadius + args.fishHeight;
+        fishPer.nextPosition[2]  = cos(zClock - 0.04f) * zRadius;
+        fishPer.scale            = args.scale[ii];
+        fishPer.time = fmod((args.mclock + ii * g_tailOffsetMult) * args.fishTailSpeed * speed,
+                            static_cast<float>(M_PI) * 2);
+    }
+}
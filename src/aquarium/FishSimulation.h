@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishSimulation.h: Define fish simulation engine. Per-fish parameters (speed, scale and radii)
+// are kept in structure-of-arrays form and regenerated only when fish counts change, from a
+// counter-based random generator. Positions and tail times of all fish are written into the
+// FishPer array in one batch pass per frame, using the vectorized kernels of the selected
+// instruction set level.
+
+#pragma once
+#ifndef FISHSIMULATION_H
+#define FISHSIMULATION_H 1
+
+#include <cstddef>
+#include <vector>
+
+#include "Random.h"
+#include "SIMD.h"
+
+class JobSystem;
+struct FishPer;
+struct FishPerPacked;
+
+constexpr int FISH_SPECIES_COUNT = 5;
+
+class FishSimulation
+{
+  public:
+    FishSimulation();
+
+    // Regenerate per-fish parameters for the given per-species fish counts.
+    void reset(const int *fishCounts);
+
+    // Draw fish parameters from the LCG sequence of earlier versions instead of the counter-based
+    // generator, to reproduce their output bit for bit. Takes effect on the next reset.
+    void setLegacyRandom(bool legacyRandom) { mLegacyRandom = legacyRandom; }
+
+    // Write world position, next position, scale and tail time of all fish. fishPers is indexed
+    // by the global fish index, species after species.
+    void update(float mclock, FishPer *fishPers) const;
+    void update(float mclock, FishPerPacked *fishPers) const;
+
+    // The scalar level reproduces the C library results bit for bit. SIMD levels stay within the
+    // bounds documented in SIMDMath.h. Defaults to the highest level supported by the CPU.
+    void setSIMDLevel(SIMDLEVEL level) { mSIMDLevel = level; }
+    SIMDLEVEL getSIMDLevel() const { return mSIMDLevel; }
+
+    // Split reset and update across the workers of jobSystem. nullptr runs them on the calling
+    // thread. The results are the same either way.
+    void setJobSystem(JobSystem *jobSystem) { mJobSystem = jobSystem; }
+
+    int getFishCount(int species) const { return mFishCounts[species]; }
+    int getFishOffset(int species) const { return mFishOffsets[species]; }
+    int getTotalFishCount() const { return mTotalFishCount; }
+
+  private:
+    void generateParameters(int species, int begin, int end);
+    void generateLegacyParameters(int begin, int end);
+    // Records of the fish data layouts are fishPerStride bytes apart.
+    void update(float mclock, unsigned char *fishPers, size_t fishPerStride) const;
+    void updateSpecies(float mclock,
+                       int species,
+                       int begin,
+                       int end,
+                       unsigned char *fishPers,
+                       size_t fishPerStride) const;
+    // Call function(species, begin, end) for the parts of global fish range [begin, end) that
+    // belong to each species, with indices relative to the species.
+    template <typename Function>
+    void forEachSpeciesRange(int begin, int end, Function function) const;
+
+    SIMDLEVEL mSIMDLevel;
+    JobSystem *mJobSystem;
+    bool mLegacyRandom;
+    CounterRandom mRandom;
+    int mFishCounts[FISH_SPECIES_COUNT];
+    int mFishOffsets[FISH_SPECIES_COUNT];
+    int mTotalFishCount;
+
+    std::vector<float> mSpeed;
+    std::vector<float> mScale;
+    std::vector<float> mXRadius;
+    std::vector<float> mYRadius;
+    std::vector<float> mZRadius;
+};
+
+#endif  // !FISHSIMULATION_H
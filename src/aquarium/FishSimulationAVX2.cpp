@@ -0,0 +1,20 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishSimulationAVX2.cpp: Instantiate the fish simulation kernel for AVX2. This file is the only
+// one built with AVX2 enabled, and is only called after getSupportedSIMDLevel() reported AVX2.
+
+#include "FishSimulationKernel.h"
+
+#ifdef AQUARIUM_SIMD_X86
+#ifndef __AVX2__
+#error "FishSimulationAVX2.cpp must be built with AVX2 enabled."
+#endif
+
+void updateFishesAVX2(const FishKernelArgs &args)
+{
+    updateFishesSIMD<simd::AVX2Ops>(args);
+}
+#endif
@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishSimulationKernel.h: Define per-instruction-set kernels of the fish simulation. Only
+// FishSimulation and the per-instruction-set translation units include this header.
+
+#pragma once
+#ifndef FISHSIMULATIONKERNEL_H
+#define FISHSIMULATIONKERNEL_H 1
+
+#include "Aquarium.h"
+#include "SIMDMath.h"
+
+// Inputs of one kernel call: fish [begin, end) of one species.
+struct FishKernelArgs
+{
+    float mclock;
+    float fishBaseClock;
+    float fishTailSpeed;
+    float fishOffset;
+    float fishHeight;
+    float fishXClock;
+    float fishYClock;
+    float fishZClock;
+
+    int begin;
+    int end;
+    // Indexed by the fish index within the species.
+    const float *speed;
+    const float *scale;
+    const float *xRadius;
+    const float *yRadius;
+    const float *zRadius;
+    // Fish data records, fishPerStride bytes apart.
+    unsigned char *fishPers;
+    size_t fishPerStride;
+
+    FishPerPacked *getFishPer(int ii) const
+    {
+        return reinterpret_cast<FishPerPacked *>(fishPers + ii * fishPerStride);
+    }
+};
+
+void updateFishesScalar(const FishKernelArgs &args);
+#ifdef AQUARIUM_SIMD_X86
+void updateFishesSSE2(const FishKernelArgs &args);
+void updateFishesAVX2(const FishKernelArgs &args);
+#endif
+
+// Computes Ops::kWidth fish per iteration. The arithmetic mirrors updateFishesScalar operation
+// for operation; only sin, cos and fmod are replaced by their vectorized versions. The last
+// partial block is padded rather than handed to the scalar kernel, so the result of a fish does
+// not depend on how a species is split into ranges.
+template <typename Ops>
+void updateFishesSIMD(const FishKernelArgs &args)
+{
+    typedef typename Ops::Float Float;
+    constexpr int kWidth = Ops::kWidth;
+
+    const Float mclock        = Ops::set1(args.mclock);
+    const Float fishBaseClock = Ops::set1(args.fishBaseClock);
+    const Float fishTailSpeed = Ops::set1(args.fishTailSpeed);
+    const Float fishOffset    = Ops::set1(args.fishOffset);
+    const Float fishHeight    = Ops::set1(args.fishHeight);
+    const Float fishXClock    = Ops::set1(args.fishXClock);
+    const Float fishYClock    = Ops::set1(args.fishYClock);
+    const Float fishZClock    = Ops::set1(args.fishZClock);
+    const Float tailOffset    = Ops::set1(g_tailOffsetMult);
+
+    float lane[kWidth];
+    for (int i = 0; i < kWidth; ++i)
+    {
+        lane[i] = static_cast<float>(i);
+    }
+    const Float laneIndex = Ops::load(lane);
+
+    float speedIn[kWidth], scaleIn[kWidth], xRadiusIn[kWidth], yRadiusIn[kWidth],
+        zRadiusIn[kWidth];
+    float out[8][kWidth];
+
+    for (int first = args.begin; first < args.end; first += kWidth)
+    {
+        const int count = args.end - first < kWidth ? args.end - first : kWidth;
+        const float *speedPtr   = args.speed + first;
+        const float *scalePtr   = args.scale + first;
+        const float *xRadiusPtr = args.xRadius + first;
+        const float *yRadiusPtr = args.yRadius + first;
+        const float *zRadiusPtr = args.zRadius + first;
+        if (count < kWidth)
+        {
+            for (int i = 0; i < kWidth; ++i)
+            {
+                int src      = i < count ? i : count - 1;
+                speedIn[i]   = speedPtr[src];
+                scaleIn[i]   = scalePtr[src];
+                xRadiusIn[i] = xRadiusPtr[src];
+                yRadiusIn[i] = yRadiusPtr[src];
+                zRadiusIn[i] = zRadiusPtr[src];
+            }
+            speedPtr   = speedIn;
+            scalePtr   = scaleIn;
+            xRadiusPtr = xRadiusIn;
+            yRadiusPtr = yRadiusIn;
+            zRadiusPtr = zRadiusIn;
+        }
+
+        Float ii      = Ops::add(Ops::set1(static_cast<float>(first)), laneIndex);
+        Float speed   = Ops::load(speedPtr);
+        Float xRadius = Ops::load(xRadiusPtr);
+        Float yRadius = Ops::load(yRadiusPtr);
+        Float zRadius = Ops::load(zRadiusPtr);
+
+        Float fishClock      = Ops::add(fishBaseClock, Ops::mul(ii, fishOffset));
+        Float fishSpeedClock = Ops::mul(fishClock, speed);
+        Float xClock         = Ops::mul(fishSpeedClock, fishXClock);
+        Float yClock         = Ops::mul(fishSpeedClock, fishYClock);
+        Float zClock         = Ops::mul(fishSpeedClock, fishZClock);
+
+        Ops::store(out[0], Ops::mul(simd::sin<Ops>(xClock), xRadius));
+        Ops::store(out[1], Ops::add(Ops::mul(simd::sin<Ops>(yClock), yRadius), fishHeight));
+        Ops::store(out[2], Ops::mul(simd::cos<Ops>(zClock), zRadius));
+        Ops::store(out[3],
+                   Ops::mul(simd::sin<Ops>(Ops::sub(xClock, Ops::set1(0.04f))), xRadius));
+        Ops::store(out[4],
+                   Ops::add(Ops::mul(simd::sin<Ops>(Ops::sub(yClock, Ops::set1(0.01f))), yRadius),
+                            fishHeight));
+        Ops::store(out[5],
+                   Ops::mul(simd::cos<Ops>(Ops::sub(zClock, Ops::set1(0.04f))), zRadius));
+        Ops::store(out[6], Ops::load(scalePtr));
+        Float tail = Ops::mul(Ops::mul(Ops::add(mclock, Ops::mul(ii, tailOffset)), fishTailSpeed),
+                              speed);
+        Ops::store(out[7], simd::fmod<Ops>(tail, static_cast<float>(M_PI) * 2));
+
+        for (int i = 0; i < count; ++i)
+        {
+            FishPerPacked *fishPer    = args.getFishPer(first + i);
+            fishPer->worldPosition[0] = out[0][i];
+            fishPer->worldPosition[1] = out[1][i];
+            fishPer->worldPosition[2] = out[2][i];
+            fishPer->nextPosition[0]  = out[3][i];
+            fishPer->nextPosition[1]  = out[4][i];
+            fishPer->nextPosition[2]  = out[5][i];
+            fishPer->scale            = out[6][i];
+            fishPer->time             = out[7][i];
+        }
+    }
+}
+
+#endif  // !FISHSIMULATIONKERNEL_H
@@ -0,0 +1,15 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishSimulationSSE2.cpp: Instantiate the fish simulation kernel for SSE2.
+
+#include "FishSimulationKernel.h"
+
+#ifdef AQUARIUM_SIMD_X86
+void updateFishesSSE2(const FishKernelArgs &args)
+{
+    updateFishesSIMD<simd::SSE2Ops>(args);
+}
+#endif
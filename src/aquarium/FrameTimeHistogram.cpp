@@ -0,0 +1,122 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FrameTimeHistogram.cpp: Implement frame time histogram.
+
+#include "FrameTimeHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Values below kLinearCount microseconds have a bucket each.
+constexpr int kLinearBits  = 8;
+constexpr int kLinearCount = 1 << kLinearBits;
+// Buckets per power of two above that.
+constexpr int kSubBucketCount = kLinearCount / 2;
+// Longer frames, about 19 hours, are counted in the last bucket.
+constexpr int kMaxExponent = 35;
+constexpr int kBucketCount = kLinearCount + (kMaxExponent - kLinearBits + 1) * kSubBucketCount;
+
+}  // namespace
+
+FrameTimeHistogram::FrameTimeHistogram() : mBuckets(kBucketCount)
+{
+    reset();
+}
+
+void FrameTimeHistogram::reset()
+{
+    std::fill(mBuckets.begin(), mBuckets.end(), 0);
+    mCount              = 0;
+    mMin                = 0.0;
+    mMax                = 0.0;
+    mMean               = 0.0;
+    mSquaredDifferences = 0.0;
+}
+
+void FrameTimeHistogram::record(double milliseconds)
+{
+    milliseconds          = std::max(milliseconds, 0.0);
+    uint64_t microseconds = static_cast<uint64_t>(milliseconds * 1000.0 + 0.5);
+    ++mBuckets[getBucketIndex(microseconds)];
+
+    mMin = mCount == 0 ? milliseconds : std::min(mMin, milliseconds);
+    mMax = std::max(mMax, milliseconds);
+
+    ++mCount;
+    double difference = milliseconds - mMean;
+    mMean += difference / mCount;
+    mSquaredDifferences += difference * (milliseconds - mMean);
+}
+
+double FrameTimeHistogram::getStandardDeviation() const
+{
+    return mCount > 1 ? std::sqrt(mSquaredDifferences / (mCount - 1)) : 0.0;
+}
+
+double FrameTimeHistogram::getPercentile(double percentile) const
+{
+    if (mCount == 0)
+    {
+        return 0.0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(percentile / 100.0 * mCount));
+    rank          = std::min(std::max(rank, static_cast<uint64_t>(1)), mCount);
+
+    uint64_t count = 0;
+    int index      = 0;
+    for (; index < kBucketCount - 1; ++index)
+    {
+        count += mBuckets[index];
+        if (count >= rank)
+        {
+            break;
+        }
+    }
+
+    // The extremes are known exactly.
+    return std::min(std::max(getBucketValue(index) / 1000.0, getMin()), mMax);
+}
+
+int FrameTimeHistogram::getBucketIndex(uint64_t microseconds)
+{
+    if (microseconds < kLinearCount)
+    {
+        return static_cast<int>(microseconds);
+    }
+
+    int exponent = kLinearBits;
+    while (exponent < kMaxExponent && (microseconds >> (exponent + 1)) != 0)
+    {
+        ++exponent;
+    }
+    if ((microseconds >> (exponent + 1)) != 0)
+    {
+        return kBucketCount - 1;
+    }
+
+    // The kLinearBits leading bits select the bucket within the power of two.
+    int subBucket = static_cast<int>(microseconds >> (exponent - kLinearBits + 1));
+    return kLinearCount + (exponent - kLinearBits) * kSubBucketCount +
+           (subBucket - kSubBucketCount);
+}
+
+double FrameTimeHistogram::getBucketValue(int index)
+{
+    if (index < kLinearCount)
+    {
+        return index;
+    }
+
+    int exponent  = kLinearBits + (index - kLinearCount) / kSubBucketCount;
+    int subBucket = kSubBucketCount + (index - kLinearCount) % kSubBucketCount;
+    int shift     = exponent - kLinearBits + 1;
+    double lowest = std::ldexp(static_cast<double>(subBucket), shift);
+    double width  = std::ldexp(1.0, shift);
+    return lowest + (width - 1.0) / 2.0;
+}
@@ -0,0 +1,48 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FrameTimeHistogram.h: Define a fixed-memory histogram of frame times. Buckets are log-linear,
+// like an HDR histogram: exact below 256 microseconds, then 128 buckets per power of two, so that
+// percentiles are within 0.4% of the recorded value whatever the run length. Mean and standard
+// deviation are computed from the exact values.
+
+#pragma once
+#ifndef FRAMETIMEHISTOGRAM_H
+#define FRAMETIMEHISTOGRAM_H 1
+
+#include <cstdint>
+#include <vector>
+
+class FrameTimeHistogram
+{
+  public:
+    FrameTimeHistogram();
+
+    void record(double milliseconds);
+    void reset();
+
+    uint64_t getCount() const { return mCount; }
+    double getMin() const { return mCount > 0 ? mMin : 0.0; }
+    double getMax() const { return mMax; }
+    double getMean() const { return mMean; }
+    double getStandardDeviation() const;
+    // The value below which percentile percent of the frame times fall, in milliseconds.
+    double getPercentile(double percentile) const;
+
+  private:
+    static int getBucketIndex(uint64_t microseconds);
+    // The midpoint of the values that fall in bucket index, in microseconds.
+    static double getBucketValue(int index);
+
+    std::vector<uint64_t> mBuckets;
+    uint64_t mCount;
+    double mMin;
+    double mMax;
+    // Welford's running mean and sum of squared differences from it.
+    double mMean;
+    double mSquaredDifferences;
+};
+
+#endif  // !FRAMETIMEHISTOGRAM_H
@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// JobSystem.cpp: Implement the work-stealing job system.
+
+#include "JobSystem.h"
+
+#include <algorithm>
+
+JobSystem::JobSystem(int workerCount) : mQueuedJobs(0), mQuit(false)
+{
+    if (workerCount < 0)
+    {
+        int coreCount = static_cast<int>(std::thread::hardware_concurrency());
+        workerCount   = std::max(coreCount - 1, 0);
+    }
+
+    for (int i = 0; i <= workerCount; ++i)
+    {
+        mQueues.emplace_back(new WorkQueue());
+    }
+    for (int i = 0; i < workerCount; ++i)
+    {
+        mWorkers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        mQuit = true;
+    }
+    mWakeCondition.notify_all();
+
+    for (std::thread &worker : mWorkers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::parallelFor(int count, int grainSize, const RangeFunction &function)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    grainSize    = std::max(grainSize, 1);
+    int jobCount = (count + grainSize - 1) / grainSize;
+    if (mWorkers.empty() || jobCount == 1)
+    {
+        for (int begin = 0; begin < count; begin += grainSize)
+        {
+            function(begin, std::min(begin + grainSize, count));
+        }
+        return;
+    }
+
+    // Deal the jobs out round robin, so that stealing is only needed to even out imbalance.
+    std::atomic<int> pending(jobCount);
+    int queueCount = static_cast<int>(mQueues.size());
+    for (int i = 0; i < queueCount; ++i)
+    {
+        WorkQueue &queue = *mQueues[i];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (int j = i; j < jobCount; j += queueCount)
+        {
+            int begin = j * grainSize;
+            queue.jobs.push_back({&function, begin, std::min(begin + grainSize, count), &pending});
+        }
+    }
+    mQueuedJobs.fetch_add(jobCount);
+    {
+        // Serialize with workers that are about to sleep, so that no wake up is lost.
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+    }
+    mWakeCondition.notify_all();
+
+    int self = queueCount - 1;
+    Job job;
+    while (pending.load(std::memory_order_acquire) > 0)
+    {
+        if (popJob(self, &job) || stealJob(self, &job))
+        {
+            runJob(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(int index)
+{
+    Job job;
+    while (true)
+    {
+        if (popJob(index, &job) || stealJob(index, &job))
+        {
+            runJob(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mWakeCondition.wait(lock, [this] { return mQuit || mQueuedJobs.load() > 0; });
+        if (mQuit)
+        {
+            return;
+        }
+    }
+}
+
+bool JobSystem::popJob(int index, Job *job)
+{
+    WorkQueue &queue = *mQueues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty())
+    {
+        return false;
+    }
+
+    *job = queue.jobs.back();
+    queue.jobs.pop_back();
+    mQueuedJobs.fetch_sub(1);
+    return true;
+}
+
+bool JobSystem::stealJob(int thief, Job *job)
+{
+    int queueCount = static_cast<int>(mQueues.size());
+    for (int i = 1; i < queueCount; ++i)
+    {
+        WorkQueue &queue = *mQueues[(thief + i) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+        {
+            continue;
+        }
+
+        *job = queue.jobs.front();
+        queue.jobs.pop_front();
+        mQueuedJobs.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::runJob(const Job &job)
+{
+    (*job.function)(job.begin, job.end);
+    job.pending->fetch_sub(1, std::memory_order_release);
+}
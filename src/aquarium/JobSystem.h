@@ -0,0 +1,71 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// JobSystem.h: Define a work-stealing job system. A fixed pool of workers each owns a deque of
+// jobs. Workers pop jobs from the back of their own deque and steal from the front of the others
+// when it runs dry. The thread that submits work helps to run it until all of it is done.
+
+#pragma once
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H 1
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem
+{
+  public:
+    // Range function called with [begin, end).
+    typedef std::function<void(int, int)> RangeFunction;
+
+    // workerCount < 0 picks one worker per logical core, except the one of the calling thread.
+    // With 0 workers, all jobs run on the calling thread.
+    explicit JobSystem(int workerCount = -1);
+    ~JobSystem();
+
+    int getWorkerCount() const { return static_cast<int>(mWorkers.size()); }
+
+    // Split [0, count) into ranges of at most grainSize elements, run function on all of them and
+    // wait until they are done. Ranges may run in any order and on any thread, so function must
+    // only write data that belongs to its range.
+    void parallelFor(int count, int grainSize, const RangeFunction &function);
+
+  private:
+    struct Job
+    {
+        const RangeFunction *function;
+        int begin;
+        int end;
+        std::atomic<int> *pending;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void workerLoop(int index);
+    bool popJob(int index, Job *job);
+    bool stealJob(int thief, Job *job);
+    void runJob(const Job &job);
+
+    std::vector<std::thread> mWorkers;
+    // One queue per worker, plus one for the submitting thread at the end.
+    std::vector<std::unique_ptr<WorkQueue>> mQueues;
+
+    std::mutex mWakeMutex;
+    std::condition_variable mWakeCondition;
+    std::atomic<int> mQueuedJobs;
+    bool mQuit;
+};
+
+#endif  // !JOBSYSTEM_H
@@ -5,9 +5,21 @@
 //
 // Main.cpp: Entry class of Aquarium.
 
+#include <string>
+
 #include "Aquarium.h"
+#include "MicroBenchmark.h"
 
 int main(int argc, char **argv) {
+    // Micro-benchmarks only exercise CPU code and don't need a context.
+    for (int i = 1; i < argc - 1; ++i)
+    {
+        if (std::string(argv[i]) == "--micro-benchmark")
+        {
+            return runMicroBenchmark(argv[i + 1]) ? 0 : -1;
+        }
+    }
+
     Aquarium aquarium;
     if (!aquarium.init(argc, argv))
     {
@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Matrix.cpp: Implement the vectorized float matrix functions and their dispatch.
+
+#include "Matrix.h"
+
+#include "MatrixKernel.h"
+
+namespace matrix {
+
+namespace {
+
+#ifndef AQUARIUM_SIMD_NEON
+void mulMatricesMatrix4Scalar(float *dst,
+                              size_t dstStride,
+                              const float *a,
+                              size_t count,
+                              const float *b)
+{
+    mulMatricesMatrix4<float>(dst, dstStride, a, count, b);
+}
+#endif
+
+template <bool kTranspose>
+void inverseMatrices4Scalar(float *dst, size_t dstStride, const float *m, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, m += 16, dst += dstStride)
+    {
+        if (kTranspose)
+        {
+            float inverse[16];
+            inverse4<float>(inverse, m);
+            transpose4<float>(dst, inverse);
+        }
+        else
+        {
+            inverse4<float>(dst, m);
+        }
+    }
+}
+
+// Kernels of the lowest level, which the single matrix functions and the tails of wider kernels
+// use as well.
+#if defined(AQUARIUM_SIMD_X86)
+typedef MatrixSSE2Ops BaselineOps;
+#elif defined(AQUARIUM_SIMD_NEON)
+typedef MatrixNEONOps BaselineOps;
+#endif
+
+void mulMatricesMatrix4Baseline(float *dst,
+                                size_t dstStride,
+                                const float *a,
+                                size_t count,
+                                const float *b)
+{
+#if defined(AQUARIUM_SIMD_X86) || defined(AQUARIUM_SIMD_NEON)
+    mulMatricesMatrix4SIMD<BaselineOps>(dst, dstStride, a, count, b);
+#else
+    mulMatricesMatrix4Scalar(dst, dstStride, a, count, b);
+#endif
+}
+
+template <bool kTranspose>
+void inverseMatrices4Baseline(float *dst, size_t dstStride, const float *m, size_t count)
+{
+#if defined(AQUARIUM_SIMD_X86) || defined(AQUARIUM_SIMD_NEON)
+    inverseMatrices4SIMD<BaselineOps, kTranspose>(dst, dstStride, m, count);
+#else
+    inverseMatrices4Scalar<kTranspose>(dst, dstStride, m, count);
+#endif
+}
+
+template <bool kTranspose>
+void dispatchInverseMatrices4(float *dst,
+                              size_t dstStride,
+                              const float *m,
+                              size_t count,
+                              SIMDLEVEL level)
+{
+    switch (level)
+    {
+#ifdef AQUARIUM_SIMD_X86
+        case SIMDLEVELAVX2:
+        {
+            size_t done = kTranspose ? inverseTransposeMatrices4AVX2(dst, dstStride, m, count)
+                                     : inverseMatrices4AVX2(dst, dstStride, m, count);
+            inverseMatrices4Baseline<kTranspose>(dst + done * dstStride, dstStride, m + done * 16,
+                                                 count - done);
+            break;
+        }
+        case SIMDLEVELSSE2:
+            inverseMatrices4Baseline<kTranspose>(dst, dstStride, m, count);
+            break;
+#endif
+        default:
+#ifdef AQUARIUM_SIMD_NEON
+            inverseMatrices4Baseline<kTranspose>(dst, dstStride, m, count);
+#else
+            inverseMatrices4Scalar<kTranspose>(dst, dstStride, m, count);
+#endif
+            break;
+    }
+}
+
+}  // namespace
+
+void mulMatrixMatrix4(float *dst, const float *a, const float *b)
+{
+    mulMatricesMatrix4Baseline(dst, 16, a, 1, b);
+}
+
+void inverse4(float *dst, const float *m)
+{
+    inverseMatrices4Baseline<false>(dst, 16, m, 1);
+}
+
+void transpose4(float *dst, const float *m)
+{
+#if defined(AQUARIUM_SIMD_X86) || defined(AQUARIUM_SIMD_NEON)
+    transpose4SIMD<BaselineOps>(dst, m);
+#else
+    transpose4<float>(dst, m);
+#endif
+}
+
+void mulMatricesMatrix4(float *dst,
+                        size_t dstStride,
+                        const float *a,
+                        size_t count,
+                        const float *b,
+                        SIMDLEVEL level)
+{
+    switch (level)
+    {
+#ifdef AQUARIUM_SIMD_X86
+        case SIMDLEVELAVX2:
+        {
+            size_t done = mulMatricesMatrix4AVX2(dst, dstStride, a, count, b);
+            mulMatricesMatrix4Baseline(dst + done * dstStride, dstStride, a + done * 16,
+                                       count - done, b);
+            break;
+        }
+        case SIMDLEVELSSE2:
+            mulMatricesMatrix4Baseline(dst, dstStride, a, count, b);
+            break;
+#endif
+        default:
+#ifdef AQUARIUM_SIMD_NEON
+            mulMatricesMatrix4Baseline(dst, dstStride, a, count, b);
+#else
+            mulMatricesMatrix4Scalar(dst, dstStride, a, count, b);
+#endif
+            break;
+    }
+}
+
+void inverseMatrices4(float *dst, size_t dstStride, const float *m, size_t count, SIMDLEVEL level)
+{
+    dispatchInverseMatrices4<false>(dst, dstStride, m, count, level);
+}
+
+void inverseTransposeMatrices4(float *dst,
+                               size_t dstStride,
+                               const float *m,
+                               size_t count,
+                               SIMDLEVEL level)
+{
+    dispatchInverseMatrices4<true>(dst, dstStride, m, count, level);
+}
+
+}  // namespace matrix
@@ -8,12 +8,14 @@
 
 #pragma once
 #ifndef MATRIX_H
-#define MATIRX_H 1
+#define MATRIX_H 1
 
 #include <cmath>
+#include <cstddef>
+
+#include "SIMD.h"
 
 namespace matrix {
-static long long RANDOM_RANGE_ = 4294967296;
 
 template <typename T>
 void mulMatrixMatrix4(T *dst, const T *a, const T *b)
@@ -68,6 +70,45 @@ void mulMatrixMatrix4(T *dst, const T *a, const T *b)
     dst[15] = a30 * b03 + a31 * b13 + a32 * b23 + a33 * b33;
 }
 
+// mulMatrixMatrix4 of count matrices stored one after another in a with the same b, which is
+// only loaded once for the batch. The results are dstStride elements apart.
+template <typename T>
+void mulMatricesMatrix4(T *dst, size_t dstStride, const T *a, size_t count, const T *b)
+{
+    T b00 = b[0];
+    T b01 = b[1];
+    T b02 = b[2];
+    T b03 = b[3];
+    T b10 = b[4 + 0];
+    T b11 = b[4 + 1];
+    T b12 = b[4 + 2];
+    T b13 = b[4 + 3];
+    T b20 = b[8 + 0];
+    T b21 = b[8 + 1];
+    T b22 = b[8 + 2];
+    T b23 = b[8 + 3];
+    T b30 = b[12 + 0];
+    T b31 = b[12 + 1];
+    T b32 = b[12 + 2];
+    T b33 = b[12 + 3];
+
+    for (size_t i = 0; i < count; ++i, a += 16, dst += dstStride)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            T a0 = a[row * 4 + 0];
+            T a1 = a[row * 4 + 1];
+            T a2 = a[row * 4 + 2];
+            T a3 = a[row * 4 + 3];
+
+            dst[row * 4 + 0] = a0 * b00 + a1 * b10 + a2 * b20 + a3 * b30;
+            dst[row * 4 + 1] = a0 * b01 + a1 * b11 + a2 * b21 + a3 * b31;
+            dst[row * 4 + 2] = a0 * b02 + a1 * b12 + a2 * b22 + a3 * b32;
+            dst[row * 4 + 3] = a0 * b03 + a1 * b13 + a2 * b23 + a3 * b33;
+        }
+    }
+}
+
 template <typename T>
 void inverse4(T *dst, const T *m)
 {
@@ -313,18 +354,6 @@ void cameraLookAt(T *dst, const T *eye, const T *target, const T *up)
     dst[15] = 1;
 }
 
-static long long randomSeed_;
-void resetPseudoRandom()
-{
-    randomSeed_ = 0;
-}
-
-static double pseudoRandom()
-{
-    randomSeed_ = (134775813 * randomSeed_ + 1) % RANDOM_RANGE_;
-    return static_cast<double>(randomSeed_) / static_cast<double>(RANDOM_RANGE_);
-}
-
 template <typename T>
 void translation(T *dst, const T *v)
 {
@@ -375,9 +404,38 @@ void translate(float *m, const float *v)
     m[15] = m03 * v0 + m13 * v1 + m23 * v2 + m33;
 }
 
-float degToRad(float degrees)
+inline float degToRad(float degrees)
 {
     return static_cast<float>(degrees * M_PI / 180.0);
 }
+
+// Float versions of the templates above, vectorized with SSE2 on x86 and NEON on AArch64. Ordinary
+// calls with float arguments resolve to them, while the templates stay available as the scalar
+// reference, e.g. matrix::inverse4<float>(dst, m). Products and transposes are bit-identical to
+// the templates, inverses differ from them by rounding only. dst may alias the inputs.
+void mulMatrixMatrix4(float *dst, const float *a, const float *b);
+void inverse4(float *dst, const float *m);
+void transpose4(float *dst, const float *m);
+
+// Batched versions over count matrices stored one after another in a or m, with the results
+// dstStride elements apart. AVX2 processes two matrices at a time. On AArch64 the NEON kernels
+// serve every level.
+void mulMatricesMatrix4(float *dst,
+                        size_t dstStride,
+                        const float *a,
+                        size_t count,
+                        const float *b,
+                        SIMDLEVEL level = getSupportedSIMDLevel());
+void inverseMatrices4(float *dst,
+                      size_t dstStride,
+                      const float *m,
+                      size_t count,
+                      SIMDLEVEL level = getSupportedSIMDLevel());
+// The transposes of the inverses, as needed to transform normals.
+void inverseTransposeMatrices4(float *dst,
+                               size_t dstStride,
+                               const float *m,
+                               size_t count,
+                               SIMDLEVEL level = getSupportedSIMDLevel());
 }
 #endif
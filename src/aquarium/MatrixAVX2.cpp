@@ -0,0 +1,38 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MatrixAVX2.cpp: Instantiate the matrix kernels for AVX2. Only called after
+// getSupportedSIMDLevel() reported AVX2.
+
+#include "MatrixKernel.h"
+
+#ifdef AQUARIUM_SIMD_X86
+#ifndef __AVX2__
+#error "MatrixAVX2.cpp must be built with AVX2 enabled."
+#endif
+
+namespace matrix {
+
+size_t mulMatricesMatrix4AVX2(float *dst,
+                              size_t dstStride,
+                              const float *a,
+                              size_t count,
+                              const float *b)
+{
+    return mulMatricesMatrix4SIMD<MatrixAVX2Ops>(dst, dstStride, a, count, b);
+}
+
+size_t inverseMatrices4AVX2(float *dst, size_t dstStride, const float *m, size_t count)
+{
+    return inverseMatrices4SIMD<MatrixAVX2Ops, false>(dst, dstStride, m, count);
+}
+
+size_t inverseTransposeMatrices4AVX2(float *dst, size_t dstStride, const float *m, size_t count)
+{
+    return inverseMatrices4SIMD<MatrixAVX2Ops, true>(dst, dstStride, m, count);
+}
+
+}  // namespace matrix
+#endif
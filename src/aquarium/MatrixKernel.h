@@ -0,0 +1,299 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MatrixKernel.h: Define the vectorized 4x4 matrix kernels behind the float functions of
+// Matrix.h. Only the per-instruction-set translation units include this header.
+//
+// A register holds one row of kMatrices matrices, one per 128-bit lane, and every shuffle stays
+// within its lane, so the same kernel runs one matrix at a time with SSE2 and NEON and two at a
+// time with AVX2.
+
+#pragma once
+#ifndef MATRIXKERNEL_H
+#define MATRIXKERNEL_H 1
+
+#include <cstddef>
+
+#include "Matrix.h"
+
+#ifdef AQUARIUM_SIMD_X86
+#include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef AQUARIUM_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace matrix {
+
+#ifdef AQUARIUM_SIMD_X86
+struct MatrixSSE2Ops
+{
+    typedef __m128 Float;
+    static constexpr int kMatrices = 1;
+
+    static Float loadRow(const float *m, int row) { return _mm_loadu_ps(m + row * 4); }
+    static Float loadShared(const float *p) { return _mm_loadu_ps(p); }
+    static void storeRow(float *dst, size_t, int row, Float v) { _mm_storeu_ps(dst + row * 4, v); }
+    static Float set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+    static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm_div_ps(a, b); }
+    // (a[x], a[y], b[z], b[w])
+    template <int x, int y, int z, int w>
+    static Float shuffle(Float a, Float b)
+    {
+        return _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x));
+    }
+};
+#endif
+
+#ifdef __AVX2__
+struct MatrixAVX2Ops
+{
+    typedef __m256 Float;
+    static constexpr int kMatrices = 2;
+
+    static Float loadRow(const float *m, int row)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(m + row * 4)),
+                                    _mm_loadu_ps(m + 16 + row * 4), 1);
+    }
+    static Float loadShared(const float *p)
+    {
+        return _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(p));
+    }
+    static void storeRow(float *dst, size_t dstStride, int row, Float v)
+    {
+        _mm_storeu_ps(dst + row * 4, _mm256_castps256_ps128(v));
+        _mm_storeu_ps(dst + dstStride + row * 4, _mm256_extractf128_ps(v, 1));
+    }
+    static Float set(float x, float y, float z, float w)
+    {
+        return _mm256_setr_ps(x, y, z, w, x, y, z, w);
+    }
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+    template <int x, int y, int z, int w>
+    static Float shuffle(Float a, Float b)
+    {
+        return _mm256_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x));
+    }
+};
+#endif
+
+#ifdef AQUARIUM_SIMD_NEON
+struct MatrixNEONOps
+{
+    typedef float32x4_t Float;
+    static constexpr int kMatrices = 1;
+
+    static Float loadRow(const float *m, int row) { return vld1q_f32(m + row * 4); }
+    static Float loadShared(const float *p) { return vld1q_f32(p); }
+    static void storeRow(float *dst, size_t, int row, Float v) { vst1q_f32(dst + row * 4, v); }
+    static Float set(float x, float y, float z, float w)
+    {
+        const float values[4] = {x, y, z, w};
+        return vld1q_f32(values);
+    }
+    static Float add(Float a, Float b) { return vaddq_f32(a, b); }
+    static Float sub(Float a, Float b) { return vsubq_f32(a, b); }
+    static Float mul(Float a, Float b) { return vmulq_f32(a, b); }
+    static Float div(Float a, Float b) { return vdivq_f32(a, b); }
+    template <int x, int y, int z, int w>
+    static Float shuffle(Float a, Float b)
+    {
+        Float r = vdupq_n_f32(vgetq_lane_f32(a, x));
+        r       = vsetq_lane_f32(vgetq_lane_f32(a, y), r, 1);
+        r       = vsetq_lane_f32(vgetq_lane_f32(b, z), r, 2);
+        return vsetq_lane_f32(vgetq_lane_f32(b, w), r, 3);
+    }
+};
+#endif
+
+// Same order of operations as the mulMatrixMatrix4 template, so the results are bit-identical.
+// Returns the number of matrices processed, a multiple of Ops::kMatrices.
+template <typename Ops>
+size_t mulMatricesMatrix4SIMD(float *dst,
+                              size_t dstStride,
+                              const float *a,
+                              size_t count,
+                              const float *b)
+{
+    typedef typename Ops::Float Float;
+
+    Float b0 = Ops::loadShared(b);
+    Float b1 = Ops::loadShared(b + 4);
+    Float b2 = Ops::loadShared(b + 8);
+    Float b3 = Ops::loadShared(b + 12);
+
+    size_t i = 0;
+    for (; i + Ops::kMatrices <= count; i += Ops::kMatrices)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            Float r = Ops::loadRow(a, row);
+            Float d = Ops::mul(Ops::template shuffle<0, 0, 0, 0>(r, r), b0);
+            d       = Ops::add(d, Ops::mul(Ops::template shuffle<1, 1, 1, 1>(r, r), b1));
+            d       = Ops::add(d, Ops::mul(Ops::template shuffle<2, 2, 2, 2>(r, r), b2));
+            d       = Ops::add(d, Ops::mul(Ops::template shuffle<3, 3, 3, 3>(r, r), b3));
+            Ops::storeRow(dst, dstStride, row, d);
+        }
+        a += 16 * Ops::kMatrices;
+        dst += dstStride * Ops::kMatrices;
+    }
+    return i;
+}
+
+template <typename Ops>
+void transposeRows4(typename Ops::Float rows[4])
+{
+    typedef typename Ops::Float Float;
+
+    Float t0 = Ops::template shuffle<0, 1, 0, 1>(rows[0], rows[1]);
+    Float t1 = Ops::template shuffle<0, 1, 0, 1>(rows[2], rows[3]);
+    Float t2 = Ops::template shuffle<2, 3, 2, 3>(rows[0], rows[1]);
+    Float t3 = Ops::template shuffle<2, 3, 2, 3>(rows[2], rows[3]);
+    rows[0]  = Ops::template shuffle<0, 2, 0, 2>(t0, t1);
+    rows[1]  = Ops::template shuffle<1, 3, 1, 3>(t0, t1);
+    rows[2]  = Ops::template shuffle<0, 2, 0, 2>(t2, t3);
+    rows[3]  = Ops::template shuffle<1, 3, 1, 3>(t2, t3);
+}
+
+// Products of 2x2 matrices stored row-major in one register. A# is the adjugate of A.
+// A * B
+template <typename Ops>
+typename Ops::Float mulMatrix2(typename Ops::Float a, typename Ops::Float b)
+{
+    return Ops::add(Ops::mul(a, Ops::template shuffle<0, 3, 0, 3>(b, b)),
+                    Ops::mul(Ops::template shuffle<1, 0, 3, 2>(a, a),
+                             Ops::template shuffle<2, 1, 2, 1>(b, b)));
+}
+
+// A# * B
+template <typename Ops>
+typename Ops::Float mulAdjugateMatrix2(typename Ops::Float a, typename Ops::Float b)
+{
+    return Ops::sub(Ops::mul(Ops::template shuffle<3, 3, 0, 0>(a, a), b),
+                    Ops::mul(Ops::template shuffle<1, 1, 2, 2>(a, a),
+                             Ops::template shuffle<2, 3, 0, 1>(b, b)));
+}
+
+// A * B#
+template <typename Ops>
+typename Ops::Float mulMatrixAdjugate2(typename Ops::Float a, typename Ops::Float b)
+{
+    return Ops::sub(Ops::mul(a, Ops::template shuffle<3, 0, 3, 0>(b, b)),
+                    Ops::mul(Ops::template shuffle<1, 0, 3, 2>(a, a),
+                             Ops::template shuffle<2, 1, 2, 1>(b, b)));
+}
+
+// Inverse by blockwise inversion of the 2x2 blocks | A B |
+//                                                  | C D |, which needs far fewer shuffles than
+// the cofactor expansion of the inverse4 template. The results differ from it by rounding only.
+// Returns the number of matrices processed, a multiple of Ops::kMatrices.
+template <typename Ops, bool kTranspose>
+size_t inverseMatrices4SIMD(float *dst, size_t dstStride, const float *m, size_t count)
+{
+    typedef typename Ops::Float Float;
+
+    const Float adjugateSign = Ops::set(1.0f, -1.0f, -1.0f, 1.0f);
+
+    size_t i = 0;
+    for (; i + Ops::kMatrices <= count; i += Ops::kMatrices)
+    {
+        Float r0 = Ops::loadRow(m, 0);
+        Float r1 = Ops::loadRow(m, 1);
+        Float r2 = Ops::loadRow(m, 2);
+        Float r3 = Ops::loadRow(m, 3);
+
+        Float a = Ops::template shuffle<0, 1, 0, 1>(r0, r1);
+        Float b = Ops::template shuffle<2, 3, 2, 3>(r0, r1);
+        Float c = Ops::template shuffle<0, 1, 0, 1>(r2, r3);
+        Float d = Ops::template shuffle<2, 3, 2, 3>(r2, r3);
+
+        // (|A|, |B|, |C|, |D|)
+        Float detSub = Ops::sub(Ops::mul(Ops::template shuffle<0, 2, 0, 2>(r0, r2),
+                                         Ops::template shuffle<1, 3, 1, 3>(r1, r3)),
+                                Ops::mul(Ops::template shuffle<1, 3, 1, 3>(r0, r2),
+                                         Ops::template shuffle<0, 2, 0, 2>(r1, r3)));
+        Float detA   = Ops::template shuffle<0, 0, 0, 0>(detSub, detSub);
+        Float detB   = Ops::template shuffle<1, 1, 1, 1>(detSub, detSub);
+        Float detC   = Ops::template shuffle<2, 2, 2, 2>(detSub, detSub);
+        Float detD   = Ops::template shuffle<3, 3, 3, 3>(detSub, detSub);
+
+        Float adjDC = mulAdjugateMatrix2<Ops>(d, c);
+        Float adjAB = mulAdjugateMatrix2<Ops>(a, b);
+
+        // The inverse is | X Y | / |M|, computed here as the adjugates of X, Y, Z and W.
+        //                | Z W |
+        Float x = Ops::sub(Ops::mul(detD, a), mulMatrix2<Ops>(b, adjDC));
+        Float w = Ops::sub(Ops::mul(detA, d), mulMatrix2<Ops>(c, adjAB));
+        Float y = Ops::sub(Ops::mul(detB, c), mulMatrixAdjugate2<Ops>(d, adjAB));
+        Float z = Ops::sub(Ops::mul(detC, b), mulMatrixAdjugate2<Ops>(a, adjDC));
+
+        // |M| = |A| |D| + |B| |C| - tr((A# B) (D# C))
+        Float trace = Ops::mul(adjAB, Ops::template shuffle<0, 2, 1, 3>(adjDC, adjDC));
+        trace       = Ops::add(trace, Ops::template shuffle<2, 3, 0, 1>(trace, trace));
+        trace       = Ops::add(trace, Ops::template shuffle<1, 0, 3, 2>(trace, trace));
+        Float detM  = Ops::sub(Ops::add(Ops::mul(detA, detD), Ops::mul(detB, detC)), trace);
+
+        Float scale = Ops::div(adjugateSign, detM);
+        x           = Ops::mul(x, scale);
+        y           = Ops::mul(y, scale);
+        z           = Ops::mul(z, scale);
+        w           = Ops::mul(w, scale);
+
+        // Undo the adjugates while putting the blocks back into rows.
+        Float rows[4] = {
+            Ops::template shuffle<3, 1, 3, 1>(x, y),
+            Ops::template shuffle<2, 0, 2, 0>(x, y),
+            Ops::template shuffle<3, 1, 3, 1>(z, w),
+            Ops::template shuffle<2, 0, 2, 0>(z, w),
+        };
+        if (kTranspose)
+        {
+            transposeRows4<Ops>(rows);
+        }
+        for (int row = 0; row < 4; ++row)
+        {
+            Ops::storeRow(dst, dstStride, row, rows[row]);
+        }
+        m += 16 * Ops::kMatrices;
+        dst += dstStride * Ops::kMatrices;
+    }
+    return i;
+}
+
+template <typename Ops>
+void transpose4SIMD(float *dst, const float *m)
+{
+    typename Ops::Float rows[4] = {Ops::loadRow(m, 0), Ops::loadRow(m, 1), Ops::loadRow(m, 2),
+                                   Ops::loadRow(m, 3)};
+    transposeRows4<Ops>(rows);
+    for (int row = 0; row < 4; ++row)
+    {
+        Ops::storeRow(dst, 16, row, rows[row]);
+    }
+}
+
+#ifdef AQUARIUM_SIMD_X86
+size_t mulMatricesMatrix4AVX2(float *dst,
+                              size_t dstStride,
+                              const float *a,
+                              size_t count,
+                              const float *b);
+size_t inverseMatrices4AVX2(float *dst, size_t dstStride, const float *m, size_t count);
+size_t inverseTransposeMatrices4AVX2(float *dst, size_t dstStride, const float *m, size_t count);
+#endif
+
+}  // namespace matrix
+
+#endif  // !MATRIXKERNEL_H
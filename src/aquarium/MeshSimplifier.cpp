@@ -0,0 +1,358 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MeshSimplifier.cpp: Implement the quadric error decimator.
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <utility>
+
+namespace {
+
+// Moving a point to another end of one of its edges.
+struct Collapse
+{
+    double error;
+    int from;
+    int to;
+};
+
+bool operator<(const Collapse &a, const Collapse &b)
+{
+    if (a.error != b.error)
+    {
+        return a.error < b.error;
+    }
+    return a.from != b.from ? a.from < b.from : a.to < b.to;
+}
+
+void computeNormal(const float *p0, const float *p1, const float *p2, double *normal)
+{
+    double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    normal[0]    = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1]    = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2]    = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+}  // namespace
+
+MeshSimplifier::MeshSimplifier(const float *positions,
+                               const float *texCoords,
+                               int vertexCount,
+                               const unsigned short *indices,
+                               int indexCount)
+    : mPositions(positions), mTexCoords(texCoords), mIndices(indices, indices + indexCount)
+{
+    // The fish are flat shaded, so that every corner has its own vertex. They are only connected
+    // through the positions.
+    std::map<std::array<float, 3>, int> points;
+    mPoints.resize(vertexCount);
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        std::array<float, 3> position = {{positions[i * 3], positions[i * 3 + 1],
+                                          positions[i * 3 + 2]}};
+        auto inserted = points.insert(std::make_pair(position, static_cast<int>(points.size())));
+        mPoints[i]    = inserted.first->second;
+        if (inserted.second)
+        {
+            mPointVertices.emplace_back();
+        }
+        mPointVertices[mPoints[i]].push_back(i);
+    }
+
+    int pointCount = static_cast<int>(mPointVertices.size());
+    mQuadrics.assign(pointCount, Quadric());
+    mLocked.assign(pointCount, false);
+
+    std::map<std::pair<int, int>, int> edges;
+    for (size_t t = 0; t + 2 < mIndices.size(); t += 3)
+    {
+        const float *p0 = positions + mIndices[t] * 3;
+        const float *p1 = positions + mIndices[t + 1] * 3;
+        const float *p2 = positions + mIndices[t + 2] * 3;
+
+        // The length of the cross product is twice the area, which weighs the plane.
+        double normal[3];
+        computeNormal(p0, p1, p2, normal);
+        double length =
+            std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length > 0.0)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                normal[i] /= length;
+            }
+            double distance = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+            for (int i = 0; i < 3; ++i)
+            {
+                addPlane(&mQuadrics[mPoints[mIndices[t + i]]], normal, distance, length * 0.5);
+            }
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            int a = mPoints[mIndices[t + i]];
+            int b = mPoints[mIndices[t + (i + 1) % 3]];
+            ++edges[std::make_pair(std::min(a, b), std::max(a, b))];
+        }
+    }
+
+    // Only edges between two triangles can collapse without opening or tearing the surface.
+    for (const auto &edge : edges)
+    {
+        if (edge.second != 2)
+        {
+            mLocked[edge.first.first]  = true;
+            mLocked[edge.first.second] = true;
+        }
+    }
+}
+
+void MeshSimplifier::simplify(int targetTriangleCount, std::vector<unsigned short> *indices) const
+{
+    std::vector<unsigned short> triangles = mIndices;
+    int triangleCount                     = static_cast<int>(triangles.size() / 3);
+    int pointCount                        = static_cast<int>(mPointVertices.size());
+
+    std::vector<bool> alive(triangleCount, true);
+    std::vector<Quadric> quadrics = mQuadrics;
+    std::vector<std::vector<int>> pointTriangles(pointCount);
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(pointCount);
+    std::vector<int> fromNeighbors, toNeighbors;
+
+    auto hasPoint = [&](int triangle, int point) {
+        return mPoints[triangles[triangle * 3]] == point ||
+               mPoints[triangles[triangle * 3 + 1]] == point ||
+               mPoints[triangles[triangle * 3 + 2]] == point;
+    };
+    auto collectNeighbors = [&](int point, std::vector<int> *neighbors) {
+        neighbors->clear();
+        for (int triangle : pointTriangles[point])
+        {
+            for (int i = 0; alive[triangle] && i < 3; ++i)
+            {
+                int neighbor = mPoints[triangles[triangle * 3 + i]];
+                if (neighbor != point)
+                {
+                    neighbors->push_back(neighbor);
+                }
+            }
+        }
+        std::sort(neighbors->begin(), neighbors->end());
+        neighbors->erase(std::unique(neighbors->begin(), neighbors->end()), neighbors->end());
+    };
+
+    // Collapses are made in passes from the cheapest. A point moved or moved to in a pass waits
+    // for the next one, whose errors include the move.
+    int liveCount = triangleCount;
+    while (liveCount > targetTriangleCount)
+    {
+        for (auto &list : pointTriangles)
+        {
+            list.clear();
+        }
+        collapses.clear();
+        for (int t = 0; t < triangleCount; ++t)
+        {
+            if (!alive[t])
+            {
+                continue;
+            }
+            for (int i = 0; i < 3; ++i)
+            {
+                int a = mPoints[triangles[t * 3 + i]];
+                int b = mPoints[triangles[t * 3 + (i + 1) % 3]];
+                pointTriangles[a].push_back(t);
+
+                Quadric sum = quadrics[a];
+                addQuadric(&sum, quadrics[b]);
+                if (!mLocked[a])
+                {
+                    collapses.push_back(
+                        {evaluate(sum, mPositions + mPointVertices[b][0] * 3), a, b});
+                }
+                if (!mLocked[b])
+                {
+                    collapses.push_back(
+                        {evaluate(sum, mPositions + mPointVertices[a][0] * 3), b, a});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end());
+        std::fill(touched.begin(), touched.end(), false);
+
+        int collapseCount = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (liveCount <= targetTriangleCount)
+            {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            // The ends of an edge between two triangles share exactly the two points across it,
+            // otherwise the collapse pinches the surface.
+            collectNeighbors(collapse.from, &fromNeighbors);
+            collectNeighbors(collapse.to, &toNeighbors);
+            std::vector<int> shared;
+            std::set_intersection(fromNeighbors.begin(), fromNeighbors.end(), toNeighbors.begin(),
+                                  toNeighbors.end(), std::back_inserter(shared));
+            if (shared.size() != 2)
+            {
+                continue;
+            }
+
+            bool valid = true;
+            for (int triangle : pointTriangles[collapse.from])
+            {
+                if (alive[triangle] && !hasPoint(triangle, collapse.to) &&
+                    flips(&triangles[triangle * 3], collapse.from, collapse.to))
+                {
+                    valid = false;
+                    break;
+                }
+            }
+            if (!valid)
+            {
+                continue;
+            }
+
+            for (int triangle : pointTriangles[collapse.from])
+            {
+                if (!alive[triangle])
+                {
+                    continue;
+                }
+                if (hasPoint(triangle, collapse.to))
+                {
+                    alive[triangle] = false;
+                    --liveCount;
+                    continue;
+                }
+                for (int i = 0; i < 3; ++i)
+                {
+                    unsigned short &vertex = triangles[triangle * 3 + i];
+                    if (mPoints[vertex] == collapse.from)
+                    {
+                        vertex = static_cast<unsigned short>(findVertex(collapse.to, vertex));
+                    }
+                }
+            }
+            addQuadric(&quadrics[collapse.to], quadrics[collapse.from]);
+            touched[collapse.from] = true;
+            touched[collapse.to]   = true;
+            ++collapseCount;
+        }
+
+        if (collapseCount == 0)
+        {
+            break;
+        }
+    }
+
+    indices->clear();
+    for (int t = 0; t < triangleCount; ++t)
+    {
+        if (alive[t])
+        {
+            indices->insert(indices->end(), &triangles[t * 3], &triangles[t * 3] + 3);
+        }
+    }
+}
+
+void MeshSimplifier::addPlane(Quadric *quadric,
+                              const double *normal,
+                              double distance,
+                              double weight)
+{
+    quadric->a00 += weight * normal[0] * normal[0];
+    quadric->a01 += weight * normal[0] * normal[1];
+    quadric->a02 += weight * normal[0] * normal[2];
+    quadric->a11 += weight * normal[1] * normal[1];
+    quadric->a12 += weight * normal[1] * normal[2];
+    quadric->a22 += weight * normal[2] * normal[2];
+    quadric->b0 += weight * normal[0] * distance;
+    quadric->b1 += weight * normal[1] * distance;
+    quadric->b2 += weight * normal[2] * distance;
+    quadric->c += weight * distance * distance;
+}
+
+void MeshSimplifier::addQuadric(Quadric *quadric, const Quadric &other)
+{
+    quadric->a00 += other.a00;
+    quadric->a01 += other.a01;
+    quadric->a02 += other.a02;
+    quadric->a11 += other.a11;
+    quadric->a12 += other.a12;
+    quadric->a22 += other.a22;
+    quadric->b0 += other.b0;
+    quadric->b1 += other.b1;
+    quadric->b2 += other.b2;
+    quadric->c += other.c;
+}
+
+double MeshSimplifier::evaluate(const Quadric &quadric, const float *position)
+{
+    double x = position[0];
+    double y = position[1];
+    double z = position[2];
+    return quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z +
+           2.0 * (quadric.a01 * x * y + quadric.a02 * x * z + quadric.a12 * y * z) +
+           2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z) + quadric.c;
+}
+
+int MeshSimplifier::findVertex(int point, int vertex) const
+{
+    const std::vector<int> &vertices = mPointVertices[point];
+    if (mTexCoords == nullptr)
+    {
+        return vertices[0];
+    }
+
+    const float *texCoord = mTexCoords + vertex * 2;
+    int closest           = vertices[0];
+    float closestDistance = -1.0f;
+    for (int candidate : vertices)
+    {
+        float du       = mTexCoords[candidate * 2] - texCoord[0];
+        float dv       = mTexCoords[candidate * 2 + 1] - texCoord[1];
+        float distance = du * du + dv * dv;
+        if (closestDistance < 0.0f || distance < closestDistance)
+        {
+            closest         = candidate;
+            closestDistance = distance;
+        }
+    }
+    return closest;
+}
+
+bool MeshSimplifier::flips(const unsigned short *triangle, int from, int point) const
+{
+    const float *before[3];
+    const float *after[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        before[i] = mPositions + triangle[i] * 3;
+        after[i]  = mPoints[triangle[i]] == from ? mPositions + mPointVertices[point][0] * 3
+                                                 : before[i];
+    }
+
+    double normalBefore[3], normalAfter[3];
+    computeNormal(before[0], before[1], before[2], normalBefore);
+    computeNormal(after[0], after[1], after[2], normalAfter);
+    return normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] +
+               normalBefore[2] * normalAfter[2] <=
+           0.0;
+}
@@ -0,0 +1,64 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MeshSimplifier.h: Define a quadric error decimator that makes the index buffers of the levels
+// of detail of a mesh. Vertices are welded by position, and edges are collapsed onto one of their
+// ends in order of the quadric error of the planes around them, so that the simplified meshes
+// index the vertices of the original one and share its vertex buffers.
+
+#pragma once
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H 1
+
+#include <vector>
+
+class MeshSimplifier
+{
+  public:
+    // positions holds 3 floats and texCoords 2 floats per vertex. indices is a triangle list.
+    MeshSimplifier(const float *positions,
+                   const float *texCoords,
+                   int vertexCount,
+                   const unsigned short *indices,
+                   int indexCount);
+
+    // Write a triangle list of about targetTriangleCount triangles to indices. Edges on the border
+    // of the mesh are kept, so a mesh may stop short of the target.
+    void simplify(int targetTriangleCount, std::vector<unsigned short> *indices) const;
+
+    int getTriangleCount() const { return static_cast<int>(mIndices.size() / 3); }
+
+  private:
+    // Symmetric 4x4 matrix summing the squared distances to planes, weighted by area.
+    struct Quadric
+    {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+    };
+
+    static void addPlane(Quadric *quadric, const double *normal, double distance, double weight);
+    static void addQuadric(Quadric *quadric, const Quadric &other);
+    static double evaluate(const Quadric &quadric, const float *position);
+
+    // Pick the vertex at point whose texture coordinates are closest to those of vertex, so that
+    // the moved corner stays in the same part of the texture.
+    int findVertex(int point, int vertex) const;
+    // Whether moving the corners of triangle at from to point turns the triangle over.
+    bool flips(const unsigned short *triangle, int from, int point) const;
+
+    const float *mPositions;
+    const float *mTexCoords;
+    std::vector<unsigned short> mIndices;
+
+    // Welded point of each vertex, and the vertices of each point.
+    std::vector<int> mPoints;
+    std::vector<std::vector<int>> mPointVertices;
+    std::vector<Quadric> mQuadrics;
+    // Points on the border of the mesh, or on edges shared by more than two triangles.
+    std::vector<bool> mLocked;
+};
+
+#endif  // !MESHSIMPLIFIER_H
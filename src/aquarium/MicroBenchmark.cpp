@@ -0,0 +1,1413 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MicroBenchmark.cpp: Implement CPU micro-benchmarks.
+
+#include "MicroBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "Aquarium.h"
+#include "BlockCompression.h"
+#include "BufferManager.h"
+#include "CommandStream.h"
+#include "FileSystem.h"
+#include "FishCulling.h"
+#include "FishModel.h"
+#include "FishSimulation.h"
+#include "JobSystem.h"
+#include "Matrix.h"
+#include "MeshSimplifier.h"
+#include "MipChain.h"
+#include "ModelCache.h"
+#include "Random.h"
+#include "ResourceHelper.h"
+#include "SIMD.h"
+#include "ShaderCache.h"
+#include "Texture.h"
+#include "Timer.h"
+
+namespace {
+
+constexpr double kMinBenchmarkSeconds = 0.5;
+constexpr float kFrameTime            = 1.0f / 60.0f;
+
+// Distance between two floats in units in the last place.
+int64_t ulpDistance(float a, float b)
+{
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    int64_t oa = ia < 0 ? static_cast<int64_t>(INT32_MIN) - ia : ia;
+    int64_t ob = ib < 0 ? static_cast<int64_t>(INT32_MIN) - ib : ib;
+    return oa > ob ? oa - ob : ob - oa;
+}
+
+int64_t maxUlpDistance(const std::vector<FishPer> &a, const std::vector<FishPer> &b)
+{
+    int64_t maxUlp = 0;
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            maxUlp = std::max(maxUlp, ulpDistance(a[i].worldPosition[j], b[i].worldPosition[j]));
+            maxUlp = std::max(maxUlp, ulpDistance(a[i].nextPosition[j], b[i].nextPosition[j]));
+        }
+        maxUlp = std::max(maxUlp, ulpDistance(a[i].scale, b[i].scale));
+        maxUlp = std::max(maxUlp, ulpDistance(a[i].time, b[i].time));
+    }
+    return maxUlp;
+}
+
+double measureFishPerSecond(const FishSimulation &simulation, std::vector<FishPer> *fishPers)
+{
+    float mclock = 0.0f;
+    int frames   = 0;
+    auto begin   = timer::now();
+    double seconds;
+    do
+    {
+        simulation.update(mclock, fishPers->data());
+        mclock += kFrameTime;
+        ++frames;
+        seconds = timer::getSeconds(begin, timer::now());
+    } while (seconds < kMinBenchmarkSeconds);
+
+    return static_cast<double>(fishPers->size()) * frames / seconds;
+}
+
+// Fish updated per second for each instruction set level, and the largest difference from the
+// scalar level, which matches the C library bit for bit.
+bool runFishBenchmark()
+{
+    const int fishCountTable[] = {10000, 100000, 1000000};
+    for (int fishCount : fishCountTable)
+    {
+        int fishCounts[FISH_SPECIES_COUNT];
+        Aquarium::calculateFishCount(fishCount, fishCounts);
+
+        FishSimulation simulation;
+        simulation.reset(fishCounts);
+        std::vector<FishPer> fishPers(fishCount);
+        std::vector<FishPer> reference(fishCount);
+
+        // A clock far into the run, so that large arguments are covered as well.
+        const float checkClock = 3600.0f;
+        simulation.setSIMDLevel(SIMDLEVELSCALAR);
+        simulation.update(checkClock, reference.data());
+
+        for (int level = SIMDLEVELSCALAR; level <= getSupportedSIMDLevel(); ++level)
+        {
+            simulation.setSIMDLevel(static_cast<SIMDLEVEL>(level));
+            simulation.update(checkClock, fishPers.data());
+            int64_t maxUlp = maxUlpDistance(fishPers, reference);
+
+            printf(
+                "[RESULT] MICROBENCHMARK:fish,SIMD:%s,FISHCOUNT:%d,FISHPERSECOND:%.0f,"
+                "MAXULP:%d\n",
+                getSIMDLevelName(static_cast<SIMDLEVEL>(level)), fishCount,
+                measureFishPerSecond(simulation, &fishPers), static_cast<int>(maxUlp));
+        }
+    }
+    return true;
+}
+
+// Scaling of the fish update with the number of threads, at the highest SIMD level. Also checks
+// that the parallel reset and update produce exactly the serial output.
+bool runFishThreadsBenchmark()
+{
+    const int fishCount = 1000000;
+    int fishCounts[FISH_SPECIES_COUNT];
+    Aquarium::calculateFishCount(fishCount, fishCounts);
+
+    const float checkClock = 3600.0f;
+    FishSimulation serial;
+    serial.reset(fishCounts);
+    std::vector<FishPer> reference(fishCount);
+    serial.update(checkClock, reference.data());
+
+    int maxThreadCount = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    double serialFishPerSecond = 0.0;
+    for (int threadCount = 1;; threadCount = std::min(threadCount * 2, maxThreadCount))
+    {
+        JobSystem jobSystem(threadCount - 1);
+        FishSimulation simulation;
+        simulation.setJobSystem(&jobSystem);
+        simulation.reset(fishCounts);
+
+        std::vector<FishPer> fishPers(fishCount);
+        simulation.update(checkClock, fishPers.data());
+        bool exact = memcmp(fishPers.data(), reference.data(), fishCount * sizeof(FishPer)) == 0;
+
+        double fishPerSecond = measureFishPerSecond(simulation, &fishPers);
+        if (threadCount == 1)
+        {
+            serialFishPerSecond = fishPerSecond;
+        }
+
+        printf(
+            "[RESULT] MICROBENCHMARK:fish-threads,SIMD:%s,THREADS:%d,FISHCOUNT:%d,"
+            "FISHPERSECOND:%.0f,SPEEDUP:%.2f,EXACT:%s\n",
+            getSIMDLevelName(simulation.getSIMDLevel()), threadCount, fishCount, fishPerSecond,
+            fishPerSecond / serialFishPerSecond, exact ? "True" : "False");
+
+        if (threadCount == maxThreadCount)
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+// Counter-based random numbers generated per second by CounterRandom::fill for each instruction
+// set level, and whether the level reproduces the scalar values exactly.
+bool runRandomBenchmark()
+{
+    const int count     = 1 << 20;
+    const int slotCount = 5;
+    std::vector<float> values(count * slotCount);
+    std::vector<float> reference(count * slotCount);
+    float *outs[slotCount];
+    float *referenceOuts[slotCount];
+    for (int slot = 0; slot < slotCount; ++slot)
+    {
+        outs[slot]          = values.data() + slot * count;
+        referenceOuts[slot] = reference.data() + slot * count;
+    }
+
+    CounterRandom random;
+    random.fill(0, count, 0, slotCount, referenceOuts, SIMDLEVELSCALAR);
+
+    for (int level = SIMDLEVELSCALAR; level <= getSupportedSIMDLevel(); ++level)
+    {
+        SIMDLEVEL simdLevel = static_cast<SIMDLEVEL>(level);
+        random.fill(0, count, 0, slotCount, outs, simdLevel);
+        bool exact = values == reference;
+
+        uint64_t firstIndex = 0;
+        auto begin          = timer::now();
+        double seconds;
+        do
+        {
+            random.fill(firstIndex, count, 0, slotCount, outs, simdLevel);
+            firstIndex += count;
+            seconds = timer::getSeconds(begin, timer::now());
+        } while (seconds < kMinBenchmarkSeconds);
+
+        printf("[RESULT] MICROBENCHMARK:random,SIMD:%s,VALUESPERSECOND:%.0f,EXACT:%s\n",
+               getSIMDLevelName(simdLevel), static_cast<double>(firstIndex) * slotCount / seconds,
+               exact ? "True" : "False");
+    }
+    return true;
+}
+
+// Largest error of an inverse relative to the magnitude of the values of the double precision
+// reference. The scalar templates reach about 2e-5 on the products with the projection, whose
+// entries span many orders of magnitude.
+constexpr float kMatrixTolerance = 1.0e-4f;
+
+float maxRelativeError(const std::vector<float> &values, const std::vector<float> &reference)
+{
+    float maxError = 0.0f;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        float error = std::abs(values[i] - reference[i]) / std::max(std::abs(reference[i]), 1.0f);
+        maxError    = std::max(maxError, error);
+    }
+    return maxError;
+}
+
+// Affine transforms like the ones of the placement, alternating with their products with a
+// perspective view projection.
+void generateMatrices(int count, std::vector<float> *matrices, float *viewProjection)
+{
+    const float eye[3]    = {30.0f, 25.0f, 40.0f};
+    const float target[3] = {0.0f, 5.0f, 0.0f};
+    const float up[3]     = {0.0f, 1.0f, 0.0f};
+    float viewInverse[16];
+    float view[16];
+    float projection[16];
+    matrix::cameraLookAt(viewInverse, eye, target, up);
+    matrix::inverse4<float>(view, viewInverse);
+    matrix::frustum(projection, -0.6f, 0.6f, -0.4f, 0.4f, 1.0f, 25000.0f);
+    matrix::mulMatrixMatrix4<float>(viewProjection, view, projection);
+
+    CounterRandom random;
+    matrices->resize(count * 16);
+    for (int i = 0; i < count; ++i)
+    {
+        float angle[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            angle[j] = random.getFloat(i, j) * 6.2831853f;
+        }
+        float scale     = 0.5f + 2.0f * random.getFloat(i, 3);
+        float cx        = std::cos(angle[0]);
+        float sx        = std::sin(angle[0]);
+        float cy        = std::cos(angle[1]);
+        float sy        = std::sin(angle[1]);
+        float cz        = std::cos(angle[2]);
+        float sz        = std::sin(angle[2]);
+        float world[16] = {scale * cy * cz,
+                           scale * cy * sz,
+                           -scale * sy,
+                           0.0f,
+                           scale * (sx * sy * cz - cx * sz),
+                           scale * (sx * sy * sz + cx * cz),
+                           scale * sx * cy,
+                           0.0f,
+                           scale * (cx * sy * cz + sx * sz),
+                           scale * (cx * sy * sz - sx * cz),
+                           scale * cx * cy,
+                           0.0f,
+                           200.0f * random.getFloat(i, 4) - 100.0f,
+                           50.0f * random.getFloat(i, 5),
+                           200.0f * random.getFloat(i, 6) - 100.0f,
+                           1.0f};
+
+        float *matrix = matrices->data() + i * 16;
+        if (i % 2 == 0)
+        {
+            memcpy(matrix, world, sizeof(world));
+        }
+        else
+        {
+            matrix::mulMatrixMatrix4<float>(matrix, world, viewProjection);
+        }
+    }
+}
+
+// Matrices processed per second by the batched matrix functions for each instruction set level,
+// and their largest error. Products must match the scalar template exactly, inverses are compared
+// against the template evaluated in double precision.
+bool runMatrixBenchmark()
+{
+    const int count = 4096;
+    std::vector<float> matrices;
+    float viewProjection[16];
+    generateMatrices(count, &matrices, viewProjection);
+
+    const char *opNames[] = {"multiply", "inverse", "inverse-transpose"};
+    std::vector<float> reference[3];
+    for (std::vector<float> &values : reference)
+    {
+        values.resize(count * 16);
+    }
+    matrix::mulMatricesMatrix4<float>(reference[0].data(), 16, matrices.data(), count,
+                                      viewProjection);
+    for (int i = 0; i < count; ++i)
+    {
+        double matrix[16];
+        double inverse[16];
+        std::copy(matrices.begin() + i * 16, matrices.begin() + (i + 1) * 16, matrix);
+        matrix::inverse4(inverse, matrix);
+        for (int j = 0; j < 16; ++j)
+        {
+            reference[1][i * 16 + j]                 = static_cast<float>(inverse[j]);
+            reference[2][i * 16 + (j % 4) * 4 + j / 4] = static_cast<float>(inverse[j]);
+        }
+    }
+
+    bool passed = true;
+    std::vector<float> values(count * 16);
+    for (int level = SIMDLEVELSCALAR; level <= getSupportedSIMDLevel(); ++level)
+    {
+        SIMDLEVEL simdLevel = static_cast<SIMDLEVEL>(level);
+        for (int op = 0; op < 3; ++op)
+        {
+            auto run = [&]() {
+                switch (op)
+                {
+                    case 0:
+                        matrix::mulMatricesMatrix4(values.data(), 16, matrices.data(), count,
+                                                   viewProjection, simdLevel);
+                        break;
+                    case 1:
+                        matrix::inverseMatrices4(values.data(), 16, matrices.data(), count,
+                                                 simdLevel);
+                        break;
+                    default:
+                        matrix::inverseTransposeMatrices4(values.data(), 16, matrices.data(),
+                                                          count, simdLevel);
+                        break;
+                }
+            };
+
+            run();
+            float maxError = maxRelativeError(values, reference[op]);
+            bool pass      = op == 0 ? maxError == 0.0f : maxError <= kMatrixTolerance;
+            passed         = passed && pass;
+
+            long long processed = 0;
+            auto begin          = timer::now();
+            double seconds;
+            do
+            {
+                run();
+                processed += count;
+                seconds = timer::getSeconds(begin, timer::now());
+            } while (seconds < kMinBenchmarkSeconds);
+
+            printf(
+                "[RESULT] MICROBENCHMARK:matrix,SIMD:%s,OP:%s,MATRICESPERSECOND:%.0f,MAXERROR:%g,"
+                "PASS:%s\n",
+                getSIMDLevelName(simdLevel), opNames[op], static_cast<double>(processed) / seconds,
+                maxError, pass ? "True" : "False");
+        }
+    }
+    return passed;
+}
+
+// Texture that is only decoded, to measure the CPU side of loading.
+class DecodedTexture : public Texture
+{
+  public:
+    DecodedTexture(const std::string &name, const std::string &url) : Texture(name, url, true) {}
+    void loadTexture() override {}
+};
+
+// The 2D textures of all models of the aquarium, decoded.
+bool decodeAquariumTextures(std::vector<std::unique_ptr<Texture>> *textures)
+{
+    ResourceHelper resourceHelper("null", "", BACKENDTYPENULL);
+    createDirectory(resourceHelper.getCachePath());
+
+    std::set<std::string> images;
+    for (const auto &info : g_sceneInfo)
+    {
+        std::string name(info.namestr);
+        ModelData data;
+        if (!ModelCache::load(resourceHelper.getModelPath(name),
+                              resourceHelper.getModelCachePath(name), &data))
+        {
+            return false;
+        }
+        for (const auto &texture : data.textures)
+        {
+            images.insert(texture.second);
+        }
+    }
+
+    for (const std::string &image : images)
+    {
+        textures->emplace_back(new DecodedTexture(image, resourceHelper.getImagePath() + image));
+        if (!textures->back()->decode())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Mip chains of the whole asset set generated per second, with and without workers, for each
+// instruction set level and with sRGB correct filtering. Levels must reproduce the scalar levels
+// exactly.
+bool runMipmapBenchmark()
+{
+    std::vector<std::unique_ptr<Texture>> textures;
+    if (!decodeAquariumTextures(&textures))
+    {
+        std::cerr << "Couldn't load the textures of the aquarium." << std::endl;
+        return false;
+    }
+
+    std::vector<MipChain *> chains;
+    double megapixels = 0.0;
+    for (const std::unique_ptr<Texture> &texture : textures)
+    {
+        MipChain *chain = texture->getMipChain();
+        chains.push_back(chain);
+        for (int level = 1; level < chain->getLevelCount(); ++level)
+        {
+            megapixels += chain->getLayerCount() * chain->getWidth(level) *
+                          chain->getHeight(level) / 1.0e6;
+        }
+    }
+
+    auto generate = [&](JobSystem *jobSystem, bool srgb, SIMDLEVEL simdLevel) {
+        for (MipChain *chain : chains)
+        {
+            chain->invalidate();
+        }
+        generateMipChains(jobSystem, chains, srgb, simdLevel);
+    };
+    auto snapshot = [&](std::vector<std::vector<uint8_t>> *data) {
+        data->clear();
+        for (MipChain *chain : chains)
+        {
+            data->emplace_back(chain->getData(), chain->getData() + chain->getSize());
+        }
+    };
+
+    std::vector<std::vector<uint8_t>> reference[2];
+    generate(nullptr, false, SIMDLEVELSCALAR);
+    snapshot(&reference[0]);
+    generate(nullptr, true, SIMDLEVELSCALAR);
+    snapshot(&reference[1]);
+
+    int threadCounts[] = {1, std::max(static_cast<int>(std::thread::hardware_concurrency()), 1)};
+    int threadCountCount = threadCounts[1] > 1 ? 2 : 1;
+    bool passed          = true;
+    std::vector<std::vector<uint8_t>> values;
+    for (int t = 0; t < threadCountCount; ++t)
+    {
+        JobSystem jobSystem(threadCounts[t] - 1);
+        for (int level = SIMDLEVELSCALAR; level <= getSupportedSIMDLevel() + 1; ++level)
+        {
+            // The last pass is sRGB, which doesn't depend on the level.
+            bool srgb           = level > getSupportedSIMDLevel();
+            SIMDLEVEL simdLevel = srgb ? getSupportedSIMDLevel() : static_cast<SIMDLEVEL>(level);
+
+            generate(&jobSystem, srgb, simdLevel);
+            snapshot(&values);
+            bool exact = values == reference[srgb ? 1 : 0];
+            passed     = passed && exact;
+
+            int runs   = 0;
+            auto begin = timer::now();
+            double seconds;
+            do
+            {
+                generate(&jobSystem, srgb, simdLevel);
+                ++runs;
+                seconds = timer::getSeconds(begin, timer::now());
+            } while (seconds < kMinBenchmarkSeconds);
+
+            printf(
+                "[RESULT] MICROBENCHMARK:mipmap,SIMD:%s,SRGB:%s,THREADS:%d,TEXTURES:%d,"
+                "MS:%.3f,MEGAPIXELSPERSECOND:%.1f,EXACT:%s\n",
+                getSIMDLevelName(simdLevel), srgb ? "True" : "False", threadCounts[t],
+                static_cast<int>(textures.size()), seconds * 1000.0 / runs,
+                megapixels * runs / seconds, exact ? "True" : "False");
+        }
+    }
+    return passed;
+}
+
+void copyMipChain(const MipChain &source, MipChain *copy)
+{
+    copy->allocate(source.getWidth(0), source.getHeight(0), source.getLevelCount(),
+                   source.getLayerCount(), source.getFormat());
+    memcpy(copy->getPixels(0, 0), source.getData(), source.getSize());
+}
+
+// Squared error and number of values of the channels that format keeps, over all levels.
+void addCompressionError(const MipChain &source,
+                         const MipChain &compressed,
+                         double *squaredError,
+                         double *valueCount)
+{
+    MipChain decoded;
+    decompressMipChain(compressed, &decoded);
+    int channelCount = compressed.getFormat() == TEXTUREFORMATBC1   ? 3
+                       : compressed.getFormat() == TEXTUREFORMATBC5 ? 2
+                                                                    : 4;
+    for (int layer = 0; layer < source.getLayerCount(); ++layer)
+    {
+        for (int level = 0; level < source.getLevelCount(); ++level)
+        {
+            for (int y = 0; y < source.getHeight(level); ++y)
+            {
+                const uint8_t *a = source.getPixels(layer, level) + source.getRowPitch(level) * y;
+                const uint8_t *b =
+                    decoded.getPixels(layer, level) + decoded.getRowPitch(level) * y;
+                for (int x = 0; x < source.getWidth(level); ++x)
+                {
+                    for (int c = 0; c < channelCount; ++c)
+                    {
+                        double difference = a[x * 4 + c] - b[x * 4 + c];
+                        *squaredError += difference * difference;
+                    }
+                }
+                *valueCount += source.getWidth(level) * channelCount;
+            }
+        }
+    }
+}
+
+// Megabytes of RGBA8 texels compressed per second and the quality of the compression of the mip
+// chains of all textures of the aquarium, for each format and for the mix that
+// '--texture-compression bc' picks, with and without workers.
+bool runTextureCompressionBenchmark()
+{
+    std::vector<std::unique_ptr<Texture>> textures;
+    if (!decodeAquariumTextures(&textures))
+    {
+        std::cerr << "Couldn't load the textures of the aquarium." << std::endl;
+        return false;
+    }
+
+    std::vector<MipChain *> sources;
+    double megabytes = 0.0;
+    for (const std::unique_ptr<Texture> &texture : textures)
+    {
+        MipChain *chain = texture->getMipChain();
+        chain->generate();
+        sources.push_back(chain);
+        for (int level = 0; level < chain->getLevelCount(); ++level)
+        {
+            megabytes += chain->getLayerCount() * chain->getWidth(level) *
+                         chain->getHeight(level) * 4 / 1.0e6;
+        }
+    }
+
+    // TEXTUREFORMATRGBA8 stands for the mix of formats of the compression mode.
+    const TEXTUREFORMAT formatTable[] = {TEXTUREFORMATBC1, TEXTUREFORMATBC3, TEXTUREFORMATBC5,
+                                         TEXTUREFORMATRGBA8};
+    int threadCounts[] = {1, std::max(static_cast<int>(std::thread::hardware_concurrency()), 1)};
+    int threadCountCount = threadCounts[1] > 1 ? 2 : 1;
+    for (int t = 0; t < threadCountCount; ++t)
+    {
+        JobSystem jobSystem(threadCounts[t] - 1);
+        for (TEXTUREFORMAT format : formatTable)
+        {
+            std::vector<TEXTUREFORMAT> formats;
+            for (MipChain *source : sources)
+            {
+                formats.push_back(format != TEXTUREFORMATRGBA8
+                                      ? format
+                                      : chooseTextureFormat(*source, TEXTURECOMPRESSIONBC));
+            }
+
+            std::vector<MipChain> copies(sources.size());
+            std::vector<MipChain *> chains;
+            for (MipChain &copy : copies)
+            {
+                chains.push_back(&copy);
+            }
+
+            // Compression replaces the chains, so only the compression of fresh copies is timed.
+            int runs       = 0;
+            double seconds = 0.0;
+            do
+            {
+                for (size_t i = 0; i < sources.size(); ++i)
+                {
+                    copyMipChain(*sources[i], &copies[i]);
+                }
+                auto begin = timer::now();
+                compressMipChains(&jobSystem, chains, formats);
+                seconds += timer::getSeconds(begin, timer::now());
+                ++runs;
+            } while (seconds < kMinBenchmarkSeconds);
+
+            double squaredError = 0.0;
+            double valueCount   = 0.0;
+            double sourceSize   = 0.0;
+            double size         = 0.0;
+            for (size_t i = 0; i < sources.size(); ++i)
+            {
+                addCompressionError(*sources[i], copies[i], &squaredError, &valueCount);
+                sourceSize += sources[i]->getSize();
+                size += copies[i].getSize();
+            }
+            double meanSquaredError = squaredError / valueCount;
+            double psnr             = meanSquaredError > 0.0
+                                          ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError)
+                                          : 99.0;
+
+            printf(
+                "[RESULT] MICROBENCHMARK:texture-compression,FORMAT:%s,THREADS:%d,TEXTURES:%d,"
+                "MBPERSECOND:%.1f,PSNR:%.2f,RATIO:%.2f\n",
+                format != TEXTUREFORMATRGBA8 ? MipChain::getFormatName(format) : "AUTO",
+                threadCounts[t], static_cast<int>(textures.size()), megabytes * runs / seconds,
+                psnr, sourceSize / size);
+        }
+    }
+    return true;
+}
+
+struct RingAllocation
+{
+    RingBuffer *ringBuffer;
+    size_t offset;
+    uint64_t stamp;
+};
+
+// Sub-allocations per second from the ring buffers of a BufferManager, with frames retiring two
+// frames after submission like on the D3D12 backend. Each allocation is stamped, and the stamps
+// are checked when the frame retires, so overlapping a region still in flight is caught. Padding
+// is the share of the used bytes lost to alignment and wrapping.
+bool runRingBufferBenchmark()
+{
+    struct Scenario
+    {
+        const char *name;
+        size_t minSize;
+        size_t maxSize;
+        int allocationsPerFrame;
+    };
+    const Scenario scenarioTable[] = {
+        {"uniforms", 64, 4096, 1024},
+        {"mixed", 64, 1 << 20, 64},
+        {"fish", sizeof(FishPer) * 10000, sizeof(FishPer) * 100000, 1},
+    };
+
+    for (const Scenario &scenario : scenarioTable)
+    {
+        CounterFence fence(2);
+        BufferManager bufferManager(&fence);
+        CounterRandom random;
+        std::deque<std::vector<RingAllocation>> frames;
+
+        uint64_t serial          = 0;
+        uint64_t allocationCount = 0;
+        uint64_t failedCount     = 0;
+        uint64_t requestedSize   = 0;
+        size_t peakSize          = 0;
+        bool valid               = true;
+        auto begin               = timer::now();
+        double seconds;
+        do
+        {
+            ++serial;
+            frames.emplace_back();
+            for (int i = 0; i < scenario.allocationsPerFrame; ++i)
+            {
+                // Sizes are spread evenly on a log scale.
+                float t     = random.getFloat(allocationCount + failedCount, 0);
+                size_t size = static_cast<size_t>(
+                    scenario.minSize *
+                    std::pow(static_cast<double>(scenario.maxSize) / scenario.minSize, t));
+
+                size_t offset          = 0;
+                RingBuffer *ringBuffer = bufferManager.allocate(size, &offset);
+                if (ringBuffer == nullptr)
+                {
+                    ++failedCount;
+                    continue;
+                }
+
+                uint64_t stamp = serial << 32 | i;
+                memcpy(ringBuffer->getData(offset), &stamp, sizeof(stamp));
+                frames.back().push_back({ringBuffer, offset, stamp});
+                ++allocationCount;
+                requestedSize += size;
+            }
+            bufferManager.finishFrame(serial);
+            fence.submit(serial);
+            peakSize = std::max(peakSize, bufferManager.getUsedSize());
+
+            uint64_t completedSerial = fence.getCompletedSerial();
+            while (!frames.empty() && serial - frames.size() + 1 <= completedSerial)
+            {
+                for (const RingAllocation &allocation : frames.front())
+                {
+                    uint64_t stamp;
+                    memcpy(&stamp, allocation.ringBuffer->getData(allocation.offset),
+                           sizeof(stamp));
+                    valid = valid && stamp == allocation.stamp;
+                }
+                frames.pop_front();
+            }
+            bufferManager.retireFrames();
+
+            seconds = timer::getSeconds(begin, timer::now());
+        } while (seconds < kMinBenchmarkSeconds);
+
+        double paddingSize = static_cast<double>(bufferManager.getPaddingSize());
+
+        printf(
+            "[RESULT] MICROBENCHMARK:ring-buffer,SCENARIO:%s,FRAMES:%llu,"
+            "ALLOCATIONSPERSECOND:%.0f,FAILED:%llu,PADDING:%.2f%%,RINGS:%d,POOLBYTES:%llu,"
+            "VALID:%s\n",
+            scenario.name, static_cast<unsigned long long>(serial), allocationCount / seconds,
+            static_cast<unsigned long long>(failedCount),
+            100.0 * paddingSize / (paddingSize + requestedSize),
+            static_cast<int>(bufferManager.getBufferCount()),
+            static_cast<unsigned long long>(peakSize), valid ? "True" : "False");
+    }
+    return true;
+}
+
+// Time to write a frame of fish data of one layout and to copy it to a ring buffer region, like
+// the D3D12 backend copies it to an upload heap.
+template <typename Record>
+void runFishUploadLayout(const char *layoutName, const FishSimulation &simulation, bool match)
+{
+    int fishCount = simulation.getTotalFishCount();
+    std::vector<Record> fishPers(fishCount);
+    size_t byteSize = sizeof(Record) * fishCount;
+
+    CounterFence fence(2);
+    BufferManager bufferManager(&fence);
+
+    uint64_t serial      = 0;
+    uint64_t failedCount = 0;
+    double updateSeconds = 0.0;
+    double uploadSeconds = 0.0;
+    float mclock         = 0.0f;
+    auto begin           = timer::now();
+    double seconds;
+    do
+    {
+        ++serial;
+        auto updateBegin = timer::now();
+        simulation.update(mclock, fishPers.data());
+        auto uploadBegin = timer::now();
+
+        size_t offset          = 0;
+        RingBuffer *ringBuffer = bufferManager.allocate(byteSize, &offset);
+        if (ringBuffer != nullptr)
+        {
+            memcpy(ringBuffer->getData(offset), fishPers.data(), byteSize);
+        }
+        else
+        {
+            ++failedCount;
+        }
+
+        auto uploadEnd = timer::now();
+        updateSeconds += timer::getSeconds(updateBegin, uploadBegin);
+        uploadSeconds += timer::getSeconds(uploadBegin, uploadEnd);
+
+        bufferManager.finishFrame(serial);
+        fence.submit(serial);
+        bufferManager.retireFrames();
+        mclock += kFrameTime;
+
+        seconds = timer::getSeconds(begin, uploadEnd);
+    } while (seconds < kMinBenchmarkSeconds);
+
+    printf(
+        "[RESULT] MICROBENCHMARK:fish-upload,LAYOUT:%s,STRIDE:%d,FISHCOUNT:%d,BYTESPERFRAME:%llu,"
+        "UPDATEMS:%.3f,UPLOADMS:%.3f,UPLOADGBPERSECOND:%.2f,FAILED:%llu,MATCH:%s\n",
+        layoutName, static_cast<int>(sizeof(Record)), fishCount,
+        static_cast<unsigned long long>(byteSize), 1000.0 * updateSeconds / serial,
+        1000.0 * uploadSeconds / serial,
+        uploadSeconds > 0.0 ? byteSize * (serial - failedCount) / uploadSeconds / 1e9 : 0.0,
+        static_cast<unsigned long long>(failedCount), match ? "True" : "False");
+}
+
+// Host bytes written and uploaded per frame with the fish data padded to 256 byte constant buffer
+// views and packed to 32 byte records. Both layouts must hold the same values.
+bool runFishUploadBenchmark()
+{
+    const int fishCountTable[] = {10000, 100000};
+    for (int fishCount : fishCountTable)
+    {
+        int fishCounts[FISH_SPECIES_COUNT];
+        Aquarium::calculateFishCount(fishCount, fishCounts);
+
+        FishSimulation simulation;
+        simulation.reset(fishCounts);
+
+        std::vector<FishPer> fishPers(fishCount);
+        std::vector<FishPerPacked> packedFishPers(fishCount);
+        simulation.update(0.0f, fishPers.data());
+        simulation.update(0.0f, packedFishPers.data());
+        bool match = true;
+        for (int i = 0; i < fishCount; ++i)
+        {
+            match = match && memcmp(&fishPers[i], &packedFishPers[i], sizeof(FishPerPacked)) == 0;
+        }
+
+        runFishUploadLayout<FishPer>("padded", simulation, match);
+        runFishUploadLayout<FishPerPacked>("packed", simulation, match);
+    }
+    return true;
+}
+
+// A fish model that only checks the draws replayed to it, by counting them and hashing their fish
+// data indices in order into a checksum it shares with the other models.
+class ReplayFishModel : public FishModel
+{
+  public:
+    ReplayFishModel(MODELNAME name, int fishPerOffset, int fishCount, uint64_t *checksum)
+        : FishModel(MODELGROUP::FISH, name, false, nullptr), mDrawCount(0), mChecksum(checksum)
+    {
+        setVisibleInstances(fishPerOffset, fishCount);
+    }
+
+    void init() override {}
+    void draw() override {}
+    void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override {}
+    void updateFishPerUniforms(float x,
+                               float y,
+                               float z,
+                               float nextX,
+                               float nextY,
+                               float nextZ,
+                               float scale,
+                               float time,
+                               int index) override
+    {
+    }
+
+    void drawFish(int fishPerIndex, int indexCount) override
+    {
+        ++mDrawCount;
+        *mChecksum = (*mChecksum ^ static_cast<uint64_t>(fishPerIndex)) * 0x100000001b3ull;
+    }
+    int getIndexCount(int lod) const override { return 1536; }
+
+    uint64_t mDrawCount;
+
+  private:
+    uint64_t *mChecksum;
+};
+
+// Fish draws recorded into command streams per second as the number of recording threads grows,
+// and replayed per second on one thread, like the null backend does with --record-commands. The
+// draws must be replayed in the same order whatever the number of threads.
+bool runCommandStreamBenchmark()
+{
+    const int fishCount = 100000;
+    int fishCounts[FISH_SPECIES_COUNT];
+    Aquarium::calculateFishCount(fishCount, fishCounts);
+
+    uint64_t checksum = 0;
+    std::vector<std::unique_ptr<ReplayFishModel>> models;
+    int fishPerOffset = 0;
+    for (int species = 0; species < FISH_SPECIES_COUNT; ++species)
+    {
+        models.emplace_back(new ReplayFishModel(
+            static_cast<MODELNAME>(MODELNAME::MODELSMALLFISHA + species), fishPerOffset,
+            fishCounts[species], &checksum));
+        fishPerOffset += fishCounts[species];
+    }
+
+    int maxThreadCount = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    uint64_t serialChecksum            = 0;
+    double serialRecordedDrawPerSecond = 0.0;
+    for (int threadCount = 1;; threadCount = std::min(threadCount * 2, maxThreadCount))
+    {
+        JobSystem jobSystem(threadCount - 1);
+        CommandRecorder recorder;
+
+        uint64_t frameCount  = 0;
+        double recordSeconds = 0.0;
+        double replaySeconds = 0.0;
+        size_t byteSize      = 0;
+        bool exact           = true;
+        auto begin           = timer::now();
+        double seconds;
+        do
+        {
+            auto recordBegin = timer::now();
+            recorder.begin();
+            for (const auto &model : models)
+            {
+                recorder.addFishModel(model.get());
+            }
+            recorder.record(&jobSystem);
+            auto replayBegin = timer::now();
+
+            checksum = 0xcbf29ce484222325ull;
+            recorder.execute();
+            auto replayEnd = timer::now();
+
+            if (threadCount == 1 && frameCount == 0)
+            {
+                serialChecksum = checksum;
+            }
+            exact = exact && checksum == serialChecksum;
+
+            ++frameCount;
+            recordSeconds += timer::getSeconds(recordBegin, replayBegin);
+            replaySeconds += timer::getSeconds(replayBegin, replayEnd);
+            seconds = timer::getSeconds(begin, replayEnd);
+        } while (seconds < kMinBenchmarkSeconds);
+
+        uint64_t drawCount = 0;
+        for (const auto &model : models)
+        {
+            drawCount += model->mDrawCount;
+            model->mDrawCount = 0;
+        }
+        exact = exact && drawCount == fishCount * frameCount;
+        for (int i = 0; i < recorder.getStreamCount(); ++i)
+        {
+            byteSize += recorder.getStreams()[i].getSize();
+        }
+
+        double recordedDrawPerSecond = fishCount * frameCount / recordSeconds;
+        if (threadCount == 1)
+        {
+            serialRecordedDrawPerSecond = recordedDrawPerSecond;
+        }
+
+        printf(
+            "[RESULT] MICROBENCHMARK:command-stream,THREADS:%d,DRAWS:%d,STREAMS:%d,"
+            "BYTESPERDRAW:%.1f,RECORDDRAWSPERSECOND:%.0f,SPEEDUP:%.2f,REPLAYDRAWSPERSECOND:%.0f,"
+            "EXACT:%s\n",
+            threadCount, fishCount, recorder.getStreamCount(),
+            static_cast<double>(byteSize) / fishCount, recordedDrawPerSecond,
+            recordedDrawPerSecond / serialRecordedDrawPerSecond,
+            fishCount * frameCount / replaySeconds, exact ? "True" : "False");
+
+        if (threadCount == maxThreadCount)
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+// The eye position and view projection of the aquarium camera at eyeClock, as
+// updateGlobalUniforms() computes them for a 16:9 window.
+void getAquariumCamera(float eyeClock, float *eye, float *viewProjection)
+{
+    eye[0]                = std::sin(eyeClock) * g_eyeRadius;
+    eye[1]                = g_eyeHeight;
+    eye[2]                = std::cos(eyeClock) * g_eyeRadius;
+    const float target[3] = {static_cast<float>(std::sin(eyeClock + M_PI)) * g_targetRadius,
+                             g_targetHeight,
+                             static_cast<float>(std::cos(eyeClock + M_PI)) * g_targetRadius};
+    const float up[3]     = {0.0f, 1.0f, 0.0f};
+    float top             = std::tan(matrix::degToRad(g_fieldOfView * g_fovFudge) * 0.5f);
+    float right           = top * 16.0f / 9.0f;
+
+    float viewInverse[16];
+    float view[16];
+    float projection[16];
+    matrix::frustum(projection, -right, right, -top, top, 1.0f, 25000.0f);
+    matrix::cameraLookAt(viewInverse, eye, target, up);
+    matrix::inverse4<float>(view, viewInverse);
+    matrix::mulMatrixMatrix4<float>(viewProjection, view, projection);
+}
+
+// Fish culled and sorted by level of detail per second for each instruction set level, from
+// cameras around the orbit of the aquarium camera, the share of fish kept, and whether every level
+// keeps exactly the fish the scalar level keeps, at the same levels of detail. The length of a
+// species stands in for the radius of its model.
+bool runFishCullingBenchmark()
+{
+    const int kCameraCount = 8;
+    const int fishCount    = 100000;
+    int fishCounts[FISH_SPECIES_COUNT];
+    Aquarium::calculateFishCount(fishCount, fishCounts);
+
+    FishSimulation simulation;
+    simulation.reset(fishCounts);
+    std::vector<FishPerPacked> fishPers(fishCount);
+    simulation.update(3600.0f, fishPers.data());
+
+    float eyes[kCameraCount][3];
+    float viewProjections[kCameraCount][16];
+    for (int i = 0; i < kCameraCount; ++i)
+    {
+        getAquariumCamera(static_cast<float>(M_PI) * 2 * i / kCameraCount, eyes[i],
+                          viewProjections[i]);
+    }
+
+    FishCulling culling;
+    for (int species = 0; species < FISH_SPECIES_COUNT; ++species)
+    {
+        culling.setSpeciesRadius(species, fishTable[species].fishLength);
+    }
+    culling.setLodDistances(g_fishLodDistances);
+
+    std::vector<FishPerPacked> visible(fishCount);
+    std::vector<FishPerPacked> reference(fishCount);
+    for (int level = SIMDLEVELSCALAR; level <= getSupportedSIMDLevel(); ++level)
+    {
+        bool match       = true;
+        int visibleCount = 0;
+        for (int i = 0; i < kCameraCount; ++i)
+        {
+            culling.setViewProjection(viewProjections[i]);
+            culling.setEyePosition(eyes[i]);
+            culling.setSIMDLevel(SIMDLEVELSCALAR);
+            int referenceCount = culling.cull(simulation, fishPers.data(), reference.data());
+            int referenceLodCounts[FISH_SPECIES_COUNT][FISH_LOD_COUNT];
+            for (int species = 0; species < FISH_SPECIES_COUNT; ++species)
+            {
+                memcpy(referenceLodCounts[species], culling.getLodCounts(species),
+                       sizeof(referenceLodCounts[species]));
+            }
+            culling.setSIMDLevel(static_cast<SIMDLEVEL>(level));
+            int count = culling.cull(simulation, fishPers.data(), visible.data());
+
+            match = match && count == referenceCount &&
+                    memcmp(visible.data(), reference.data(), sizeof(FishPerPacked) * count) == 0;
+            for (int species = 0; species < FISH_SPECIES_COUNT; ++species)
+            {
+                match = match && memcmp(referenceLodCounts[species], culling.getLodCounts(species),
+                                        sizeof(referenceLodCounts[species])) == 0;
+            }
+            visibleCount += count;
+        }
+
+        int frames = 0;
+        auto begin = timer::now();
+        double seconds;
+        do
+        {
+            culling.setViewProjection(viewProjections[frames % kCameraCount]);
+            culling.setEyePosition(eyes[frames % kCameraCount]);
+            culling.cull(simulation, fishPers.data(), visible.data());
+            ++frames;
+            seconds = timer::getSeconds(begin, timer::now());
+        } while (seconds < kMinBenchmarkSeconds);
+
+        printf(
+            "[RESULT] MICROBENCHMARK:fish-culling,SIMD:%s,FISHCOUNT:%d,FISHPERSECOND:%.0f,"
+            "VISIBLERATIO:%.3f,MATCH:%s\n",
+            getSIMDLevelName(static_cast<SIMDLEVEL>(level)), fishCount,
+            static_cast<double>(fishCount) * frames / seconds,
+            static_cast<double>(visibleCount) / (static_cast<double>(fishCount) * kCameraCount),
+            match ? "True" : "False");
+    }
+    return true;
+}
+
+// Triangles of the meshes of each level of detail of the fish and the time to decimate them, then
+// the fish triangles submitted per frame at a large fish count from cameras around the orbit of
+// the aquarium camera, with culling and levels of detail on and off.
+bool runFishLodBenchmark()
+{
+    ResourceHelper resourceHelper("null", "", BACKENDTYPENULL);
+    createDirectory(resourceHelper.getCachePath());
+
+    FishCulling culling;
+    int triangleCounts[FISH_SPECIES_COUNT][FISH_LOD_COUNT];
+    for (int species = 0; species < FISH_SPECIES_COUNT; ++species)
+    {
+        const Fish &fishInfo = fishTable[species];
+        std::string name(fishInfo.name);
+        ModelData data;
+        if (!ModelCache::load(resourceHelper.getModelPath(name),
+                              resourceHelper.getModelCachePath(name), &data))
+        {
+            return false;
+        }
+
+        const ModelField *positions = nullptr;
+        const ModelField *texCoords = nullptr;
+        const ModelField *indices   = nullptr;
+        for (const auto &field : data.fields)
+        {
+            if (field.name == "position" && field.numComponents == 3)
+            {
+                positions = &field;
+            }
+            else if (field.name == "texCoord" && field.numComponents == 2)
+            {
+                texCoords = &field;
+            }
+            else if (field.name == "indices" && field.isIndex)
+            {
+                indices = &field;
+            }
+        }
+        if (positions == nullptr || texCoords == nullptr || indices == nullptr)
+        {
+            std::cerr << name << " has no positions, texture coordinates or indices." << std::endl;
+            return false;
+        }
+
+        const float *positionData = static_cast<const float *>(positions->data);
+        int vertexCount           = positions->count / 3;
+        culling.setSpeciesRadius(species,
+                                 FishCulling::computeSpeciesRadius(positionData, vertexCount,
+                                                                   fishInfo.fishLength,
+                                                                   fishInfo.fishBendAmount));
+
+        auto begin = timer::now();
+        MeshSimplifier simplifier(positionData, static_cast<const float *>(texCoords->data),
+                                  vertexCount, static_cast<const unsigned short *>(indices->data),
+                                  indices->count);
+        triangleCounts[species][0] = simplifier.getTriangleCount();
+        std::vector<unsigned short> lodIndices;
+        for (int lod = 1; lod < FISH_LOD_COUNT; ++lod)
+        {
+            simplifier.simplify(
+                static_cast<int>(simplifier.getTriangleCount() * g_fishLodTriangleRatios[lod]),
+                &lodIndices);
+            triangleCounts[species][lod] = static_cast<int>(lodIndices.size() / 3);
+        }
+        double milliseconds = timer::getSeconds(begin, timer::now()) * 1000.0;
+
+        printf("[RESULT] MICROBENCHMARK:fish-lod,MODEL:%s", fishInfo.name);
+        for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+        {
+            printf(",LOD%d_TRIANGLES:%d", lod, triangleCounts[species][lod]);
+        }
+        printf(",SIMPLIFY_MS:%.3f\n", milliseconds);
+    }
+
+    const int kCameraCount = 8;
+    const int fishCount    = 100000;
+    int fishCounts[FISH_SPECIES_COUNT];
+    Aquarium::calculateFishCount(fishCount, fishCounts);
+
+    FishSimulation simulation;
+    simulation.reset(fishCounts);
+    std::vector<FishPerPacked> fishPers(fishCount);
+    std::vector<FishPerPacked> visible(fishCount);
+    simulation.update(3600.0f, fishPers.data());
+
+    float eyes[kCameraCount][3];
+    float viewProjections[kCameraCount][16];
+    for (int i = 0; i < kCameraCount; ++i)
+    {
+        getAquariumCamera(static_cast<float>(M_PI) * 2 * i / kCameraCount, eyes[i],
+                          viewProjections[i]);
+    }
+
+    for (int cull = 0; cull < 2; ++cull)
+    {
+        for (int lod = 0; lod < 2; ++lod)
+        {
+            culling.setLodDistances(lod ? g_fishLodDistances : nullptr);
+            uint64_t triangleCount = 0;
+            uint64_t lodFishCounts[FISH_LOD_COUNT] = {};
+            for (int i = 0; i < kCameraCount; ++i)
+            {
+                culling.setViewProjection(cull ? viewProjections[i] : nullptr);
+                culling.setEyePosition(eyes[i]);
+                culling.cull(simulation, fishPers.data(), visible.data());
+                for (int species = 0; species < FISH_SPECIES_COUNT; ++species)
+                {
+                    for (int level = 0; level < FISH_LOD_COUNT; ++level)
+                    {
+                        int count = culling.getLodCounts(species)[level];
+                        triangleCount += static_cast<uint64_t>(count) *
+                                         static_cast<uint64_t>(triangleCounts[species][level]);
+                        lodFishCounts[level] += count;
+                    }
+                }
+            }
+
+            printf(
+                "[RESULT] MICROBENCHMARK:fish-lod,FISHCOUNT:%d,CULLING:%s,LOD:%s,"
+                "TRIANGLES_PER_FRAME:%.0f",
+                fishCount, cull ? "True" : "False", lod ? "True" : "False",
+                static_cast<double>(triangleCount) / kCameraCount);
+            for (int level = 0; level < FISH_LOD_COUNT; ++level)
+            {
+                printf(",LOD%d_FISH_PER_FRAME:%.1f", level,
+                       static_cast<double>(lodFishCounts[level]) / kCameraCount);
+            }
+            printf("\n");
+        }
+    }
+    return true;
+}
+
+// The programs of the aquarium, with whether they are alpha blended.
+const struct
+{
+    const char *vertexShader;
+    const char *fragmentShader;
+    bool blend;
+} kBenchmarkPrograms[] = {
+    {"diffuseVertexShader", "diffuseFragmentShader", true},
+    {"fishVertexShader", "fishNormalMapFragmentShader", true},
+    {"fishVertexShader", "fishReflectionFragmentShader", true},
+    {"innerRefractionMapVertexShader", "innerRefractionMapFragmentShader", false},
+    {"normalMapVertexShader", "normalMapFragmentShader", true},
+    {"reflectionMapVertexShader", "reflectionMapFragmentShader", true},
+    {"seaweedVertexShader", "seaweedFragmentShader", true},
+};
+
+// Create the programs like the loader used to, reading both files of each program and patching
+// the alpha with a regular expression. Returns the code of all shaders.
+std::string createProgramsWithRegex(const std::string &programPath, const std::string &alpha)
+{
+    std::string code;
+    for (const auto &program : kBenchmarkPrograms)
+    {
+        std::ifstream vertexStream(programPath + program.vertexShader, std::ios::in);
+        code += std::string((std::istreambuf_iterator<char>(vertexStream)),
+                            std::istreambuf_iterator<char>());
+        std::ifstream fragmentStream(programPath + program.fragmentShader, std::ios::in);
+        std::string fragmentCode((std::istreambuf_iterator<char>(fragmentStream)),
+                                 std::istreambuf_iterator<char>());
+        if (program.blend)
+        {
+            fragmentCode =
+                std::regex_replace(fragmentCode, std::regex(R"(diffuseColor.w)"), alpha);
+        }
+        code += fragmentCode;
+    }
+    return code;
+}
+
+// Create the programs through shaderCache, the code standing for the compiled shaders like on the
+// null backend. Returns the code of all shaders, or an empty string if one can't be read.
+std::string createProgramsWithCache(const std::string &programPath,
+                                    const std::string &alpha,
+                                    ShaderCache *shaderCache)
+{
+    ShaderCache::Compiler compiler = [](const std::string &code, std::string *binary) {
+        *binary = code;
+        return true;
+    };
+
+    std::string code;
+    for (const auto &program : kBenchmarkPrograms)
+    {
+        const ShaderSource *vertexSource =
+            shaderCache->loadSource(programPath + program.vertexShader);
+        const ShaderSource *fragmentSource =
+            shaderCache->loadSource(programPath + program.fragmentShader);
+        std::string vertexShader;
+        std::string fragmentShader;
+        if (vertexSource == nullptr || fragmentSource == nullptr ||
+            !shaderCache->getShader(*vertexSource, "VS", nullptr, compiler, &vertexShader) ||
+            !shaderCache->getShader(*fragmentSource, "PS", program.blend ? &alpha : nullptr,
+                                    compiler, &fragmentShader))
+        {
+            return std::string();
+        }
+        code += vertexShader;
+        code += fragmentShader;
+    }
+    return code;
+}
+
+// Remove the shaders of the programs from the cache folder of shaderCache.
+void removeCachedShaders(const std::string &programPath,
+                         const std::string &alpha,
+                         ShaderCache *shaderCache)
+{
+    for (const auto &program : kBenchmarkPrograms)
+    {
+        const ShaderSource *vertexSource =
+            shaderCache->loadSource(programPath + program.vertexShader);
+        const ShaderSource *fragmentSource =
+            shaderCache->loadSource(programPath + program.fragmentShader);
+        if (vertexSource != nullptr && fragmentSource != nullptr)
+        {
+            uint64_t vertexKey = shaderCache->getKey(*vertexSource, "VS", nullptr);
+            uint64_t fragmentKey =
+                shaderCache->getKey(*fragmentSource, "PS", program.blend ? &alpha : nullptr);
+            std::remove(shaderCache->getCachePath(vertexKey).c_str());
+            std::remove(shaderCache->getCachePath(fragmentKey).c_str());
+        }
+    }
+}
+
+// Time to create the programs of the aquarium with the regular expression the loader used to
+// patch shaders with, and through the shader cache: cold, with no shader in the cache folder yet,
+// warm from the cache folder, as on the next start, and warm from memory. The null backend has no
+// compiler, so cold times leave out compiling. All modes must produce the same code.
+bool runShaderCacheBenchmark()
+{
+    ResourceHelper resourceHelper("null", "", BACKENDTYPENULL);
+    createDirectory(resourceHelper.getCachePath());
+    const std::string &programPath = resourceHelper.getProgramPath();
+    const std::string alpha        = "0.5";
+    int programCount =
+        static_cast<int>(sizeof(kBenchmarkPrograms) / sizeof(kBenchmarkPrograms[0]));
+
+    auto newCache = [&resourceHelper]() {
+        std::unique_ptr<ShaderCache> shaderCache(new ShaderCache());
+        shaderCache->setFolder(resourceHelper.getCachePath());
+        shaderCache->setConfiguration("micro-benchmark");
+        return shaderCache;
+    };
+    removeCachedShaders(programPath, alpha, newCache().get());
+
+    auto begin            = timer::now();
+    std::string reference = createProgramsWithRegex(programPath, alpha);
+    double regexTime      = timer::getMilliseconds(begin, timer::now());
+    printf("[RESULT] MICROBENCHMARK:shader-cache,MODE:regex,PROGRAMS:%d,PROGRAMMS:%.3f\n",
+           programCount, regexTime);
+
+    std::unique_ptr<ShaderCache> coldCache = newCache();
+    std::unique_ptr<ShaderCache> warmCache = newCache();
+    const struct
+    {
+        const char *mode;
+        ShaderCache *shaderCache;
+    } modeTable[] = {
+        {"cold", coldCache.get()},
+        {"warm-disk", warmCache.get()},
+        {"warm-memory", warmCache.get()},
+    };
+
+    bool succeeded = true;
+    for (const auto &mode : modeTable)
+    {
+        ShaderCacheStatistics before = mode.shaderCache->getStatistics();
+        begin                        = timer::now();
+        std::string code = createProgramsWithCache(programPath, alpha, mode.shaderCache);
+        double time      = timer::getMilliseconds(begin, timer::now());
+        const ShaderCacheStatistics &after = mode.shaderCache->getStatistics();
+        succeeded                          = succeeded && !code.empty();
+
+        printf(
+            "[RESULT] MICROBENCHMARK:shader-cache,MODE:%s,PROGRAMS:%d,PROGRAMMS:%.3f,"
+            "COMPILES:%d,DISKHITS:%d,MEMORYHITS:%d,MATCH:%s\n",
+            mode.mode, programCount, time, after.compiles - before.compiles,
+            after.diskHits - before.diskHits, after.memoryHits - before.memoryHits,
+            code == reference ? "True" : "False");
+    }
+
+    removeCachedShaders(programPath, alpha, newCache().get());
+    return succeeded;
+}
+
+}  // namespace
+
+bool runMicroBenchmark(const std::string &name)
+{
+    if (name == "command-stream")
+    {
+        return runCommandStreamBenchmark();
+    }
+    if (name == "fish")
+    {
+        return runFishBenchmark();
+    }
+    if (name == "fish-culling")
+    {
+        return runFishCullingBenchmark();
+    }
+    if (name == "fish-lod")
+    {
+        return runFishLodBenchmark();
+    }
+    if (name == "fish-upload")
+    {
+        return runFishUploadBenchmark();
+    }
+    if (name == "fish-threads")
+    {
+        return runFishThreadsBenchmark();
+    }
+    if (name == "random")
+    {
+        return runRandomBenchmark();
+    }
+    if (name == "matrix")
+    {
+        return runMatrixBenchmark();
+    }
+    if (name == "mipmap")
+    {
+        return runMipmapBenchmark();
+    }
+    if (name == "shader-cache")
+    {
+        return runShaderCacheBenchmark();
+    }
+    if (name == "ring-buffer")
+    {
+        return runRingBufferBenchmark();
+    }
+    if (name == "texture-compression")
+    {
+        return runTextureCompressionBenchmark();
+    }
+
+    std::cerr << "Unknown micro-benchmark: " << name << std::endl;
+    return false;
+}
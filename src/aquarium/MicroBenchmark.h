@@ -0,0 +1,18 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MicroBenchmark.h: Define CPU micro-benchmarks that run without creating a context. Results are
+// printed as [RESULT] lines, in the same form the rendering benchmark uses.
+
+#pragma once
+#ifndef MICROBENCHMARK_H
+#define MICROBENCHMARK_H 1
+
+#include <string>
+
+// Run the micro-benchmark with the given name. Returns false if there is no such benchmark.
+bool runMicroBenchmark(const std::string &name);
+
+#endif  // !MICROBENCHMARK_H
@@ -0,0 +1,400 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MipChain.cpp: Implement the mip chain layout and the box filter.
+
+#include "MipChain.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "JobSystem.h"
+
+#ifdef AQUARIUM_SIMD_X86
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Output pixels per job, so that small levels don't pay for the synchronization.
+constexpr int kMipJobPixels = 16384;
+
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+struct SRGBTables
+{
+    static constexpr int kLinearSteps = 4096;
+
+    SRGBTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            toLinear[i] = toLinearValue(i / 255.0);
+        }
+        // Rounding happens in sRGB space, so the thresholds are the midpoints between the codes.
+        for (int i = 0; i < 255; ++i)
+        {
+            thresholds[i] = toLinearValue((i + 0.5) / 255.0);
+        }
+        for (int i = 0; i <= kLinearSteps; ++i)
+        {
+            float linear  = static_cast<float>(i) / kLinearSteps;
+            firstCodes[i] = static_cast<uint8_t>(
+                std::upper_bound(thresholds, thresholds + 255, linear) - thresholds);
+        }
+    }
+
+    static float toLinearValue(double v)
+    {
+        return static_cast<float>(v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4));
+    }
+
+    // The table gives the code at the start of the step that linear is in. Codes are about a step
+    // apart at the dark end and further apart above, so the search rarely moves.
+    uint8_t toSRGB(float linear) const
+    {
+        int code = firstCodes[static_cast<int>(linear * kLinearSteps)];
+        while (code < 255 && linear >= thresholds[code])
+        {
+            ++code;
+        }
+        return static_cast<uint8_t>(code);
+    }
+
+    float toLinear[256];
+    float thresholds[255];
+    uint8_t firstCodes[kLinearSteps + 1];
+};
+
+const SRGBTables &getSRGBTables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+// Average of the 2x2 blocks of rows r0 and r1 of the level above. x1 of the block is clamped for
+// levels above that are one pixel wide; r1 is r0 for levels above that are one pixel high.
+void downsampleRowScalar(uint8_t *dst,
+                         const uint8_t *r0,
+                         const uint8_t *r1,
+                         int firstPixel,
+                         int width,
+                         int srcWidth)
+{
+    for (int x = firstPixel; x < width; ++x)
+    {
+        int x0 = 2 * x * 4;
+        int x1 = std::min(2 * x + 1, srcWidth - 1) * 4;
+        for (int c = 0; c < 4; ++c)
+        {
+            dst[x * 4 + c] =
+                static_cast<uint8_t>((r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+void downsampleRowSRGB(uint8_t *dst, const uint8_t *r0, const uint8_t *r1, int width, int srcWidth)
+{
+    const SRGBTables &tables = getSRGBTables();
+    for (int x = 0; x < width; ++x)
+    {
+        int x0 = 2 * x * 4;
+        int x1 = std::min(2 * x + 1, srcWidth - 1) * 4;
+        for (int c = 0; c < 3; ++c)
+        {
+            float sum = tables.toLinear[r0[x0 + c]] + tables.toLinear[r0[x1 + c]] +
+                        tables.toLinear[r1[x0 + c]] + tables.toLinear[r1[x1 + c]];
+            dst[x * 4 + c] = tables.toSRGB(sum * 0.25f);
+        }
+        dst[x * 4 + 3] =
+            static_cast<uint8_t>((r0[x0 + 3] + r0[x1 + 3] + r1[x0 + 3] + r1[x1 + 3] + 2) >> 2);
+    }
+}
+
+#ifdef AQUARIUM_SIMD_X86
+// Same rounding as the scalar version, four pixels at a time. Returns the first pixel left.
+int downsampleRowSSE2(uint8_t *dst, const uint8_t *r0, const uint8_t *r1, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two  = _mm_set1_epi16(2);
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r0 + x * 8));
+        __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r0 + x * 8 + 16));
+        __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r1 + x * 8));
+        __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r1 + x * 8 + 16));
+
+        // Vertical sums of two source pixels per register, widened to 16 bits.
+        __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+        __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+        __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+        __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+        // Horizontal sums of the pairs give two output pixels per register.
+        __m128i h0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+        __m128i h1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+        h0         = _mm_srli_epi16(_mm_add_epi16(h0, two), 2);
+        h1         = _mm_srli_epi16(_mm_add_epi16(h1, two), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), _mm_packus_epi16(h0, h1));
+    }
+    return x;
+}
+#endif
+
+}  // namespace
+
+MipChain::MipChain()
+    : mWidth(0),
+      mHeight(0),
+      mLevelCount(0),
+      mLayerCount(0),
+      mFormat(TEXTUREFORMATRGBA8),
+      mGenerated(false),
+      mLayerSize(0),
+      mData(nullptr)
+{
+}
+
+int MipChain::getFullLevelCount(int width, int height)
+{
+    return static_cast<int>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+int MipChain::getBlockDimension(TEXTUREFORMAT format)
+{
+    return format == TEXTUREFORMATRGBA8 ? 1 : 4;
+}
+
+size_t MipChain::getBlockByteSize(TEXTUREFORMAT format)
+{
+    switch (format)
+    {
+        case TEXTUREFORMATBC1:
+            return 8;
+        case TEXTUREFORMATBC3:
+        case TEXTUREFORMATBC5:
+            return 16;
+        default:
+            return 4;
+    }
+}
+
+const char *MipChain::getFormatName(TEXTUREFORMAT format)
+{
+    switch (format)
+    {
+        case TEXTUREFORMATBC1:
+            return "BC1";
+        case TEXTUREFORMATBC3:
+            return "BC3";
+        case TEXTUREFORMATBC5:
+            return "BC5";
+        default:
+            return "RGBA8";
+    }
+}
+
+void MipChain::layOut(int width, int height, int levelCount, int layerCount, TEXTUREFORMAT format)
+{
+    mWidth      = width;
+    mHeight     = height;
+    mLevelCount = levelCount > 0 ? levelCount : getFullLevelCount(width, height);
+    mLayerCount = layerCount;
+    mFormat     = format;
+    mGenerated  = false;
+
+    // Levels smaller than a block still take a whole block.
+    int blockDimension = getBlockDimension(format);
+    size_t blockSize   = getBlockByteSize(format);
+    mLevels.clear();
+    size_t offset = 0;
+    for (int level = 0; level < mLevelCount; ++level)
+    {
+        size_t blocksWide = (getWidth(level) + blockDimension - 1) / blockDimension;
+        Level layout;
+        layout.offset   = alignUp(offset, kLevelAlignment);
+        layout.rowPitch = alignUp(blocksWide * blockSize, kRowPitchAlignment);
+        layout.rowCount = (getHeight(level) + blockDimension - 1) / blockDimension;
+        mLevels.push_back(layout);
+        offset = layout.offset + layout.rowPitch * layout.rowCount;
+    }
+    mLayerSize = alignUp(offset, kLevelAlignment);
+}
+
+void MipChain::allocate(int width,
+                        int height,
+                        int levelCount,
+                        int layerCount,
+                        TEXTUREFORMAT format)
+{
+    layOut(width, height, levelCount, layerCount, format);
+
+    mFile.reset();
+    mStorage.reset(new uint8_t[getSize() + kLevelAlignment]);
+    uintptr_t address = reinterpret_cast<uintptr_t>(mStorage.get());
+    mData             = mStorage.get() + (alignUp(address, kLevelAlignment) - address);
+}
+
+bool MipChain::map(std::unique_ptr<MappedFile> file,
+                   size_t offset,
+                   int width,
+                   int height,
+                   int levelCount,
+                   int layerCount,
+                   TEXTUREFORMAT format)
+{
+    // Mappings start on a page, so aligned offsets keep the levels aligned.
+    char *data = file->mutableData();
+    if (data == nullptr || offset % kLevelAlignment != 0 || format >= TEXTUREFORMATMAX)
+    {
+        return false;
+    }
+    layOut(width, height, levelCount, layerCount, format);
+    if (offset > file->size() || getSize() > file->size() - offset)
+    {
+        release();
+        return false;
+    }
+
+    mStorage.reset();
+    mFile      = std::move(file);
+    mData      = reinterpret_cast<uint8_t *>(data) + offset;
+    mGenerated = true;
+    return true;
+}
+
+void MipChain::release()
+{
+    mStorage.reset();
+    mFile.reset();
+    mData = nullptr;
+    std::vector<Level>().swap(mLevels);
+    mLevelCount = 0;
+    mLayerCount = 0;
+    mLayerSize  = 0;
+}
+
+int MipChain::getWidth(int level) const
+{
+    return std::max(mWidth >> level, 1);
+}
+
+int MipChain::getHeight(int level) const
+{
+    return std::max(mHeight >> level, 1);
+}
+
+void MipChain::generate(JobSystem *jobSystem, bool srgb, SIMDLEVEL simdLevel)
+{
+    generateMipChains(jobSystem, {this}, srgb, simdLevel);
+}
+
+void MipChain::downsample(int layer,
+                          int level,
+                          int firstRow,
+                          int lastRow,
+                          bool srgb,
+                          SIMDLEVEL simdLevel)
+{
+    int width          = getWidth(level);
+    int srcWidth       = getWidth(level - 1);
+    int srcHeight      = getHeight(level - 1);
+    size_t pitch       = getRowPitch(level);
+    size_t srcPitch    = getRowPitch(level - 1);
+    uint8_t *dst       = getPixels(layer, level) + pitch * firstRow;
+    const uint8_t *src = getPixels(layer, level - 1);
+
+    for (int y = firstRow; y < lastRow; ++y, dst += pitch)
+    {
+        const uint8_t *r0 = src + srcPitch * (2 * y);
+        const uint8_t *r1 = src + srcPitch * std::min(2 * y + 1, srcHeight - 1);
+        if (srgb)
+        {
+            downsampleRowSRGB(dst, r0, r1, width, srcWidth);
+            continue;
+        }
+
+        int firstPixel = 0;
+#ifdef AQUARIUM_SIMD_X86
+        if (simdLevel >= SIMDLEVELSSE2)
+        {
+            firstPixel = downsampleRowSSE2(dst, r0, r1, width);
+        }
+#endif
+        downsampleRowScalar(dst, r0, r1, firstPixel, width, srcWidth);
+    }
+}
+
+void generateMipChains(JobSystem *jobSystem,
+                       const std::vector<MipChain *> &chains,
+                       bool srgb,
+                       SIMDLEVEL simdLevel)
+{
+    struct MipJob
+    {
+        MipChain *chain;
+        int layer;
+        int firstRow;
+        int lastRow;
+    };
+
+    int levelCount = 0;
+    for (MipChain *chain : chains)
+    {
+        if (!chain->isGenerated())
+        {
+            levelCount = std::max(levelCount, chain->getLevelCount());
+        }
+    }
+
+    std::vector<MipJob> jobs;
+    for (int level = 1; level < levelCount; ++level)
+    {
+        jobs.clear();
+        for (MipChain *chain : chains)
+        {
+            if (chain->isGenerated() || level >= chain->getLevelCount())
+            {
+                continue;
+            }
+            int height     = chain->getHeight(level);
+            int rowsPerJob = std::max(kMipJobPixels / chain->getWidth(level), 1);
+            for (int layer = 0; layer < chain->getLayerCount(); ++layer)
+            {
+                for (int row = 0; row < height; row += rowsPerJob)
+                {
+                    jobs.push_back({chain, layer, row, std::min(row + rowsPerJob, height)});
+                }
+            }
+        }
+
+        auto run = [&](int begin, int end) {
+            for (int i = begin; i < end; ++i)
+            {
+                const MipJob &job = jobs[i];
+                job.chain->downsample(job.layer, level, job.firstRow, job.lastRow, srgb,
+                                      simdLevel);
+            }
+        };
+        if (jobSystem != nullptr)
+        {
+            jobSystem->parallelFor(static_cast<int>(jobs.size()), 1, run);
+        }
+        else
+        {
+            run(0, static_cast<int>(jobs.size()));
+        }
+    }
+
+    for (MipChain *chain : chains)
+    {
+        chain->mGenerated = true;
+    }
+}
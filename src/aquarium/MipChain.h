@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// MipChain.h: Define the mip chains of textures and their generation by 2x2 box filtering.
+//
+// All levels of all layers live in one allocation laid out the way D3D12 lays out copyable
+// footprints: layers one after another, the levels of a layer from largest to smallest, every
+// level starting at a multiple of 512 bytes and every row at a multiple of 256 bytes. Uploads can
+// copy the whole chain at once. Rows of block compressed chains are rows of 4x4 blocks.
+
+#pragma once
+#ifndef MIPCHAIN_H
+#define MIPCHAIN_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "FileSystem.h"
+#include "SIMD.h"
+
+class JobSystem;
+
+enum TEXTUREFORMAT : uint32_t
+{
+    TEXTUREFORMATRGBA8,
+    // Opaque RGB, 8 bytes per 4x4 block.
+    TEXTUREFORMATBC1,
+    // RGBA, 16 bytes per 4x4 block.
+    TEXTUREFORMATBC3,
+    // Two channels, 16 bytes per 4x4 block.
+    TEXTUREFORMATBC5,
+    TEXTUREFORMATMAX
+};
+
+class MipChain
+{
+  public:
+    static constexpr size_t kRowPitchAlignment = 256;
+    static constexpr size_t kLevelAlignment    = 512;
+
+    MipChain();
+
+    // Allocate levelCount levels of layerCount layers, for a base level of width x height. 0 as
+    // levelCount stands for the full chain down to 1x1.
+    void allocate(int width,
+                  int height,
+                  int levelCount,
+                  int layerCount,
+                  TEXTUREFORMAT format = TEXTUREFORMATRGBA8);
+    // Lay the chain out over a copy-on-write mapping of a file whose levels were generated before,
+    // e.g. a texture cache, starting at offset. Fails if the file is too small for the chain.
+    bool map(std::unique_ptr<MappedFile> file,
+             size_t offset,
+             int width,
+             int height,
+             int levelCount,
+             int layerCount,
+             TEXTUREFORMAT format);
+    void release();
+
+    static int getFullLevelCount(int width, int height);
+    // Texels along each side of a block, 1 for RGBA8.
+    static int getBlockDimension(TEXTUREFORMAT format);
+    // Bytes per block, or per texel for RGBA8.
+    static size_t getBlockByteSize(TEXTUREFORMAT format);
+    static const char *getFormatName(TEXTUREFORMAT format);
+
+    int getWidth(int level) const;
+    int getHeight(int level) const;
+    int getLevelCount() const { return mLevelCount; }
+    int getLayerCount() const { return mLayerCount; }
+    TEXTUREFORMAT getFormat() const { return mFormat; }
+    size_t getRowPitch(int level) const { return mLevels[level].rowPitch; }
+    // Rows of texels, or of blocks for compressed formats.
+    int getRowCount(int level) const { return mLevels[level].rowCount; }
+    size_t getOffset(int layer, int level) const
+    {
+        return mLayerSize * layer + mLevels[level].offset;
+    }
+    uint8_t *getPixels(int layer, int level) { return mData + getOffset(layer, level); }
+    const uint8_t *getPixels(int layer, int level) const { return mData + getOffset(layer, level); }
+    const uint8_t *getData() const { return mData; }
+    bool isMapped() const { return mFile != nullptr; }
+    size_t getSize() const { return mLayerSize * mLayerCount; }
+
+    // Whether all levels below the base level have been generated.
+    bool isGenerated() const { return mGenerated || mLevelCount <= 1; }
+    // Mark the levels below the base level as out of date, after the base level changed.
+    void invalidate() { mGenerated = false; }
+    // Generate the levels below the base level of every layer. With srgb, the colors are averaged
+    // in linear space; alpha always is. Only RGBA8 chains are filtered, compressed chains are
+    // compressed from generated ones.
+    void generate(JobSystem *jobSystem = nullptr,
+                  bool srgb           = false,
+                  SIMDLEVEL simdLevel = getSupportedSIMDLevel());
+
+    // Rows [firstRow, lastRow) of level, filtered from the level above it.
+    void downsample(int layer,
+                    int level,
+                    int firstRow,
+                    int lastRow,
+                    bool srgb,
+                    SIMDLEVEL simdLevel);
+
+  private:
+    friend void generateMipChains(JobSystem *jobSystem,
+                                  const std::vector<MipChain *> &chains,
+                                  bool srgb,
+                                  SIMDLEVEL simdLevel);
+
+    friend void compressMipChains(JobSystem *jobSystem,
+                                  const std::vector<MipChain *> &chains,
+                                  const std::vector<TEXTUREFORMAT> &formats);
+    friend void decompressMipChain(const MipChain &chain, MipChain *decoded);
+
+    struct Level
+    {
+        size_t offset;
+        size_t rowPitch;
+        int rowCount;
+    };
+
+    void layOut(int width, int height, int levelCount, int layerCount, TEXTUREFORMAT format);
+
+    int mWidth;
+    int mHeight;
+    int mLevelCount;
+    int mLayerCount;
+    TEXTUREFORMAT mFormat;
+    bool mGenerated;
+    std::vector<Level> mLevels;
+    size_t mLayerSize;
+    std::unique_ptr<uint8_t[]> mStorage;
+    std::unique_ptr<MappedFile> mFile;
+    uint8_t *mData;
+};
+
+// Generate the chains together. A level only depends on the level above it, so each level of all
+// chains is one wave of jobs, split by layer and by rows.
+void generateMipChains(JobSystem *jobSystem,
+                       const std::vector<MipChain *> &chains,
+                       bool srgb           = false,
+                       SIMDLEVEL simdLevel = getSupportedSIMDLevel());
+
+#endif  // !MIPCHAIN_H
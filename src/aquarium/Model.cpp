@@ -10,7 +10,10 @@
 #include "Model.h"
 
 Model::Model()
-    : mProgram(nullptr),
+    : worldmatrices(nullptr),
+      worldInverseTransposes(nullptr),
+      worldmatrixCount(0),
+      mProgram(nullptr),
       mBlend(false),
       mName(MODELMAX)
 {
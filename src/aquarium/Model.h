@@ -30,16 +30,32 @@ class Model
   public:
     Model();
     Model(MODELGROUP type, MODELNAME name, bool blend)
-        : mProgram(nullptr), mBlend(blend), mName(name) {}
+        : worldmatrices(nullptr),
+          worldInverseTransposes(nullptr),
+          worldmatrixCount(0),
+          mProgram(nullptr),
+          mBlend(blend),
+          mName(name)
+    {
+    }
     virtual ~Model();
     virtual void prepareForDraw()                                              = 0;
     virtual void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) = 0;
+    // Batched alternative to updatePerInstanceUniforms(): the backend's own world uniforms of the
+    // next count instances, for the caller to fill in before prepareForDraw(). nullptr if the
+    // model has no such array or no room left in it.
+    virtual WorldUniforms *mapWorldUniforms(int count) { return nullptr; }
     virtual void draw() = 0;
 
     void setProgram(Program *program);
     virtual void init() = 0;
 
-    std::vector<std::vector<float>> worldmatrices;
+    // World matrices of the placed instances, 16 floats each and one after another, in the
+    // placement arena of the aquarium. Placement never changes after load, so the inverse
+    // transposes are computed once along with them.
+    float *worldmatrices;
+    float *worldInverseTransposes;
+    int worldmatrixCount;
     std::unordered_map<std::string, Texture *> textureMap;
     std::unordered_map<std::string, Buffer *> bufferMap;
 
@@ -0,0 +1,349 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ModelCache.cpp: Implement loading models through the binary cache.
+
+#include "ModelCache.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "rapidjson/document.h"
+
+namespace {
+
+const char kModelCacheMagic[4] = {'A', 'Q', 'M', 'C'};
+
+size_t alignUp(size_t value)
+{
+    return (value + kModelCacheAlignment - 1) & ~(kModelCacheAlignment - 1);
+}
+
+size_t getFieldTypeSize(uint32_t type)
+{
+    return type == MODELCACHEFIELDUINT16 ? sizeof(unsigned short) : sizeof(float);
+}
+
+// Read the header if the cache has the current format and hasn't been truncated.
+bool readHeader(const char *cache, size_t size, ModelCacheHeader *header)
+{
+    if (cache == nullptr || size < sizeof(ModelCacheHeader))
+    {
+        return false;
+    }
+
+    memcpy(header, cache, sizeof(ModelCacheHeader));
+    return memcmp(header->magic, kModelCacheMagic, sizeof(kModelCacheMagic)) == 0 &&
+           header->version == kModelCacheVersion && header->fileSize == size;
+}
+
+bool readString(const char *cache, size_t size, const ModelCacheString &string, std::string *out)
+{
+    if (static_cast<uint64_t>(string.offset) + string.length > size)
+    {
+        return false;
+    }
+
+    out->assign(cache + string.offset, string.length);
+    return true;
+}
+
+ModelCacheString appendString(const std::string &string, std::string *strings, size_t base)
+{
+    ModelCacheString entry;
+    entry.offset = static_cast<uint32_t>(base + strings->size());
+    entry.length = static_cast<uint32_t>(string.size());
+    strings->append(string);
+    return entry;
+}
+
+}  // namespace
+
+bool ModelCache::load(const std::string &sourcePath,
+                      const std::string &cachePath,
+                      ModelData *model)
+{
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (!getFileStatus(sourcePath, &sourceSize, &sourceTime))
+    {
+        std::cerr << "Failed to find model file " << sourcePath << "." << std::endl;
+        return false;
+    }
+
+    // The model file hasn't been touched since the cache was built.
+    ModelCacheHeader header;
+    bool validCache = model->mCache.open(cachePath) &&
+                      readHeader(model->mCache.data(), model->mCache.size(), &header);
+    if (validCache && header.sourceSize == sourceSize && header.sourceTime == sourceTime &&
+        readCache(model->mCache.data(), model->mCache.size(), model))
+    {
+        return true;
+    }
+
+    MappedFile source;
+    std::string sourceCopy;
+    size_t textSize;
+    char *text = mapText(sourcePath, &source, &sourceCopy, &textSize);
+    if (text == nullptr)
+    {
+        std::cerr << "Failed to read model file " << sourcePath << "." << std::endl;
+        return false;
+    }
+    uint64_t sourceHash = hashBytes(text, textSize);
+
+    // The model file was touched but its content didn't change, e.g. by a checkout. Store the new
+    // time so that later loads don't hash the file again.
+    if (validCache && header.sourceSize == textSize && header.sourceHash == sourceHash)
+    {
+        std::string cache(model->mCache.data(), model->mCache.size());
+        model->mCache.close();
+
+        header.sourceSize = sourceSize;
+        header.sourceTime = sourceTime;
+        memcpy(&cache[0], &header, sizeof(header));
+        if (writeFileAtomic(cachePath, cache.data(), cache.size()) && mapCache(cachePath, model))
+        {
+            return true;
+        }
+    }
+    model->mCache.close();
+
+    if (!parseJson(text, model))
+    {
+        std::cerr << "Failed to parse model file " << sourcePath << "." << std::endl;
+        return false;
+    }
+
+    // The cache only speeds up later loads, so failing to write it isn't an error.
+    std::string cache = serialize(*model, sourceSize, sourceTime, sourceHash);
+    writeFileAtomic(cachePath, cache.data(), cache.size());
+
+    return true;
+}
+
+bool ModelCache::parseJson(char *text, ModelData *model)
+{
+    rapidjson::Document document;
+    document.ParseInsitu(text);
+    if (document.HasParseError() || !document.IsObject() || !document.HasMember("models"))
+    {
+        return false;
+    }
+
+    const rapidjson::Value &models = document["models"];
+    if (!models.IsArray() || models.Empty())
+    {
+        return false;
+    }
+
+    model->textures.clear();
+    model->fields.clear();
+    model->mArena.reset();
+    model->fromCache = false;
+
+    const rapidjson::Value &value = models[models.Size() - 1];
+
+    const rapidjson::Value &textures = value["textures"];
+    for (rapidjson::Value::ConstMemberIterator itr = textures.MemberBegin();
+         itr != textures.MemberEnd(); ++itr)
+    {
+        model->textures.emplace_back(itr->name.GetString(), itr->value.GetString());
+    }
+
+    // All the field data goes into one block.
+    const rapidjson::Value &arrays = value["fields"];
+    size_t dataSize                = 0;
+    for (rapidjson::Value::ConstMemberIterator itr = arrays.MemberBegin();
+         itr != arrays.MemberEnd(); ++itr)
+    {
+        size_t elementSize = strcmp(itr->name.GetString(), "indices") == 0
+                                 ? sizeof(unsigned short)
+                                 : sizeof(float);
+        dataSize += alignUp(itr->value["data"].Size() * elementSize);
+    }
+    model->mArena.reserve(dataSize, kModelCacheAlignment);
+
+    for (rapidjson::Value::ConstMemberIterator itr = arrays.MemberBegin();
+         itr != arrays.MemberEnd(); ++itr)
+    {
+        ModelField field;
+        field.name          = itr->name.GetString();
+        field.numComponents = itr->value["numComponents"].GetInt();
+        field.isIndex       = field.name == "indices";
+
+        const rapidjson::Value &data = itr->value["data"];
+        field.count                  = static_cast<int>(data.Size());
+        if (field.isIndex)
+        {
+            unsigned short *indices =
+                model->mArena.allocateArray<unsigned short>(data.Size(), kModelCacheAlignment);
+            for (rapidjson::SizeType i = 0; i < data.Size(); ++i)
+            {
+                indices[i] = static_cast<unsigned short>(data[i].GetInt());
+            }
+            field.data = indices;
+        }
+        else
+        {
+            float *floats = model->mArena.allocateArray<float>(data.Size(), kModelCacheAlignment);
+            for (rapidjson::SizeType i = 0; i < data.Size(); ++i)
+            {
+                floats[i] = data[i].GetFloat();
+            }
+            field.data = floats;
+        }
+
+        model->fields.emplace_back(std::move(field));
+    }
+
+    return true;
+}
+
+bool ModelCache::mapCache(const std::string &cachePath, ModelData *model)
+{
+    if (!model->mCache.open(cachePath))
+    {
+        return false;
+    }
+    if (!readCache(model->mCache.data(), model->mCache.size(), model))
+    {
+        model->mCache.close();
+        return false;
+    }
+    return true;
+}
+
+bool ModelCache::readCache(const char *cache, size_t size, ModelData *model)
+{
+    ModelCacheHeader header;
+    if (!readHeader(cache, size, &header))
+    {
+        return false;
+    }
+
+    uint64_t tablesSize = sizeof(ModelCacheHeader) +
+                          static_cast<uint64_t>(header.textureCount) * sizeof(ModelCacheTexture) +
+                          static_cast<uint64_t>(header.fieldCount) * sizeof(ModelCacheField);
+    if (tablesSize > size)
+    {
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::string>> textures(header.textureCount);
+    const char *entry = cache + sizeof(ModelCacheHeader);
+    for (auto &texture : textures)
+    {
+        ModelCacheTexture textureEntry;
+        memcpy(&textureEntry, entry, sizeof(textureEntry));
+        entry += sizeof(textureEntry);
+        if (!readString(cache, size, textureEntry.name, &texture.first) ||
+            !readString(cache, size, textureEntry.image, &texture.second))
+        {
+            return false;
+        }
+    }
+
+    std::vector<ModelField> fields(header.fieldCount);
+    for (auto &field : fields)
+    {
+        ModelCacheField fieldEntry;
+        memcpy(&fieldEntry, entry, sizeof(fieldEntry));
+        entry += sizeof(fieldEntry);
+        if (fieldEntry.type >= MODELCACHEFIELDMAX ||
+            fieldEntry.dataOffset % kModelCacheAlignment != 0 ||
+            fieldEntry.dataOffset + fieldEntry.count * getFieldTypeSize(fieldEntry.type) > size ||
+            !readString(cache, size, fieldEntry.name, &field.name))
+        {
+            return false;
+        }
+
+        field.numComponents = static_cast<int>(fieldEntry.numComponents);
+        field.isIndex       = fieldEntry.type == MODELCACHEFIELDUINT16;
+        field.count         = static_cast<int>(fieldEntry.count);
+        field.data          = cache + fieldEntry.dataOffset;
+    }
+
+    model->textures = std::move(textures);
+    model->fields   = std::move(fields);
+    model->mArena.reset();
+    model->fromCache = true;
+    return true;
+}
+
+std::string ModelCache::serialize(const ModelData &model,
+                                  uint64_t sourceSize,
+                                  int64_t sourceTime,
+                                  uint64_t sourceHash)
+{
+    size_t stringsBase = sizeof(ModelCacheHeader) +
+                         model.textures.size() * sizeof(ModelCacheTexture) +
+                         model.fields.size() * sizeof(ModelCacheField);
+
+    std::string strings;
+    std::vector<ModelCacheTexture> textureEntries;
+    for (const auto &texture : model.textures)
+    {
+        ModelCacheTexture entry;
+        entry.name  = appendString(texture.first, &strings, stringsBase);
+        entry.image = appendString(texture.second, &strings, stringsBase);
+        textureEntries.push_back(entry);
+    }
+
+    std::vector<ModelCacheField> fieldEntries;
+    for (const auto &field : model.fields)
+    {
+        ModelCacheField entry;
+        entry.name          = appendString(field.name, &strings, stringsBase);
+        entry.type          = field.isIndex ? MODELCACHEFIELDUINT16 : MODELCACHEFIELDFLOAT32;
+        entry.numComponents = static_cast<uint32_t>(field.numComponents);
+        entry.count         = static_cast<uint32_t>(field.count);
+        entry.reserved      = 0;
+        entry.dataOffset    = 0;
+        fieldEntries.push_back(entry);
+    }
+
+    size_t dataOffset = alignUp(stringsBase + strings.size());
+    for (auto &entry : fieldEntries)
+    {
+        entry.dataOffset = dataOffset;
+        dataOffset       = alignUp(dataOffset + entry.count * getFieldTypeSize(entry.type));
+    }
+
+    std::string cache(dataOffset, '\0');
+
+    ModelCacheHeader header;
+    memcpy(header.magic, kModelCacheMagic, sizeof(kModelCacheMagic));
+    header.version      = kModelCacheVersion;
+    header.fileSize     = cache.size();
+    header.sourceSize   = sourceSize;
+    header.sourceTime   = sourceTime;
+    header.sourceHash   = sourceHash;
+    header.textureCount = static_cast<uint32_t>(textureEntries.size());
+    header.fieldCount   = static_cast<uint32_t>(fieldEntries.size());
+
+    char *out = &cache[0];
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    if (!textureEntries.empty())
+    {
+        memcpy(out, textureEntries.data(), textureEntries.size() * sizeof(ModelCacheTexture));
+        out += textureEntries.size() * sizeof(ModelCacheTexture);
+    }
+    if (!fieldEntries.empty())
+    {
+        memcpy(out, fieldEntries.data(), fieldEntries.size() * sizeof(ModelCacheField));
+        out += fieldEntries.size() * sizeof(ModelCacheField);
+    }
+    memcpy(out, strings.data(), strings.size());
+
+    for (size_t i = 0; i < fieldEntries.size(); ++i)
+    {
+        memcpy(&cache[fieldEntries[i].dataOffset], model.fields[i].data,
+               fieldEntries[i].count * getFieldTypeSize(fieldEntries[i].type));
+    }
+
+    return cache;
+}
@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ModelCache.h: Define the binary cache of model files.
+//
+// Model files are JSON with one number per vertex component, and parsing them dominates start up.
+// The first load converts each model into a binary container that later loads map directly:
+//
+//   ModelCacheHeader
+//   ModelCacheTexture[textureCount]
+//   ModelCacheField[fieldCount]
+//   string bytes
+//   field data, each array 16-byte aligned: float32 for vertex fields, uint16 for indices
+//
+// The header records the size, modification time and hash of the JSON it was built from. A cache
+// whose size and time don't match is only reused if the hash still matches, otherwise the model
+// is parsed from JSON again and the cache rebuilt.
+
+#pragma once
+#ifndef MODELCACHE_H
+#define MODELCACHE_H 1
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Arena.h"
+#include "FileSystem.h"
+
+constexpr uint32_t kModelCacheVersion = 1;
+constexpr size_t kModelCacheAlignment = 16;
+
+enum MODELCACHEFIELDTYPE : uint32_t
+{
+    MODELCACHEFIELDFLOAT32,
+    MODELCACHEFIELDUINT16,
+    MODELCACHEFIELDMAX
+};
+
+struct ModelCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    uint32_t textureCount;
+    uint32_t fieldCount;
+};
+
+struct ModelCacheString
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct ModelCacheTexture
+{
+    ModelCacheString name;
+    ModelCacheString image;
+};
+
+struct ModelCacheField
+{
+    ModelCacheString name;
+    uint32_t type;
+    uint32_t numComponents;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t dataOffset;
+};
+
+// One vertex or index array of a model. data points to count floats, or count indices if isIndex.
+struct ModelField
+{
+    std::string name;
+    int numComponents;
+    bool isIndex;
+    int count;
+    const void *data;
+};
+
+// Textures and vertex data of a model. The field data either points into the mapped cache or into
+// arrays parsed from JSON, and stays valid as long as the ModelData.
+class ModelData
+{
+  public:
+    ModelData() : fromCache(false), mArena(0) {}
+    ModelData(const ModelData &) = delete;
+    ModelData &operator=(const ModelData &) = delete;
+
+    // Texture name and image file pairs, in the order of the model file.
+    std::vector<std::pair<std::string, std::string>> textures;
+    std::vector<ModelField> fields;
+    bool fromCache;
+
+  private:
+    friend class ModelCache;
+
+    MappedFile mCache;
+    // Field data of models parsed from JSON. It is reserved up front, so chunks are sized to fit.
+    BumpArena mArena;
+};
+
+class ModelCache
+{
+  public:
+    // Load the model file at sourcePath through the cache at cachePath, rebuilding the cache when
+    // it is missing or stale.
+    static bool load(const std::string &sourcePath,
+                     const std::string &cachePath,
+                     ModelData *model);
+
+  private:
+    // Parse in situ, so text is overwritten.
+    static bool parseJson(char *text, ModelData *model);
+    static bool mapCache(const std::string &cachePath, ModelData *model);
+    static bool readCache(const char *cache, size_t size, ModelData *model);
+    static std::string serialize(const ModelData &model,
+                                 uint64_t sourceSize,
+                                 int64_t sourceTime,
+                                 uint64_t sourceHash);
+};
+
+#endif  // !MODELCACHE_H
@@ -7,18 +7,39 @@
 
 #include "Program.h"
 
-#include <fstream>
+#include <iostream>
 
 void Program::loadProgram()
 {
-    std::ifstream VertexShaderStream(mVId, std::ios::in);
-    VertexShaderCode = std::string((std::istreambuf_iterator<char>(VertexShaderStream)),
-                                   std::istreambuf_iterator<char>());
-    VertexShaderStream.close();
+    if (mLoaded)
+    {
+        return;
+    }
 
-    // Read the Fragment Shader code from the file
-    std::ifstream FragmentShaderStream(mFId, std::ios::in);
-    FragmentShaderCode = std::string((std::istreambuf_iterator<char>(FragmentShaderStream)),
-                                     std::istreambuf_iterator<char>());
-    FragmentShaderStream.close();
+    mVertexSource   = mShaderCache->loadSource(mVId);
+    mFragmentSource = mShaderCache->loadSource(mFId);
+    if (mVertexSource == nullptr || mFragmentSource == nullptr)
+    {
+        std::cerr << "Failed to read shaders " << mVId << " and " << mFId << std::endl;
+    }
+
+    mLoaded = true;
+}
+
+bool Program::getShaders(bool enableAlphaBlending,
+                         const std::string &alpha,
+                         const ShaderCache::Compiler &vertexCompiler,
+                         const ShaderCache::Compiler &fragmentCompiler,
+                         std::string *vertexShader,
+                         std::string *fragmentShader)
+{
+    loadProgram();
+    if (mVertexSource == nullptr || mFragmentSource == nullptr)
+    {
+        return false;
+    }
+
+    return mShaderCache->getShader(*mVertexSource, "VS", nullptr, vertexCompiler, vertexShader) &&
+           mShaderCache->getShader(*mFragmentSource, "PS", enableAlphaBlending ? &alpha : nullptr,
+                                   fragmentCompiler, fragmentShader);
 }
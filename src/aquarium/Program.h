@@ -10,28 +10,52 @@
 
 #include <string>
 
+#include "ShaderCache.h"
+
 enum UNIFORMNAME : short;
 
 class Program
 {
   public:
-    Program(){}
-    Program(const std::string &mVertexShader, const std::string &fragmentShader)
-        : mVId(mVertexShader), mFId(fragmentShader)
+    Program()
+        : mShaderCache(nullptr), mVertexSource(nullptr), mFragmentSource(nullptr), mLoaded(false)
+    {
+    }
+    Program(ShaderCache *shaderCache,
+            const std::string &mVertexShader,
+            const std::string &fragmentShader)
+        : mVId(mVertexShader),
+          mFId(fragmentShader),
+          mShaderCache(shaderCache),
+          mVertexSource(nullptr),
+          mFragmentSource(nullptr),
+          mLoaded(false)
     {
     }
     virtual ~Program() {}
     virtual void setProgram() {}
     virtual void compileProgram(bool enableAlphaBlending, const std::string &alpha) = 0;
+    // Read the shader sources. compileProgram() does it if it hasn't been done, but the loader
+    // calls it ahead on a worker thread. Programs sharing a shader share its source.
+    void loadProgram();
 
   protected:
-    void loadProgram();
+    // The compiled vertex and fragment shader, from the shader cache or compiled by compiler.
+    // The fragment shader has its alpha replaced if enableAlphaBlending is set.
+    bool getShaders(bool enableAlphaBlending,
+                    const std::string &alpha,
+                    const ShaderCache::Compiler &vertexCompiler,
+                    const ShaderCache::Compiler &fragmentCompiler,
+                    std::string *vertexShader,
+                    std::string *fragmentShader);
 
     std::string mVId;
     std::string mFId;
 
-    std::string VertexShaderCode;
-    std::string FragmentShaderCode;
+    ShaderCache *mShaderCache;
+    const ShaderSource *mVertexSource;
+    const ShaderSource *mFragmentSource;
+    bool mLoaded;
 };
 
 #endif // !PROGRAM_H
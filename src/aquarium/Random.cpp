@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Random.cpp: Implement batched generation of counter-based random numbers.
+
+#include "Random.h"
+
+#include "RandomKernel.h"
+
+void CounterRandom::fill(uint64_t firstIndex,
+                         int count,
+                         uint32_t firstSlot,
+                         int slotCount,
+                         float *const *outs,
+                         SIMDLEVEL level) const
+{
+    if (count <= 0 || slotCount <= 0)
+    {
+        return;
+    }
+
+    // Slots that share a Philox block are generated by one pass over the indices.
+    uint32_t lastSlot = firstSlot + slotCount - 1;
+    for (uint32_t block = firstSlot >> 2; block <= lastSlot >> 2; ++block)
+    {
+        float *blockOuts[4] = {nullptr, nullptr, nullptr, nullptr};
+        for (uint32_t word = 0; word < 4; ++word)
+        {
+            uint32_t slot = block * 4 + word;
+            if (slot >= firstSlot && slot <= lastSlot)
+            {
+                blockOuts[word] = outs[slot - firstSlot];
+            }
+        }
+
+        switch (level)
+        {
+#ifdef AQUARIUM_SIMD_X86
+            case SIMDLEVELAVX2:
+                fillPhiloxBlockAVX2(firstIndex, count, block, mKey, blockOuts);
+                break;
+            case SIMDLEVELSSE2:
+                fillPhiloxBlockSSE2(firstIndex, count, block, mKey, blockOuts);
+                break;
+#endif
+            default:
+                fillPhiloxBlockScalar(firstIndex, count, block, mKey, blockOuts);
+                break;
+        }
+    }
+}
+
+void fillPhiloxBlockScalar(uint64_t firstIndex,
+                           int count,
+                           uint32_t block,
+                           const uint32_t key[2],
+                           float *const outs[4])
+{
+    for (int i = 0; i < count; ++i)
+    {
+        uint64_t index      = firstIndex + i;
+        uint32_t counter[4] = {static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32),
+                               block, 0};
+        uint32_t bits[4];
+        philox::generate(counter, key, bits);
+        for (int word = 0; word < 4; ++word)
+        {
+            if (outs[word] != nullptr)
+            {
+                outs[word][i] = philox::toUnitFloat(bits[word]);
+            }
+        }
+    }
+}
+
+#ifdef AQUARIUM_SIMD_X86
+void fillPhiloxBlockSSE2(uint64_t firstIndex,
+                         int count,
+                         uint32_t block,
+                         const uint32_t key[2],
+                         float *const outs[4])
+{
+    fillPhiloxBlockSIMD<simd::SSE2Ops>(firstIndex, count, block, key, outs);
+}
+#endif
@@ -0,0 +1,164 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Random.h: Define the random number generators of the aquarium.
+//
+// CounterRandom is a counter-based generator: the value for (index, slot) is a pure function of
+// its inputs, computed by the Philox4x32-10 block cipher (Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3"). Any value costs O(1) and ranges of values can be generated in
+// any order, on any thread and several at a time with SIMD.
+//
+// LegacyRandomStream reproduces the LCG sequence that matrix::pseudoRandom() used to return, so
+// that results can still be compared against older builds.
+
+#pragma once
+#ifndef RANDOM_H
+#define RANDOM_H 1
+
+#include <cstdint>
+
+#include "SIMD.h"
+
+namespace philox {
+
+constexpr uint32_t kMultiplier0 = 0xD2511F53;
+constexpr uint32_t kMultiplier1 = 0xCD9E8D57;
+constexpr uint32_t kWeyl0       = 0x9E3779B9;
+constexpr uint32_t kWeyl1       = 0xBB67AE85;
+constexpr int kRounds           = 10;
+
+inline void mulHiLo(uint32_t a, uint32_t b, uint32_t *hi, uint32_t *lo)
+{
+    uint64_t product = static_cast<uint64_t>(a) * b;
+    *hi              = static_cast<uint32_t>(product >> 32);
+    *lo              = static_cast<uint32_t>(product);
+}
+
+// Philox4x32-10 of counter with key, written to out.
+inline void generate(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4])
+{
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < kRounds; ++round)
+    {
+        uint32_t hi0, lo0, hi1, lo1;
+        mulHiLo(kMultiplier0, c0, &hi0, &lo0);
+        mulHiLo(kMultiplier1, c2, &hi1, &lo1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += kWeyl0;
+        k1 += kWeyl1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+// Uniform float in [0, 1) from the top 24 bits, so that every value is exactly representable.
+inline float toUnitFloat(uint32_t bits)
+{
+    return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+}  // namespace philox
+
+class CounterRandom
+{
+  public:
+    explicit CounterRandom(uint32_t seed = 0) : mKey{seed, 0} {}
+
+    // Random bits for (index, slot). Slots come in blocks of four that share one Philox call, so
+    // generating neighboring slots together is cheaper.
+    uint32_t getBits(uint64_t index, uint32_t slot) const
+    {
+        uint32_t counter[4] = {static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32),
+                               slot >> 2, 0};
+        uint32_t out[4];
+        philox::generate(counter, mKey, out);
+        return out[slot & 3];
+    }
+
+    // Uniform value in [0, 1) for (index, slot).
+    float getFloat(uint64_t index, uint32_t slot) const
+    {
+        return philox::toUnitFloat(getBits(index, slot));
+    }
+
+    // outs[s][i] = getFloat(firstIndex + i, firstSlot + s) for every slot s in [0, slotCount) and
+    // i in [0, count). The result is the same at every SIMD level.
+    void fill(uint64_t firstIndex,
+              int count,
+              uint32_t firstSlot,
+              int slotCount,
+              float *const *outs,
+              SIMDLEVEL level = getSupportedSIMDLevel()) const;
+
+  private:
+    uint32_t mKey[2];
+};
+
+// Kernels behind CounterRandom::fill. outs has one entry per word of the Philox block, nullptr for
+// words that aren't needed.
+void fillPhiloxBlockScalar(uint64_t firstIndex,
+                           int count,
+                           uint32_t block,
+                           const uint32_t key[2],
+                           float *const outs[4]);
+#ifdef AQUARIUM_SIMD_X86
+void fillPhiloxBlockSSE2(uint64_t firstIndex,
+                         int count,
+                         uint32_t block,
+                         const uint32_t key[2],
+                         float *const outs[4]);
+void fillPhiloxBlockAVX2(uint64_t firstIndex,
+                         int count,
+                         uint32_t block,
+                         const uint32_t key[2],
+                         float *const outs[4]);
+#endif
+
+// The sequence matrix::pseudoRandom() returned after matrix::resetPseudoRandom(), starting at any
+// position. Streams don't share state, so several threads can each generate their own part.
+class LegacyRandomStream
+{
+  public:
+    explicit LegacyRandomStream(long long position) { seek(position); }
+
+    // Jump to the given position by composing the LCG step with itself, in O(log position).
+    void seek(long long position)
+    {
+        // The sequence starts from seed 0, so only the additive part of the composition matters.
+        uint32_t mul    = kMultiplier;
+        uint32_t add    = 1;
+        uint32_t result = 0;
+        for (; position > 0; position >>= 1)
+        {
+            if (position & 1)
+            {
+                result = result * mul + add;
+            }
+            add = add * mul + add;
+            mul = mul * mul;
+        }
+        mSeed = result;
+    }
+
+    double next()
+    {
+        mSeed = (kMultiplier * mSeed + 1) % kRange;
+        return static_cast<double>(mSeed) / static_cast<double>(kRange);
+    }
+
+  private:
+    static constexpr long long kMultiplier = 134775813;
+    static constexpr long long kRange      = 4294967296;
+
+    long long mSeed;
+};
+
+#endif  // !RANDOM_H
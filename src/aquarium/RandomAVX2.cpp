@@ -0,0 +1,24 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// RandomAVX2.cpp: Instantiate the Philox kernel for AVX2. Only called after
+// getSupportedSIMDLevel() reported AVX2.
+
+#include "RandomKernel.h"
+
+#ifdef AQUARIUM_SIMD_X86
+#ifndef __AVX2__
+#error "RandomAVX2.cpp must be built with AVX2 enabled."
+#endif
+
+void fillPhiloxBlockAVX2(uint64_t firstIndex,
+                         int count,
+                         uint32_t block,
+                         const uint32_t key[2],
+                         float *const outs[4])
+{
+    fillPhiloxBlockSIMD<simd::AVX2Ops>(firstIndex, count, block, key, outs);
+}
+#endif
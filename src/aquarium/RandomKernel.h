@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// RandomKernel.h: Define the vectorized Philox kernel behind CounterRandom::fill. Only the
+// per-instruction-set translation units include this header.
+
+#pragma once
+#ifndef RANDOMKERNEL_H
+#define RANDOMKERNEL_H 1
+
+#include "Random.h"
+#include "SIMDMath.h"
+
+// Same rounds as philox::generate, with one counter per lane.
+template <typename Ops>
+void fillPhiloxBlockSIMD(uint64_t firstIndex,
+                         int count,
+                         uint32_t block,
+                         const uint32_t key[2],
+                         float *const outs[4])
+{
+    typedef typename Ops::Int Int;
+    constexpr int kWidth = Ops::kWidth;
+
+    uint32_t indexLo[kWidth];
+    uint32_t indexHi[kWidth];
+    float partial[kWidth];
+
+    for (int first = 0; first < count; first += kWidth)
+    {
+        for (int i = 0; i < kWidth; ++i)
+        {
+            uint64_t index = firstIndex + first + i;
+            indexLo[i]     = static_cast<uint32_t>(index);
+            indexHi[i]     = static_cast<uint32_t>(index >> 32);
+        }
+
+        Int c[4] = {Ops::loadInt(indexLo), Ops::loadInt(indexHi), Ops::set1Int(block),
+                    Ops::set1Int(0)};
+        uint32_t k0 = key[0];
+        uint32_t k1 = key[1];
+        for (int round = 0; round < philox::kRounds; ++round)
+        {
+            Int hi0, lo0, hi1, lo1;
+            Ops::mulHiLo(c[0], philox::kMultiplier0, &hi0, &lo0);
+            Ops::mulHiLo(c[2], philox::kMultiplier1, &hi1, &lo1);
+            c[0] = Ops::xorInt(Ops::xorInt(hi1, c[1]), Ops::set1Int(k0));
+            c[1] = lo1;
+            c[2] = Ops::xorInt(Ops::xorInt(hi0, c[3]), Ops::set1Int(k1));
+            c[3] = lo0;
+            k0 += philox::kWeyl0;
+            k1 += philox::kWeyl1;
+        }
+
+        int laneCount = count - first < kWidth ? count - first : kWidth;
+        for (int word = 0; word < 4; ++word)
+        {
+            if (outs[word] == nullptr)
+            {
+                continue;
+            }
+            if (laneCount == kWidth)
+            {
+                Ops::store(outs[word] + first, Ops::toUnitFloat(c[word]));
+            }
+            else
+            {
+                Ops::store(partial, Ops::toUnitFloat(c[word]));
+                for (int i = 0; i < laneCount; ++i)
+                {
+                    outs[word][first + i] = partial[i];
+                }
+            }
+        }
+    }
+}
+
+#endif  // !RANDOMKERNEL_H
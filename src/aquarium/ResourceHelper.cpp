@@ -23,6 +23,7 @@ const std::string slash = "/";
 
 static const char *shaderFolder   = "src/aquarium/shaders";
 static const char *resourceFolder = "src/aquarium/assets";
+static const char *cacheFolder    = "src/aquarium/cache";
 
 const std::vector<std::string> skyBoxUrls = {
     "GlobeOuter_EM_positive_x.jpg", "GlobeOuter_EM_negative_x.jpg", "GlobeOuter_EM_positive_y.jpg",
@@ -66,6 +67,10 @@ ResourceHelper::ResourceHelper(const std::string &mBackendName,
     programStream << mPath << shaderFolder << slash;
     mProgramPath = programStream.str();
 
+    std::ostringstream cacheStream;
+    cacheStream << mPath << cacheFolder << slash;
+    mCachePath = cacheStream.str();
+
     std::ostringstream fishBehaviorStream;
     fishBehaviorStream << mPath << "FishBehavior.json";
     mFishBehaviorPath = fishBehaviorStream.str();
@@ -102,6 +107,11 @@ ResourceHelper::ResourceHelper(const std::string &mBackendName,
             mBackendTypeStr = "D3D12";
             break;
         }
+        case BACKENDTYPE::BACKENDTYPENULL:
+        {
+            mBackendTypeStr = "Null";
+            break;
+        }
         default:
         {
             std::cerr << "Backend type can not reached." << std::endl;
@@ -127,6 +137,26 @@ std::string ResourceHelper::getModelPath(const std::string &modelName) const
     return modelStream.str();
 }
 
+std::string ResourceHelper::getModelCachePath(const std::string &modelName) const
+{
+    std::ostringstream modelCacheStream;
+    modelCacheStream << mCachePath << modelName << ".bin";
+    return modelCacheStream.str();
+}
+
+std::string ResourceHelper::getTextureCachePath(const std::string &textureName,
+                                                TEXTURECOMPRESSION compression) const
+{
+    std::ostringstream textureCacheStream;
+    textureCacheStream << mCachePath << textureName;
+    if (compression != TEXTURECOMPRESSIONNONE)
+    {
+        textureCacheStream << "." << getTextureCompressionName(compression);
+    }
+    textureCacheStream << ".tex";
+    return textureCacheStream.str();
+}
+
 const std::string &ResourceHelper::getProgramPath() const
 {
     return mProgramPath;
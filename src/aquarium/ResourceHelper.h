@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "Aquarium.h"
+#include "BlockCompression.h"
 
 class ResourceHelper
 {
@@ -21,6 +22,12 @@ class ResourceHelper
     const std::string &getPropPlacementPath() const { return mPropPlacementPath; }
     const std::string &getImagePath() const { return mImagePath; }
     std::string getModelPath(const std::string &modelName) const;
+    // Generated files such as preprocessed models live in the cache folder.
+    const std::string &getCachePath() const { return mCachePath; }
+    std::string getModelCachePath(const std::string &modelName) const;
+    // Each compression mode caches its textures separately.
+    std::string getTextureCachePath(const std::string &textureName,
+                                    TEXTURECOMPRESSION compression = TEXTURECOMPRESSIONNONE) const;
     const std::string &getProgramPath() const;
     const std::string &getFishBehaviorPath() const { return mFishBehaviorPath; }
     const std::string &getBackendName() const { return mBackendName; }
@@ -35,6 +42,7 @@ class ResourceHelper
     std::string mProgramPath;
     std::string mPropPlacementPath;
     std::string mModelPath;
+    std::string mCachePath;
     std::string mFishBehaviorPath;
 
     std::string mBackendName;
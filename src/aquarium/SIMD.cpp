@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// SIMD.cpp: Implement runtime detection of instruction set levels.
+
+#include "SIMD.h"
+
+#if defined(AQUARIUM_SIMD_X86) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+#ifdef AQUARIUM_SIMD_X86
+bool isAVX2Supported()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    // AVX2 needs the OS to save the YMM state as well.
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx     = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+}  // namespace
+
+SIMDLEVEL getSupportedSIMDLevel()
+{
+#ifdef AQUARIUM_SIMD_X86
+    // SSE2 is part of the x86-64 baseline and of every x86 target the aquarium is built for.
+    static const SIMDLEVEL level = isAVX2Supported() ? SIMDLEVELAVX2 : SIMDLEVELSSE2;
+    return level;
+#else
+    return SIMDLEVELSCALAR;
+#endif
+}
+
+const char *getSIMDLevelName(SIMDLEVEL level)
+{
+    switch (level)
+    {
+        case SIMDLEVELSCALAR:
+            return "scalar";
+        case SIMDLEVELSSE2:
+            return "sse2";
+        case SIMDLEVELAVX2:
+            return "avx2";
+        default:
+            return "unknown";
+    }
+}
+
+bool parseSIMDLevel(const std::string &name, SIMDLEVEL *level)
+{
+    for (int i = 0; i < SIMDLEVELMAX; ++i)
+    {
+        if (name == getSIMDLevelName(static_cast<SIMDLEVEL>(i)))
+        {
+            *level = static_cast<SIMDLEVEL>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,35 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// SIMD.h: Define instruction set levels used by the CPU kernels and runtime detection of them.
+
+#pragma once
+#ifndef SIMD_H
+#define SIMD_H 1
+
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AQUARIUM_SIMD_X86 1
+#endif
+// NEON is part of the AArch64 baseline, so it needs no runtime detection.
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define AQUARIUM_SIMD_NEON 1
+#endif
+
+enum SIMDLEVEL : short
+{
+    SIMDLEVELSCALAR,
+    SIMDLEVELSSE2,
+    SIMDLEVELAVX2,
+    SIMDLEVELMAX
+};
+
+// Highest level supported by both the build and the running CPU.
+SIMDLEVEL getSupportedSIMDLevel();
+const char *getSIMDLevelName(SIMDLEVEL level);
+bool parseSIMDLevel(const std::string &name, SIMDLEVEL *level);
+
+#endif  // !SIMD_H
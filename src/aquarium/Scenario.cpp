@@ -0,0 +1,330 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Scenario.cpp: Implement the frame-scripted scenario of the aquarium.
+
+#include "Scenario.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "rapidjson/document.h"
+#include "rapidjson/istreamwrapper.h"
+
+namespace {
+
+bool readVector(const rapidjson::Value &value, float *vector)
+{
+    if (!value.IsArray() || value.Size() != 3)
+    {
+        return false;
+    }
+    for (rapidjson::SizeType i = 0; i < 3; ++i)
+    {
+        if (!value[i].IsNumber())
+        {
+            return false;
+        }
+        vector[i] = static_cast<float>(value[i].GetDouble());
+    }
+    return true;
+}
+
+bool readPhase(const rapidjson::Value &value, double fixedTimeStep, ScenarioPhase *phase)
+{
+    if (!value.IsObject())
+    {
+        return false;
+    }
+
+    phase->frameCount     = 0;
+    phase->fishCountBegin = -1;
+    phase->fishCountEnd   = -1;
+    phase->fishDelta      = 0;
+    phase->fixedTimeStep  = fixedTimeStep;
+    if (value.HasMember("name") && value["name"].IsString())
+    {
+        phase->name = value["name"].GetString();
+    }
+    if (value.HasMember("frames"))
+    {
+        if (!value["frames"].IsInt() || value["frames"].GetInt() < 0)
+        {
+            return false;
+        }
+        phase->frameCount = value["frames"].GetInt();
+    }
+    if (value.HasMember("fishCount"))
+    {
+        // A count, or the first and last count of a ramp.
+        const rapidjson::Value &fishCount = value["fishCount"];
+        if (fishCount.IsInt())
+        {
+            phase->fishCountBegin = fishCount.GetInt();
+        }
+        else if (fishCount.IsArray() && fishCount.Size() == 2 && fishCount[0u].IsInt() &&
+                 fishCount[1u].IsInt() && phase->frameCount > 0)
+        {
+            phase->fishCountBegin = fishCount[0u].GetInt();
+            phase->fishCountEnd   = fishCount[1u].GetInt();
+        }
+        else
+        {
+            return false;
+        }
+        if (phase->fishCountBegin < 0 || (fishCount.IsArray() && phase->fishCountEnd < 0))
+        {
+            return false;
+        }
+    }
+    if (value.HasMember("addFish"))
+    {
+        if (!value["addFish"].IsInt())
+        {
+            return false;
+        }
+        phase->fishDelta = value["addFish"].GetInt();
+    }
+    if (value.HasMember("fixedTimeStep"))
+    {
+        if (!value["fixedTimeStep"].IsNumber() || value["fixedTimeStep"].GetDouble() < 0.0)
+        {
+            return false;
+        }
+        phase->fixedTimeStep = value["fixedTimeStep"].GetDouble();
+    }
+    if (value.HasMember("camera"))
+    {
+        const rapidjson::Value &camera = value["camera"];
+        if (!camera.IsArray())
+        {
+            return false;
+        }
+        for (rapidjson::SizeType i = 0; i < camera.Size(); ++i)
+        {
+            CameraKey key;
+            if (!camera[i].IsObject() || !camera[i].HasMember("frame") ||
+                !camera[i]["frame"].IsInt() || !camera[i].HasMember("eye") ||
+                !readVector(camera[i]["eye"], key.eye) || !camera[i].HasMember("target") ||
+                !readVector(camera[i]["target"], key.target))
+            {
+                return false;
+            }
+            key.frame = camera[i]["frame"].GetInt();
+            phase->cameraPath.push_back(key);
+        }
+        std::stable_sort(phase->cameraPath.begin(), phase->cameraPath.end(),
+                         [](const CameraKey &a, const CameraKey &b) { return a.frame < b.frame; });
+    }
+    return true;
+}
+
+// A behavior changes the fish count after frame frames of the previous one, or of the start for
+// the first one, and the count then holds until the next behavior. Each count is a phase.
+bool readBehaviors(const rapidjson::Value &behaviors, std::vector<ScenarioPhase> *phases)
+{
+    if (!behaviors.IsArray())
+    {
+        return false;
+    }
+
+    ScenarioPhase phase = {"initial", 0, -1, -1, 0, 0.0, {}};
+    for (rapidjson::SizeType i = 0; i < behaviors.Size(); ++i)
+    {
+        const rapidjson::Value &behavior = behaviors[i];
+        if (!behavior.IsObject() || !behavior.HasMember("frame") || !behavior["frame"].IsInt() ||
+            !behavior.HasMember("op") || !behavior["op"].IsString() ||
+            !behavior.HasMember("count") || !behavior["count"].IsInt())
+        {
+            return false;
+        }
+
+        phase.frameCount = behavior["frame"].GetInt() + (i > 0 ? 1 : 0);
+        if (phase.frameCount > 0)
+        {
+            phases->push_back(phase);
+        }
+
+        int count       = behavior["count"].GetInt();
+        phase.name      = "behavior" + std::to_string(i);
+        phase.fishDelta = std::string(behavior["op"].GetString()) == "+" ? count : -count;
+    }
+    phase.frameCount = 0;
+    phases->push_back(phase);
+    return true;
+}
+
+}  // namespace
+
+Scenario::Scenario() : mPhases(), mResults(), mPhase(-1), mPhaseFrame(-1), mMSAACount(0) {}
+
+bool Scenario::load(const std::string &path)
+{
+    std::ifstream stream(path, std::ios::in);
+    if (!stream)
+    {
+        std::cerr << "Failed to open scenario " << path << "." << std::endl;
+        return false;
+    }
+    rapidjson::IStreamWrapper is(stream);
+    rapidjson::Document document;
+    document.ParseStream(is);
+
+    bool valid = !document.HasParseError() && document.IsObject() &&
+                 (document.HasMember("phases") || document.HasMember("behaviors"));
+    double fixedTimeStep = 0.0;
+    if (valid && document.HasMember("fixedTimeStep"))
+    {
+        valid         = document["fixedTimeStep"].IsNumber();
+        fixedTimeStep = valid ? document["fixedTimeStep"].GetDouble() : 0.0;
+    }
+    if (valid && document.HasMember("msaa"))
+    {
+        valid      = document["msaa"].IsInt() && document["msaa"].GetInt() > 0;
+        mMSAACount = valid ? document["msaa"].GetInt() : 0;
+    }
+    if (valid && document.HasMember("alphaBlending"))
+    {
+        valid          = document["alphaBlending"].IsString();
+        mAlphaBlending = valid ? document["alphaBlending"].GetString() : "";
+    }
+    if (valid && document.HasMember("phases"))
+    {
+        const rapidjson::Value &phases = document["phases"];
+        valid                          = phases.IsArray() && phases.Size() > 0;
+        for (rapidjson::SizeType i = 0; valid && i < phases.Size(); ++i)
+        {
+            ScenarioPhase phase;
+            phase.name = "phase" + std::to_string(i);
+            valid      = readPhase(phases[i], fixedTimeStep, &phase);
+            mPhases.push_back(phase);
+        }
+    }
+    else if (valid)
+    {
+        valid = readBehaviors(document["behaviors"], &mPhases);
+    }
+
+    if (!valid)
+    {
+        std::cerr << "Scenario " << path << " isn't valid." << std::endl;
+        mPhases.clear();
+        return false;
+    }
+    return true;
+}
+
+bool Scenario::beginFrame(int *fishCount)
+{
+    if (mPhase >= static_cast<int>(mPhases.size()))
+    {
+        return false;
+    }
+
+    if (mPhase >= 0)
+    {
+        ++mPhaseFrame;
+    }
+    if (mPhase < 0 ||
+        (mPhases[mPhase].frameCount > 0 && mPhaseFrame >= mPhases[mPhase].frameCount))
+    {
+        ++mPhase;
+        mPhaseFrame = 0;
+        if (mPhase >= static_cast<int>(mPhases.size()))
+        {
+            return false;
+        }
+
+        const ScenarioPhase &phase = mPhases[mPhase];
+        int count = phase.fishCountBegin >= 0 ? phase.fishCountBegin : *fishCount;
+        mResults.emplace_back();
+        PhaseResult &result   = mResults.back();
+        result.fishCountBegin = std::max(count + phase.fishDelta, 0);
+        result.updateMs       = 0.0;
+        result.drawMs         = 0.0;
+        result.submitMs       = 0.0;
+    }
+
+    const ScenarioPhase &phase = mPhases[mPhase];
+    PhaseResult &result        = mResults.back();
+    int count                  = result.fishCountBegin;
+    if (phase.fishCountEnd >= 0)
+    {
+        double t = phase.frameCount > 1 ? static_cast<double>(mPhaseFrame) / (phase.frameCount - 1)
+                                        : 1.0;
+        count += static_cast<int>(std::lround((phase.fishCountEnd - count) * t));
+    }
+    result.fishCountEnd = count;
+    *fishCount          = count;
+    return true;
+}
+
+double Scenario::getFixedTimeStep() const
+{
+    return mPhase >= 0 && mPhase < static_cast<int>(mPhases.size())
+               ? mPhases[mPhase].fixedTimeStep
+               : 0.0;
+}
+
+bool Scenario::getCamera(float *eye, float *target) const
+{
+    if (mPhase < 0 || mPhase >= static_cast<int>(mPhases.size()) ||
+        mPhases[mPhase].cameraPath.empty())
+    {
+        return false;
+    }
+
+    // The keys around the frame, clamped to the ends of the path.
+    const std::vector<CameraKey> &path = mPhases[mPhase].cameraPath;
+    auto next = std::upper_bound(path.begin(), path.end(), mPhaseFrame,
+                                 [](int frame, const CameraKey &key) { return frame < key.frame; });
+    const CameraKey &after  = next == path.end() ? path.back() : *next;
+    const CameraKey &before = next == path.begin() ? path.front() : *(next - 1);
+    float t                 = after.frame > before.frame
+                  ? static_cast<float>(mPhaseFrame - before.frame) / (after.frame - before.frame)
+                  : 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        eye[i]    = before.eye[i] + (after.eye[i] - before.eye[i]) * t;
+        target[i] = before.target[i] + (after.target[i] - before.target[i]) * t;
+    }
+    return true;
+}
+
+void Scenario::endFrame(double frameMs, double updateMs, double drawMs, double submitMs)
+{
+    if (mResults.empty())
+    {
+        return;
+    }
+
+    PhaseResult &result = mResults.back();
+    result.frameTimes.record(frameMs);
+    result.updateMs += updateMs;
+    result.drawMs += drawMs;
+    result.submitMs += submitMs;
+}
+
+void Scenario::printResults() const
+{
+    for (size_t i = 0; i < mResults.size(); ++i)
+    {
+        const PhaseResult &result = mResults[i];
+        double frameCount         = std::max<double>(result.frameTimes.getCount(), 1.0);
+        printf(
+            "[RESULT] SCENARIOPHASE:%d,NAME:%s,FRAMES:%llu,FISH_BEGIN:%d,FISH_END:%d,"
+            "FIXED_DT:%.4f,MEAN_MS:%.3f,MEDIAN_MS:%.3f,P99_MS:%.3f,MAX_MS:%.3f,UPDATE_MS:%.3f,"
+            "DRAW_MS:%.3f,SUBMIT_MS:%.3f\n",
+            static_cast<int>(i), mPhases[i].name.c_str(),
+            static_cast<unsigned long long>(result.frameTimes.getCount()), result.fishCountBegin,
+            result.fishCountEnd, mPhases[i].fixedTimeStep, result.frameTimes.getMean(),
+            result.frameTimes.getPercentile(50.0), result.frameTimes.getPercentile(99.0),
+            result.frameTimes.getMax(), result.updateMs / frameCount, result.drawMs / frameCount,
+            result.submitMs / frameCount);
+    }
+}
@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Scenario.h: Define a frame-scripted scenario of the aquarium. A scenario is a list of phases
+// played one after the other, each running for a number of frames with its own fish count, which
+// may ramp from one count to another, its own camera path and its own time step. MSAA and alpha
+// blending are baked into the render targets and pipelines at load, so a scenario sets them once
+// for the whole run. The frame times of each phase are reported separately.
+
+#pragma once
+#ifndef SCENARIO_H
+#define SCENARIO_H 1
+
+#include <string>
+#include <vector>
+
+#include "FrameTimeHistogram.h"
+
+// Eye and target of the camera at a frame of a phase.
+struct CameraKey
+{
+    int frame;
+    float eye[3];
+    float target[3];
+};
+
+struct ScenarioPhase
+{
+    std::string name;
+    // Frames the phase runs for. 0 runs it until the test ends.
+    int frameCount;
+    // Fish count at the first and the last frame of the phase, interpolated in between. -1 keeps
+    // the count of the previous phase. fishDelta is added to the count at the start of the phase.
+    int fishCountBegin;
+    int fishCountEnd;
+    int fishDelta;
+    // Seconds the simulation and the camera advance per frame. 0 follows the wall clock.
+    double fixedTimeStep;
+    // Keys sorted by frame, interpolated linearly. The camera orbits as usual without keys.
+    std::vector<CameraKey> cameraPath;
+};
+
+class Scenario
+{
+  public:
+    Scenario();
+
+    // Read a scenario from a JSON file of phases, or of the {frame, op, count} behaviors of
+    // FishBehavior.json. Returns false if the file can't be read or isn't a scenario.
+    bool load(const std::string &path);
+
+    // MSAA sample count of the run, 0 if the scenario doesn't set it.
+    int getMSAACount() const { return mMSAACount; }
+    // Value of --enable-alpha-blending for the run, empty if the scenario doesn't set it.
+    const std::string &getAlphaBlending() const { return mAlphaBlending; }
+
+    // Whether the scenario ends by itself, that is whether its last phase has a frame count.
+    bool isBounded() const { return !mPhases.empty() && mPhases.back().frameCount > 0; }
+
+    // Move to the next frame and write its fish count to fishCount, which holds the count of the
+    // last frame. Returns false once the last phase has ended.
+    bool beginFrame(int *fishCount);
+    // Whether the current frame is the first one of its phase.
+    bool isPhaseStart() const { return mPhaseFrame == 0; }
+    double getFixedTimeStep() const;
+    // Write eye and target of the current frame if its phase has a camera path.
+    bool getCamera(float *eye, float *target) const;
+    // Times of the current frame in milliseconds, the stages of the frame as in FPSTimer.
+    void endFrame(double frameMs, double updateMs, double drawMs, double submitMs);
+
+    // Print a result line per phase played.
+    void printResults() const;
+
+  private:
+    struct PhaseResult
+    {
+        int fishCountBegin;
+        int fishCountEnd;
+        FrameTimeHistogram frameTimes;
+        double updateMs;
+        double drawMs;
+        double submitMs;
+    };
+
+    std::vector<ScenarioPhase> mPhases;
+    std::vector<PhaseResult> mResults;
+    int mPhase;
+    int mPhaseFrame;
+    int mMSAACount;
+    std::string mAlphaBlending;
+};
+
+#endif  // !SCENARIO_H
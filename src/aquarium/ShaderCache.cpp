@@ -0,0 +1,194 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ShaderCache.cpp: Implement loading shader sources and caching compiled shaders.
+
+#include "ShaderCache.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "FileSystem.h"
+#include "Timer.h"
+
+namespace {
+
+const char kShaderCacheMagic[4] = {'A', 'Q', 'S', 'C'};
+
+}  // namespace
+
+const char ShaderCache::kAlphaToken[] = "diffuseColor.w";
+
+ShaderCache::ShaderCache() : mStatistics()
+{
+}
+
+const ShaderSource *ShaderCache::loadSource(const std::string &path)
+{
+    ShaderSource *source;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::unique_ptr<ShaderSource> &entry = mSources[path];
+        if (entry == nullptr)
+        {
+            entry.reset(new ShaderSource());
+            entry->path  = path;
+            entry->hash  = 0;
+            entry->valid = false;
+        }
+        source = entry.get();
+    }
+
+    // Other threads asking for the same file wait for the first one to read it.
+    std::call_once(source->loaded, [source]() {
+        std::string text;
+        if (!readFile(source->path, &text))
+        {
+            return;
+        }
+        source->hash = hashBytes(text.data(), text.size());
+
+        size_t tokenSize = sizeof(kAlphaToken) - 1;
+        size_t begin     = 0;
+        size_t found;
+        while ((found = text.find(kAlphaToken, begin)) != std::string::npos)
+        {
+            source->segments.push_back(text.substr(begin, found - begin));
+            begin = found + tokenSize;
+        }
+        source->segments.push_back(text.substr(begin));
+        source->valid = true;
+    });
+
+    return source->valid ? source : nullptr;
+}
+
+std::string ShaderCache::expand(const ShaderSource &source, const std::string *alpha)
+{
+    const std::string token(kAlphaToken);
+    const std::string &replacement = alpha != nullptr ? *alpha : token;
+
+    size_t size = 0;
+    for (const std::string &segment : source.segments)
+    {
+        size += segment.size() + replacement.size();
+    }
+
+    std::string code;
+    code.reserve(size);
+    for (size_t i = 0; i < source.segments.size(); ++i)
+    {
+        if (i > 0)
+        {
+            code += replacement;
+        }
+        code += source.segments[i];
+    }
+    return code;
+}
+
+bool ShaderCache::getShader(const ShaderSource &source,
+                            const char *stage,
+                            const std::string *alpha,
+                            const Compiler &compiler,
+                            std::string *binary)
+{
+    auto begin   = timer::now();
+    uint64_t key = getKey(source, stage, alpha);
+
+    auto binaryIt = mBinaries.find(key);
+    if (binaryIt != mBinaries.end())
+    {
+        *binary = binaryIt->second;
+        ++mStatistics.memoryHits;
+    }
+    else
+    {
+        if (loadBinary(key, binary))
+        {
+            ++mStatistics.diskHits;
+        }
+        else
+        {
+            if (!compiler(expand(source, alpha), binary))
+            {
+                return false;
+            }
+            ++mStatistics.compiles;
+            // Failing to write the cache only costs the next start.
+            storeBinary(key, *binary);
+        }
+        mBinaries[key] = *binary;
+    }
+
+    mStatistics.time += timer::getMilliseconds(begin, timer::now());
+    return true;
+}
+
+uint64_t ShaderCache::getKey(const ShaderSource &source,
+                             const char *stage,
+                             const std::string *alpha) const
+{
+    // Fields are separated by NULs, which none of them contain.
+    std::string variant = mConfiguration;
+    variant.push_back('\0');
+    variant += stage;
+    variant.push_back('\0');
+    variant.append(reinterpret_cast<const char *>(&source.hash), sizeof(source.hash));
+    if (alpha != nullptr)
+    {
+        variant.push_back('\0');
+        variant += *alpha;
+    }
+    return hashBytes(variant.data(), variant.size());
+}
+
+std::string ShaderCache::getCachePath(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64 ".shader", key);
+    return mFolder + name;
+}
+
+bool ShaderCache::loadBinary(uint64_t key, std::string *binary) const
+{
+    std::string cache;
+    if (mFolder.empty() || !readFile(getCachePath(key), &cache) ||
+        cache.size() < sizeof(ShaderCacheHeader))
+    {
+        return false;
+    }
+
+    ShaderCacheHeader header;
+    memcpy(&header, cache.data(), sizeof(header));
+    if (memcmp(header.magic, kShaderCacheMagic, sizeof(kShaderCacheMagic)) != 0 ||
+        header.version != kShaderCacheVersion || header.key != key ||
+        header.size != cache.size() - sizeof(header))
+    {
+        return false;
+    }
+
+    binary->assign(cache, sizeof(header), std::string::npos);
+    return true;
+}
+
+bool ShaderCache::storeBinary(uint64_t key, const std::string &binary) const
+{
+    if (mFolder.empty())
+    {
+        return false;
+    }
+
+    ShaderCacheHeader header;
+    memcpy(header.magic, kShaderCacheMagic, sizeof(kShaderCacheMagic));
+    header.version = kShaderCacheVersion;
+    header.key     = key;
+    header.size    = binary.size();
+
+    std::string cache(reinterpret_cast<const char *>(&header), sizeof(header));
+    cache += binary;
+    return writeFileAtomic(getCachePath(key), cache.data(), cache.size());
+}
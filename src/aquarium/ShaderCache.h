@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ShaderCache.h: Define the cache of shader sources and of the shaders compiled from them.
+//
+// Each source file is read once, however many programs share it, and split at the token that
+// alpha blending replaces, so that a variant is put together from the pieces instead of searching
+// the text again. Compiled shaders are kept in memory and in the cache folder:
+//
+//   ShaderCacheHeader
+//   the compiled shader, as the backend produced it
+//
+// A compiled shader is keyed by a hash of its source, its stage, the substituted alpha and the
+// configuration of the backend, that is its name, compiler flags and macros. Changing any of them
+// changes the key, so a cache file is never stale; old ones are just no longer read.
+
+#pragma once
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H 1
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+constexpr uint32_t kShaderCacheVersion = 1;
+
+struct ShaderCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+};
+
+// A shader source split at the alpha token: every segment but the last is followed by one.
+struct ShaderSource
+{
+    std::string path;
+    uint64_t hash;
+    std::vector<std::string> segments;
+    bool valid;
+    std::once_flag loaded;
+};
+
+struct ShaderCacheStatistics
+{
+    int memoryHits;
+    int diskHits;
+    int compiles;
+    // Time spent getting shaders, compiling included, in milliseconds.
+    double time;
+};
+
+class ShaderCache
+{
+  public:
+    // The text that alpha blending variants replace with the alpha of the aquarium.
+    static const char kAlphaToken[];
+
+    // Compile code into binary, false if it doesn't compile.
+    typedef std::function<bool(const std::string &code, std::string *binary)> Compiler;
+
+    ShaderCache();
+    ShaderCache(const ShaderCache &) = delete;
+    ShaderCache &operator=(const ShaderCache &) = delete;
+
+    // Compiled shaders are only kept in memory until a folder is set.
+    void setFolder(const std::string &folder) { mFolder = folder; }
+    // Everything the backend compiles shaders with, e.g. its compiler flags and macros.
+    void setConfiguration(const std::string &configuration) { mConfiguration = configuration; }
+
+    // The source at path, read on the first call. Thread safe. Returns nullptr if the file can't
+    // be read.
+    const ShaderSource *loadSource(const std::string &path);
+
+    // The code of source with the alpha token replaced by alpha, or kept if alpha is nullptr.
+    static std::string expand(const ShaderSource &source, const std::string *alpha);
+
+    // The compiled shader of a variant of source for stage, from memory, from the cache folder,
+    // or compiled by compiler and then stored in both. Programs are compiled on one thread, so
+    // unlike loadSource() this isn't thread safe.
+    bool getShader(const ShaderSource &source,
+                   const char *stage,
+                   const std::string *alpha,
+                   const Compiler &compiler,
+                   std::string *binary);
+
+    uint64_t getKey(const ShaderSource &source, const char *stage, const std::string *alpha) const;
+    std::string getCachePath(uint64_t key) const;
+    const ShaderCacheStatistics &getStatistics() const { return mStatistics; }
+
+  private:
+    bool loadBinary(uint64_t key, std::string *binary) const;
+    bool storeBinary(uint64_t key, const std::string &binary) const;
+
+    std::string mFolder;
+    std::string mConfiguration;
+
+    // Guards mSources.
+    std::mutex mMutex;
+    std::unordered_map<std::string, std::unique_ptr<ShaderSource>> mSources;
+    std::unordered_map<uint64_t, std::string> mBinaries;
+    ShaderCacheStatistics mStatistics;
+};
+
+#endif  // !SHADERCACHE_H
@@ -8,124 +8,178 @@
 #include "Texture.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
 
 #include "AQUARIUM_ASSERT.h"
+#include "FileSystem.h"
 
 #define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include "stb_image.h"
-#include "stb_image_resize.h"
+
+Texture::Texture(const std::string &name, const std::vector<std::string> &urls, bool flip)
+    : mUrls(urls),
+      mWidth(0),
+      mHeight(0),
+      mFlip(flip),
+      mIsCubeMap(true),
+      mDecoded(false),
+      mFromCache(false),
+      mCompression(TEXTURECOMPRESSIONNONE),
+      mName(name),
+      mCacheSource()
+{
+}
 
 Texture::Texture(const std::string &name, const std::string &url, bool flip)
     : mUrls(),
     mWidth(0),
     mHeight(0),
     mFlip(flip),
-    mName(name)
+    mIsCubeMap(false),
+    mDecoded(false),
+    mFromCache(false),
+    mCompression(TEXTURECOMPRESSIONNONE),
+    mName(name),
+    mCacheSource()
 {
     std::string urlpath = url;
     mUrls.push_back(urlpath);
 }
 
+Texture::~Texture() {}
+
+bool Texture::readImages()
+{
+    bool useCache = !mCachePath.empty() && TextureCache::getSourceStatus(mUrls, &mCacheSource);
+    if (useCache && loadCache())
+    {
+        return true;
+    }
+
+    mImageFiles.resize(mUrls.size());
+    for (size_t i = 0; i < mUrls.size(); ++i)
+    {
+        if (!readFile(mUrls[i], &mImageFiles[i]))
+        {
+            std::cerr << "Couldn't open input file " << mUrls[i] << std::endl;
+            return false;
+        }
+    }
+
+    // The images may have been touched without changing.
+    if (useCache)
+    {
+        mCacheSource.hash = TextureCache::hashImages(mImageFiles);
+        if (loadCache())
+        {
+            std::vector<std::string>().swap(mImageFiles);
+        }
+    }
+    return true;
+}
+
 // Force loading 3 channel images to 4 channel by stb becasue Dawn doesn't support 3 channel
 // formats currently. The group is discussing on whether webgpu shoud support 3 channel format.
 // https://github.com/gpuweb/gpuweb/issues/66#issuecomment-410021505
-bool Texture::loadImage(const std::vector<std::string> &urls, std::vector<uint8_t *>* pixels)
+bool Texture::decode()
 {
-    stbi_set_flip_vertically_on_load(mFlip);
-    for (auto filename : urls) {
-        uint8_t *pixel = stbi_load(filename.c_str(), &mWidth, &mHeight, 0, 4);
-        if (pixel == 0)
+    if (mDecoded)
+    {
+        return true;
+    }
+    if (mImageFiles.size() != mUrls.size() && !readImages())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < mImageFiles.size(); ++i)
+    {
+        const std::string &file = mImageFiles[i];
+        int width, height;
+        uint8_t *pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(file.data()),
+                                                static_cast<int>(file.size()), &width, &height,
+                                                0, 4);
+        if (pixels == 0)
+        {
+            std::cerr << "Couldn't decode input file " << mUrls[i] << std::endl;
+            return false;
+        }
+
+        if (i == 0)
+        {
+            mWidth  = width;
+            mHeight = height;
+            mMipChain.allocate(mWidth, mHeight, mIsCubeMap ? 1 : 0,
+                               static_cast<int>(mImageFiles.size()));
+        }
+        else if (width != mWidth || height != mHeight)
         {
-            std::cout << stderr << "Couldn't open input file" << filename << std::endl;
+            std::cerr << "Faces of " << mName << " differ in size" << std::endl;
+            stbi_image_free(pixels);
             return false;
         }
-        pixels->push_back(pixel);
+
+        copyBaseLevel(static_cast<int>(i), pixels);
+        stbi_image_free(pixels);
     }
+    std::vector<std::string>().swap(mImageFiles);
+
+    mDecoded = true;
     return true;
 }
 
-bool Texture::isPowerOf2(int value)
+bool Texture::loadCache()
 {
-    return (value & (value - 1)) == 0;
+    if (!TextureCache::load(mCachePath, mCacheSource, mFlip, mIsCubeMap ? 1 : 0,
+                            static_cast<int>(mUrls.size()), &mMipChain))
+    {
+        return false;
+    }
+    mWidth     = mMipChain.getWidth(0);
+    mHeight    = mMipChain.getHeight(0);
+    mDecoded   = true;
+    mFromCache = true;
+    return true;
 }
 
-// Free image data after upload to gpu
-void Texture::DestoryImageData(std::vector<uint8_t*>& pixelVec)
+// The cache only speeds up later loads, so callers may ignore failing to write it.
+bool Texture::storeCache()
 {
-    for (auto& pixels : pixelVec)
+    if (mCachePath.empty() || mFromCache || !mDecoded || !mMipChain.isGenerated() ||
+        mMipChain.getFormat() != getCompressedFormat())
     {
-        free(pixels);
-        pixels = nullptr;
+        return false;
     }
+    return TextureCache::store(mCachePath, mCacheSource, mFlip, mMipChain);
 }
 
-void Texture::copyPaddingBuffer(unsigned char *dst, unsigned char *src, int width, int height, int kPadding)
+void Texture::finishMipChain()
 {
-    unsigned char *s = src;
-    unsigned char *d = dst;
-    for(int i = 0; i < height; ++i)
+    mMipChain.generate();
+    TEXTUREFORMAT format = getCompressedFormat();
+    if (format != mMipChain.getFormat())
     {
-        memcpy(d, s, width * 4);
-        s += width * 4;
-        d += kPadding * 4;
+        compressMipChains(nullptr, {&mMipChain}, {format});
     }
 }
 
-void Texture::generateMipmap(uint8_t *input_pixels,
-                             int input_w,
-                             int input_h,
-                             int input_stride_in_bytes,
-                             std::vector<uint8_t *> &output_pixels,
-                             int output_w,
-                             int output_h,
-                             int output_stride_in_bytes,
-                             int num_channels,
-                             bool is256padding)
+// stbi_set_flip_vertically_on_load() is global state of stb, so flip while copying to be able to
+// decode on several threads at once.
+void Texture::copyBaseLevel(int layer, const uint8_t *pixels)
 {
-    int mipmapLevel =
-        static_cast<uint32_t>(floor(log2(std::max(output_w, output_h)))) + 1;
-    output_pixels.resize(mipmapLevel);
-    int height      = output_h;
-    int width  = output_w;
-
-    if (!is256padding)
+    size_t rowSize  = static_cast<size_t>(mWidth) * 4;
+    size_t rowPitch = mMipChain.getRowPitch(0);
+    uint8_t *dst    = mMipChain.getPixels(layer, 0);
+    for (int y = 0; y < mHeight; ++y)
     {
-        for (int i = 0; i < mipmapLevel; ++i)
-        {
-            output_pixels[i] = (unsigned char *)malloc(output_w * height * 4 * sizeof(char));
-            stbir_resize_uint8(input_pixels, input_w, input_h, input_stride_in_bytes,
-                               output_pixels[i], width, height, output_stride_in_bytes,
-                               num_channels);
-
-            height >>= 1;
-            width >>= 1;
-            if (height == 0)
-            {
-                height = 1;
-            }
-        }
+        int srcRow = mFlip ? mHeight - 1 - y : y;
+        memcpy(dst + rowPitch * y, pixels + rowSize * srcRow, rowSize);
     }
-    else
-    {
-        uint8_t *pixels = (unsigned char *)malloc(output_w * height * 4 * sizeof(char));
+}
 
-        for (int i = 0; i < mipmapLevel; ++i)
-        {
-            output_pixels[i] = (unsigned char *)malloc(output_w * height * 4 * sizeof(char));
-            stbir_resize_uint8(input_pixels, input_w, input_h, input_stride_in_bytes, pixels, width,
-                               height, output_stride_in_bytes, num_channels);
-            copyPaddingBuffer(output_pixels[i], pixels, width, height, output_w);
-
-            height >>= 1;
-            width >>= 1;
-            if (height == 0)
-            {
-                height = 1;
-            }
-        }
-        free(pixels);
-    }
+bool Texture::isPowerOf2(int value)
+{
+    return (value & (value - 1)) == 0;
 }
@@ -12,42 +12,82 @@
 #include <string>
 #include <vector>
 
+#include "BlockCompression.h"
+#include "MipChain.h"
+#include "TextureCache.h"
+
 class Texture
 {
   public:
-    virtual ~Texture(){}
-    Texture() {}
-    Texture(const std::string &name, const std::vector<std::string> &urls, bool flip) : mUrls(urls), mFlip(flip), mName(name) {}
+    virtual ~Texture();
+    Texture()
+        : mWidth(0),
+          mHeight(0),
+          mFlip(false),
+          mIsCubeMap(false),
+          mDecoded(false),
+          mFromCache(false),
+          mCompression(TEXTURECOMPRESSIONNONE),
+          mCacheSource()
+    {
+    }
+    Texture(const std::string &name, const std::vector<std::string> &urls, bool flip);
     Texture(const std::string &name, const std::string &url, bool flip);
     std::string getName() { return mName; }
+    // Upload the decoded images to the backend, decoding them first if that hasn't happened yet.
+    // Main thread only.
     virtual void loadTexture() = 0;
-    void generateMipmap(uint8_t *input_pixels,
-                        int input_w,
-                        int input_h,
-                        int input_stride_in_bytes,
-                        std::vector<uint8_t *> &output_pixels,
-                        int output_w,
-                        int output_h,
-                        int output_stride_in_bytes,
-                        int num_channels,
-                        bool is256padding);
+
+    // Loading is split so that the loader can run the first steps of different textures on worker
+    // threads: readImages() reads the image files, decode() decodes them into the base level of
+    // the mip chain, and generateMipChains() generates the other levels of 2D textures. None of
+    // them touches anything but the textures themselves. loadTexture() generates the levels that
+    // are still missing.
+    //
+    // With a cache path, readImages() maps the cached chain instead if it is up to date, which
+    // leaves nothing to decode or generate, and storeCache() stores the generated chain otherwise.
+    //
+    // With compression, the generated chain is compressed to getCompressedFormat() before it is
+    // stored and uploaded, see compressMipChains(). loadTexture() compresses chains that are still
+    // RGBA8.
+    void setCachePath(const std::string &cachePath) { mCachePath = cachePath; }
+    void setCompression(TEXTURECOMPRESSION compression) { mCompression = compression; }
+    bool readImages();
+    bool decode();
+    bool storeCache();
+    TEXTUREFORMAT getCompressedFormat() const
+    {
+        return chooseTextureFormat(mMipChain, mCompression);
+    }
+    bool isDecoded() const { return mDecoded; }
+    bool isFromCache() const { return mFromCache; }
+    MipChain *getMipChain() { return &mMipChain; }
 
   protected:
     bool isPowerOf2(int);
-    bool loadImage(const std::vector<std::string> &urls, std::vector<uint8_t *>* pixels);
-    void DestoryImageData(std::vector<uint8_t *>& pixelVec);
-    void copyPaddingBuffer(unsigned char *dst,
-                           unsigned char *src,
-                           int width,
-                           int height,
-                           int kPadding);
+    bool loadCache();
+    // Generate and compress what decoding left to do, for loadTexture().
+    void finishMipChain();
+    // Copy decoded pixels into the base level of layer, flipping them if needed.
+    void copyBaseLevel(int layer, const uint8_t *pixels);
 
     std::vector<std::string> mUrls;
     int mWidth;
     int mHeight;
     bool mFlip;
+    bool mIsCubeMap;
+    bool mDecoded;
+    bool mFromCache;
+    TEXTURECOMPRESSION mCompression;
 
     std::string mName;
+    std::string mCachePath;
+    TextureCacheSource mCacheSource;
+    // Encoded image files, released once decoded.
+    std::vector<std::string> mImageFiles;
+    // One layer per face of cubemaps, which have a single level, and the full chain of 2D
+    // textures.
+    MipChain mMipChain;
 };
 
 #endif // !TEXTURE_H
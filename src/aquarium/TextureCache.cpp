@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// TextureCache.cpp: Implement mapping and storing decoded textures.
+
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "FileSystem.h"
+
+namespace {
+
+const char kTextureCacheMagic[4] = {'A', 'Q', 'T', 'C'};
+
+static_assert(sizeof(TextureCacheHeader) <= MipChain::kLevelAlignment,
+              "The header must fit in front of the first level.");
+
+// Open the cache at cachePath if it has the current format, hasn't been truncated and holds a
+// chain of the expected layout.
+bool openCache(const std::string &cachePath,
+               bool flip,
+               int levelCount,
+               int layerCount,
+               MappedFile *file,
+               TextureCacheHeader *header)
+{
+    if (!file->open(cachePath, true) || file->size() < sizeof(TextureCacheHeader))
+    {
+        return false;
+    }
+
+    memcpy(header, file->data(), sizeof(TextureCacheHeader));
+    if (memcmp(header->magic, kTextureCacheMagic, sizeof(kTextureCacheMagic)) != 0 ||
+        header->version != kTextureCacheVersion || header->fileSize != file->size() ||
+        header->format >= TEXTUREFORMATMAX || header->width <= 0 || header->height <= 0)
+    {
+        return false;
+    }
+
+    int expectedLevelCount =
+        levelCount > 0 ? levelCount : MipChain::getFullLevelCount(header->width, header->height);
+    return header->flip == (flip ? 1u : 0u) && header->levelCount == expectedLevelCount &&
+           header->layerCount == layerCount &&
+           header->rowPitchAlignment == MipChain::kRowPitchAlignment &&
+           header->levelAlignment == MipChain::kLevelAlignment &&
+           header->dataOffset == MipChain::kLevelAlignment;
+}
+
+bool mapChain(std::unique_ptr<MappedFile> file, const TextureCacheHeader &header, MipChain *chain)
+{
+    return chain->map(std::move(file), static_cast<size_t>(header.dataOffset), header.width,
+                      header.height, header.levelCount, header.layerCount,
+                      static_cast<TEXTUREFORMAT>(header.format));
+}
+
+}  // namespace
+
+bool TextureCache::getSourceStatus(const std::vector<std::string> &paths,
+                                   TextureCacheSource *source)
+{
+    source->size = 0;
+    source->time = 0;
+    source->hash = 0;
+    for (const std::string &path : paths)
+    {
+        uint64_t size;
+        int64_t time;
+        if (!getFileStatus(path, &size, &time))
+        {
+            return false;
+        }
+        source->size += size;
+        source->time = std::max(source->time, time);
+    }
+    return true;
+}
+
+uint64_t TextureCache::hashImages(const std::vector<std::string> &images)
+{
+    std::vector<uint64_t> hashes;
+    for (const std::string &image : images)
+    {
+        hashes.push_back(hashBytes(image.data(), image.size()));
+    }
+    return hashBytes(hashes.data(), hashes.size() * sizeof(uint64_t));
+}
+
+bool TextureCache::load(const std::string &cachePath,
+                        const TextureCacheSource &source,
+                        bool flip,
+                        int levelCount,
+                        int layerCount,
+                        MipChain *chain)
+{
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    TextureCacheHeader header;
+    if (!openCache(cachePath, flip, levelCount, layerCount, file.get(), &header))
+    {
+        return false;
+    }
+
+    // The images haven't been touched since the cache was built.
+    if (header.sourceSize == source.size && header.sourceTime == source.time)
+    {
+        return mapChain(std::move(file), header, chain);
+    }
+
+    // The images were touched but their content didn't change, e.g. by a checkout. Store the new
+    // time so that later loads don't read the images again.
+    if (source.hash == 0 || header.sourceHash != source.hash)
+    {
+        return false;
+    }
+    std::string cache(file->data(), file->size());
+    file->close();
+
+    header.sourceSize = source.size;
+    header.sourceTime = source.time;
+    memcpy(&cache[0], &header, sizeof(header));
+    if (!writeFileAtomic(cachePath, cache.data(), cache.size()) ||
+        !openCache(cachePath, flip, levelCount, layerCount, file.get(), &header))
+    {
+        return false;
+    }
+    return mapChain(std::move(file), header, chain);
+}
+
+bool TextureCache::store(const std::string &cachePath,
+                         const TextureCacheSource &source,
+                         bool flip,
+                         const MipChain &chain)
+{
+    size_t dataOffset = MipChain::kLevelAlignment;
+    std::string cache(dataOffset + chain.getSize(), '\0');
+
+    TextureCacheHeader header;
+    memcpy(header.magic, kTextureCacheMagic, sizeof(kTextureCacheMagic));
+    header.version           = kTextureCacheVersion;
+    header.fileSize          = cache.size();
+    header.sourceSize        = source.size;
+    header.sourceTime        = source.time;
+    header.sourceHash        = source.hash;
+    header.format            = chain.getFormat();
+    header.flip              = flip ? 1 : 0;
+    header.width             = chain.getWidth(0);
+    header.height            = chain.getHeight(0);
+    header.levelCount        = chain.getLevelCount();
+    header.layerCount        = chain.getLayerCount();
+    header.rowPitchAlignment = MipChain::kRowPitchAlignment;
+    header.levelAlignment    = MipChain::kLevelAlignment;
+    header.dataOffset        = dataOffset;
+
+    memcpy(&cache[0], &header, sizeof(header));
+    memcpy(&cache[dataOffset], chain.getData(), chain.getSize());
+    return writeFileAtomic(cachePath, cache.data(), cache.size());
+}
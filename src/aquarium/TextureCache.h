@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// TextureCache.h: Define the cache of decoded textures.
+//
+// Decoding the images and generating their mipmaps dominate loading textures. The first load
+// stores each texture in its final upload layout, which later loads map instead:
+//
+//   TextureCacheHeader
+//   padding up to MipChain::kLevelAlignment
+//   the mip chain, byte for byte as MipChain lays it out: every layer with all its levels, RGBA8
+//   or block compressed
+//
+// The header records the format and the layout the chain was built with, so caches of other
+// layouts are rebuilt, and each texture compression mode has a cache file of its own. Like the
+// model cache, it records the size, modification time and hash of the source images; the faces
+// of cube maps count as one source, with their sizes summed, the latest time and a hash of their
+// hashes.
+
+#pragma once
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H 1
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MipChain.h"
+
+constexpr uint32_t kTextureCacheVersion = 1;
+
+struct TextureCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+    uint32_t format;
+    uint32_t flip;
+    int32_t width;
+    int32_t height;
+    int32_t levelCount;
+    int32_t layerCount;
+    uint32_t rowPitchAlignment;
+    uint32_t levelAlignment;
+    uint64_t dataOffset;
+};
+
+// The source images of a texture. A hash of 0 means the images haven't been read.
+struct TextureCacheSource
+{
+    uint64_t size;
+    int64_t time;
+    uint64_t hash;
+};
+
+class TextureCache
+{
+  public:
+    // Status of the images at paths, false if one of them doesn't exist.
+    static bool getSourceStatus(const std::vector<std::string> &paths, TextureCacheSource *source);
+    static uint64_t hashImages(const std::vector<std::string> &images);
+
+    // Map the cache at cachePath into chain if it was built from source, flipped as flip, with
+    // levelCount levels (0 for the full chain) of layerCount layers. The chain takes the format
+    // of the cache. A cache whose source size and time don't match is used if the hash still
+    // does, and its header is updated.
+    static bool load(const std::string &cachePath,
+                     const TextureCacheSource &source,
+                     bool flip,
+                     int levelCount,
+                     int layerCount,
+                     MipChain *chain);
+    // Store the generated chain.
+    static bool store(const std::string &cachePath,
+                      const TextureCacheSource &source,
+                      bool flip,
+                      const MipChain &chain);
+};
+
+#endif  // !TEXTURECACHE_H
@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Timer.h: Define the clock that the aquarium and the micro-benchmarks measure time with. The
+// steady clock is monotonic wall time, backed by QueryPerformanceCounter on Windows and
+// CLOCK_MONOTONIC elsewhere, so that frames of a few milliseconds are measured to the microsecond.
+
+#pragma once
+#ifndef TIMER_H
+#define TIMER_H 1
+
+#include <chrono>
+
+namespace timer
+{
+
+typedef std::chrono::steady_clock Clock;
+
+inline Clock::time_point now()
+{
+    return Clock::now();
+}
+
+inline double getSeconds(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double>(end - start).count();
+}
+
+inline double getMilliseconds(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Seconds since an arbitrary origin, for timestamps kept as numbers.
+inline double getSeconds()
+{
+    return std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+}
+
+}  // namespace timer
+
+#endif  // !TIMER_H
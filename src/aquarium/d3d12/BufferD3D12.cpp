@@ -10,12 +10,12 @@
 BufferD3D12::BufferD3D12(ContextD3D12 *context,
                          int totalCmoponents,
                          int numComponents,
-                         const std::vector<float> &buffer,
+                         const float *buffer,
                          bool isIndex)
     : mIsIndex(isIndex), mTotoalComponents(totalCmoponents), mStride(0), mOffset(nullptr)
 {
     mSize   = totalCmoponents * sizeof(float);
-    mBuffer = context->createDefaultBuffer(buffer.data(), mSize, mUploadBuffer);
+    mBuffer = context->createDefaultBuffer(buffer, mSize, mUploadBuffer);
 
     // Initialize the vertex buffer view.
     mVertexBufferView.BufferLocation = mBuffer->GetGPUVirtualAddress();
@@ -26,12 +26,12 @@ BufferD3D12::BufferD3D12(ContextD3D12 *context,
 BufferD3D12::BufferD3D12(ContextD3D12 *context,
                          int totalCmoponents,
                          int numComponents,
-                         const std::vector<unsigned short> &buffer,
+                         const unsigned short *buffer,
                          bool isIndex)
     : mIsIndex(isIndex), mTotoalComponents(totalCmoponents), mStride(0), mOffset(nullptr)
 {
     mSize   = totalCmoponents * sizeof(unsigned short);
-    mBuffer = context->createDefaultBuffer(buffer.data(), mSize, mUploadBuffer);
+    mBuffer = context->createDefaultBuffer(buffer, mSize, mUploadBuffer);
 
     // Initialize the vertex buffer view.
     mIndexBufferView.BufferLocation = mBuffer->GetGPUVirtualAddress();
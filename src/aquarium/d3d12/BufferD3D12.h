@@ -26,12 +26,12 @@ class BufferD3D12 : public Buffer
     BufferD3D12(ContextD3D12 *context,
                 int totalCmoponents,
                 int numComponents,
-                const std::vector<float> &buffer,
+                const float *buffer,
                 bool isIndex);
     BufferD3D12(ContextD3D12 *context,
                 int totalCmoponents,
                 int numComponents,
-                const std::vector<unsigned short> &buffer,
+                const unsigned short *buffer,
                 bool isIndex);
 
     ComPtr<ID3D12Resource> getBuffer() const { return mBuffer; }
@@ -0,0 +1,47 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "BufferManagerD3D12.h"
+
+#include <cstdio>
+
+#include "ContextD3D12.h"
+
+RingBufferD3D12::RingBufferD3D12(ComPtr<ID3D12Resource> resource, size_t size, uint8_t *data)
+    : RingBuffer(size, data), mResource(resource)
+{
+}
+
+void RingBufferD3D12::destory()
+{
+    mResource->Unmap(0, nullptr);
+    mResource.Reset();
+    mData = nullptr;
+}
+
+BufferManagerD3D12::BufferManagerD3D12(ContextD3D12 *context, const FrameFence *fence)
+    : BufferManager(fence), mContext(context)
+{
+}
+
+// The upload heap stays mapped for the lifetime of the ring, the CPU only writes regions that no
+// frame in flight reads.
+RingBuffer *BufferManagerD3D12::createRingBuffer(size_t size)
+{
+    ComPtr<ID3D12Resource> resource = mContext->createUploadBuffer(size);
+
+    uint8_t *data = nullptr;
+    CD3DX12_RANGE readRange(0, 0);
+    if (FAILED(resource->Map(0, &readRange, reinterpret_cast<void **>(&data))))
+    {
+        // The resource is released with the last reference, and the caller falls back to a
+        // synchronous upload.
+        printf("D3D12 backend failed to map a ring buffer of %zu bytes\n", size);
+        return nullptr;
+    }
+
+    return new RingBufferD3D12(resource, size, data);
+}
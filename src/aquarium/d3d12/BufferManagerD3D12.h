@@ -0,0 +1,57 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// BufferManagerD3D12.h: Defines the ring buffers of D3D12, persistently mapped upload heaps that
+// per-frame data is copied from, and the fence that retires them.
+
+#pragma once
+#ifndef BUFFERMANAGERD3D12_H
+#define BUFFERMANAGERD3D12_H 1
+
+#include "stdafx.h"
+
+using Microsoft::WRL::ComPtr;
+
+#include "../BufferManager.h"
+
+class ContextD3D12;
+
+class FenceD3D12 : public FrameFence
+{
+  public:
+    explicit FenceD3D12(ComPtr<ID3D12Fence> fence) : mFence(fence) {}
+
+    uint64_t getCompletedSerial() const override { return mFence->GetCompletedValue(); }
+
+  private:
+    ComPtr<ID3D12Fence> mFence;
+};
+
+class RingBufferD3D12 : public RingBuffer
+{
+  public:
+    RingBufferD3D12(ComPtr<ID3D12Resource> resource, size_t size, uint8_t *data);
+
+    ComPtr<ID3D12Resource> getResource() const { return mResource; }
+
+    void destory() override;
+
+  private:
+    ComPtr<ID3D12Resource> mResource;
+};
+
+class BufferManagerD3D12 : public BufferManager
+{
+  public:
+    BufferManagerD3D12(ContextD3D12 *context, const FrameFence *fence);
+
+  protected:
+    RingBuffer *createRingBuffer(size_t size) override;
+
+  private:
+    ContextD3D12 *mContext;
+};
+
+#endif  // !BUFFERMANAGERD3D12_H
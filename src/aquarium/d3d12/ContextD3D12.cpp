@@ -6,13 +6,16 @@
 
 #include "ContextD3D12.h"
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
 
+#include "../Timer.h"
 #include "BufferD3D12.h"
+#include "BufferManagerD3D12.h"
 #include "FishModelD3D12.h"
 #include "FishModelInstancedDrawD3D12.h"
 #include "GenericModelD3D12.h"
@@ -42,13 +45,17 @@ inline void ThrowIfFailed(HRESULT hr)
 ContextD3D12::ContextD3D12(BACKENDTYPE backendType)
     : lightWorldPositionView({}),
       mFishPersBufferView({}),
+      mPackFishPers(false),
       fishPers(nullptr),
+      packedFishPers(nullptr),
+      mFishPersCapacity(0),
       mWindow(nullptr),
       mDevice(nullptr),
       mCommandQueue(nullptr),
       mSwapChain(nullptr),
       mPreferredSwapChainFormat(DXGI_FORMAT_R8G8B8A8_UNORM),
       mCompileFlags(0),
+      mFishPersState(D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
       m_frameIndex(0),
       mRtvHeap(nullptr),
       mDsvHeap(nullptr),
@@ -56,6 +63,8 @@ ContextD3D12::ContextD3D12(BACKENDTYPE backendType)
       mRtvDescriptorSize(0),
       mCbvmSrvDescriptorSize(0),
       mFenceValue(0),
+      mFrameFence(nullptr),
+      mBufferManager(nullptr),
       mRootSignature({}),
       mViewport(0.0f, 0.0f, 0.0f, 0.0f),
       mScissorRect(0.0f, 0.0f, 0.0f, 0.0f),
@@ -82,6 +91,8 @@ ContextD3D12::~ContextD3D12()
         destoryImgUI();
     }
     destoryFishResource();
+    delete mBufferManager;
+    delete mFrameFence;
 }
 
 bool ContextD3D12::initialize(
@@ -94,6 +105,18 @@ bool ContextD3D12::initialize(
     mVsync      = 0;
     mDisableControlPanel = toggleBitset.test(static_cast<TOGGLE>(TOGGLE::DISABLECONTROLPANEL));
 
+    // The fish vertex shader reads packed fish data when FISH_PER_PACKED is defined. Instanced
+    // draws read the same packed records as per-instance vertex data instead.
+    bool instancedDraws = toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS));
+    mPackFishPers =
+        toggleBitset.test(static_cast<size_t>(TOGGLE::PACKFISHPERS)) || instancedDraws;
+    if (mPackFishPers && !instancedDraws)
+    {
+        mShaderMacros.push_back({"FISH_PER_PACKED", "1"});
+        mFishPersState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    }
+    mShaderMacros.push_back({nullptr, nullptr});
+
     // initialise GLFW
     if (!glfwInit())
     {
@@ -153,6 +176,18 @@ bool ContextD3D12::initialize(
     }
 #endif
 
+    // Compiled shaders are cached per compiler, flags and macros.
+    std::ostringstream shaderConfiguration;
+    shaderConfiguration << "d3d12 d3dcompiler_" << D3D_COMPILER_VERSION << " 5_1 " << mCompileFlags;
+    for (const D3D_SHADER_MACRO &macro : mShaderMacros)
+    {
+        if (macro.Name != nullptr)
+        {
+            shaderConfiguration << " " << macro.Name << "=" << macro.Definition;
+        }
+    }
+    mShaderCache.setConfiguration(shaderConfiguration.str());
+
     ComPtr<IDXGIFactory4> mFactory;
     ThrowIfFailed(CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&mFactory)));
 
@@ -392,10 +427,14 @@ void ContextD3D12::initAvailableToggleBitset(BACKENDTYPE backendType)
     mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEFULLSCREENMODE));
     mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::TURNOFFVSYNC));
     mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::DISABLED3D12RENDERPASS));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::PACKFISHPERS));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::RECORDCOMMANDS));
 }
 
 void ContextD3D12::DoFlush(const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> &toggleBitset)
 {
+    timer::Clock::time_point begin = timer::now();
+
     if (mDisableD3D12RenderPass)
     {
         // Resolve MSAA texture to non MSAA texture, and then present.
@@ -449,6 +488,8 @@ void ContextD3D12::DoFlush(const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEM
         mCommandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
     }
 
+    mSubmitTime = timer::getMilliseconds(begin, timer::now());
+
     // Present the frame.
     ThrowIfFailed(mSwapChain->Present(mVsync, 0));
 
@@ -476,6 +517,9 @@ void ContextD3D12::Flush()
             ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
         }
 
+        mFrameFence    = new FenceD3D12(mFence);
+        mBufferManager = new BufferManagerD3D12(this, mFrameFence);
+
         ThrowIfFailed(mSwapChain->Present(mVsync, 0));
         m_frameIndex = mSwapChain->GetCurrentBackBufferIndex();
 
@@ -616,19 +660,18 @@ Model *ContextD3D12::createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME
     return model;
 }
 
-Buffer *ContextD3D12::createBuffer(int numComponents, std::vector<float> *buf, bool isIndex)
+Buffer *ContextD3D12::createBuffer(int numComponents, const float *buf, int size, bool isIndex)
 {
-    Buffer *buffer =
-        new BufferD3D12(this, static_cast<int>(buf->size()), numComponents, *buf, isIndex);
+    Buffer *buffer = new BufferD3D12(this, size, numComponents, buf, isIndex);
     return buffer;
 }
 
 Buffer *ContextD3D12::createBuffer(int numComponents,
-                                   std::vector<unsigned short> *buf,
+                                   const unsigned short *buf,
+                                   int size,
                                    bool isIndex)
 {
-    Buffer *buffer =
-        new BufferD3D12(this, static_cast<int>(buf->size()), numComponents, *buf, isIndex);
+    Buffer *buffer = new BufferD3D12(this, size, numComponents, buf, isIndex);
     return buffer;
 }
 
@@ -642,14 +685,12 @@ Program *ContextD3D12::createProgram(const std::string &mVId, const std::string
 Texture *ContextD3D12::createTexture(const std::string &name, const std::string &url)
 {
     Texture *texture = new TextureD3D12(this, name, url);
-    texture->loadTexture();
     return texture;
 }
 
 Texture *ContextD3D12::createTexture(const std::string &name, const std::vector<std::string> &urls)
 {
     Texture *texture = new TextureD3D12(this, name, urls);
-    texture->loadTexture();
     return texture;
 }
 
@@ -712,13 +753,7 @@ void ContextD3D12::initGeneralResources(Aquarium *aquarium)
     staticSamplers.emplace_back(std::move(sampler2D));
     staticSamplers.emplace_back(std::move(samplerCube));
 
-    fishPers = new FishPer[aquarium->getCurFishCount()];
-
-    mFishPersBuffer = createDefaultBuffer(
-        fishPers, CalcConstantBufferByteSize(sizeof(FishPer) * aquarium->getCurFishCount()),
-        stagingBuffer);
-    mFishPersBufferView.BufferLocation = mFishPersBuffer->GetGPUVirtualAddress();
-    mFishPersBufferView.SizeInBytes    = CalcConstantBufferByteSize(sizeof(FishPer));
+    createFishResource(aquarium->getCurFishCount());
 
     mPreTotalInstance = aquarium->getPreFishCount();
     mCurTotalInstance = aquarium->getCurFishCount();
@@ -727,7 +762,8 @@ void ContextD3D12::initGeneralResources(Aquarium *aquarium)
 void ContextD3D12::updateConstantBufferSync(ComPtr<ID3D12Resource> defaultBuffer,
                                             const ComPtr<ID3D12Resource> uploadBuffer,
                                             const void *initData,
-                                            UINT64 byteSize)
+                                            UINT64 byteSize,
+                                            D3D12_RESOURCE_STATES state)
 {
     // Describe the data we want to copy into the default buffer.
     D3D12_SUBRESOURCE_DATA subResourceData = {};
@@ -736,14 +772,12 @@ void ContextD3D12::updateConstantBufferSync(ComPtr<ID3D12Resource> defaultBuffer
     subResourceData.SlicePitch             = subResourceData.RowPitch;
 
     // Schedule to copy the data to the default buffer resource.
-    stateTransition(defaultBuffer, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
-                    D3D12_RESOURCE_STATE_COPY_DEST);
+    stateTransition(defaultBuffer, state, D3D12_RESOURCE_STATE_COPY_DEST);
 
     UpdateSubresources<1>(mCommandList.Get(), defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1,
                           &subResourceData);
 
-    stateTransition(defaultBuffer, D3D12_RESOURCE_STATE_COPY_DEST,
-                    D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    stateTransition(defaultBuffer, D3D12_RESOURCE_STATE_COPY_DEST, state);
 }
 
 void ContextD3D12::updateWorldlUniforms(Aquarium *aquarium)
@@ -762,13 +796,13 @@ ComPtr<ID3DBlob> ContextD3D12::createShaderModule(const std::string &type,
 
     if (type == "VS")
     {
-        hr = (D3DCompile(shaderStr.c_str(), shaderStr.length(), nullptr, nullptr, nullptr, "main",
-                         "vs_5_1", mCompileFlags, 0, &shader, &errors));
+        hr = (D3DCompile(shaderStr.c_str(), shaderStr.length(), nullptr, mShaderMacros.data(),
+                         nullptr, "main", "vs_5_1", mCompileFlags, 0, &shader, &errors));
     }
     else  // "FS"
     {
-        hr = (D3DCompile(shaderStr.c_str(), shaderStr.length(), nullptr, nullptr, nullptr, "main",
-                         "ps_5_1", mCompileFlags, 0, &shader, &errors));
+        hr = (D3DCompile(shaderStr.c_str(), shaderStr.length(), nullptr, mShaderMacros.data(),
+                         nullptr, "main", "ps_5_1", mCompileFlags, 0, &shader, &errors));
     }
 
     if (FAILED(hr))
@@ -820,6 +854,7 @@ void ContextD3D12::WaitForPreviousFrame()
     const UINT64 fence = mFenceValue;
     ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), fence));
     mBufferSerias[m_frameIndex] = mFenceValue;
+    mBufferManager->finishFrame(fence);
 
     // Aquarium uses 3 back buffers for better performance.
     // Wait until the previous before previous frame is finished.
@@ -830,6 +865,8 @@ void ContextD3D12::WaitForPreviousFrame()
         ThrowIfFailed(mFence->SetEventOnCompletion(fence, mFenceEvent));
         WaitForSingleObject(mFenceEvent, INFINITE);
     }
+    mBufferManager->retireFrames();
+    releaseRetiredResources();
 
     // Get frame index for the next frame
     m_frameIndex = mSwapChain->GetCurrentBackBufferIndex();
@@ -842,22 +879,53 @@ void ContextD3D12::FlushPreviousFrames()
     const UINT64 fence = mFenceValue;
     ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), fence));
     mBufferSerias[m_frameIndex] = mFenceValue;
+    mBufferManager->finishFrame(fence);
 
     if (mFence->GetCompletedValue() < mFenceValue)
     {
         ThrowIfFailed(mFence->SetEventOnCompletion(fence, mFenceEvent));
         WaitForSingleObject(mFenceEvent, INFINITE);
     }
+    mBufferManager->retireFrames();
+    releaseRetiredResources();
 
     // Get frame index for the next frame
     m_frameIndex = mSwapChain->GetCurrentBackBufferIndex();
 }
 
-void ContextD3D12::updateAllFishData()
+// Each frame copies fish data from its own region of the ring buffers, so the CPU never
+// overwrites data that a frame in flight still reads.
+void ContextD3D12::updateAllFishData(int fishCount)
 {
     // TODO(yizhou): Split data updating and render pass.
-    updateConstantBufferSync(mFishPersBuffer, stagingBuffer, fishPers,
-                             CalcConstantBufferByteSize(sizeof(FishPer) * mCurTotalInstance));
+    if (fishCount == 0)
+    {
+        return;
+    }
+
+    UINT64 byteSize        = getFishPersByteSize(fishCount);
+    size_t offset          = 0;
+    RingBuffer *ringBuffer = mBufferManager->allocate(byteSize, &offset);
+    if (ringBuffer == nullptr)
+    {
+        // The pool is full of frames in flight.
+        FlushPreviousFrames();
+        ringBuffer = mBufferManager->allocate(byteSize, &offset);
+    }
+    if (ringBuffer == nullptr)
+    {
+        updateConstantBufferSync(mFishPersBuffer, stagingBuffer, getFishPersData(), byteSize,
+                                 mFishPersState);
+        return;
+    }
+
+    memcpy(ringBuffer->getData(offset), getFishPersData(), byteSize);
+
+    stateTransition(mFishPersBuffer, mFishPersState, D3D12_RESOURCE_STATE_COPY_DEST);
+    mCommandList->CopyBufferRegion(mFishPersBuffer.Get(), 0,
+                                   static_cast<RingBufferD3D12 *>(ringBuffer)->getResource().Get(),
+                                   offset, byteSize);
+    stateTransition(mFishPersBuffer, D3D12_RESOURCE_STATE_COPY_DEST, mFishPersState);
 }
 
 void ContextD3D12::checkRootSignatureSupport()
@@ -1040,7 +1108,8 @@ void ContextD3D12::createCommandList(ID3D12PipelineState *pInitialState,
 
 ComPtr<ID3D12Resource> ContextD3D12::createDefaultBuffer(const void *initData,
                                                          UINT64 byteSize,
-                                                         ComPtr<ID3D12Resource>& uploadBuffer) const
+                                                         ComPtr<ID3D12Resource>& uploadBuffer,
+                                                         D3D12_RESOURCE_STATES state) const
 {
     ComPtr<ID3D12Resource> defaultBuffer;
 
@@ -1069,12 +1138,23 @@ ComPtr<ID3D12Resource> ContextD3D12::createDefaultBuffer(const void *initData,
     UpdateSubresources<1>(mCommandList.Get(), defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1,
                           &subResourceData);
 
-    stateTransition(defaultBuffer, D3D12_RESOURCE_STATE_COPY_DEST,
-                    D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    stateTransition(defaultBuffer, D3D12_RESOURCE_STATE_COPY_DEST, state);
 
     return defaultBuffer;
 }
 
+ComPtr<ID3D12Resource> ContextD3D12::createUploadBuffer(UINT64 byteSize) const
+{
+    ComPtr<ID3D12Resource> uploadBuffer;
+
+    CD3DX12_RESOURCE_DESC resourceDescriptor = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+    ThrowIfFailed(mDevice->CreateCommittedResource(
+        &uploadheapProperties, D3D12_HEAP_FLAG_NONE, &resourceDescriptor,
+        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
+
+    return uploadBuffer;
+}
+
 void ContextD3D12::createRootSignature(
     const D3D12_VERSIONED_ROOT_SIGNATURE_DESC &pRootSignatureDesc,
     ComPtr<ID3D12RootSignature>& rootSignature) const
@@ -1094,22 +1174,21 @@ void ContextD3D12::createRootSignature(
 }
 
 void ContextD3D12::createTexture(const D3D12_RESOURCE_DESC &textureDesc,
-                                 const std::vector<UINT8 *> &texture,
+                                 const MipChain &mipChain,
                                  ComPtr<ID3D12Resource>& m_texture,
-                                 ComPtr<ID3D12Resource>& textureUploadHeap,
-                                 int TextureWidth,
-                                 int TextureHeight,
-                                 int TexturePixelSize,
-                                 int mipLevels,
-                                 int arraySize)
+                                 ComPtr<ID3D12Resource>& textureUploadHeap)
 {
     ThrowIfFailed(mDevice->CreateCommittedResource(&defaultheapProperties, D3D12_HEAP_FLAG_NONE,
                                                    &textureDesc, D3D12_RESOURCE_STATE_COPY_DEST,
                                                    nullptr, IID_PPV_ARGS(&m_texture)));
 
-    int num2DSubresources = mipLevels * arraySize;
-    const UINT64 uploadBufferSize =
-        GetRequiredIntermediateSize(m_texture.Get(), 0, num2DSubresources);
+    UINT num2DSubresources = textureDesc.MipLevels * textureDesc.DepthOrArraySize;
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(num2DSubresources);
+    std::vector<UINT> numRows(num2DSubresources);
+    std::vector<UINT64> rowSizes(num2DSubresources);
+    UINT64 uploadBufferSize = 0;
+    mDevice->GetCopyableFootprints(&textureDesc, 0, num2DSubresources, 0, layouts.data(),
+                                   numRows.data(), rowSizes.data(), &uploadBufferSize);
 
     CD3DX12_RESOURCE_DESC resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
     // Create the GPU upload buffer.
@@ -1117,31 +1196,46 @@ void ContextD3D12::createTexture(const D3D12_RESOURCE_DESC &textureDesc,
                                                    &resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
                                                    nullptr, IID_PPV_ARGS(&textureUploadHeap)));
 
-    // Max mipmap levels is 10.
-    D3D12_SUBRESOURCE_DATA textureData[11];
-
-    for (int i = 0; i < num2DSubresources; i++)
+    // Subresources are ordered by layer, then by level, like the mip chain.
+    bool sameLayout = true;
+    for (UINT i = 0; i < num2DSubresources; ++i)
     {
-        textureData[i].pData      = texture[i];
-        textureData[i].RowPitch   = TextureWidth * 4;
-        textureData[i].SlicePitch = textureData[i].RowPitch * TextureHeight;
-
-        // Width and height of cubemap are the same.
-        if (arraySize == 6)
-        {
-            continue;
-        }
+        int layer  = i / textureDesc.MipLevels;
+        int level  = i % textureDesc.MipLevels;
+        sameLayout = sameLayout && layouts[i].Offset == mipChain.getOffset(layer, level) &&
+                     layouts[i].Footprint.RowPitch == mipChain.getRowPitch(level);
+    }
 
-        TextureWidth >>= 1;
-        TextureHeight >>= 1;
-        if (TextureHeight == 0)
+    UINT8 *mapped = nullptr;
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(textureUploadHeap->Map(0, &readRange, reinterpret_cast<void **>(&mapped)));
+    if (sameLayout)
+    {
+        memcpy(mapped, mipChain.getData(), static_cast<size_t>(uploadBufferSize));
+    }
+    else
+    {
+        for (UINT i = 0; i < num2DSubresources; ++i)
         {
-            TextureHeight = 1;
+            int layer        = i / textureDesc.MipLevels;
+            int level        = i % textureDesc.MipLevels;
+            const UINT8 *src = mipChain.getData() + mipChain.getOffset(layer, level);
+            for (UINT row = 0; row < numRows[i]; ++row)
+            {
+                memcpy(mapped + layouts[i].Offset + layouts[i].Footprint.RowPitch * row,
+                       src + mipChain.getRowPitch(level) * row,
+                       static_cast<size_t>(rowSizes[i]));
+            }
         }
     }
+    textureUploadHeap->Unmap(0, nullptr);
 
-    UpdateSubresources(mCommandList.Get(), m_texture.Get(), textureUploadHeap.Get(), 0, 0,
-                       num2DSubresources, &textureData[0]);
+    for (UINT i = 0; i < num2DSubresources; ++i)
+    {
+        CD3DX12_TEXTURE_COPY_LOCATION dst(m_texture.Get(), i);
+        CD3DX12_TEXTURE_COPY_LOCATION src(textureUploadHeap.Get(), layouts[i]);
+        mCommandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+    }
 
     stateTransition(m_texture, D3D12_RESOURCE_STATE_COPY_DEST,
                     D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
@@ -1260,25 +1354,73 @@ void ContextD3D12::reallocResource(int preTotalInstance,
     mPreTotalInstance = preTotalInstance;
     mCurTotalInstance = curTotalInstance;
 
-    if (curTotalInstance == 0)
-        return;
-
-    // If current fish number > pre fish number, allocate a new bigger buffer.
-    // If current fish number <= prefish number, do not allocate a new one.
-    // TODO(yizhou) : optimize the buffer allocation strategy.
-    if (preTotalInstance >= curTotalInstance)
+    if (curTotalInstance <= mFishPersCapacity)
     {
         return;
     }
 
-    destoryFishResource();
+    createFishResource(growFishCapacity(mFishPersCapacity, curTotalInstance));
+}
 
-    fishPers = new FishPer[curTotalInstance];
+void ContextD3D12::createFishResource(int capacity)
+{
+    if (mPackFishPers)
+    {
+        FishPerPacked *grownFishPers = new FishPerPacked[capacity];
+        if (packedFishPers != nullptr)
+        {
+            memcpy(grownFishPers, packedFishPers, sizeof(FishPerPacked) * mFishPersCapacity);
+            delete[] packedFishPers;
+        }
+        packedFishPers = grownFishPers;
+    }
+    else
+    {
+        FishPer *grownFishPers = new FishPer[capacity];
+        if (fishPers != nullptr)
+        {
+            memcpy(grownFishPers, fishPers, sizeof(FishPer) * mFishPersCapacity);
+            delete[] fishPers;
+        }
+        fishPers = grownFishPers;
+    }
+    mFishPersCapacity = capacity;
 
-    mFishPersBuffer = createDefaultBuffer(
-        fishPers, CalcConstantBufferByteSize(sizeof(FishPer) * curTotalInstance), stagingBuffer);
+    // Frames in flight still read the old buffers, so they are released once those frames
+    // complete instead of draining the pipeline.
+    if (mFishPersBuffer.Get() != nullptr)
+    {
+        retireResource(mFishPersBuffer);
+        retireResource(stagingBuffer);
+    }
+    mFishPersBuffer = createDefaultBuffer(getFishPersData(), getFishPersByteSize(capacity),
+                                          stagingBuffer, mFishPersState);
     mFishPersBufferView.BufferLocation = mFishPersBuffer->GetGPUVirtualAddress();
-    mFishPersBufferView.SizeInBytes    = CalcConstantBufferByteSize(sizeof(FishPer));
+    mFishPersBufferView.SizeInBytes    = mPackFishPers
+                                          ? sizeof(FishPerPacked)
+                                          : CalcConstantBufferByteSize(sizeof(FishPer));
+}
+
+// Padded records are read through constant buffer views, which must cover 256 byte multiples.
+UINT64 ContextD3D12::getFishPersByteSize(int fishCount)
+{
+    return mPackFishPers ? sizeof(FishPerPacked) * fishCount
+                         : CalcConstantBufferByteSize(sizeof(FishPer) * fishCount);
+}
+
+void ContextD3D12::retireResource(ComPtr<ID3D12Resource> resource)
+{
+    // The frame being recorded signals the next fence value.
+    mRetiredResources.push(std::make_pair(mFenceValue + 1, resource));
+}
+
+void ContextD3D12::releaseRetiredResources()
+{
+    UINT64 completedValue = mFence->GetCompletedValue();
+    while (!mRetiredResources.empty() && mRetiredResources.front().first <= completedValue)
+    {
+        mRetiredResources.pop();
+    }
 }
 
 void ContextD3D12::destoryFishResource()
@@ -1288,9 +1430,9 @@ void ContextD3D12::destoryFishResource()
     mFishPersBuffer.Reset();
     stagingBuffer.Reset();
 
-    if (fishPers != nullptr)
-    {
-        delete fishPers;
-        fishPers = nullptr;
-    }
+    delete[] fishPers;
+    delete[] packedFishPers;
+    fishPers          = nullptr;
+    packedFishPers    = nullptr;
+    mFishPersCapacity = 0;
 }
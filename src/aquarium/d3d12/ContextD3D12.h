@@ -9,7 +9,11 @@
 #ifndef CONTEXTD3D12_H
 #define CONTEXTD3D12_H
 
+#include <queue>
+#include <utility>
+
 #include "../Context.h"
+#include "../MipChain.h"
 
 #include "GLFW/glfw3.h"
 
@@ -18,6 +22,9 @@ using Microsoft::WRL::ComPtr;
 
 enum BACKENDTYPE : short;
 
+class BufferManagerD3D12;
+class FenceD3D12;
+
 constexpr int cbvsrvCount = 88;
 
 class ContextD3D12 : public Context
@@ -45,9 +52,13 @@ class ContextD3D12 : public Context
     void preFrame() override;
 
     Model *createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend) override;
-    Buffer *createBuffer(int numComponents, std::vector<float> *buffer, bool isIndex) override;
     Buffer *createBuffer(int numComponents,
-                         std::vector<unsigned short> *buffer,
+                         const float *buffer,
+                         int size,
+                         bool isIndex) override;
+    Buffer *createBuffer(int numComponents,
+                         const unsigned short *buffer,
+                         int size,
                          bool isIndex) override;
 
     Program *createProgram(const std::string &mVId, const std::string &mFId) override;
@@ -75,9 +86,13 @@ class ContextD3D12 : public Context
     void createCommandList(ID3D12PipelineState *pInitialState,
                            ComPtr<ID3D12GraphicsCommandList4>& commandList);
 
-    ComPtr<ID3D12Resource> createDefaultBuffer(const void *initData,
-                                               UINT64 byteSize,
-                                               ComPtr<ID3D12Resource>& uploadBuffer) const;
+    // The buffer is left in state, ready to be read.
+    ComPtr<ID3D12Resource> createDefaultBuffer(
+        const void *initData,
+        UINT64 byteSize,
+        ComPtr<ID3D12Resource>& uploadBuffer,
+        D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER) const;
+    ComPtr<ID3D12Resource> createUploadBuffer(UINT64 byteSize) const;
     void createRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC &pRootSignatureDesc,
                              ComPtr<ID3D12RootSignature>& rootSignature) const;
     void createGraphicsPipelineState(
@@ -93,24 +108,25 @@ class ContextD3D12 : public Context
     void buildCbvDescriptor(const D3D12_CONSTANT_BUFFER_VIEW_DESC &cbvDesc,
                             D3D12_GPU_DESCRIPTOR_HANDLE *hGpuDescriptor);
     UINT CalcConstantBufferByteSize(UINT byteSize);
+    // Upload every subresource of textureDesc from the mip chain, which has the same layers and
+    // levels.
     void createTexture(const D3D12_RESOURCE_DESC &textureDesc,
-                       const std::vector<UINT8 *> &texture,
+                       const MipChain &mipChain,
                        ComPtr<ID3D12Resource>& m_texture,
-                       ComPtr<ID3D12Resource>& textureUploadHeap,
-                       int TextureWidth,
-                       int TextureHeight,
-                       int TexturePixelSize,
-                       int mipLevels,
-                       int arraySize);
+                       ComPtr<ID3D12Resource>& textureUploadHeap);
     void FlushPreviousFrames();
     void reallocResource(int preTotalInstance,
                          int curTotalInstance,
                          bool enableDynamicBufferOffset) override;
-    void updateAllFishData() override;
-    void updateConstantBufferSync(ComPtr<ID3D12Resource> defaultBuffer,
-                                  const ComPtr<ID3D12Resource> uploadBuffer,
-                                  const void *initData,
-                                  UINT64 byteSize);
+    void updateAllFishData(int fishCount) override;
+    FishPer *getFishPers() override { return fishPers; }
+    FishPerPacked *getPackedFishPers() override { return packedFishPers; }
+    void updateConstantBufferSync(
+        ComPtr<ID3D12Resource> defaultBuffer,
+        const ComPtr<ID3D12Resource> uploadBuffer,
+        const void *initData,
+        UINT64 byteSize,
+        D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
     void checkRootSignatureSupport();
     bool getRenderPassesTier(ID3D12Device *device);
     void beginRenderPass() override;
@@ -133,7 +149,12 @@ class ContextD3D12 : public Context
     D3D12_CONSTANT_BUFFER_VIEW_DESC mFishPersBufferView;
     ComPtr<ID3D12Resource> mFishPersBuffer;
     ComPtr<ID3D12Resource> stagingBuffer;
+    // With --pack-fish-pers, fish data is read from a structured buffer through a root shader
+    // resource view and packedFishPers is allocated instead of fishPers.
+    bool mPackFishPers;
     FishPer *fishPers;
+    FishPerPacked *packedFishPers;
+    int mFishPersCapacity;
 
   private:
     bool GetHardwareAdapter(
@@ -147,6 +168,17 @@ class ContextD3D12 : public Context
                          D3D12_RESOURCE_STATES transferState) const;
     void initAvailableToggleBitset(BACKENDTYPE backendType) override;
     void destoryFishResource();
+    // Grow the host fish data to capacity fish, keeping its content, and create a default buffer
+    // of the same size.
+    void createFishResource(int capacity);
+    UINT64 getFishPersByteSize(int fishCount);
+    const void *getFishPersData() const
+    {
+        return mPackFishPers ? static_cast<const void *>(packedFishPers) : fishPers;
+    }
+    // Keep resource alive until the frame being recorded completes.
+    void retireResource(ComPtr<ID3D12Resource> resource);
+    void releaseRetiredResources();
 
     GLFWwindow *mWindow;
     ComPtr<ID3D12Device> mDevice;
@@ -154,6 +186,9 @@ class ContextD3D12 : public Context
     ComPtr<IDXGISwapChain3> mSwapChain;
     DXGI_FORMAT mPreferredSwapChainFormat;
     UINT mCompileFlags;
+    // Defines of every shader, terminated by a null macro.
+    std::vector<D3D_SHADER_MACRO> mShaderMacros;
+    D3D12_RESOURCE_STATES mFishPersState;
 
     static const UINT mFrameCount = 3;
     UINT m_frameIndex;
@@ -171,6 +206,12 @@ class ContextD3D12 : public Context
     ComPtr<ID3D12Fence> mFence;
     UINT64 mFenceValue;
     HANDLE mFenceEvent;
+    // Per-frame fish data is copied from ring buffers that frames retire through mFrameFence.
+    FenceD3D12 *mFrameFence;
+    BufferManagerD3D12 *mBufferManager;
+    // Resources replaced while frames that use them are in flight, with the fence value that
+    // retires them.
+    std::queue<std::pair<UINT64, ComPtr<ID3D12Resource>>> mRetiredResources;
 
     D3D12_FEATURE_DATA_ROOT_SIGNATURE mRootSignature;
     D3D12_RENDER_PASS_ENDING_ACCESS_RESOLVE_SUBRESOURCE_PARAMETERS subresourceParameters;
@@ -47,7 +47,10 @@ void FishModelD3D12::init()
     mTexCoordBuffer = static_cast<BufferD3D12 *>(bufferMap["texCoord"]);
     mTangentBuffer  = static_cast<BufferD3D12 *>(bufferMap["tangent"]);
     mBiNormalBuffer = static_cast<BufferD3D12 *>(bufferMap["binormal"]);
-    mIndicesBuffer  = static_cast<BufferD3D12 *>(bufferMap["indices"]);
+    for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+    {
+        mIndicesBuffers[lod] = static_cast<BufferD3D12 *>(getLodIndicesBuffer(lod));
+    }
 
     mVertexBufferView[0] = mPositionBuffer->mVertexBufferView;
     mVertexBufferView[1] = mNormalBuffer->mVertexBufferView;
@@ -89,7 +92,7 @@ void FishModelD3D12::init()
     // Bind textures, samplers and immutable constant buffers in a descriptor table.
     // Bind frequently updated constant buffers by root descriptors.
     CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
-    CD3DX12_ROOT_PARAMETER1 rootParameters[5];
+    CD3DX12_ROOT_PARAMETER1 rootParameters[6];
     CD3DX12_DESCRIPTOR_RANGE1 ranges[2];
     rootParameters[0] = mContextD3D12->rootParameterGeneral;
     rootParameters[1] = mContextD3D12->rootParameterWorld;
@@ -120,10 +123,23 @@ void FishModelD3D12::init()
         rootParameters[3].InitAsDescriptorTable(1, &ranges[1], D3D12_SHADER_VISIBILITY_PIXEL);
     }
 
-    rootParameters[4].InitAsConstantBufferView(0, 3, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
-                                               D3D12_SHADER_VISIBILITY_VERTEX);
+    // Padded fish data is bound per fish as a constant buffer view. Packed fish data is bound
+    // once per model as a structured buffer, and each draw passes the index of its fish.
+    UINT rootParameterCount = 5;
+    if (mContextD3D12->mPackFishPers)
+    {
+        rootParameters[4].InitAsShaderResourceView(0, 3, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE,
+                                                   D3D12_SHADER_VISIBILITY_VERTEX);
+        rootParameters[5].InitAsConstants(1, 1, 3, D3D12_SHADER_VISIBILITY_VERTEX);
+        rootParameterCount = 6;
+    }
+    else
+    {
+        rootParameters[4].InitAsConstantBufferView(
+            0, 3, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_VERTEX);
+    }
 
-    rootSignatureDesc.Init_1_1(_countof(rootParameters), rootParameters, 2u,
+    rootSignatureDesc.Init_1_1(rootParameterCount, rootParameters, 2u,
                                mContextD3D12->staticSamplers.data(),
                                D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
@@ -139,6 +155,29 @@ void FishModelD3D12::draw()
     if (mCurInstance == 0)
         return;
 
+    bind();
+
+    // The fish of each level of detail follow each other.
+    int fishPerIndex = mFishPerOffset;
+    for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+    {
+        int instanceCount = getLodInstanceCount(lod);
+        if (instanceCount == 0)
+        {
+            continue;
+        }
+
+        bindLod(lod);
+        int indexCount = getIndexCount(lod);
+        for (int i = 0; i < instanceCount; i++)
+        {
+            drawFish(fishPerIndex++, indexCount);
+        }
+    }
+}
+
+void FishModelD3D12::bind()
+{
     mContextD3D12->mCommandList->SetPipelineState(mPipelineState.Get());
     mContextD3D12->mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
@@ -151,16 +190,41 @@ void FishModelD3D12::draw()
 
     mContextD3D12->mCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     mContextD3D12->mCommandList->IASetVertexBuffers(0, 5, mVertexBufferView);
-    mContextD3D12->mCommandList->IASetIndexBuffer(&mIndicesBuffer->mIndexBufferView);
+    mContextD3D12->mCommandList->IASetIndexBuffer(&mIndicesBuffers[0]->mIndexBufferView);
 
-    for (int i = 0; i < mCurInstance; i++)
+    if (mContextD3D12->mPackFishPers)
+    {
+        mContextD3D12->mCommandList->SetGraphicsRootShaderResourceView(
+            4, mContextD3D12->mFishPersBufferView.BufferLocation);
+    }
+}
+
+// The meshes of all levels share the vertex buffers, only the indices change.
+void FishModelD3D12::bindLod(int lod)
+{
+    mContextD3D12->mCommandList->IASetIndexBuffer(&mIndicesBuffers[lod]->mIndexBufferView);
+}
+
+// Each fish has its own FishPer constant buffer view or, with packed fish data, its index into
+// the structured buffer.
+void FishModelD3D12::drawFish(int fishPerIndex, int indexCount)
+{
+    if (mContextD3D12->mPackFishPers)
+    {
+        mContextD3D12->mCommandList->SetGraphicsRoot32BitConstant(5, fishPerIndex, 0);
+    }
+    else
     {
         mContextD3D12->mCommandList->SetGraphicsRootConstantBufferView(
             4, mContextD3D12->mFishPersBufferView.BufferLocation +
-                   (mFishPerOffset + i) * mContextD3D12->mFishPersBufferView.SizeInBytes);
-        mContextD3D12->mCommandList->DrawIndexedInstanced(mIndicesBuffer->getTotalComponents(), 1,
-                                                          0, 0, 0);
+                   fishPerIndex * mContextD3D12->mFishPersBufferView.SizeInBytes);
     }
+    mContextD3D12->mCommandList->DrawIndexedInstanced(indexCount, 1, 0, 0, 0);
+}
+
+int FishModelD3D12::getIndexCount(int lod) const
+{
+    return mIndicesBuffers[lod]->getTotalComponents();
 }
 
 void FishModelD3D12::updatePerInstanceUniforms(const WorldUniforms &worldUniforms) {}
@@ -176,12 +240,14 @@ void FishModelD3D12::updateFishPerUniforms(float x,
                                            int index)
 {
     index += mFishPerOffset;
-    mContextD3D12->fishPers[index].worldPosition[0] = x;
-    mContextD3D12->fishPers[index].worldPosition[1] = y;
-    mContextD3D12->fishPers[index].worldPosition[2] = z;
-    mContextD3D12->fishPers[index].nextPosition[0]  = nextX;
-    mContextD3D12->fishPers[index].nextPosition[1]  = nextY;
-    mContextD3D12->fishPers[index].nextPosition[2]  = nextZ;
-    mContextD3D12->fishPers[index].scale            = scale;
-    mContextD3D12->fishPers[index].time             = time;
+    FishPerPacked &fishPer   = mContextD3D12->mPackFishPers ? mContextD3D12->packedFishPers[index]
+                                                            : mContextD3D12->fishPers[index];
+    fishPer.worldPosition[0] = x;
+    fishPer.worldPosition[1] = y;
+    fishPer.worldPosition[2] = z;
+    fishPer.nextPosition[0]  = nextX;
+    fishPer.nextPosition[1]  = nextY;
+    fishPer.nextPosition[2]  = nextZ;
+    fishPer.scale            = scale;
+    fishPer.time             = time;
 }
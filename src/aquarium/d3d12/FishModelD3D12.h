@@ -30,6 +30,10 @@ class FishModelD3D12 : public FishModel
 
     void init() override;
     void draw() override;
+    void bind() override;
+    void bindLod(int lod) override;
+    void drawFish(int fishPerIndex, int indexCount) override;
+    int getIndexCount(int lod) const override;
 
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
     void updateFishPerUniforms(float x,
@@ -66,7 +70,7 @@ class FishModelD3D12 : public FishModel
     BufferD3D12 *mTangentBuffer;
     BufferD3D12 *mBiNormalBuffer;
 
-    BufferD3D12 *mIndicesBuffer;
+    BufferD3D12 *mIndicesBuffers[FISH_LOD_COUNT];
 
   private:
     D3D12_CONSTANT_BUFFER_VIEW_DESC mLightFactorView;
@@ -8,12 +8,14 @@
 #include "BufferD3D12.h"
 #include "FishModelInstancedDrawD3D12.h"
 
+#include <cstddef>
+
 FishModelInstancedDrawD3D12::FishModelInstancedDrawD3D12(Context *context,
                                                          Aquarium *aquarium,
                                                          MODELGROUP type,
                                                          MODELNAME name,
                                                          bool blend)
-    : FishModel(type, name, blend, aquarium), instance(0)
+    : FishModel(type, name, blend, aquarium)
 {
     mContextD3D12 = static_cast<ContextD3D12 *>(context);
 
@@ -25,20 +27,15 @@ FishModelInstancedDrawD3D12::FishModelInstancedDrawD3D12(Context *context,
     mLightFactorUniforms.shininess      = 5.0f;
     mLightFactorUniforms.specularFactor = 0.3f;
 
-    instance = aquarium->fishCounts[fishInfo.modelName - MODELNAME::MODELSMALLFISHA];
-    mFishPers = new FishPer[instance];
+    mCurInstance = aquarium->fishCounts[fishInfo.modelName - MODELNAME::MODELSMALLFISHA];
+    mPreInstance = mCurInstance;
 }
 
-FishModelInstancedDrawD3D12::~FishModelInstancedDrawD3D12()
-{
-    delete mFishPers;
-}
+FishModelInstancedDrawD3D12::~FishModelInstancedDrawD3D12() {}
 
+// The pipeline is created even without fish, which can come later.
 void FishModelInstancedDrawD3D12::init()
 {
-    if (instance == 0)
-        return;
-
     mProgramD3D12 = static_cast<ProgramD3D12 *>(mProgram);
 
     mDiffuseTexture    = static_cast<TextureD3D12 *>(textureMap["diffuse"]);
@@ -51,7 +48,10 @@ void FishModelInstancedDrawD3D12::init()
     mTexCoordBuffer = static_cast<BufferD3D12 *>(bufferMap["texCoord"]);
     mTangentBuffer  = static_cast<BufferD3D12 *>(bufferMap["tangent"]);
     mBiNormalBuffer = static_cast<BufferD3D12 *>(bufferMap["binormal"]);
-    mIndicesBuffer  = static_cast<BufferD3D12 *>(bufferMap["indices"]);
+    for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+    {
+        mIndicesBuffers[lod] = static_cast<BufferD3D12 *>(getLodIndicesBuffer(lod));
+    }
 
     mVertexBufferView[0] = mPositionBuffer->mVertexBufferView;
     mVertexBufferView[1] = mNormalBuffer->mVertexBufferView;
@@ -59,16 +59,6 @@ void FishModelInstancedDrawD3D12::init()
     mVertexBufferView[3] = mTangentBuffer->mVertexBufferView;
     mVertexBufferView[4] = mBiNormalBuffer->mVertexBufferView;
 
-    mFishPersBuffer = mContextD3D12->createDefaultBuffer(
-        mFishPers, mContextD3D12->CalcConstantBufferByteSize(sizeof(FishPer) * instance),
-        mFishPersUploadBuffer);
-    mFishPersBufferView.BufferLocation = mFishPersBuffer->GetGPUVirtualAddress();
-    mFishPersBufferView.SizeInBytes =
-        mContextD3D12->CalcConstantBufferByteSize(sizeof(FishPer) * instance);
-    mFishPersBufferView.StrideInBytes = sizeof(FishPer);
-
-    mVertexBufferView[5] = mFishPersBufferView;
-
     mInputElementDescs = {
         {"TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
          D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
@@ -80,13 +70,13 @@ void FishModelInstancedDrawD3D12::init()
          D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
         {"TEXCOORD", 4, DXGI_FORMAT_R32G32B32_FLOAT, 4, 0,
          D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-        {"TEXCOORD", 5, DXGI_FORMAT_R32G32B32_FLOAT, 5, 0,
+        {"TEXCOORD", 5, DXGI_FORMAT_R32G32B32_FLOAT, 5, offsetof(FishPerPacked, worldPosition),
          D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1},
-        {"TEXCOORD", 6, DXGI_FORMAT_R32_FLOAT, 5, 3 * sizeof(float),
+        {"TEXCOORD", 6, DXGI_FORMAT_R32_FLOAT, 5, offsetof(FishPerPacked, scale),
          D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1},
-        {"TEXCOORD", 7, DXGI_FORMAT_R32G32B32_FLOAT, 5, 4 * sizeof(float),
+        {"TEXCOORD", 7, DXGI_FORMAT_R32G32B32_FLOAT, 5, offsetof(FishPerPacked, nextPosition),
          D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1},
-        {"TEXCOORD", 8, DXGI_FORMAT_R32_FLOAT, 5, 5 * sizeof(float),
+        {"TEXCOORD", 8, DXGI_FORMAT_R32_FLOAT, 5, offsetof(FishPerPacked, time),
          D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1},
     };
 
@@ -153,15 +143,9 @@ void FishModelInstancedDrawD3D12::init()
         mProgramD3D12->getFSModule(), mPipelineState, mBlend);
 }
 
-void FishModelInstancedDrawD3D12::prepareForDraw()
-{
-    mContextD3D12->updateConstantBufferSync(mFishPersBuffer, mFishPersUploadBuffer, mFishPers,
-                                            sizeof(FishPer) * instance);
-}
-
 void FishModelInstancedDrawD3D12::draw()
 {
-    if (instance == 0)
+    if (mCurInstance == 0)
         return;
 
     mContextD3D12->mCommandList->SetPipelineState(mPipelineState.Get());
@@ -174,12 +158,37 @@ void FishModelInstancedDrawD3D12::draw()
     mContextD3D12->mCommandList->SetGraphicsRootDescriptorTable(
         3, mDiffuseTexture->getTextureGPUHandle());
 
+    // The fish data buffer is replaced when it grows, so its view is taken at every draw. The
+    // instances of the species start at its fish data, the start instance offsets the
+    // per-instance fetches.
+    mVertexBufferView[5].BufferLocation = mContextD3D12->mFishPersBufferView.BufferLocation;
+    mVertexBufferView[5].SizeInBytes =
+        static_cast<UINT>(sizeof(FishPerPacked) * mContextD3D12->mFishPersCapacity);
+    mVertexBufferView[5].StrideInBytes = sizeof(FishPerPacked);
+
     mContextD3D12->mCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
     mContextD3D12->mCommandList->IASetVertexBuffers(0, 6, mVertexBufferView);
-    mContextD3D12->mCommandList->IASetIndexBuffer(&mIndicesBuffer->mIndexBufferView);
 
-    mContextD3D12->mCommandList->DrawIndexedInstanced(mIndicesBuffer->getTotalComponents(),
-                                                      instance, 0, 0, 0);
+    // One batch per level of detail, whose instances follow those of the level before.
+    int startInstance = mFishPerOffset;
+    for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+    {
+        int instanceCount = getLodInstanceCount(lod);
+        if (instanceCount == 0)
+        {
+            continue;
+        }
+
+        mContextD3D12->mCommandList->IASetIndexBuffer(&mIndicesBuffers[lod]->mIndexBufferView);
+        mContextD3D12->mCommandList->DrawIndexedInstanced(getIndexCount(lod), instanceCount, 0, 0,
+                                                          startInstance);
+        startInstance += instanceCount;
+    }
+}
+
+int FishModelInstancedDrawD3D12::getIndexCount(int lod) const
+{
+    return mIndicesBuffers[lod]->getTotalComponents();
 }
 
 void FishModelInstancedDrawD3D12::updatePerInstanceUniforms(const WorldUniforms &worldUniforms) {}
@@ -194,12 +203,13 @@ void FishModelInstancedDrawD3D12::updateFishPerUniforms(float x,
                                                         float time,
                                                         int index)
 {
-    mFishPers[index].worldPosition[0] = x;
-    mFishPers[index].worldPosition[1] = y;
-    mFishPers[index].worldPosition[2] = z;
-    mFishPers[index].nextPosition[0]  = nextX;
-    mFishPers[index].nextPosition[1]  = nextY;
-    mFishPers[index].nextPosition[2]  = nextZ;
-    mFishPers[index].scale            = scale;
-    mFishPers[index].time             = time;
+    FishPerPacked &fishPer   = mContextD3D12->packedFishPers[index + mFishPerOffset];
+    fishPer.worldPosition[0] = x;
+    fishPer.worldPosition[1] = y;
+    fishPer.worldPosition[2] = z;
+    fishPer.nextPosition[0]  = nextX;
+    fishPer.nextPosition[1]  = nextY;
+    fishPer.nextPosition[2]  = nextZ;
+    fishPer.scale            = scale;
+    fishPer.time             = time;
 }
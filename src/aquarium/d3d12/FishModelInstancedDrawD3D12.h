@@ -3,7 +3,9 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 //
-// FishModelD3D12InstancedDraw.h: Defnes fish model of D3D12
+// FishModelD3D12InstancedDraw.h: Defnes fish model of D3D12 that draws all fish of a species with
+// a single instanced draw. The per-instance data is the packed fish data of the context, bound as
+// a vertex buffer.
 
 #pragma once
 #ifndef FISHMODELD3D12INSTANCEDDRAW_H
@@ -29,8 +31,8 @@ class FishModelInstancedDrawD3D12 : public FishModel
     ~FishModelInstancedDrawD3D12();
 
     void init() override;
-    void prepareForDraw() override;
     void draw() override;
+    int getIndexCount(int lod) const override;
 
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
     void updateFishPerUniforms(float x,
@@ -56,15 +58,6 @@ class FishModelInstancedDrawD3D12 : public FishModel
         float specularFactor;
     } mLightFactorUniforms;
 
-    struct FishPer
-    {
-        float worldPosition[3];
-        float scale;
-        float nextPosition[3];
-        float time;
-    };
-    FishPer *mFishPers;
-
     TextureD3D12 *mDiffuseTexture;
     TextureD3D12 *mNormalTexture;
     TextureD3D12 *mReflectionTexture;
@@ -76,13 +69,9 @@ class FishModelInstancedDrawD3D12 : public FishModel
     BufferD3D12 *mTangentBuffer;
     BufferD3D12 *mBiNormalBuffer;
 
-    BufferD3D12 *mIndicesBuffer;
+    BufferD3D12 *mIndicesBuffers[FISH_LOD_COUNT];
 
   private:
-    D3D12_VERTEX_BUFFER_VIEW mFishPersBufferView;
-    ComPtr<ID3D12Resource> mFishPersBuffer;
-    ComPtr<ID3D12Resource> mFishPersUploadBuffer;
-
     D3D12_CONSTANT_BUFFER_VIEW_DESC mLightFactorView;
     D3D12_GPU_DESCRIPTOR_HANDLE mLightFactorGPUHandle;
     ComPtr<ID3D12Resource> mLightFactorBuffer;
@@ -99,8 +88,6 @@ class FishModelInstancedDrawD3D12 : public FishModel
     ComPtr<ID3D12RootSignature> mRootSignature;
     ComPtr<ID3D12PipelineState> mPipelineState;
 
-    int instance;
-
     ProgramD3D12 *mProgramD3D12;
     ContextD3D12 *mContextD3D12;
 };
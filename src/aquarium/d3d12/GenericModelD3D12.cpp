@@ -194,3 +194,16 @@ void GenericModelD3D12::updatePerInstanceUniforms(const WorldUniforms &worldUnif
 
     mInstance++;
 }
+
+WorldUniforms *GenericModelD3D12::mapWorldUniforms(int count)
+{
+    int capacity = sizeof(mWorldUniformPer) / sizeof(mWorldUniformPer.WorldUniforms[0]);
+    if (mInstance + count > capacity)
+    {
+        return nullptr;
+    }
+
+    WorldUniforms *worldUniforms = mWorldUniformPer.WorldUniforms + mInstance;
+    mInstance += count;
+    return worldUniforms;
+}
@@ -33,6 +33,7 @@ class GenericModelD3D12 : public Model
     void draw() override;
 
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
+    WorldUniforms *mapWorldUniforms(int count) override;
 
     TextureD3D12 *mDiffuseTexture;
     TextureD3D12 *mNormalTexture;
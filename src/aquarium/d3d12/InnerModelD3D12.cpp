@@ -136,3 +136,9 @@ void InnerModelD3D12::updatePerInstanceUniforms(const WorldUniforms &worldUnifor
 {
     memcpy(&mWorldUniformPer, &worldUniforms, sizeof(WorldUniforms));
 }
+
+// The model has room for a single instance.
+WorldUniforms *InnerModelD3D12::mapWorldUniforms(int count)
+{
+    return count == 1 ? &mWorldUniformPer : nullptr;
+}
@@ -29,6 +29,7 @@ class InnerModelD3D12 : public Model
     void prepareForDraw() override;
     void draw() override;
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
+    WorldUniforms *mapWorldUniforms(int count) override;
 
     struct InnerUniforms
     {
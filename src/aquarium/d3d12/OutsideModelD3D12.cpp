@@ -127,3 +127,9 @@ void OutsideModelD3D12::updatePerInstanceUniforms(const WorldUniforms &worldUnif
 {
     memcpy(&mWorldUniformPer, &worldUniforms, sizeof(WorldUniforms));
 }
+
+// The model has room for a single instance.
+WorldUniforms *OutsideModelD3D12::mapWorldUniforms(int count)
+{
+    return count == 1 ? &mWorldUniformPer : nullptr;
+}
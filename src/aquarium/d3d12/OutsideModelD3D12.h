@@ -32,6 +32,7 @@ class OutsideModelD3D12 : public Model
     void draw() override;
 
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
+    WorldUniforms *mapWorldUniforms(int count) override;
 
     TextureD3D12 *mDiffuseTexture;
     TextureD3D12 *mNormalTexture;
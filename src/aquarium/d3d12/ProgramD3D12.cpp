@@ -5,28 +5,56 @@
 //
 
 #include <cstring>
-#include <regex>
 
 #include "ContextD3D12.h"
 #include "ProgramD3D12.h"
 
+namespace {
+
+ComPtr<ID3DBlob> createBlob(const std::string &binary)
+{
+    ComPtr<ID3DBlob> blob;
+    if (FAILED(D3DCreateBlob(binary.size(), &blob)))
+    {
+        return nullptr;
+    }
+    memcpy(blob->GetBufferPointer(), binary.data(), binary.size());
+    return blob;
+}
+
+}  // namespace
+
 ProgramD3D12::ProgramD3D12(ContextD3D12 *context, const std::string &mVId, const std::string &mFId)
-    : Program(mVId, mFId), mVertexShader(nullptr), mPixelShader(nullptr), context(context)
+    : Program(context->getShaderCache(), mVId, mFId),
+      mVertexShader(nullptr),
+      mPixelShader(nullptr),
+      context(context)
 {
 }
 
 ProgramD3D12::~ProgramD3D12() {}
 
-void ProgramD3D12::compileProgram(bool enableBlending, const std::string& alpha)
+void ProgramD3D12::compileProgram(bool enableBlending, const std::string &alpha)
 {
-    loadProgram();
+    auto compiler = [this](const char *type) {
+        return [this, type](const std::string &code, std::string *binary) {
+            ComPtr<ID3DBlob> shader = context->createShaderModule(type, code);
+            if (shader == nullptr)
+            {
+                return false;
+            }
+            binary->assign(static_cast<const char *>(shader->GetBufferPointer()),
+                           shader->GetBufferSize());
+            return true;
+        };
+    };
 
-    if (enableBlending)
+    std::string vertexShader;
+    std::string pixelShader;
+    if (getShaders(enableBlending, alpha, compiler("VS"), compiler("PS"), &vertexShader,
+                   &pixelShader))
     {
-        FragmentShaderCode =
-            std::regex_replace(FragmentShaderCode, std::regex(R"(diffuseColor.w)"), alpha);
+        mVertexShader = createBlob(vertexShader);
+        mPixelShader  = createBlob(pixelShader);
     }
-
-    mVertexShader = context->createShaderModule("VS", VertexShaderCode);
-    mPixelShader  = context->createShaderModule("PS", FragmentShaderCode);
 }
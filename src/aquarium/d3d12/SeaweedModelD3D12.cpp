@@ -150,4 +150,20 @@ void SeaweedModelD3D12::updatePerInstanceUniforms(const WorldUniforms &worldUnif
     instance++;
 }
 
+WorldUniforms *SeaweedModelD3D12::mapWorldUniforms(int count)
+{
+    int capacity = sizeof(mWorldUniformPer) / sizeof(mWorldUniformPer.worldUniforms[0]);
+    if (instance + count > capacity)
+    {
+        return nullptr;
+    }
+
+    WorldUniforms *worldUniforms = mWorldUniformPer.worldUniforms + instance;
+    for (int i = 0; i < count; ++i, ++instance)
+    {
+        mSeaweedPer.seaweed[instance].time = mAquarium->g.mclock + instance;
+    }
+    return worldUniforms;
+}
+
 void SeaweedModelD3D12::updateSeaweedModelTime(float time) {}
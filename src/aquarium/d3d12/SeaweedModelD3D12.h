@@ -30,6 +30,7 @@ class SeaweedModelD3D12 : public SeaweedModel
     void draw() override;
 
     void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
+    WorldUniforms *mapWorldUniforms(int count) override;
 
     TextureD3D12 *mDiffuseTexture;
     TextureD3D12 *mNormalTexture;
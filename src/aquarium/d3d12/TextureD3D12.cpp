@@ -10,6 +10,25 @@
 #include "ContextD3D12.h"
 #include "TextureD3D12.h"
 
+namespace {
+
+DXGI_FORMAT getDXGIFormat(TEXTUREFORMAT format)
+{
+    switch (format)
+    {
+        case TEXTUREFORMATBC1:
+            return DXGI_FORMAT_BC1_UNORM;
+        case TEXTUREFORMATBC3:
+            return DXGI_FORMAT_BC3_UNORM;
+        case TEXTUREFORMATBC5:
+            return DXGI_FORMAT_BC5_UNORM;
+        default:
+            return DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+}
+
+}  // namespace
+
 TextureD3D12::~TextureD3D12() {}
 
 TextureD3D12::TextureD3D12(ContextD3D12 *context, const std::string &name, const std::string &url)
@@ -36,7 +55,13 @@ TextureD3D12::TextureD3D12(ContextD3D12 *context,
 
 void TextureD3D12::loadTexture()
 {
-    loadImage(mUrls, &mPixelVec);
+    if (!decode())
+    {
+        return;
+    }
+
+    finishMipChain();
+    mFormat = getDXGIFormat(mMipChain.getFormat());
 
     if (mTextureViewDimension == D3D12_SRV_DIMENSION_TEXTURECUBE)
     {
@@ -51,16 +76,12 @@ void TextureD3D12::loadTexture()
         textureDesc.SampleDesc.Quality  = 0;
         textureDesc.Dimension           = mTextureDimension;
 
-        mContext->createTexture(textureDesc, mPixelVec, mTexture, mTextureUploadHeap, mWidth,
-                                mHeight, 4u, textureDesc.MipLevels, textureDesc.DepthOrArraySize);
+        mContext->createTexture(textureDesc, mMipChain, mTexture, mTextureUploadHeap);
     }
     else
     {
-        generateMipmap(mPixelVec[0], mWidth, mHeight, 0, mResizedVec, mWidth, mHeight, 0, 4, false);
-
         D3D12_RESOURCE_DESC textureDesc = {};
-        textureDesc.MipLevels =
-            static_cast<uint16_t>(std::floor(std::log2(std::max(mWidth, mHeight)))) + 1;
+        textureDesc.MipLevels          = static_cast<uint16_t>(mMipChain.getLevelCount());
         textureDesc.Format             = mFormat;
         textureDesc.Width              = mWidth;
         textureDesc.Height             = mHeight;
@@ -70,9 +91,11 @@ void TextureD3D12::loadTexture()
         textureDesc.SampleDesc.Quality = 0;
         textureDesc.Dimension          = mTextureDimension;
 
-        mContext->createTexture(textureDesc, mResizedVec, mTexture, mTextureUploadHeap, mWidth,
-                                mHeight, 4u, textureDesc.MipLevels, textureDesc.DepthOrArraySize);
+        mContext->createTexture(textureDesc, mMipChain, mTexture, mTextureUploadHeap);
     }
+
+    // The upload heap holds a copy of the pixels until the copy to the texture has executed.
+    mMipChain.release();
 }
 
 // Allocate descriptors sequentially on deascriptor heap to bind root signature, create srv before
@@ -42,9 +42,6 @@ class TextureD3D12 : public Texture
     ComPtr<ID3D12Resource> mTextureUploadHeap;
     D3D12_SHADER_RESOURCE_VIEW_DESC mSrvDesc;
     D3D12_GPU_DESCRIPTOR_HANDLE mTextureGPUHandle;
-
-    std::vector<unsigned char *> mPixelVec;
-    std::vector<unsigned char *> mResizedVec;
     ContextD3D12 *mContext;
 };
 
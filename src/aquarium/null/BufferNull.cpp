@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "BufferNull.h"
+
+#include <cstring>
+
+#include "ContextNull.h"
+
+BufferNull::BufferNull(ContextNull *context,
+                       int totalCmoponents,
+                       int numComponents,
+                       const float *buffer,
+                       bool isIndex)
+    : mData(totalCmoponents * sizeof(float)),
+      mIsIndex(isIndex),
+      mTotoalComponents(totalCmoponents),
+      mNumComponents(numComponents)
+{
+    if (!mData.empty())
+    {
+        memcpy(mData.data(), buffer, mData.size());
+    }
+    context->recordUpload(mData.size());
+}
+
+BufferNull::BufferNull(ContextNull *context,
+                       int totalCmoponents,
+                       int numComponents,
+                       const unsigned short *buffer,
+                       bool isIndex)
+    : mData(totalCmoponents * sizeof(unsigned short)),
+      mIsIndex(isIndex),
+      mTotoalComponents(totalCmoponents),
+      mNumComponents(numComponents)
+{
+    if (!mData.empty())
+    {
+        memcpy(mData.data(), buffer, mData.size());
+    }
+    context->recordUpload(mData.size());
+}
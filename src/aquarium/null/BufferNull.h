@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// BufferNull.h: Defines the buffer wrapper of the null backend. Vertex and index data is kept in
+// host memory in place of a GPU buffer.
+
+#pragma once
+#ifndef BUFFERNULL_H
+#define BUFFERNULL_H 1
+
+#include <vector>
+
+#include "../Buffer.h"
+
+class ContextNull;
+
+class BufferNull : public Buffer
+{
+  public:
+    BufferNull(ContextNull *context,
+               int totalCmoponents,
+               int numComponents,
+               const float *buffer,
+               bool isIndex);
+    BufferNull(ContextNull *context,
+               int totalCmoponents,
+               int numComponents,
+               const unsigned short *buffer,
+               bool isIndex);
+
+    int getTotalComponents() const { return mTotoalComponents; }
+    int getNumComponents() const { return mNumComponents; }
+    bool getIsIndex() const { return mIsIndex; }
+    int getDataSize() const { return static_cast<int>(mData.size()); }
+
+  private:
+    std::vector<unsigned char> mData;
+    bool mIsIndex;
+    int mTotoalComponents;
+    int mNumComponents;
+};
+
+#endif  // !BUFFERNULL_H
@@ -0,0 +1,271 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "ContextNull.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "../Timer.h"
+#include "BufferNull.h"
+#include "FishModelNull.h"
+#include "GenericModelNull.h"
+#include "ProgramNull.h"
+#include "SeaweedModelNull.h"
+#include "TextureNull.h"
+
+namespace {
+
+// The D3D12 backend keeps up to 3 frames in flight: the one being recorded and the 2 submitted
+// before it, which complete 2 frames after they're submitted.
+constexpr uint64_t kFrameLatency = 2;
+
+}  // namespace
+
+ContextNull::ContextNull(BACKENDTYPE backendType)
+    : mPackFishPers(false),
+      mFence(kFrameLatency),
+      mBufferManager(&mFence),
+      mFrameCount(0), mDrawCount(0), mUploadedBytes(0), mLoadUploadedBytes(0)
+{
+    mClientWidth            = 1920;
+    mClientHeight           = 1080;
+    mPreTotalInstance       = 0;
+    mCurTotalInstance       = 0;
+    mDisableD3D12RenderPass = true;
+
+    mResourceHelper = new ResourceHelper("null", "", backendType);
+    initAvailableToggleBitset(backendType);
+}
+
+ContextNull::~ContextNull()
+{
+    delete mResourceHelper;
+}
+
+bool ContextNull::initialize(
+    BACKENDTYPE backend,
+    const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> &toggleBitset,
+    int windowWidth,
+    int windowHeight)
+{
+    // There is no window, so the control panel is never shown.
+    mDisableControlPanel = true;
+    // Instanced draws read packed fish data as per-instance vertex data.
+    mPackFishPers = toggleBitset.test(static_cast<size_t>(TOGGLE::PACKFISHPERS)) ||
+                    toggleBitset.test(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS));
+    mShaderCache.setConfiguration("null");
+
+    setWindowSize(windowWidth, windowHeight);
+    mResourceHelper->setRenderer("Null");
+
+    return true;
+}
+
+void ContextNull::setWindowTitle(const std::string &text) {}
+
+// Nothing is presented, so the aquarium requires a bound on the run with this backend.
+bool ContextNull::ShouldQuit()
+{
+    return false;
+}
+
+void ContextNull::KeyBoardQuit() {}
+
+void ContextNull::initAvailableToggleBitset(BACKENDTYPE backendType)
+{
+    // Nothing is presented, so these are accepted and ignored.
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEFULLSCREENMODE));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::TURNOFFVSYNC));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::PACKFISHPERS));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::RECORDCOMMANDS));
+    mAvailableToggleBitset.set(static_cast<size_t>(TOGGLE::ENABLEINSTANCEDDRAWS));
+}
+
+// Nothing is presented, the whole flush counts as submission.
+void ContextNull::DoFlush(const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> &toggleBitset)
+{
+    timer::Clock::time_point begin = timer::now();
+    ++mFrameCount;
+
+    mBufferManager.finishFrame(mFrameCount);
+    mFence.submit(mFrameCount);
+    mBufferManager.retireFrames();
+    mSubmitTime = timer::getMilliseconds(begin, timer::now());
+}
+
+// Everything recorded so far was uploaded during loading.
+void ContextNull::Flush()
+{
+    mLoadUploadedBytes = mUploadedBytes;
+    mUploadedBytes     = 0;
+    mDrawCount         = 0;
+}
+
+void ContextNull::Terminate()
+{
+    int frameCount = mFrameCount > 0 ? mFrameCount : 1;
+    printf("[RESULT] BACKEND:NULL,FRAMES:%d,DRAWS_PER_FRAME:%llu,UPLOAD_BYTES_PER_FRAME:%llu,"
+           "LOAD_UPLOAD_BYTES:%llu,RING_BUFFERS:%d,RING_BUFFER_BYTES:%llu,FISH_PER_STRIDE:%d\n",
+           mFrameCount, static_cast<unsigned long long>(mDrawCount / frameCount),
+           static_cast<unsigned long long>(mUploadedBytes / frameCount),
+           static_cast<unsigned long long>(mLoadUploadedBytes),
+           static_cast<int>(mBufferManager.getBufferCount()),
+           static_cast<unsigned long long>(mBufferManager.getUsedSize()),
+           static_cast<int>(mPackFishPers ? sizeof(FishPerPacked) : sizeof(FishPer)));
+}
+
+void ContextNull::showWindow() {}
+
+void ContextNull::updateFPS(const FPSTimer &fpsTimer,
+                            int *fishCount,
+                            std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> *toggleBitset)
+{
+}
+
+void ContextNull::destoryImgUI() {}
+
+void ContextNull::preFrame() {}
+
+Model *ContextNull::createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend)
+{
+    Model *model;
+    switch (type)
+    {
+        case MODELGROUP::FISH:
+        case MODELGROUP::FISHINSTANCEDDRAW:
+            model = new FishModelNull(this, aquarium, type, name, blend);
+            break;
+        case MODELGROUP::GENERIC:
+        case MODELGROUP::INNER:
+        case MODELGROUP::OUTSIDE:
+            model = new GenericModelNull(this, aquarium, type, name, blend);
+            break;
+        case MODELGROUP::SEAWEED:
+            model = new SeaweedModelNull(this, aquarium, type, name, blend);
+            break;
+        default:
+            model = nullptr;
+            std::cerr << "can not create model type" << std::endl;
+    }
+
+    return model;
+}
+
+Buffer *ContextNull::createBuffer(int numComponents, const float *buf, int size, bool isIndex)
+{
+    Buffer *buffer = new BufferNull(this, size, numComponents, buf, isIndex);
+    return buffer;
+}
+
+Buffer *ContextNull::createBuffer(int numComponents,
+                                  const unsigned short *buf,
+                                  int size,
+                                  bool isIndex)
+{
+    Buffer *buffer = new BufferNull(this, size, numComponents, buf, isIndex);
+    return buffer;
+}
+
+Program *ContextNull::createProgram(const std::string &mVId, const std::string &mFId)
+{
+    ProgramNull *program = new ProgramNull(this, mVId, mFId);
+
+    return program;
+}
+
+Texture *ContextNull::createTexture(const std::string &name, const std::string &url)
+{
+    Texture *texture = new TextureNull(this, name, url);
+    return texture;
+}
+
+Texture *ContextNull::createTexture(const std::string &name, const std::vector<std::string> &urls)
+{
+    Texture *texture = new TextureNull(this, name, urls);
+    return texture;
+}
+
+void ContextNull::initGeneralResources(Aquarium *aquarium)
+{
+    recordUpload(calcConstantBufferByteSize(sizeof(LightUniforms)));
+    recordUpload(calcConstantBufferByteSize(sizeof(FogUniforms)));
+    recordUpload(calcConstantBufferByteSize(sizeof(LightWorldPositionUniform)));
+
+    if (mPackFishPers)
+    {
+        mPackedFishPers.resize(aquarium->getCurFishCount());
+    }
+    else
+    {
+        mFishPers.resize(aquarium->getCurFishCount());
+    }
+
+    mPreTotalInstance = aquarium->getPreFishCount();
+    mCurTotalInstance = aquarium->getCurFishCount();
+}
+
+void ContextNull::updateWorldlUniforms(Aquarium *aquarium)
+{
+    recordUpload(calcConstantBufferByteSize(sizeof(LightWorldPositionUniform)));
+}
+
+void ContextNull::reallocResource(int preTotalInstance,
+                                  int curTotalInstance,
+                                  bool enableDynamicBufferOffset)
+{
+    mPreTotalInstance = preTotalInstance;
+    mCurTotalInstance = curTotalInstance;
+
+    int size = static_cast<int>(mPackFishPers ? mPackedFishPers.size() : mFishPers.size());
+    if (curTotalInstance > size)
+    {
+        int capacity = growFishCapacity(size, curTotalInstance);
+        if (mPackFishPers)
+        {
+            mPackedFishPers.resize(capacity);
+        }
+        else
+        {
+            mFishPers.resize(capacity);
+        }
+        // A GPU backend uploads the grown buffer once.
+        recordUpload(getFishPersByteSize(capacity));
+    }
+}
+
+size_t ContextNull::getFishPersByteSize(int fishCount) const
+{
+    return mPackFishPers ? sizeof(FishPerPacked) * fishCount
+                         : calcConstantBufferByteSize(sizeof(FishPer) * fishCount);
+}
+
+void ContextNull::updateAllFishData(int fishCount)
+{
+    if (fishCount == 0)
+    {
+        return;
+    }
+
+    size_t byteSize        = getFishPersByteSize(fishCount);
+    size_t offset          = 0;
+    RingBuffer *ringBuffer = mBufferManager.allocate(byteSize, &offset);
+    if (ringBuffer != nullptr)
+    {
+        if (mPackFishPers)
+        {
+            memcpy(ringBuffer->getData(offset), mPackedFishPers.data(),
+                   sizeof(FishPerPacked) * fishCount);
+        }
+        else
+        {
+            memcpy(ringBuffer->getData(offset), mFishPers.data(),
+                   sizeof(FishPer) * fishCount);
+        }
+    }
+    recordUpload(byteSize);
+}
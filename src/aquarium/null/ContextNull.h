@@ -0,0 +1,100 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ContextNull.h : Defines a headless backend without a graphics API. It does all the CPU work of
+// the other backends, loading assets and updating uniforms and fish data in host memory, but
+// skips GPU submission and only counts the draws and bytes it would have submitted. This allows
+// profiling the simulation and the loader on hosts without a GPU.
+
+#pragma once
+#ifndef CONTEXTNULL_H
+#define CONTEXTNULL_H 1
+
+#include <cstdint>
+#include <vector>
+
+#include "../BufferManager.h"
+#include "../Context.h"
+
+enum BACKENDTYPE : short;
+
+class ContextNull : public Context
+{
+  public:
+    ContextNull(BACKENDTYPE backendType);
+    ~ContextNull();
+    bool initialize(BACKENDTYPE backend,
+                    const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> &toggleBitset,
+                    int windowWidth,
+                    int windowHeight) override;
+    void setWindowTitle(const std::string &text) override;
+    bool ShouldQuit() override;
+    void KeyBoardQuit() override;
+    void DoFlush(const std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> &toggleBitset) override;
+    void Terminate() override;
+    void showWindow() override;
+    void updateFPS(const FPSTimer &fpsTimer,
+                   int *fishCount,
+                   std::bitset<static_cast<size_t>(TOGGLE::TOGGLEMAX)> *toggleBitset) override;
+    void destoryImgUI() override;
+
+    void Flush() override;
+    void preFrame() override;
+
+    Model *createModel(Aquarium *aquarium, MODELGROUP type, MODELNAME name, bool blend) override;
+    Buffer *createBuffer(int numComponents,
+                         const float *buffer,
+                         int size,
+                         bool isIndex) override;
+    Buffer *createBuffer(int numComponents,
+                         const unsigned short *buffer,
+                         int size,
+                         bool isIndex) override;
+
+    Program *createProgram(const std::string &mVId, const std::string &mFId) override;
+
+    Texture *createTexture(const std::string &name, const std::string &url) override;
+    Texture *createTexture(const std::string &name, const std::vector<std::string> &urls) override;
+
+    void initGeneralResources(Aquarium *aquarium) override;
+    void updateWorldlUniforms(Aquarium *aquarium) override;
+    void reallocResource(int preTotalInstance,
+                         int curTotalInstance,
+                         bool enableDynamicBufferOffset) override;
+    void updateAllFishData(int fishCount) override;
+    FishPer *getFishPers() override { return mFishPers.empty() ? nullptr : mFishPers.data(); }
+    FishPerPacked *getPackedFishPers() override
+    {
+        return mPackedFishPers.empty() ? nullptr : mPackedFishPers.data();
+    }
+
+    // Account for work that a GPU backend would have submitted.
+    void recordUpload(size_t byteSize) { mUploadedBytes += byteSize; }
+    void recordDraws(int drawCount) { mDrawCount += drawCount; }
+
+    // Same rounding as the constant buffers of the D3D12 backend.
+    static size_t calcConstantBufferByteSize(size_t byteSize) { return (byteSize + 255) & ~255; }
+
+  private:
+    void initAvailableToggleBitset(BACKENDTYPE backendType) override;
+    // Bytes of fish data uploaded for fishCount fish in the selected layout.
+    size_t getFishPersByteSize(int fishCount) const;
+
+    // Only the array of the layout selected by --pack-fish-pers is allocated.
+    bool mPackFishPers;
+    std::vector<FishPer> mFishPers;
+    std::vector<FishPerPacked> mPackedFishPers;
+    // Fish data is copied to host memory ring buffers like the D3D12 backend copies it to upload
+    // heaps, and frames retire as if a GPU ran behind.
+    CounterFence mFence;
+    BufferManager mBufferManager;
+
+    int mFrameCount;
+    uint64_t mDrawCount;
+    uint64_t mUploadedBytes;
+    uint64_t mLoadUploadedBytes;
+};
+
+#endif  // !CONTEXTNULL_H
@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishModelNull.cpp: Implements fish model of the null backend.
+
+#include "FishModelNull.h"
+
+FishModelNull::FishModelNull(Context *context,
+                             Aquarium *aquarium,
+                             MODELGROUP type,
+                             MODELNAME name,
+                             bool blend)
+    : FishModel(type, name, blend, aquarium),
+      mDiffuseTexture(nullptr),
+      mIndicesBuffers(),
+      mInstanced(type == MODELGROUP::FISHINSTANCEDDRAW)
+{
+    mContextNull = static_cast<ContextNull *>(context);
+
+    const Fish &fishInfo               = fishTable[getSpecies()];
+    mFishVertexUniforms.fishLength     = fishInfo.fishLength;
+    mFishVertexUniforms.fishBendAmount = fishInfo.fishBendAmount;
+    mFishVertexUniforms.fishWaveLength = fishInfo.fishWaveLength;
+
+    mLightFactorUniforms.shininess      = 5.0f;
+    mLightFactorUniforms.specularFactor = 0.3f;
+
+    mCurInstance = aquarium->fishCounts[fishInfo.modelName - MODELNAME::MODELSMALLFISHA];
+    mPreInstance = mCurInstance;
+}
+
+void FishModelNull::init()
+{
+    mDiffuseTexture = static_cast<TextureNull *>(textureMap["diffuse"]);
+    for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+    {
+        mIndicesBuffers[lod] = static_cast<BufferNull *>(getLodIndicesBuffer(lod));
+    }
+
+    mContextNull->recordUpload(ContextNull::calcConstantBufferByteSize(sizeof(FishVertexUniforms)));
+    mContextNull->recordUpload(
+        ContextNull::calcConstantBufferByteSize(sizeof(LightFactorUniforms)));
+}
+
+// Fish are drawn one by one, each with its own FishPer constant buffer view or, with packed fish
+// data, its index into the structured buffer. Instanced models draw all their fish of a level of
+// detail at once.
+void FishModelNull::draw()
+{
+    if (mCurInstance == 0)
+        return;
+
+    for (int lod = 0; lod < FISH_LOD_COUNT; ++lod)
+    {
+        int instanceCount = getLodInstanceCount(lod);
+        if (instanceCount > 0)
+        {
+            mContextNull->recordDraws(mInstanced ? 1 : instanceCount);
+        }
+    }
+}
+
+void FishModelNull::drawFish(int fishPerIndex, int indexCount)
+{
+    mContextNull->recordDraws(1);
+}
+
+int FishModelNull::getIndexCount(int lod) const
+{
+    return mIndicesBuffers[lod]->getTotalComponents();
+}
+
+void FishModelNull::updatePerInstanceUniforms(const WorldUniforms &worldUniforms) {}
+
+void FishModelNull::updateFishPerUniforms(float x,
+                                          float y,
+                                          float z,
+                                          float nextX,
+                                          float nextY,
+                                          float nextZ,
+                                          float scale,
+                                          float time,
+                                          int index)
+{
+    FishPerPacked *packedFishPers = mContextNull->getPackedFishPers();
+    FishPerPacked &fishPer        = packedFishPers != nullptr
+                                        ? packedFishPers[index + mFishPerOffset]
+                                        : mContextNull->getFishPers()[index + mFishPerOffset];
+    fishPer.worldPosition[0] = x;
+    fishPer.worldPosition[1] = y;
+    fishPer.worldPosition[2] = z;
+    fishPer.nextPosition[0]  = nextX;
+    fishPer.nextPosition[1]  = nextY;
+    fishPer.nextPosition[2]  = nextZ;
+    fishPer.scale            = scale;
+    fishPer.time             = time;
+}
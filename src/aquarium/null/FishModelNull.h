@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// FishModelNull.h: Defnes fish model of the null backend.
+
+#pragma once
+#ifndef FISHMODELNULL_H
+#define FISHMODELNULL_H 1
+
+#include "BufferNull.h"
+#include "ContextNull.h"
+#include "TextureNull.h"
+
+#include "../FishModel.h"
+
+class FishModelNull : public FishModel
+{
+  public:
+    FishModelNull(Context *context,
+                  Aquarium *aquarium,
+                  MODELGROUP type,
+                  MODELNAME name,
+                  bool blend);
+
+    void init() override;
+    void draw() override;
+    void drawFish(int fishPerIndex, int indexCount) override;
+    int getIndexCount(int lod) const override;
+
+    void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
+    void updateFishPerUniforms(float x,
+                               float y,
+                               float z,
+                               float nextX,
+                               float nextY,
+                               float nextZ,
+                               float scale,
+                               float time,
+                               int index) override;
+
+    struct FishVertexUniforms
+    {
+        float fishLength;
+        float fishWaveLength;
+        float fishBendAmount;
+    } mFishVertexUniforms;
+
+    struct LightFactorUniforms
+    {
+        float shininess;
+        float specularFactor;
+    } mLightFactorUniforms;
+
+    TextureNull *mDiffuseTexture;
+    BufferNull *mIndicesBuffers[FISH_LOD_COUNT];
+
+  private:
+    ContextNull *mContextNull;
+    // Whether all fish of the model are drawn with a single instanced draw.
+    bool mInstanced;
+};
+
+#endif  // !FISHMODELNULL_H
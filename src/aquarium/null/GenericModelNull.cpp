@@ -0,0 +1,63 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// GenericModelNull.cpp: Implements generic model of the null backend.
+
+#include "GenericModelNull.h"
+
+GenericModelNull::GenericModelNull(Context *context,
+                                   Aquarium *aquarium,
+                                   MODELGROUP type,
+                                   MODELNAME name,
+                                   bool blend)
+    : Model(type, name, blend), mDiffuseTexture(nullptr), mIndicesBuffer(nullptr), mInstance(0)
+{
+    mContextNull = static_cast<ContextNull *>(context);
+}
+
+void GenericModelNull::init()
+{
+    mDiffuseTexture = static_cast<TextureNull *>(textureMap["diffuse"]);
+    mIndicesBuffer  = static_cast<BufferNull *>(bufferMap["indices"]);
+}
+
+// Update constant buffer per frame. Only the instances placed this frame count as uploaded.
+void GenericModelNull::prepareForDraw()
+{
+    mContextNull->recordUpload(
+        ContextNull::calcConstantBufferByteSize(sizeof(WorldUniforms) * mInstance));
+}
+
+void GenericModelNull::draw()
+{
+    if (mInstance > 0)
+    {
+        mContextNull->recordDraws(1);
+    }
+
+    mInstance = 0;
+}
+
+void GenericModelNull::updatePerInstanceUniforms(const WorldUniforms &worldUniforms)
+{
+    if (mInstance < 20)
+    {
+        mWorldUniformPer.worldUniforms[mInstance] = worldUniforms;
+    }
+
+    mInstance++;
+}
+
+WorldUniforms *GenericModelNull::mapWorldUniforms(int count)
+{
+    if (mInstance + count > 20)
+    {
+        return nullptr;
+    }
+
+    WorldUniforms *worldUniforms = mWorldUniformPer.worldUniforms + mInstance;
+    mInstance += count;
+    return worldUniforms;
+}
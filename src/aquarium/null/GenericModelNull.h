@@ -0,0 +1,50 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// GenericModelNull.h: Defnes generic model of the null backend. Inner and outside models differ
+// from generic models only in their pipelines, so they share this model.
+
+#pragma once
+#ifndef GENERICMODELNULL_H
+#define GENERICMODELNULL_H 1
+
+#include "BufferNull.h"
+#include "ContextNull.h"
+#include "TextureNull.h"
+
+#include "../Model.h"
+
+class GenericModelNull : public Model
+{
+  public:
+    GenericModelNull(Context *context,
+                     Aquarium *aquarium,
+                     MODELGROUP type,
+                     MODELNAME name,
+                     bool blend);
+
+    void init() override;
+    void prepareForDraw() override;
+    void draw() override;
+
+    void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
+    WorldUniforms *mapWorldUniforms(int count) override;
+
+    TextureNull *mDiffuseTexture;
+    BufferNull *mIndicesBuffer;
+
+    struct WorldUniformPer
+    {
+        WorldUniforms worldUniforms[20];
+    };
+    WorldUniformPer mWorldUniformPer;
+
+  private:
+    ContextNull *mContextNull;
+
+    int mInstance;
+};
+
+#endif  // !GENERICMODELNULL_H
@@ -0,0 +1,32 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "ProgramNull.h"
+
+#include "ContextNull.h"
+
+ProgramNull::ProgramNull(ContextNull *context, const std::string &mVId, const std::string &mFId)
+    : Program(context->getShaderCache(), mVId, mFId), mContext(context)
+{
+}
+
+ProgramNull::~ProgramNull() {}
+
+void ProgramNull::compileProgram(bool enableBlending, const std::string &alpha)
+{
+    // There is no compiler, the code itself stands for the compiled shader.
+    ShaderCache::Compiler compiler = [](const std::string &code, std::string *binary) {
+        *binary = code;
+        return true;
+    };
+
+    std::string vertexShader;
+    std::string fragmentShader;
+    if (getShaders(enableBlending, alpha, compiler, compiler, &vertexShader, &fragmentShader))
+    {
+        mContext->recordUpload(vertexShader.size() + fragmentShader.size());
+    }
+}
@@ -0,0 +1,31 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// ProgramNull.h: Defines Program wrapper of the null backend. Shaders are loaded, patched and
+// cached like on the other backends, but never compiled.
+
+#pragma once
+#ifndef PROGRAMNULL_H
+#define PROGRAMNULL_H 1
+
+#include <string>
+
+#include "../Program.h"
+
+class ContextNull;
+
+class ProgramNull : public Program
+{
+  public:
+    ProgramNull(ContextNull *context, const std::string &mVId, const std::string &mFId);
+    ~ProgramNull() override;
+
+    void compileProgram(bool enableAlphaBlending, const std::string &alpha) override;
+
+  private:
+    ContextNull *mContext;
+};
+
+#endif  // !PROGRAMNULL_H
@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// SeaweedModelNull.cpp: Implements seaweed model of the null backend.
+
+#include "SeaweedModelNull.h"
+
+SeaweedModelNull::SeaweedModelNull(Context *context,
+                                   Aquarium *aquarium,
+                                   MODELGROUP type,
+                                   MODELNAME name,
+                                   bool blend)
+    : SeaweedModel(type, name, blend),
+      mDiffuseTexture(nullptr),
+      mIndicesBuffer(nullptr),
+      mAquarium(aquarium),
+      instance(0)
+{
+    mContextNull = static_cast<ContextNull *>(context);
+}
+
+void SeaweedModelNull::init()
+{
+    mDiffuseTexture = static_cast<TextureNull *>(textureMap["diffuse"]);
+    mIndicesBuffer  = static_cast<BufferNull *>(bufferMap["indices"]);
+}
+
+// Only the instances placed this frame count as uploaded.
+void SeaweedModelNull::prepareForDraw()
+{
+    mContextNull->recordUpload(
+        ContextNull::calcConstantBufferByteSize(sizeof(WorldUniforms) * instance));
+    mContextNull->recordUpload(ContextNull::calcConstantBufferByteSize(sizeof(Seaweed) * instance));
+}
+
+void SeaweedModelNull::draw()
+{
+    if (instance > 0)
+    {
+        mContextNull->recordDraws(1);
+    }
+
+    instance = 0;
+}
+
+void SeaweedModelNull::updatePerInstanceUniforms(const WorldUniforms &worldUniforms)
+{
+    if (instance < 20)
+    {
+        mWorldUniformPer.worldUniforms[instance] = worldUniforms;
+        mSeaweedPer.seaweed[instance].time       = mAquarium->g.mclock + instance;
+    }
+
+    instance++;
+}
+
+WorldUniforms *SeaweedModelNull::mapWorldUniforms(int count)
+{
+    if (instance + count > 20)
+    {
+        return nullptr;
+    }
+
+    WorldUniforms *worldUniforms = mWorldUniformPer.worldUniforms + instance;
+    for (int i = 0; i < count; ++i, ++instance)
+    {
+        mSeaweedPer.seaweed[instance].time = mAquarium->g.mclock + instance;
+    }
+    return worldUniforms;
+}
+
+void SeaweedModelNull::updateSeaweedModelTime(float time) {}
@@ -0,0 +1,61 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// SeaweedModelNull.h: Defnes seaweed model of the null backend.
+
+#pragma once
+#ifndef SEAWEEDMODELNULL_H
+#define SEAWEEDMODELNULL_H 1
+
+#include "BufferNull.h"
+#include "ContextNull.h"
+#include "TextureNull.h"
+
+#include "../SeaweedModel.h"
+
+class SeaweedModelNull : public SeaweedModel
+{
+  public:
+    SeaweedModelNull(Context *context,
+                     Aquarium *aquarium,
+                     MODELGROUP type,
+                     MODELNAME name,
+                     bool blend);
+
+    void init() override;
+    void prepareForDraw() override;
+    void draw() override;
+
+    void updatePerInstanceUniforms(const WorldUniforms &worldUniforms) override;
+    WorldUniforms *mapWorldUniforms(int count) override;
+    void updateSeaweedModelTime(float time) override;
+
+    TextureNull *mDiffuseTexture;
+    BufferNull *mIndicesBuffer;
+
+    struct Seaweed
+    {
+        float time;
+        float padding[3];
+    };
+    struct SeaweedPer
+    {
+        Seaweed seaweed[20];
+    } mSeaweedPer;
+
+    struct WorldUniformPer
+    {
+        WorldUniforms worldUniforms[20];
+    };
+    WorldUniformPer mWorldUniformPer;
+
+  private:
+    ContextNull *mContextNull;
+    Aquarium *mAquarium;
+
+    int instance;
+};
+
+#endif  // !SEAWEEDMODELNULL_H
@@ -0,0 +1,39 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+
+#include "TextureNull.h"
+
+#include "ContextNull.h"
+
+TextureNull::~TextureNull() {}
+
+TextureNull::TextureNull(ContextNull *context, const std::string &name, const std::string &url)
+    : Texture(name, url, true), mMipLevels(1), mFormat(TEXTUREFORMATRGBA8), mContext(context)
+{
+}
+
+TextureNull::TextureNull(ContextNull *context,
+                         const std::string &name,
+                         const std::vector<std::string> &urls)
+    : Texture(name, urls, false), mMipLevels(1), mFormat(TEXTUREFORMATRGBA8), mContext(context)
+{
+}
+
+void TextureNull::loadTexture()
+{
+    if (!decode())
+    {
+        return;
+    }
+
+    finishMipChain();
+    mMipLevels = mMipChain.getLevelCount();
+    mFormat    = mMipChain.getFormat();
+    mContext->recordUpload(mMipChain.getSize());
+
+    // Nothing reads the pixels after they would have been uploaded.
+    mMipChain.release();
+}
@@ -0,0 +1,39 @@
+//
+// Copyright (c) 2020 The Aquarium Project Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// TextureNull.h: Wrap textures of the null backend. Images are decoded, mipmapped and compressed
+// like on the other backends, then released instead of uploaded.
+
+#pragma once
+#ifndef TEXTURENULL_H
+#define TEXTURENULL_H 1
+
+#include <vector>
+
+#include "../Texture.h"
+
+class ContextNull;
+
+class TextureNull : public Texture
+{
+  public:
+    ~TextureNull() override;
+    TextureNull(ContextNull *context, const std::string &name, const std::string &url);
+    TextureNull(ContextNull *context,
+                const std::string &name,
+                const std::vector<std::string> &urls);
+
+    void loadTexture() override;
+    bool isCubeMap() const { return mIsCubeMap; }
+    int getMipLevels() const { return mMipLevels; }
+    TEXTUREFORMAT getFormat() const { return mFormat; }
+
+  private:
+    int mMipLevels;
+    TEXTUREFORMAT mFormat;
+    ContextNull *mContext;
+};
+
+#endif  // !TEXTURENULL_H